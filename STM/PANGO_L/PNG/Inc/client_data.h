@@ -10,6 +10,12 @@
 #ifndef INC_CLIENT_DATA_H_
 #define INC_CLIENT_DATA_H_
 
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Define types ------------------------------------------------------------ */
+#define MAC_ADDRESS_LENGTH      6 			/**< Length of a MAC address array. */
+
 /**
   * @brief Structure definition for storing client data with specific packing.
   */
@@ -17,7 +23,7 @@
 struct pango_client_data
 {
     uint8_t status;         		/**< A flag indicating if the application has started or ended. */
-    uint8_t mac_address[6]; 		/**< MAC address storage. */
+    uint8_t mac_address[MAC_ADDRESS_LENGTH];/**< MAC address storage. */
     uint8_t x_coor;          		/**< X-coordinate. */
     uint8_t y_coor;          		/**< Y-coordinate. */
 };
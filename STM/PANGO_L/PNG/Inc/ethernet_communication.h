@@ -15,13 +15,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "main.h"
+#include "client_data.h"
 
 /* Handler types ------------------------------------------------------------*/
 extern ETH_HandleTypeDef 	  heth;			/**< External ETH handler for Ethernet communication */
 
 /* Define types ------------------------------------------------------------ */
 #define ETH_HANDLER  		  &heth			/**< Macro for extracting the controllers 'MAC address' */
-#define MAC_ADDRESS_LENGTH      6 			/**< Length of a MAC address array. */
 
 /**
  * @brief Retrieves the MAC address from the Ethernet controller and stores it in an array.
@@ -0,0 +1,131 @@
+/**
+  ******************************************************************************
+  * @file    pango_port.h
+  * @brief   Header file for the port layer, the peripherals the PNG core uses.
+  *
+  * 		 The core (png_core.c, pango_functions.c, random_number_generator.c)
+  * 		 calls no HAL function, only these. They are implemented on the Nucleo
+  * 		 board by Src/pango_port_stm32.c with the HAL, and on a workstation by
+  * 		 Linux/pango_port_linux.c with a pty and /dev/urandom, see Makefile.
+  *
+  * 		 The transmits that return at once, the _start ones, are those of the
+  * 		 event driven mode, see png_core_set_mode: DMA on the board.
+  * @author  Vlad Kulikov
+  * @date    19.10.2026
+  ******************************************************************************
+  */
+
+#ifndef INC_PANGO_PORT_H_
+#define INC_PANGO_PORT_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/**
+ * @brief Status returned by the port functions.
+ */
+typedef enum
+{
+	PORT_OK = 0,						/**< The peripheral did what was asked */
+	PORT_ERROR = 1						/**< The peripheral failed */
+} port_status;
+
+/**
+ * @brief Transmits a buffer to the BBB controller, blocks until it is sent.
+ *
+ * @param data The bytes to transmit.
+ * @param size Number of bytes.
+ * @return PORT_OK on success, PORT_ERROR otherwise.
+ */
+port_status port_uart_transmit(const uint8_t *data, uint16_t size);
+
+/**
+ * @brief Starts the transmit of a buffer to the BBB controller, returns at once.
+ *
+ * The buffer is read until the port calls png_core_transmit_done, from the
+ * transmit complete interrupt on the board. One transmit at a time.
+ *
+ * @param data The bytes to transmit, left untouched until the transmit is done.
+ * @param size Number of bytes.
+ * @return PORT_OK if the transmit started, PORT_ERROR otherwise.
+ */
+port_status port_uart_transmit_start(const uint8_t *data, uint16_t size);
+
+/**
+ * @brief Starts the transmit of text of the log, returns at once.
+ *
+ * The port calls png_log_transmit_done when it is sent, see png_log.h.
+ *
+ * @param data The text, left untouched until the transmit is done.
+ * @param size Number of bytes.
+ * @return PORT_OK if the transmit started, PORT_ERROR otherwise.
+ */
+port_status port_log_transmit_start(const uint8_t *data, uint16_t size);
+
+/**
+ * @brief Sleeps until an interrupt, unless png_core_pending has work already.
+ *
+ * The check and the sleep are one step for the interrupts, so an event that
+ * comes between them still wakes the core.
+ */
+void port_wait_for_event(void);
+
+/**
+ * @brief Turns the interrupts off, for state the main loop shares with them.
+ *
+ * @return The state to give back to port_critical_exit.
+ */
+uint32_t port_critical_enter(void);
+
+/**
+ * @brief Turns the interrupts back on, if port_critical_enter turned them off.
+ *
+ * @param state What port_critical_enter returned.
+ */
+void port_critical_exit(uint32_t state);
+
+/**
+ * @brief Arms the receive of the next status byte from the BBB controller.
+ *
+ * Returns at once. When the byte is stored in 'status' the port calls
+ * png_core_status_received, from the receive interrupt on the board.
+ *
+ * @param status Where the byte is stored.
+ * @return PORT_OK on success, PORT_ERROR otherwise.
+ */
+port_status port_uart_receive_status(uint8_t *status);
+
+/**
+ * @brief Generates a random 32-bit unsigned integer.
+ *
+ * @param number Pointer to store the number.
+ * @return PORT_OK on success, PORT_ERROR otherwise.
+ */
+port_status port_random(uint32_t *number);
+
+/**
+ * @brief Gets the MAC address of the controller, the unique ID of the unit.
+ *
+ * @param mac_address Array of MAC_ADDRESS_LENGTH bytes to store it in.
+ * @return PORT_OK on success, PORT_ERROR otherwise.
+ */
+port_status port_mac_address(uint8_t *mac_address);
+
+/**
+ * @brief Milliseconds since the start, wraps around after 49 days.
+ *
+ * @return The milliseconds.
+ */
+uint32_t port_millis(void);
+
+/**
+ * @brief Restarts the controller, does not return.
+ */
+void port_system_reset(void);
+
+/**
+ * @brief Stops on an error the controller can't recover from, does not return.
+ */
+void port_error_handler(void);
+
+#endif /* INC_PANGO_PORT_H_ */
@@ -0,0 +1,174 @@
+/**
+  ******************************************************************************
+  * @file    png_core.h
+  * @brief   Header file for the core of the PNG module, the exchange with the
+  * 		 BBB controller without the HAL.
+  *
+  * 		 The BBB sends a status byte, ON or OFF, the core answers it with the
+  * 		 event of the unit in a frame, see uart_frame.h. A RESTART restarts
+  * 		 the controller, a STREAM_START or STREAM_STOP starts or stops the
+  * 		 streaming of the track, see png_stream.h. Every fifth unknown status the core reports a
+  * 		 HARDWARE_ERROR and stops. The peripherals are reached through
+  * 		 pango_port.h only, so the same core runs on the board and on Linux.
+  *
+  * 		 In the polling mode the main loop calls png_core_run_once over and
+  * 		 over and every frame waits for the UART. In the event driven mode a
+  * 		 frame is handed to the DMA, the loop sleeps in port_wait_for_event
+  * 		 between the interrupts and printf goes to the log of png_log.h.
+  * @author  Vlad Kulikov
+  * @date    19.10.2026
+  ******************************************************************************
+  */
+
+#ifndef INC_PNG_CORE_H_
+#define INC_PNG_CORE_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "client_data.h"
+#include "pango_port.h"					/**< Include that enables the use of the peripherals */
+#include "random_number_generator.h"	/**< Include that enables the random coordinates */
+#include "png_stream.h"					/**< Include that enables the streaming of the track */
+#include "png_log.h"					/**< Include that enables the deferred log */
+#include "../../../../common/crc8/crc8.h"	/**< Include that enables the CRC-8 shared with the BBB and the server */
+#include "../../../../common/uart_frame/uart_frame.h"	/**< Include that enables the framing of the data sent to the BBB */
+
+/**
+ * @brief Enumeration representing the restart flag states.
+ *
+ * This enumeration defines two states: ON and OFF, representing logical states.
+ */
+typedef enum
+{
+	ON = 1,								/**< Represents the logical state 'ON' of the client*/
+	OFF = 2,							/**< Represents the logical state 'OFF' of the client*/
+	RESTART = 3,						/**< Restarting the STM Controller because of BBB problem */
+	HARDWARE_ERROR = 255				/**< Problem with the STM hardware */
+} restart_flag;
+
+/**
+ * @brief How the core waits for the UART, see png_core_set_mode.
+ */
+typedef enum
+{
+	PNG_CORE_POLLING = 0,				/**< Blocking transmits, the main loop spins */
+	PNG_CORE_EVENT_DRIVEN = 1			/**< Transmits with completion callbacks, the main loop sleeps */
+} png_core_mode;
+
+/**
+ * @brief Macro definitions for functions.c file.
+ */
+#define BUFFER_SIZE_TO_SEND    	  10	 		/**< Size of the buffer used for data transmission to the BBB */
+#define WRONG_STATUS_LIMIT		5			/**< Every that many unknown status values the STM reports a HARDWARE_ERROR */
+#define RESTART_NUCLEO_BOARD    4			/**< Value that restarts the controller, is send from the BBB in case of a CRC-8 checksum fail */
+#define AMOUNT_OF_DATA_MINUS_ONE_ITERATION                 					 8 					/**< Represents the amount of data minus one in a loop iteration for packing */
+#define PLACE_FOR_CRC8_VALUE                				(uint8_t)(BUFFER_SIZE_TO_SEND - 1) 	/**< Index indicating the position in the buffer where the CRC-8 value is stored */
+#define AMOUNT_OF_DATA_FOR_CRC8_CHECKSUM_VALUE              (uint8_t)(BUFFER_SIZE_TO_SEND - 1) 	/**< Amount of data used for CRC-8 checksum calculation */
+#define PNG_FRAME_SIZE						UART_FRAME_SIZE(BUFFER_SIZE_TO_SEND)	/**< Size of the frame the event is sent in */
+
+/* Set by png_core_status_received when a known status is received */
+extern volatile uint8_t interrupt_flag;
+
+/* A struct that will hold the received data from the BBB controller */
+extern struct pango_client_data pango_client_data;
+
+/**
+ * @brief Sets how the core waits for the UART, is kept over png_core_init.
+ *
+ * @param mode PNG_CORE_POLLING, the default, or PNG_CORE_EVENT_DRIVEN.
+ */
+void png_core_set_mode(png_core_mode mode);
+
+/**
+ * @brief Starts the core: gets the MAC address and arms the receive of the first status.
+ *
+ * Is called again after a restart, so it sets every state the core has.
+ */
+void png_core_init(void);
+
+/**
+ * @brief Handles a status byte stored by the port in pango_client_data.status.
+ *
+ * Runs in the receive interrupt on the board, so it only sets interrupt_flag
+ * for png_core_run_once, or arms the receive again for an unknown status.
+ */
+void png_core_status_received(void);
+
+/**
+ * @brief Ends the transmit of port_uart_transmit_start.
+ *
+ * Runs in the transmit complete or error interrupt on the board. A failed
+ * transmit restarts the controller from png_core_run_once, as a failed
+ * blocking one does.
+ *
+ * @param status PORT_OK if the frame was sent, PORT_ERROR otherwise.
+ */
+void png_core_transmit_done(port_status status);
+
+/**
+ * @brief Tells if an interrupt left work for png_core_run_once.
+ *
+ * port_wait_for_event doesn't sleep while it is so.
+ *
+ * @return 1 if there is work, 0 otherwise.
+ */
+int png_core_pending(void);
+
+/**
+ * @brief Tells if every status received is answered and its frame sent.
+ *
+ * @return 1 if so, 0 while a status or a transmit is pending.
+ */
+int png_core_idle(void);
+
+/**
+ * @brief Answers the received status, if there is one, and sends the track.
+ *
+ * Is called in the main loop: when interrupt_flag is set it restarts on a
+ * RESTART, starts or stops the streaming, or sends the event, and arms the
+ * receive of the next status. While streaming it takes the samples that are
+ * due and sends the full batches. In the event driven mode one frame is in
+ * flight at a time, the rest waits for the next call after it is sent.
+ *
+ * @return 1 if a status was handled or a batch sent, 0 otherwise.
+ */
+int png_core_run_once(void);
+
+/**
+ * @brief Milliseconds until png_core_run_once has a sample to take.
+ *
+ * @return The milliseconds, 0 if one is due, -1 when not streaming.
+ */
+int32_t png_core_wait_ms(void);
+
+/**
+ * @brief Builds the frame of the event in pango_client_data with new coordinates.
+ *
+ * @param send_frame Room for PNG_FRAME_SIZE bytes (output parameter).
+ * @return Size of the frame.
+ */
+uint16_t png_core_build_frame(uint8_t send_frame[PNG_FRAME_SIZE]);
+
+/**
+ * @brief Packs data from a pango_client_data structure into a buffer for transmission.
+ *
+ * This function prepares a buffer with specific data from the pango_client_data structure,
+ * arranging it for transmission with a provision for a CRC8 checksum.
+ *
+ * @param client_data Pointer to the pango_client_data structure containing data to be packed.
+ * @param buffer_to_send Array to store the packed data along with space for CRC8 checksum.
+ *
+ * The structure of the packed buffer is as follows:
+ * - Element 0: Status value from the pango_client_data structure.
+ * - Elements 1 to 6: MAC address (MAC[0] to MAC[5]) from the pango_client_data structure.
+ * - Element 7: X-coordinate (x_coor) from the pango_client_data structure.
+ * - Element 8: Y-coordinate (y_coor) from the pango_client_data structure.
+ * - Element 9: Reserved for CRC8 checksum.
+ *
+ * The function ensures correct positioning of the structure's data within the buffer.
+ */
+void pack_pango_buffer(struct pango_client_data *client_data, uint8_t buffer_to_send[AMOUNT_OF_DATA_FOR_CRC8_CHECKSUM_VALUE]);
+
+#endif /* INC_PNG_CORE_H_ */
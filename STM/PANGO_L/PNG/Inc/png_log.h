@@ -0,0 +1,80 @@
+/**
+  ******************************************************************************
+  * @file    png_log.h
+  * @brief   Header file for the deferred log of the PNG module.
+  *
+  * 		 In the event driven mode, see png_core_set_mode, printf doesn't wait
+  * 		 for USER_UART: _write copies the text into a ring and returns, from
+  * 		 an interrupt too. The main loop drains the ring when it has nothing
+  * 		 else to do, one transmit of the port at a time, and the port tells
+  * 		 png_log_transmit_done when it is sent. Text that finds the ring full
+  * 		 is dropped and counted, the log never holds up the core.
+  *
+  * 		 The size is set at compile time, e.g. -DPNG_LOG_RING_SIZE=512.
+  * @author  Vlad Kulikov
+  * @date    19.10.2026
+  ******************************************************************************
+  */
+
+#ifndef INC_PNG_LOG_H_
+#define INC_PNG_LOG_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Define types ------------------------------------------------------------ */
+#ifndef PNG_LOG_RING_SIZE
+#define PNG_LOG_RING_SIZE			1024		/**< Bytes of text the ring holds, a power of two */
+#endif
+
+_Static_assert((PNG_LOG_RING_SIZE & (PNG_LOG_RING_SIZE - 1)) == 0, "PNG_LOG_RING_SIZE must be a power of two");
+
+/**
+ * @brief The state of the log.
+ */
+struct png_log
+{
+	char ring[PNG_LOG_RING_SIZE];		/**< The text not sent yet */
+	uint32_t head;						/**< Bytes put in so far */
+	uint32_t tail;						/**< Bytes sent so far */
+	uint32_t dropped;					/**< Bytes the full ring lost */
+	uint16_t in_flight;					/**< Bytes the port is sending, 0 when it is idle */
+};
+
+extern struct png_log png_log;
+
+/**
+ * @brief Empties the log.
+ */
+void png_log_init(void);
+
+/**
+ * @brief Copies text into the ring, what doesn't fit is dropped.
+ *
+ * Doesn't wait, so it is what _write calls, from the main loop and from
+ * the interrupts.
+ *
+ * @param data The text.
+ * @param len Number of bytes.
+ * @return 'len', as the text is taken whether or not it fits.
+ */
+int png_log_write(const char *data, int len);
+
+/**
+ * @brief Starts the transmit of the text in the ring, if the port is idle.
+ *
+ * @return 1 if a transmit was started, 0 otherwise.
+ */
+int png_log_drain(void);
+
+/**
+ * @brief Frees the text the port sent, called by the port when the transmit ends.
+ */
+void png_log_transmit_done(void);
+
+/**
+ * @brief Forgets the transmit the port gave up, its text is sent again by png_log_drain.
+ */
+void png_log_abort(void);
+
+#endif /* INC_PNG_LOG_H_ */
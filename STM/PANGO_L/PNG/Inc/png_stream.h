@@ -0,0 +1,155 @@
+/**
+  ******************************************************************************
+  * @file    png_stream.h
+  * @brief   Header file for the streaming of the track of the unit.
+  *
+  * 		 After a STREAM_START from the BBB the position is sampled every
+  * 		 period_ms into a ring, and every PNG_STREAM_BATCH samples are sent
+  * 		 in one frame, a TRACK batch, until a STREAM_STOP sends the rest.
+  * 		 The first sample of a batch is whole, the others are the moves from
+  * 		 the one before, a signed nibble per axis in one byte:
+  * 		  _______________________________________________________________
+  * 		 | TRACK | MAC | seq | count | x0 | y0 | dx dy ... | crc8      |
+  * 		 |   1   |  6  |  1  |   1   |  1 |  1 | count - 1 |   1       |
+  * 		 |_______|_____|_____|_______|____|____|___________|___________|
+  * 		 seq counts the batches, so a lost one is seen, the CRC-8 covers
+  * 		 the bytes before it as in the event. A batch of 16 samples is a
+  * 		 30 byte frame, where an event frame is 13 bytes for one sample.
+  *
+  * 		 The sizes are set at compile time, e.g. -DPNG_STREAM_BATCH=8.
+  * @author  Vlad Kulikov
+  * @date    19.10.2026
+  ******************************************************************************
+  */
+
+#ifndef INC_PNG_STREAM_H_
+#define INC_PNG_STREAM_H_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+#include "client_data.h"
+#include "../../../../common/uart_frame/uart_frame.h"
+
+/* Define types ------------------------------------------------------------ */
+#ifndef PNG_STREAM_RING_SIZE
+#define PNG_STREAM_RING_SIZE		64			/**< Samples the ring holds, a power of two */
+#endif
+#ifndef PNG_STREAM_BATCH
+#define PNG_STREAM_BATCH			16			/**< Samples sent in one frame */
+#endif
+#ifndef PNG_STREAM_SAMPLE_MS
+#define PNG_STREAM_SAMPLE_MS		100			/**< Default period of the samples in milliseconds */
+#endif
+#define PNG_STREAM_COORDINATE_MAX	127			/**< Coordinates are 0 to 127, as get_coordinates gives them */
+#define PNG_STREAM_WALK_STEP		3			/**< Largest move of the track per sample on each axis */
+#define PNG_STREAM_MAX_STEP			7			/**< Largest move a signed nibble holds */
+#define PNG_STREAM_HEADER_SIZE		11			/**< TRACK, MAC, seq, count, x0 and y0 */
+#define PNG_STREAM_PAYLOAD_SIZE(count)	(PNG_STREAM_HEADER_SIZE + (count) - 1 + 1)	/**< Size of a batch of 'count' samples */
+#define PNG_STREAM_MAX_DECODE		(UART_FRAME_MAX_PAYLOAD - PNG_STREAM_HEADER_SIZE)	/**< Most samples a frame holds, whatever the batch of the sender */
+
+_Static_assert((PNG_STREAM_RING_SIZE & (PNG_STREAM_RING_SIZE - 1)) == 0, "PNG_STREAM_RING_SIZE must be a power of two");
+_Static_assert(PNG_STREAM_BATCH >= 1 && PNG_STREAM_BATCH <= PNG_STREAM_RING_SIZE, "PNG_STREAM_BATCH must fit in the ring");
+_Static_assert(PNG_STREAM_PAYLOAD_SIZE(PNG_STREAM_BATCH) <= UART_FRAME_MAX_PAYLOAD, "PNG_STREAM_BATCH must fit in a frame");
+_Static_assert(PNG_STREAM_WALK_STEP <= PNG_STREAM_MAX_STEP, "PNG_STREAM_WALK_STEP must fit in a nibble");
+
+/**
+ * @brief Status values of the streaming, after the ones of restart_flag.
+ */
+typedef enum
+{
+	STREAM_START = 9,					/**< From the BBB: sample the track and send it */
+	STREAM_STOP = 10,					/**< From the BBB: send the samples left and stop */
+	TRACK = 11							/**< To the BBB: the first byte of a batch */
+} stream_flag;
+
+/**
+ * @brief A position of the track.
+ */
+struct png_sample
+{
+	uint8_t x;							/**< X-coordinate. */
+	uint8_t y;							/**< Y-coordinate. */
+};
+
+/**
+ * @brief The state of the streaming.
+ */
+struct png_stream
+{
+	struct png_sample ring[PNG_STREAM_RING_SIZE];	/**< The samples not sent yet */
+	uint32_t head;						/**< Samples put in so far */
+	uint32_t tail;						/**< Samples sent so far */
+	uint32_t dropped;					/**< Samples the full ring lost */
+	uint32_t period_ms;					/**< Period of the samples */
+	uint32_t next_sample_ms;			/**< port_millis of the next sample */
+	struct png_sample position;			/**< The position of the unit on its track */
+	uint8_t active;						/**< ON while streaming, OFF otherwise */
+	uint8_t seq;						/**< Number of the next batch */
+};
+
+extern struct png_stream png_stream;
+
+/**
+ * @brief Stops the streaming and empties the ring, the period is kept.
+ */
+void png_stream_init(void);
+
+/**
+ * @brief Stops the streaming, the samples not sent are dropped.
+ */
+void png_stream_stop(void);
+
+/**
+ * @brief Sets the period of the samples.
+ *
+ * @param period_ms Period in milliseconds, at least 1.
+ */
+void png_stream_set_period(uint32_t period_ms);
+
+/**
+ * @brief Starts the track at a random position, the first sample is taken at once.
+ *
+ * @param now_ms The time of port_millis.
+ */
+void png_stream_start(uint32_t now_ms);
+
+/**
+ * @brief Takes the samples that are due, the ring keeps the newest when it is full.
+ *
+ * @param now_ms The time of port_millis.
+ * @return Number of samples taken.
+ */
+uint32_t png_stream_sample(uint32_t now_ms);
+
+/**
+ * @brief Milliseconds until the next sample is due.
+ *
+ * @param now_ms The time of port_millis.
+ * @return The milliseconds, 0 if it is due, -1 when not streaming.
+ */
+int32_t png_stream_wait_ms(uint32_t now_ms);
+
+/**
+ * @brief Takes a batch out of the ring.
+ *
+ * @param mac_address The MAC address of the unit.
+ * @param min_count The batch is built only if at least that many samples are buffered, 1 to PNG_STREAM_BATCH.
+ * @param payload Room for PNG_STREAM_PAYLOAD_SIZE(PNG_STREAM_BATCH) bytes (output parameter).
+ * @return Size of the batch, 0 if fewer than min_count samples are buffered.
+ */
+uint8_t png_stream_build_batch(const uint8_t *mac_address, uint32_t min_count, uint8_t *payload);
+
+/**
+ * @brief Reads a batch back into its samples, as the receiver does.
+ *
+ * @param payload The batch.
+ * @param length Size of the batch.
+ * @param mac_address Room for MAC_ADDRESS_LENGTH bytes (output parameter).
+ * @param seq Pointer to store the number of the batch (output parameter).
+ * @param samples Room for PNG_STREAM_MAX_DECODE samples (output parameter).
+ * @return Number of samples, 0 if the batch is not valid.
+ */
+uint8_t png_stream_decode(const uint8_t *payload, uint8_t length, uint8_t *mac_address, uint8_t *seq, struct png_sample *samples);
+
+#endif /* INC_PNG_STREAM_H_ */
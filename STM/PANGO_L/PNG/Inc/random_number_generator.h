@@ -1,7 +1,8 @@
 /**
   ******************************************************************************
   * @file    random_number_generator.h
-  * @brief   Header file for generating random numbers using the RNG peripheral.
+  * @brief   Header file for generating random numbers using the RNG peripheral,
+  * 		 through port_random.
   * @author  Vlad Kulikov
   * @date    23.12.2023
   ******************************************************************************
@@ -13,15 +14,8 @@
 /* Includes ------------------------------------------------------------------ */
 #include <stdio.h>
 #include <stdlib.h>
-#include "main.h"
 #include "client_data.h"
 
-/* Handler types ------------------------------------------------------------*/
-extern RNG_HandleTypeDef 	hrng;		/**< External RNG handler for generating random numbers */
-
-/* Define types ------------------------------------------------------------ */
-#define RNG_PANGO 			&hrng		/**< Macro for generating random numbers in the get_coordinates function*/
-
 /**
  * @brief Generates random coordinates and assigns them to a pango_client_data structure.
  *
@@ -38,14 +32,14 @@ void get_coordinates(struct pango_client_data *client_data);
 /**
  * @brief Generates a random 32-bit unsigned integer and restricts it to the range [0, 127].
  *
- * This function utilizes the Hardware Abstraction Layer (HAL) to generate a random number
- * using the hardware Random Number Generator (RNG). The generated number is then
+ * This function utilizes port_random to generate a random number, with the hardware
+ * Random Number Generator (RNG) on the board. The generated number is then
  * reduced to fit within the range [0, 127].
  *
  * @param insert_num Pointer to a variable to store the generated random number.
  *
  * The function handles errors in the RNG generation by printing an error message
- * and entering an infinite loop if the HAL_RNG_GenerateRandomNumber operation fails.
+ * and entering port_error_handler if the port_random operation fails.
  * The final random number is stored at the address pointed to by insert_num.
  */
 void rand_uint128(uint32_t *ins_num);
@@ -18,7 +18,6 @@ extern UART_HandleTypeDef 		huart4;			/**< External UART handler for general pur
 /* Define types ------------------------------------------------------------ */
 #define USER_UART 				&huart3			/**< Macro for debugging and clarify when the program starts */
 #define UART_4 					&huart4			/**< Macro for receiving and transmitting data from the BBB controller */
-#define BUFFER_SIZE_TO_SEND    	  10	 		/**< Size of the buffer used for data transmission via UART_4 */
 #define SMALL_DELAY				 1000			/**< Represents the amount of time there is a transmission delay in milliseconds, this value can be changed */
 
 #endif /* INC_UART_COMMUNICATION_H_ */
@@ -0,0 +1,113 @@
+/**
+  ******************************************************************************
+  * @file    main_linux.c
+  * @brief   Source file, runs the core of png_core.c on Linux.
+  *
+  * 		 Usage: png_host [--uart PATH] [--mac XX:XX:XX:XX:XX:XX] [--stream PERIOD_MS] [--event]
+  * 		 Without --uart a pty is made, the BBB opens its printed slave, e.g.
+  * 		 ./bbb_pango_client_host --server 127.0.0.1 --uart /dev/pts/3
+  * 		 --stream streams the track from the start, as after a STREAM_START,
+  * 		 with a sample every PERIOD_MS. --event runs the event driven mode
+  * 		 of png_core_set_mode, with the main loop of the board for it.
+  * @author  Vlad Kulikov
+  * @date    19.10.2026
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "pango_port_linux.h"
+
+/* Counts the restarts, is kept over the jumps of port_system_reset */
+static volatile unsigned long restarts;
+
+int main(int argc, char *argv[])
+{
+	const char *uart_path = NULL;
+	int stream = 0;
+	int event = 0;
+	int arg = 1;
+
+	if(argc > arg + 1 && strcmp(argv[arg], "--uart") == 0)
+	{
+		uart_path = argv[arg + 1];
+		arg += 2;
+	}
+	if(argc > arg + 1 && strcmp(argv[arg], "--mac") == 0)
+	{
+		if(port_linux_set_mac(argv[arg + 1]) == -1)
+		{
+			return 1;
+		}
+		arg += 2;
+	}
+	if(argc > arg + 1 && strcmp(argv[arg], "--stream") == 0)
+	{
+		png_stream_set_period((uint32_t)atoi(argv[arg + 1]));
+		stream = 1;
+		arg += 2;
+	}
+	if(argc > arg && strcmp(argv[arg], "--event") == 0)
+	{
+		event = 1;
+		++arg;
+	}
+	if(arg != argc)
+	{
+		fprintf(stderr, "Usage: %s [--uart PATH] [--mac XX:XX:XX:XX:XX:XX] [--stream PERIOD_MS] [--event]\n", argv[0]);
+		return 1;
+	}
+	if(port_linux_uart_open(uart_path) == -1)
+	{
+		return 1;
+	}
+	if(event)
+	{
+		/* printf goes through the log, as _write does on the board */
+		if(port_linux_log_redirect(1) == -1)
+		{
+			return 1;
+		}
+		png_core_set_mode(PNG_CORE_EVENT_DRIVEN);
+	}
+
+	printf("Start of the program\n");
+	/* port_system_reset comes back here, as the board comes back to main */
+	if(setjmp(port_linux_reset_point) != 0)
+	{
+		++restarts;
+		printf("Restart %lu\n", restarts);
+	}
+	png_core_init();
+	if(stream)
+	{
+		png_stream_start(port_millis());
+	}
+
+	while(1)
+	{
+		/* Answers the BBB when a status was received, sends the track */
+		png_core_run_once();
+		if(event)
+		{
+			/* The main loop of main_PNG: the log, then until the next interrupt */
+			png_log_drain();
+			port_wait_for_event();
+			if(port_linux_uart_closed())
+			{
+				break;
+			}
+		}
+		/* Until the status or the next sample */
+		else if(port_linux_poll(png_core_wait_ms()) == -1)
+		{
+			break;
+		}
+	}
+	printf("UART_4 closed\n");
+	/* What the log still holds */
+	while(event && (png_log_drain() || png_log.in_flight != 0))
+	{
+		port_linux_poll(-1);
+	}
+	return 0;
+}
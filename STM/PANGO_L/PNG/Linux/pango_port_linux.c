@@ -0,0 +1,540 @@
+/**
+  ******************************************************************************
+  * @file    pango_port_linux.c
+  * @brief   Source file for the port layer on Linux.
+  * @author  Vlad Kulikov
+  * @date    19.10.2026
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "pango_port_linux.h"
+
+jmp_buf port_linux_reset_point;
+
+struct port_linux_blocked port_linux_blocked;
+
+/* The file descriptor of UART_4, and the slave of its pty kept open, so reads
+ * of the master don't fail while the BBB reopens the slave */
+static int uart_fd = -1;
+static int uart_slave_fd = -1;
+
+/* The status byte the core armed the receive of, NULL when none is armed */
+static uint8_t *armed_status;
+
+/* The transmit of port_uart_transmit_start left to write, NULL when none */
+static const uint8_t *tx_data;
+static size_t tx_left;
+
+/* The stdout there was before port_linux_log_redirect, and the transmit of
+ * port_log_transmit_start left to write to it */
+static int log_fd = -1;
+static FILE *log_stream;
+static int log_deferred;
+static const uint8_t *log_data;
+static size_t log_left;
+
+/* Set by port_wait_for_event when port_linux_poll failed */
+static int uart_closed;
+
+static uint8_t mac[MAC_ADDRESS_LENGTH];
+static int mac_set;
+
+/* The bytes of /dev/urandom not handed out yet */
+static uint8_t random_bytes[PORT_LINUX_RANDOM_SIZE];
+static size_t random_left;
+static int random_fd = -1;
+
+/**
+ * @brief Nanoseconds of the monotonic clock.
+ */
+static uint64_t port_linux_now_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief Writes a buffer whole, waiting for the descriptor when it is full, and counts the wait.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int port_linux_write_blocking(int fd, const uint8_t *data, size_t size)
+{
+	struct pollfd pfd = {.fd = fd, .events = POLLOUT};
+	uint64_t begin = port_linux_now_ns();
+	size_t sent = 0;
+
+	while(sent < size)
+	{
+		ssize_t bytes = write(fd, data + sent, size - sent);
+
+		if(bytes == -1)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			if(errno == EAGAIN && poll(&pfd, 1, -1) != -1)
+			{
+				continue;
+			}
+			return -1;
+		}
+		sent += (size_t)bytes;
+	}
+	++port_linux_blocked.calls;
+	port_linux_blocked.bytes += size;
+	port_linux_blocked.ns += port_linux_now_ns() - begin;
+	return 0;
+}
+
+/**
+ * @brief Makes UART_4 non-blocking, so the transmits of port_linux_poll never wait.
+ */
+static void port_linux_uart_nonblock(int fd)
+{
+	int flags = fcntl(fd, F_GETFL);
+
+	if(flags != -1)
+	{
+		fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+	}
+}
+
+/**
+ * @brief Opens UART_4: the tty at 'path', or a new pty when 'path' is NULL.
+ *
+ * The slave of a new pty is printed, the BBB opens it with --uart.
+ *
+ * @param path Path of the tty, or NULL.
+ * @return 0 on success, -1 on error.
+ */
+int port_linux_uart_open(const char *path)
+{
+	char slave_path[PORT_LINUX_PATH_SIZE];
+	struct termios options;
+	int fd;
+
+	if(path != NULL)
+	{
+		if((fd = open(path, O_RDWR | O_NOCTTY)) == -1)
+		{
+			fprintf(stderr, "Unable to open %s - %s\n", path, strerror(errno));
+			return -1;
+		}
+		if(tcgetattr(fd, &options) == 0)
+		{
+			cfmakeraw(&options);
+			tcsetattr(fd, TCSANOW, &options);
+		}
+		port_linux_uart_nonblock(fd);
+		uart_fd = fd;
+		return 0;
+	}
+
+	if((fd = posix_openpt(O_RDWR | O_NOCTTY)) == -1 || grantpt(fd) == -1 ||
+		unlockpt(fd) == -1 || ptsname_r(fd, slave_path, sizeof(slave_path)) != 0)
+	{
+		perror("posix_openpt");
+		return -1;
+	}
+	if((uart_slave_fd = open(slave_path, O_RDWR | O_NOCTTY)) == -1)
+	{
+		fprintf(stderr, "Unable to open %s - %s\n", slave_path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	/* Raw from the start, before the BBB sets it up: no byte of a frame is translated */
+	tcgetattr(uart_slave_fd, &options);
+	cfmakeraw(&options);
+	tcsetattr(uart_slave_fd, TCSANOW, &options);
+	port_linux_uart_nonblock(fd);
+	uart_fd = fd;
+	printf("UART_4 is %s\n", slave_path);
+	fflush(stdout);
+	return 0;
+}
+
+/**
+ * @brief Uses an open file descriptor as UART_4.
+ *
+ * @param fd The file descriptor.
+ */
+void port_linux_uart_set_fd(int fd)
+{
+	port_linux_uart_nonblock(fd);
+	uart_fd = fd;
+	uart_closed = 0;
+}
+
+/**
+ * @brief Sets the MAC address port_mac_address gives.
+ *
+ * @param text The address as "XX:XX:XX:XX:XX:XX".
+ * @return 0 on success, -1 if the address can't be parsed.
+ */
+int port_linux_set_mac(const char *text)
+{
+	unsigned int byte[MAC_ADDRESS_LENGTH];
+	char end;
+
+	if(sscanf(text, "%x:%x:%x:%x:%x:%x%c", &byte[0], &byte[1], &byte[2], &byte[3], &byte[4], &byte[5], &end) != MAC_ADDRESS_LENGTH)
+	{
+		fprintf(stderr, "Bad MAC address %s\n", text);
+		return -1;
+	}
+	for(int i = 0; i < MAC_ADDRESS_LENGTH; ++i)
+	{
+		if(byte[i] > 0xFF)
+		{
+			fprintf(stderr, "Bad MAC address %s\n", text);
+			return -1;
+		}
+		mac[i] = (uint8_t)byte[i];
+	}
+	mac_set = 1;
+	return 0;
+}
+
+/**
+ * @brief Writes to the log what its stdout takes, for port_linux_log_redirect.
+ */
+static ssize_t port_linux_log_cookie_write(void *cookie, const char *data, size_t size)
+{
+	(void)cookie;
+	if(log_deferred)
+	{
+		return png_log_write(data, (int)size);
+	}
+	/* The _write of Tools.c in the polling mode: printf waits for USER_UART */
+	return (port_linux_write_blocking(log_fd, (const uint8_t *)data, size) == 0) ? (ssize_t)size : -1;
+}
+
+/**
+ * @brief Sends stdout through the log, as _write of Tools.c does on the board.
+ *
+ * @param deferred 1 for the event driven mode, 0 for the polling one.
+ * @return 0 on success, -1 on error.
+ */
+int port_linux_log_redirect(int deferred)
+{
+	cookie_io_functions_t functions = {.write = port_linux_log_cookie_write};
+	FILE *log;
+
+	fflush(stdout);
+	if(log_fd == -1 && (log_fd = dup(fileno(stdout))) == -1)
+	{
+		perror("dup");
+		return -1;
+	}
+	if((log = fopencookie(NULL, "w", functions)) == NULL)
+	{
+		perror("fopencookie");
+		return -1;
+	}
+	/* A line at a time, as the board sends it */
+	setvbuf(log, NULL, _IOLBF, 0);
+	if(log_stream != NULL)
+	{
+		fclose(log_stream);
+	}
+	log_stream = log;
+	log_deferred = deferred;
+	stdout = log;
+	return 0;
+}
+
+/**
+ * @brief Writes what the descriptor takes of a transmit in flight, as the DMA does.
+ *
+ * @return 1 when the transmit is out, 0 while bytes are left, -1 on error.
+ */
+static int port_linux_write_some(int fd, const uint8_t **data, size_t *left, size_t most)
+{
+	ssize_t bytes = write(fd, *data, (*left < most) ? *left : most);
+
+	if(bytes == -1)
+	{
+		return (errno == EINTR || errno == EAGAIN) ? 0 : -1;
+	}
+	*data += bytes;
+	*left -= (size_t)bytes;
+	return (*left == 0) ? 1 : 0;
+}
+
+/**
+ * @brief Waits for the armed status byte or the end of a transmit, and hands them to the core.
+ *
+ * @param timeout_ms Time to wait in milliseconds, -1 for no limit.
+ * @return 1 if a byte was handed over or a transmit ended, 0 if nothing came or nothing is awaited,
+ * 		   -1 when UART_4 is closed or fails.
+ */
+int port_linux_poll(int timeout_ms)
+{
+	struct pollfd pfd[2] = {{.fd = uart_fd}, {.fd = log_fd}};
+	uint8_t *status = armed_status;
+	int handled = 0;
+	ssize_t bytes;
+	int ready, done;
+
+	if(status != NULL)
+	{
+		pfd[0].events |= POLLIN;
+	}
+	if(tx_data != NULL)
+	{
+		pfd[0].events |= POLLOUT;
+	}
+	if(log_data != NULL)
+	{
+		pfd[1].events = POLLOUT;
+	}
+	if(pfd[0].events == 0 && pfd[1].events == 0)
+	{
+		return 0;
+	}
+	ready = poll(pfd, (pfd[1].events != 0) ? 2 : 1, timeout_ms);
+	if(ready == -1)
+	{
+		return (errno == EINTR) ? 0 : -1;
+	}
+	if(ready == 0)
+	{
+		return 0;
+	}
+
+	/* The transmit complete interrupt of USER_UART */
+	if(pfd[1].revents != 0)
+	{
+		done = port_linux_write_some(log_fd, &log_data, &log_left, PORT_LINUX_LOG_CHUNK);
+		if(done != 0)
+		{
+			/* A log that can't be written is dropped, as the board can't report it either */
+			log_data = NULL;
+			log_left = 0;
+			png_log_transmit_done();
+			handled = 1;
+		}
+	}
+
+	/* The transmit complete, or error, interrupt of UART_4 */
+	if(tx_data != NULL && (pfd[0].revents & (POLLOUT | POLLERR | POLLHUP)) != 0)
+	{
+		done = port_linux_write_some(uart_fd, &tx_data, &tx_left, tx_left);
+		if(done != 0)
+		{
+			tx_data = NULL;
+			tx_left = 0;
+			png_core_transmit_done((done == 1) ? PORT_OK : PORT_ERROR);
+			handled = 1;
+		}
+	}
+
+	/* The receive interrupt of UART_4 */
+	if(status == NULL || (pfd[0].revents & (POLLIN | POLLERR | POLLHUP)) == 0)
+	{
+		return handled;
+	}
+	bytes = read(uart_fd, status, sizeof(*status));
+	if(bytes == -1 && (errno == EINTR || errno == EAGAIN))
+	{
+		return handled;
+	}
+	if(bytes != sizeof(*status))
+	{
+		/* EOF, or the other end of a socket closed */
+		return -1;
+	}
+	/* The receive is armed once, as HAL_UART_Receive_IT is */
+	armed_status = NULL;
+	png_core_status_received();
+	return 1;
+}
+
+/**
+ * @brief Tells if port_wait_for_event found UART_4 closed.
+ *
+ * @return 1 if so, 0 otherwise.
+ */
+int port_linux_uart_closed(void)
+{
+	return uart_closed;
+}
+
+/**
+ * @brief Cycles the board would have spent in the transmits of port_linux_blocked.
+ *
+ * @return The cycles.
+ */
+uint64_t port_linux_blocked_cycles(void)
+{
+	return (uint64_t)port_linux_blocked.bytes * 10 * PORT_LINUX_BOARD_HZ / PORT_LINUX_BOARD_BAUD;
+}
+
+/**
+ * @brief Transmits a buffer to the BBB controller, blocks until it is sent.
+ */
+port_status port_uart_transmit(const uint8_t *data, uint16_t size)
+{
+	return (port_linux_write_blocking(uart_fd, data, size) == 0) ? PORT_OK : PORT_ERROR;
+}
+
+/**
+ * @brief Starts the transmit of a buffer to the BBB controller, port_linux_poll writes it.
+ */
+port_status port_uart_transmit_start(const uint8_t *data, uint16_t size)
+{
+	if(uart_fd == -1 || tx_data != NULL || size == 0)
+	{
+		return PORT_ERROR;
+	}
+	tx_data = data;
+	tx_left = size;
+	return PORT_OK;
+}
+
+/**
+ * @brief Starts the transmit of text of the log, port_linux_poll writes it.
+ */
+port_status port_log_transmit_start(const uint8_t *data, uint16_t size)
+{
+	if(log_fd == -1 || log_data != NULL || size == 0)
+	{
+		return PORT_ERROR;
+	}
+	log_data = data;
+	log_left = size;
+	return PORT_OK;
+}
+
+/**
+ * @brief Waits in port_linux_poll until the status, a transmit or the next sample.
+ */
+void port_wait_for_event(void)
+{
+	if(port_linux_poll(png_core_pending() ? 0 : png_core_wait_ms()) == -1)
+	{
+		uart_closed = 1;
+	}
+}
+
+/**
+ * @brief Nothing to turn off, the interrupts of port_linux_poll run in the main loop.
+ */
+uint32_t port_critical_enter(void)
+{
+	return 0;
+}
+
+/**
+ * @brief Nothing to turn back on, see port_critical_enter.
+ */
+void port_critical_exit(uint32_t state)
+{
+	(void)state;
+}
+
+/**
+ * @brief Arms the receive of the next status byte, port_linux_poll reads it.
+ */
+port_status port_uart_receive_status(uint8_t *status)
+{
+	if(uart_fd == -1)
+	{
+		return PORT_ERROR;
+	}
+	armed_status = status;
+	return PORT_OK;
+}
+
+/**
+ * @brief Generates a random number from /dev/urandom.
+ */
+port_status port_random(uint32_t *number)
+{
+	if(random_left < sizeof(*number))
+	{
+		size_t filled = 0;
+
+		if(random_fd == -1 && (random_fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC)) == -1)
+		{
+			return PORT_ERROR;
+		}
+		while(filled < sizeof(random_bytes))
+		{
+			ssize_t bytes = read(random_fd, random_bytes + filled, sizeof(random_bytes) - filled);
+
+			if(bytes <= 0)
+			{
+				if(bytes == -1 && errno == EINTR)
+				{
+					continue;
+				}
+				return PORT_ERROR;
+			}
+			filled += (size_t)bytes;
+		}
+		random_left = sizeof(random_bytes);
+	}
+	random_left -= sizeof(*number);
+	memcpy(number, &random_bytes[random_left], sizeof(*number));
+	return PORT_OK;
+}
+
+/**
+ * @brief Gives the MAC address of port_linux_set_mac, PORT_LINUX_DEFAULT_MAC otherwise.
+ */
+port_status port_mac_address(uint8_t *mac_address)
+{
+	if(!mac_set && port_linux_set_mac(PORT_LINUX_DEFAULT_MAC) == -1)
+	{
+		return PORT_ERROR;
+	}
+	memcpy(mac_address, mac, MAC_ADDRESS_LENGTH);
+	return PORT_OK;
+}
+
+/**
+ * @brief Milliseconds of the monotonic clock.
+ */
+uint32_t port_millis(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint32_t)((uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000);
+}
+
+/**
+ * @brief Restarts: drops the input not read yet and the transmits in flight, and jumps back to port_linux_reset_point.
+ */
+void port_system_reset(void)
+{
+	armed_status = NULL;
+	/* The DMA stops with the controller, the log sends its text again */
+	tx_data = NULL;
+	tx_left = 0;
+	if(log_data != NULL)
+	{
+		log_data = NULL;
+		log_left = 0;
+		png_log_abort();
+	}
+	if(isatty(uart_fd))
+	{
+		tcflush(uart_fd, TCIFLUSH);
+	}
+	longjmp(port_linux_reset_point, 1);
+}
+
+/**
+ * @brief Exits, the board would loop in Error_Handler until it is reset by hand.
+ */
+void port_error_handler(void)
+{
+	fprintf(stderr, "Error_Handler: the STM stopped\n");
+	exit(1);
+}
@@ -0,0 +1,129 @@
+/**
+  ******************************************************************************
+  * @file    pango_port_linux.h
+  * @brief   Header file for the port layer on Linux, the core of the PNG module
+  * 		 on a workstation.
+  *
+  * 		 - UART_4 is a file descriptor: a new pty whose slave is given to the
+  * 		   BBB, a tty given by its path, or any descriptor, see png_bench.c.
+  * 		 - The RNG is /dev/urandom, read PORT_LINUX_RANDOM_SIZE bytes at once.
+  * 		 - The MAC address is given, PORT_LINUX_DEFAULT_MAC otherwise.
+  * 		 - A restart jumps back to port_linux_reset_point, with the input
+  * 		   that wasn't read dropped, as the board drops it.
+  * 		 - The error handler exits.
+  *
+  * 		 The interrupts are port_linux_poll: the main loop calls it to read
+  * 		 the armed status byte, and it calls png_core_status_received. The
+  * 		 transmits of the _start functions are its DMA: it writes them while
+  * 		 UART_4 and the log take bytes, and calls png_core_transmit_done and
+  * 		 png_log_transmit_done when they are out.
+  *
+  * 		 The blocking transmits are counted in port_linux_blocked, and turned
+  * 		 into the cycles the board would spin in HAL_UART_Transmit for them.
+  * @author  Vlad Kulikov
+  * @date    19.10.2026
+  ******************************************************************************
+  */
+
+#ifndef LINUX_PANGO_PORT_LINUX_H_
+#define LINUX_PANGO_PORT_LINUX_H_
+
+/* Includes ------------------------------------------------------------------*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <setjmp.h>
+#include <termios.h>
+#include <time.h>
+#include "png_core.h"
+
+/* Define types ------------------------------------------------------------ */
+#define PORT_LINUX_RANDOM_SIZE		256						/**< Bytes of /dev/urandom read at once */
+#define PORT_LINUX_PATH_SIZE		64						/**< Size of the path of a pty */
+#define PORT_LINUX_DEFAULT_MAC		"02:50:4E:47:00:01"		/**< A locally administered address */
+#define PORT_LINUX_LOG_CHUNK		512						/**< Most bytes of the log written per poll, below PIPE_BUF */
+#define PORT_LINUX_BOARD_BAUD		115200					/**< Baud rate of UART_4 and USER_UART on the board, 8N1 */
+#define PORT_LINUX_BOARD_HZ			216000000				/**< Core clock of the NucleoF746ZG */
+
+/**
+ * @brief The transmits that waited for their bytes to be sent.
+ */
+struct port_linux_blocked
+{
+	unsigned long calls;				/**< Blocking transmits, of UART_4 and of printf */
+	unsigned long bytes;				/**< Bytes they sent */
+	uint64_t ns;						/**< Time they took on this machine */
+};
+
+extern struct port_linux_blocked port_linux_blocked;
+
+/* Where port_system_reset jumps to, set with setjmp before png_core_init */
+extern jmp_buf port_linux_reset_point;
+
+/**
+ * @brief Opens UART_4: the tty at 'path', or a new pty when 'path' is NULL.
+ *
+ * The slave of a new pty is printed, the BBB opens it with --uart.
+ *
+ * @param path Path of the tty, or NULL.
+ * @return 0 on success, -1 on error.
+ */
+int port_linux_uart_open(const char *path);
+
+/**
+ * @brief Uses an open file descriptor as UART_4.
+ *
+ * @param fd The file descriptor.
+ */
+void port_linux_uart_set_fd(int fd);
+
+/**
+ * @brief Sets the MAC address port_mac_address gives.
+ *
+ * @param text The address as "XX:XX:XX:XX:XX:XX".
+ * @return 0 on success, -1 if the address can't be parsed.
+ */
+int port_linux_set_mac(const char *text);
+
+/**
+ * @brief Sends stdout through the log, as _write of Tools.c does on the board.
+ *
+ * The text goes to the stdout there was: at once and counted in
+ * port_linux_blocked when 'deferred' is 0, through png_log_write otherwise.
+ *
+ * @param deferred 1 for the event driven mode, 0 for the polling one.
+ * @return 0 on success, -1 on error.
+ */
+int port_linux_log_redirect(int deferred);
+
+/**
+ * @brief Waits for the armed status byte or the end of a transmit, and hands them to the core.
+ *
+ * @param timeout_ms Time to wait in milliseconds, -1 for no limit.
+ * @return 1 if a byte was handed over or a transmit ended, 0 if nothing came or nothing is awaited,
+ * 		   -1 when UART_4 is closed or fails.
+ */
+int port_linux_poll(int timeout_ms);
+
+/**
+ * @brief Tells if port_wait_for_event found UART_4 closed.
+ *
+ * @return 1 if so, 0 otherwise.
+ */
+int port_linux_uart_closed(void);
+
+/**
+ * @brief Cycles the board would have spent in the transmits of port_linux_blocked.
+ *
+ * Ten bits a byte at PORT_LINUX_BOARD_BAUD, on a core at PORT_LINUX_BOARD_HZ.
+ *
+ * @return The cycles.
+ */
+uint64_t port_linux_blocked_cycles(void);
+
+#endif /* LINUX_PANGO_PORT_LINUX_H_ */
@@ -0,0 +1,422 @@
+/**
+  ******************************************************************************
+  * @file    png_bench.c
+  * @brief   Benchmark and regression check of the core of the PNG module.
+  *
+  * 		 Plays the BBB on a socket pair in place of UART_4: writes a status,
+  * 		 lets the core answer it and checks the frame, as the BBB checks it.
+  * 		 Every BENCH_RESTART_EVERY exchanges a RESTART is sent, the core must restart
+  * 		 and answer the next status. Then times the building of a frame, and
+  * 		 the CRC-8 of the event in it, without the UART.
+  *
+  * 		 The exchanges run in both modes of png_core_set_mode. The polling
+  * 		 one waits in the transmits of the frames and of printf, the event
+  * 		 driven one must never wait: the cycles the board spends blocked
+  * 		 in each are counted by port_linux_blocked.
+  *
+  * 		 The streaming is checked twice: on a clock of its own, every batch
+  * 		 is decoded and the track must go on from batch to batch in moves
+  * 		 of at most PNG_STREAM_WALK_STEP, and on the socket pair, where a
+  * 		 STREAM_STOP must bring every sample taken since the STREAM_START,
+  * 		 in both modes.
+  *
+  * 		 Usage: ./png_bench [exchanges]
+  * @author  Vlad Kulikov
+  * @date    19.10.2026
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <time.h>
+#include <sys/socket.h>
+#include "pango_port_linux.h"
+
+/* Define types ------------------------------------------------------------ */
+#define BENCH_DEFAULT_EXCHANGES		200000
+#define BENCH_RESTART_EVERY			1000
+#define BENCH_BUILD_ROUNDS			(1 << 20)
+#define BENCH_MAC					"02:50:4E:47:00:2A"
+#define BENCH_STREAM_SAMPLES		(1 << 20)
+#define BENCH_STREAM_MS				200
+
+/* A volatile sink, so the compiler keeps every CRC it doesn't otherwise use */
+static volatile uint8_t bench_sink;
+
+/* Counts the restarts, is kept over the jumps of port_system_reset */
+static volatile unsigned long bench_restarts;
+
+/**
+ * @brief Seconds of the monotonic clock.
+ */
+static double bench_now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Reads the answer of the core and checks it as the BBB does.
+ *
+ * @return 0 if the answer is the event of 'status', -1 otherwise.
+ */
+static int bench_check_answer(int bbb_fd, struct uart_framer *framer, uint8_t status, const uint8_t *mac)
+{
+	uint8_t event[UART_FRAME_MAX_PAYLOAD];
+	uint8_t length;
+
+	while((length = uart_framer_next(framer, event)) == 0)
+	{
+		size_t space;
+		uint8_t *free_bytes = uart_framer_space(framer, &space);
+		ssize_t bytes = read(bbb_fd, free_bytes, space);
+
+		if(bytes <= 0)
+		{
+			perror("read");
+			return -1;
+		}
+		uart_framer_commit(framer, (size_t)bytes);
+	}
+	if(length != BUFFER_SIZE_TO_SEND || crc8_compute(event, AMOUNT_OF_DATA_FOR_CRC8_CHECKSUM_VALUE) != event[PLACE_FOR_CRC8_VALUE] ||
+	   event[0] != status || memcmp(&event[1], mac, MAC_ADDRESS_LENGTH) != 0 || event[7] > 127 || event[8] > 127)
+	{
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Runs the main loop until every status is answered and its frame sent.
+ *
+ * @return 0 on success, -1 when UART_4 fails.
+ */
+static int bench_run(png_core_mode mode)
+{
+	if(mode == PNG_CORE_POLLING)
+	{
+		png_core_run_once();
+		return 0;
+	}
+	/* The main loop of main_PNG, on the interrupts of port_linux_poll */
+	while(1)
+	{
+		png_core_run_once();
+		png_log_drain();
+		if(png_core_idle() && !png_core_pending())
+		{
+			return 0;
+		}
+		port_wait_for_event();
+		if(port_linux_uart_closed())
+		{
+			return -1;
+		}
+	}
+}
+
+/**
+ * @brief Sets the mode of the core and of printf, and clears port_linux_blocked.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int bench_set_mode(png_core_mode mode)
+{
+	png_core_set_mode(mode);
+	port_linux_blocked = (struct port_linux_blocked){0};
+	return port_linux_log_redirect(mode == PNG_CORE_EVENT_DRIVEN);
+}
+
+/**
+ * @brief Runs the exchanges through the socket pair.
+ *
+ * @return Number of bad answers, -1 if the exchanges couldn't run.
+ */
+static long bench_exchanges(long exchanges, const uint8_t *mac, png_core_mode mode, double *seconds)
+{
+	struct uart_framer framer;
+	int sockets[2];
+	volatile long bad = 0;
+	volatile long done = 0;
+	double begin;
+
+	if(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == -1)
+	{
+		perror("socketpair");
+		return -1;
+	}
+	port_linux_uart_set_fd(sockets[0]);
+	uart_framer_init(&framer);
+
+	begin = bench_now();
+	if(setjmp(port_linux_reset_point) != 0)
+	{
+		++bench_restarts;
+	}
+	png_core_init();
+	while(done < exchanges)
+	{
+		uint8_t status = (done % BENCH_RESTART_EVERY == BENCH_RESTART_EVERY - 1) ? RESTART : ((done & 1) ? OFF : ON);
+
+		++done;
+		if(write(sockets[1], &status, sizeof(status)) != sizeof(status) || port_linux_poll(-1) != 1)
+		{
+			perror("write");
+			close(sockets[0]);
+			close(sockets[1]);
+			return -1;
+		}
+		/* A RESTART jumps back above, and is not answered */
+		if(bench_run(mode) == -1)
+		{
+			close(sockets[0]);
+			close(sockets[1]);
+			return -1;
+		}
+		if(bench_check_answer(sockets[1], &framer, status, mac) == -1)
+		{
+			++bad;
+		}
+	}
+	*seconds = bench_now() - begin;
+	close(sockets[0]);
+	close(sockets[1]);
+	return bad;
+}
+
+/**
+ * @brief Checks a decoded batch goes on from the sample before it.
+ *
+ * @return 0 if every move is at most PNG_STREAM_WALK_STEP on each axis, -1 otherwise.
+ */
+static int bench_check_track(const struct png_sample *samples, uint8_t count, struct png_sample *last, int first)
+{
+	for(uint8_t i = 0; i < count; ++i)
+	{
+		if(samples[i].x > PNG_STREAM_COORDINATE_MAX || samples[i].y > PNG_STREAM_COORDINATE_MAX ||
+		   (!first && (abs(samples[i].x - last->x) > PNG_STREAM_WALK_STEP || abs(samples[i].y - last->y) > PNG_STREAM_WALK_STEP)))
+		{
+			return -1;
+		}
+		*last = samples[i];
+		first = 0;
+	}
+	return 0;
+}
+
+/**
+ * @brief Streams on a clock of its own, with every batch framed, decoded and checked.
+ *
+ * @return Number of bad batches.
+ */
+static long bench_stream_codec(const uint8_t *mac, double *ns_per_sample, double *bytes_per_sample)
+{
+	uint8_t batch[PNG_STREAM_PAYLOAD_SIZE(PNG_STREAM_BATCH)];
+	uint8_t frame[UART_FRAME_SIZE(PNG_STREAM_PAYLOAD_SIZE(PNG_STREAM_BATCH))];
+	struct png_sample samples[PNG_STREAM_MAX_DECODE], last = {0};
+	uint8_t decoded_mac[MAC_ADDRESS_LENGTH], seq, size, count, expected_seq = 0;
+	unsigned long frame_bytes = 0, decoded = 0;
+	long bad = 0;
+	double begin;
+
+	png_stream_init();
+	png_stream_set_period(1);
+	png_stream_start(0);
+	begin = bench_now();
+	for(uint32_t now_ms = 0; now_ms < BENCH_STREAM_SAMPLES; ++now_ms)
+	{
+		png_stream_sample(now_ms);
+		while((size = png_stream_build_batch(mac, PNG_STREAM_BATCH, batch)) != 0)
+		{
+			frame_bytes += uart_frame_encode(batch, size, frame);
+			count = png_stream_decode(batch, size, decoded_mac, &seq, samples);
+			if(count != PNG_STREAM_BATCH || seq != expected_seq++ || memcmp(decoded_mac, mac, MAC_ADDRESS_LENGTH) != 0 ||
+			   bench_check_track(samples, count, &last, decoded == 0) == -1)
+			{
+				++bad;
+			}
+			decoded += count;
+		}
+	}
+	*ns_per_sample = (bench_now() - begin) * 1e9 / BENCH_STREAM_SAMPLES;
+	*bytes_per_sample = (double)frame_bytes / (double)decoded;
+	if(decoded + (png_stream.head - png_stream.tail) != BENCH_STREAM_SAMPLES || png_stream.dropped != 0)
+	{
+		++bad;
+	}
+	png_stream_stop();
+	return bad;
+}
+
+/**
+ * @brief Streams through the socket pair between a STREAM_START and a STREAM_STOP.
+ *
+ * @return Number of bad batches, -1 if the streaming couldn't run.
+ */
+static long bench_stream_uart(const uint8_t *mac, png_core_mode mode, unsigned long *samples_sent)
+{
+	struct png_sample samples[PNG_STREAM_MAX_DECODE], last = {0};
+	uint8_t payload[UART_FRAME_MAX_PAYLOAD], decoded_mac[MAC_ADDRESS_LENGTH];
+	uint8_t status[] = {STREAM_START, STREAM_STOP}, seq, length, count;
+	struct uart_framer framer;
+	unsigned long decoded = 0;
+	uint32_t end_ms;
+	int sockets[2];
+	long bad = 0;
+
+	if(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == -1)
+	{
+		perror("socketpair");
+		return -1;
+	}
+	port_linux_uart_set_fd(sockets[0]);
+	uart_framer_init(&framer);
+	png_stream_set_period(1);
+	png_core_init();
+
+	/* The main loop of main_linux.c, for BENCH_STREAM_MS, then until the STREAM_STOP is done */
+	for(int i = 0; i < 2; ++i)
+	{
+		if(write(sockets[1], &status[i], sizeof(status[i])) != sizeof(status[i]))
+		{
+			perror("write");
+			close(sockets[0]);
+			close(sockets[1]);
+			return -1;
+		}
+		end_ms = port_millis() + BENCH_STREAM_MS;
+		do
+		{
+			if(mode == PNG_CORE_EVENT_DRIVEN)
+			{
+				png_log_drain();
+				port_wait_for_event();
+			}
+			if(port_linux_uart_closed() || (mode == PNG_CORE_POLLING && port_linux_poll(png_core_wait_ms()) == -1))
+			{
+				close(sockets[0]);
+				close(sockets[1]);
+				return -1;
+			}
+			png_core_run_once();
+		}
+		while(i == 0 ? (int32_t)(port_millis() - end_ms) < 0 : (png_stream.active == ON || !png_core_idle()));
+	}
+	*samples_sent = png_stream.head;
+	shutdown(sockets[0], SHUT_WR);
+
+	while(1)
+	{
+		size_t space;
+		uint8_t *free_bytes = uart_framer_space(&framer, &space);
+		ssize_t bytes = read(sockets[1], free_bytes, space);
+
+		if(bytes <= 0)
+		{
+			break;
+		}
+		uart_framer_commit(&framer, (size_t)bytes);
+		while((length = uart_framer_next(&framer, payload)) != 0)
+		{
+			count = png_stream_decode(payload, length, decoded_mac, &seq, samples);
+			if(count == 0 || bench_check_track(samples, count, &last, decoded == 0) == -1)
+			{
+				++bad;
+			}
+			decoded += count;
+		}
+	}
+	if(decoded != *samples_sent || png_stream.active != OFF)
+	{
+		++bad;
+	}
+	close(sockets[0]);
+	close(sockets[1]);
+	return bad;
+}
+
+int main(int argc, char *argv[])
+{
+	long exchanges = (argc > 1) ? atol(argv[1]) : BENCH_DEFAULT_EXCHANGES;
+	uint8_t mac[MAC_ADDRESS_LENGTH];
+	uint8_t frame[PNG_FRAME_SIZE];
+	uint8_t event[BUFFER_SIZE_TO_SEND] = {ON, 0x02, 0x50, 0x4E, 0x47, 0x00, 0x2A, 12, 34};
+	unsigned long expected_restarts, event_restarts;
+	double seconds, event_seconds, begin, build_ns, crc_ns, sample_ns, sample_bytes;
+	unsigned long streamed = 0, event_streamed = 0;
+	struct port_linux_blocked blocked, event_blocked;
+	uint64_t blocked_cycles, event_blocked_cycles;
+	uint8_t crc = 0;
+	long bad, event_bad, stream_bad, uart_bad, event_uart_bad;
+
+	if(exchanges <= 0)
+	{
+		fprintf(stderr, "Usage: %s [exchanges]\n", argv[0]);
+		return 1;
+	}
+	if(port_linux_set_mac(BENCH_MAC) == -1 || port_mac_address(mac) != PORT_OK)
+	{
+		return 1;
+	}
+	/* The core prints nothing on a good exchange, but a RESTART is printed */
+	freopen("/dev/null", "w", stdout);
+
+	if(bench_set_mode(PNG_CORE_POLLING) == -1 || (bad = bench_exchanges(exchanges, mac, PNG_CORE_POLLING, &seconds)) == -1)
+	{
+		return 1;
+	}
+	blocked = port_linux_blocked;
+	blocked_cycles = port_linux_blocked_cycles();
+
+	event_restarts = bench_restarts;
+	if(bench_set_mode(PNG_CORE_EVENT_DRIVEN) == -1 || (event_bad = bench_exchanges(exchanges, mac, PNG_CORE_EVENT_DRIVEN, &event_seconds)) == -1)
+	{
+		return 1;
+	}
+	event_blocked = port_linux_blocked;
+	event_blocked_cycles = port_linux_blocked_cycles();
+	event_restarts = bench_restarts - event_restarts;
+	bench_restarts -= event_restarts;
+	expected_restarts = (unsigned long)(exchanges / BENCH_RESTART_EVERY);
+
+	/* The frame without the UART: coordinates, packing, CRC-8 and framing */
+	begin = bench_now();
+	for(long i = 0; i < BENCH_BUILD_ROUNDS; ++i)
+	{
+		png_core_build_frame(frame);
+		bench_sink ^= frame[PNG_FRAME_SIZE - 1];
+	}
+	build_ns = (bench_now() - begin) * 1e9 / BENCH_BUILD_ROUNDS;
+
+	/* The CRC-8 of the event alone */
+	begin = bench_now();
+	for(long i = 0; i < BENCH_BUILD_ROUNDS; ++i)
+	{
+		event[8] = (uint8_t)i;
+		crc ^= crc8_compute(event, AMOUNT_OF_DATA_FOR_CRC8_CHECKSUM_VALUE);
+	}
+	bench_sink = crc;
+	crc_ns = (bench_now() - begin) * 1e9 / BENCH_BUILD_ROUNDS;
+
+	stream_bad = bench_stream_codec(mac, &sample_ns, &sample_bytes);
+	event_uart_bad = bench_stream_uart(mac, PNG_CORE_EVENT_DRIVEN, &event_streamed);
+	bench_set_mode(PNG_CORE_POLLING);
+	uart_bad = bench_stream_uart(mac, PNG_CORE_POLLING, &streamed);
+
+	fprintf(stderr, "exchanges  %ld in %.3f s: %.0f exchanges/s, %.2f us each\n", exchanges, seconds, exchanges / seconds, seconds * 1e6 / exchanges);
+	fprintf(stderr, "event      %ld in %.3f s: %.0f exchanges/s, %.2f us each\n", exchanges, event_seconds, exchanges / event_seconds, event_seconds * 1e6 / exchanges);
+	fprintf(stderr, "restarts   %lu of %lu, event driven %lu\n", bench_restarts, expected_restarts, event_restarts);
+	fprintf(stderr, "bad        %ld, event driven %ld\n", bad, event_bad);
+	fprintf(stderr, "blocked    polling %lu transmits, %lu bytes: %llu board cycles, %.0f per exchange, %.3f ms here\n",
+			blocked.calls, blocked.bytes, (unsigned long long)blocked_cycles, (double)blocked_cycles / exchanges, blocked.ns / 1e6);
+	fprintf(stderr, "blocked    event driven %lu transmits, %lu bytes: %llu board cycles\n",
+			event_blocked.calls, event_blocked.bytes, (unsigned long long)event_blocked_cycles);
+	fprintf(stderr, "frame      %.1f ns to build, the CRC-8 of the event alone %.1f ns\n", build_ns, crc_ns);
+	fprintf(stderr, "stream     %d samples per batch: %.1f ns and %.2f UART bytes per sample, %.1f for an event, bad %ld\n",
+			PNG_STREAM_BATCH, sample_ns, sample_bytes, (double)PNG_FRAME_SIZE, stream_bad);
+	fprintf(stderr, "stream     %lu samples in %d ms through UART_4, bad %ld\n", streamed, BENCH_STREAM_MS, uart_bad);
+	fprintf(stderr, "stream     %lu samples in %d ms through UART_4 event driven, bad %ld\n", event_streamed, BENCH_STREAM_MS, event_uart_bad);
+	return (bad != 0 || event_bad != 0 || bench_restarts != expected_restarts || event_restarts != expected_restarts ||
+			event_blocked.calls != 0 || stream_bad != 0 || uart_bad != 0 || event_uart_bad != 0) ? 1 : 0;
+}
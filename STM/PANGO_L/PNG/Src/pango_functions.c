@@ -9,7 +9,7 @@
   */
 
 /* Includes ------------------------------------------------------------------*/
-#include "PNG.h"
+#include "png_core.h"
 
 /**
  * @brief Packs data from a pango_client_data structure into a buffer for transmission.
@@ -59,38 +59,6 @@ void pack_pango_buffer(struct pango_client_data *client_data, uint8_t buffer_to_
 	}
 }
 
-/**
- * @brief Calculate CRC-8 checksum for the given data and used in the CRC_8_check function.
- *
- * This function calculates the CRC-8 checksum for the given data using a predefined polynomial.
- *
- * @param data Pointer to the data array.
- * @param length Length of the data array.
- * @return CRC-8 checksum.
- */
-uint8_t calculate_crc8(uint8_t* data, uint32_t length)
-{
-    uint8_t crc = 0xFF; // Initial value, typically 0xFF for CRC-8
-
-    for (uint32_t i = 0; i < length; i++)
-    {
-        crc ^= data[i];
-
-        for (uint8_t j = 0; j < 8; j++)
-        {
-            if (crc & 0x80)
-            {
-                crc = (crc << 1) ^ CRC_POLYNOMIAL;
-            }
-            else
-            {
-                crc <<= 1;
-            }
-        }
-    }
-
-    return crc;
-}
 //
 //void uart_transmit_bbb(UART_HandleTypeDef *huart, const uint8_t *send_buff, uint16_t send_buff_size, uin32_t timeout, uint8_t transmition_time)
 //{
@@ -0,0 +1,127 @@
+/**
+  ******************************************************************************
+  * @file    pango_port_stm32.c
+  * @brief   Source file for the port layer on the Nucleo board, with the HAL.
+  * @author  Vlad Kulikov
+  * @date    19.10.2026
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "PNG.h"
+
+/**
+ * @brief Transmits a buffer to the BBB controller over UART_4.
+ */
+port_status port_uart_transmit(const uint8_t *data, uint16_t size)
+{
+	return (HAL_UART_Transmit(UART_4, (uint8_t *)data, size, SMALL_DELAY) == HAL_OK) ? PORT_OK : PORT_ERROR;
+}
+
+/**
+ * @brief Starts the DMA transmit of a buffer over UART_4, HAL_UART_TxCpltCallback runs when it is out.
+ *
+ * The UART4_TX DMA stream must be set in the .ioc of the project.
+ */
+port_status port_uart_transmit_start(const uint8_t *data, uint16_t size)
+{
+	return (HAL_UART_Transmit_DMA(UART_4, (uint8_t *)data, size) == HAL_OK) ? PORT_OK : PORT_ERROR;
+}
+
+/**
+ * @brief Starts the DMA transmit of the log over USER_UART, HAL_UART_TxCpltCallback runs when it is out.
+ *
+ * The USART3_TX DMA stream must be set in the .ioc of the project.
+ */
+port_status port_log_transmit_start(const uint8_t *data, uint16_t size)
+{
+	return (HAL_UART_Transmit_DMA(USER_UART, (uint8_t *)data, size) == HAL_OK) ? PORT_OK : PORT_ERROR;
+}
+
+/**
+ * @brief Sleeps in WFI until an interrupt, unless png_core_pending has work.
+ *
+ * The interrupts are masked around the check: one that comes after it is
+ * held pending, and a pending interrupt wakes WFI even when masked, so it
+ * runs as soon as they are unmasked.
+ */
+void port_wait_for_event(void)
+{
+	__disable_irq();
+	if(!png_core_pending())
+	{
+		__WFI();
+	}
+	__enable_irq();
+}
+
+/**
+ * @brief Masks the interrupts, the mask there was is given back.
+ */
+uint32_t port_critical_enter(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	return primask;
+}
+
+/**
+ * @brief Unmasks the interrupts, unless they were masked before port_critical_enter.
+ */
+void port_critical_exit(uint32_t state)
+{
+	if(state == 0)
+	{
+		__enable_irq();
+	}
+}
+
+/**
+ * @brief Arms the receive interrupt of UART_4, HAL_UART_RxCpltCallback runs when the byte is in.
+ */
+port_status port_uart_receive_status(uint8_t *status)
+{
+	return (HAL_UART_Receive_IT(UART_4, status, sizeof(*status)) == HAL_OK) ? PORT_OK : PORT_ERROR;
+}
+
+/**
+ * @brief Generates a random number with the RNG peripheral.
+ */
+port_status port_random(uint32_t *number)
+{
+	return (HAL_RNG_GenerateRandomNumber(RNG_PANGO, number) == HAL_OK) ? PORT_OK : PORT_ERROR;
+}
+
+/**
+ * @brief Gets the MAC address from the ETH peripheral, see get_mac_address.
+ */
+port_status port_mac_address(uint8_t *mac_address)
+{
+	get_mac_address(mac_address);
+	return PORT_OK;
+}
+
+/**
+ * @brief Milliseconds of the SysTick.
+ */
+uint32_t port_millis(void)
+{
+	return HAL_GetTick();
+}
+
+/**
+ * @brief Restarts the controller.
+ */
+void port_system_reset(void)
+{
+	NVIC_SystemReset();
+}
+
+/**
+ * @brief Enters the infinite loop of Error_Handler.
+ */
+void port_error_handler(void)
+{
+	Error_Handler();
+}
@@ -0,0 +1,337 @@
+/**
+  ******************************************************************************
+  * @file    png_core.c
+  * @brief   Source file for the core of the PNG module, the exchange with the
+  * 		 BBB controller without the HAL.
+  * @author  Vlad Kulikov
+  * @date    19.10.2026
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "png_core.h"
+
+volatile uint8_t interrupt_flag = OFF;
+
+/* Represents the number of times a received status value was different than
+ * the ones the program knows */
+volatile uint8_t wrong_status = 1;
+
+/* A struct that will hold the received data from the BBB controller */
+struct pango_client_data pango_client_data = {0};
+
+/* The frames are built here, an event or a batch, and read by the DMA in the
+ * event driven mode until png_core_transmit_done */
+#define PNG_TX_FRAME_SIZE		UART_FRAME_SIZE(PNG_STREAM_PAYLOAD_SIZE(PNG_STREAM_BATCH))
+_Static_assert(PNG_TX_FRAME_SIZE >= PNG_FRAME_SIZE, "An event must fit in the transmit buffer");
+static uint8_t tx_frame[PNG_TX_FRAME_SIZE];
+
+static png_core_mode core_mode = PNG_CORE_POLLING;
+
+/* Set while the DMA reads tx_frame, and by png_core_transmit_done for the main loop */
+static volatile uint8_t tx_busy;
+static volatile uint8_t tx_done_flag = OFF;
+static volatile uint8_t tx_error;
+
+/**
+ * @brief Sets how the core waits for the UART, is kept over png_core_init.
+ *
+ * @param mode PNG_CORE_POLLING, the default, or PNG_CORE_EVENT_DRIVEN.
+ */
+void png_core_set_mode(png_core_mode mode)
+{
+	core_mode = mode;
+}
+
+/**
+ * @brief Starts the core: gets the MAC address and arms the receive of the first status.
+ *
+ * Is called again after a restart, so it sets every state the core has.
+ */
+void png_core_init(void)
+{
+	port_status status;
+
+	interrupt_flag = OFF;
+	wrong_status = 1;
+	tx_busy = 0;
+	tx_done_flag = OFF;
+	tx_error = 0;
+	pango_client_data = (struct pango_client_data){0};
+	png_stream_init();
+
+	/* Getting the MAC ADDREESS of the STM controller */
+	status = port_mac_address(pango_client_data.mac_address);
+	if(status != PORT_OK)
+	{
+		perror("port_mac_address");
+		printf("\r\n");
+		/* Entering an infinite loop */
+		port_error_handler();
+	}
+
+	/* Interrupt waits for a status value from the BBB */
+	status = port_uart_receive_status(&(pango_client_data.status));
+	if(status != PORT_OK)
+	{
+		perror("port_uart_receive_status");
+		exit(1);
+	}
+}
+
+/**
+ * @brief Handles a status byte stored by the port in pango_client_data.status.
+ *
+ * Runs in the receive interrupt on the board, so it only sets interrupt_flag
+ * for png_core_run_once, or arms the receive again for an unknown status.
+ */
+void png_core_status_received(void)
+{
+	port_status status;
+	if(wrong_status % WRONG_STATUS_LIMIT == 0)
+	{
+		uint8_t hardware_error = HARDWARE_ERROR;
+		printf("Restart the 'STM Controller' with the restart button\r\n");
+		port_uart_transmit(&hardware_error, sizeof(hardware_error));
+		port_error_handler();
+	}
+	/* When there is hardware error in the STM or the BBB most likely a cable fault */
+	switch(pango_client_data.status)
+	{
+		case ON:
+			interrupt_flag = ON;
+			break;
+		case OFF:
+			interrupt_flag = ON;
+			break;
+		case RESTART:
+			interrupt_flag = ON;
+			break;
+		case STREAM_START:
+			interrupt_flag = ON;
+			break;
+		case STREAM_STOP:
+			interrupt_flag = ON;
+			break;
+		default:
+			++wrong_status;
+			interrupt_flag = OFF;
+			printf("status  = %d\r\n", pango_client_data.status);
+			status = port_uart_receive_status(&(pango_client_data.status));
+			if(status != PORT_OK)
+			{
+				perror("port_uart_receive_status");
+				exit(1);
+			}
+			break;
+	}
+}
+
+/**
+ * @brief Ends the transmit of port_uart_transmit_start.
+ *
+ * Runs in the transmit complete or error interrupt on the board, so it only
+ * frees tx_frame and leaves the rest to png_core_run_once.
+ *
+ * @param status PORT_OK if the frame was sent, PORT_ERROR otherwise.
+ */
+void png_core_transmit_done(port_status status)
+{
+	if(status != PORT_OK)
+	{
+		tx_error = 1;
+	}
+	tx_busy = 0;
+	tx_done_flag = ON;
+}
+
+/**
+ * @brief Tells if an interrupt left work for png_core_run_once.
+ *
+ * @return 1 if there is work, 0 otherwise.
+ */
+int png_core_pending(void)
+{
+	return interrupt_flag == ON || tx_done_flag == ON;
+}
+
+/**
+ * @brief Tells if every status received is answered and its frame sent.
+ *
+ * @return 1 if so, 0 while a status or a transmit is pending.
+ */
+int png_core_idle(void)
+{
+	return interrupt_flag == OFF && !tx_busy;
+}
+
+/**
+ * @brief Sends the frame in tx_frame: waits for the UART in the polling mode,
+ * hands it to the DMA in the event driven mode.
+ *
+ * A transmit that fails restarts the controller, the BBB sees it as a timeout.
+ */
+static void png_core_transmit(uint16_t frame_size)
+{
+	port_status status;
+
+	if(core_mode == PNG_CORE_EVENT_DRIVEN)
+	{
+		tx_busy = 1;
+		status = port_uart_transmit_start(tx_frame, frame_size);
+		if(status != PORT_OK)
+		{
+			tx_busy = 0;
+		}
+	}
+	else
+	{
+		status = port_uart_transmit(tx_frame, frame_size);
+	}
+	if(status != PORT_OK)
+	{
+		perror("port_uart_transmit");
+		printf("\r\n");
+		/* BBB controller send a restarting the system value */
+		port_system_reset();
+	}
+}
+
+/**
+ * @brief Builds the frame of the event in pango_client_data with new coordinates.
+ *
+ * @param send_frame Room for PNG_FRAME_SIZE bytes (output parameter).
+ * @return Size of the frame.
+ */
+uint16_t png_core_build_frame(uint8_t send_frame[PNG_FRAME_SIZE])
+{
+	/* A buffer that will hold the data to be transmitted to the BBB controller */
+	uint8_t send_buff[BUFFER_SIZE_TO_SEND] = {0};
+
+	/* Generates random coordinates for the BBB */
+	get_coordinates(&pango_client_data);
+
+	/* Data in pango_client_data is stored in send_buff */
+	pack_pango_buffer(&pango_client_data, send_buff);
+
+	/* Getting the CRC-8 value */
+	send_buff[PLACE_FOR_CRC8_VALUE] = crc8_compute(send_buff, AMOUNT_OF_DATA_FOR_CRC8_CHECKSUM_VALUE);
+
+	/* All the data in one frame, so the BBB finds it in the stream of the UART, see uart_frame.h */
+	return (uint16_t)uart_frame_encode(send_buff, sizeof(send_buff), send_frame);
+}
+
+/**
+ * @brief Sends the batches of the track that are full, all the samples left when 'flush' is set.
+ *
+ * In the event driven mode it stops at the batch in flight, the ring keeps the rest.
+ *
+ * @return Number of batches sent.
+ */
+static int png_core_stream(int flush)
+{
+	uint8_t batch[PNG_STREAM_PAYLOAD_SIZE(PNG_STREAM_BATCH)];
+	uint8_t batch_size;
+	int sent = 0;
+
+	png_stream_sample(port_millis());
+	while(!tx_busy && (batch_size = png_stream_build_batch(pango_client_data.mac_address, flush ? 1 : PNG_STREAM_BATCH, batch)) != 0)
+	{
+		png_core_transmit((uint16_t)uart_frame_encode(batch, batch_size, tx_frame));
+		++sent;
+	}
+	return sent;
+}
+
+/**
+ * @brief Answers the status in pango_client_data.status and arms the receive of the next one.
+ */
+static void png_core_answer(void)
+{
+	port_status status;
+
+	switch(pango_client_data.status)
+	{
+		/* If the CRC-8 check was faulty the nucleos system will restart */
+		case RESTART:
+			/* BBB controller send a restarting the system value */
+			printf("Restarting because of BBB request\r\n\n");
+			port_system_reset();
+			break;
+		case STREAM_START:
+			png_stream_start(port_millis());
+			break;
+		case STREAM_STOP:
+			/* The samples taken so far are sent, in a short batch */
+			if(png_stream.active == ON)
+			{
+				png_core_stream(1);
+				/* The rest after the batch in flight, the STREAM_STOP stays pending until then */
+				if(png_stream.head != png_stream.tail)
+				{
+					return;
+				}
+			}
+			png_stream_stop();
+			break;
+		default:
+			/* Sending all the data to the BBB, in one frame */
+			png_core_transmit(png_core_build_frame(tx_frame));
+			break;
+	}
+	/* Reseting the flag before the receive is armed, the next status may come at once */
+	interrupt_flag = OFF;
+
+	/* Here we initialize again the receiving interrupt */
+	status = port_uart_receive_status(&(pango_client_data.status));
+	if(status != PORT_OK)
+	{
+		perror("port_uart_receive_status");
+		exit(1);
+	}
+}
+
+/**
+ * @brief Answers the received status, if there is one, and sends the track.
+ *
+ * Is called in the main loop: when interrupt_flag is set it restarts on a
+ * RESTART, starts or stops the streaming, or sends the event, and arms the
+ * receive of the next status. While streaming it takes the samples that are
+ * due and sends the full batches.
+ *
+ * @return 1 if a status was handled or a batch sent, 0 otherwise.
+ */
+int png_core_run_once(void)
+{
+	int handled = 0;
+
+	tx_done_flag = OFF;
+	if(tx_error)
+	{
+		perror("port_uart_transmit_start");
+		printf("\r\n");
+		/* BBB controller send a restarting the system value */
+		port_system_reset();
+	}
+	/* Nothing to answer until a data received interrupt occurs, nor while a frame is in flight */
+	if(interrupt_flag == ON && !tx_busy)
+	{
+		png_core_answer();
+		handled = 1;
+	}
+	if(png_stream.active == ON && interrupt_flag == OFF && png_core_stream(0) > 0)
+	{
+		handled = 1;
+	}
+	return handled;
+}
+
+/**
+ * @brief Milliseconds until png_core_run_once has a sample to take.
+ *
+ * @return The milliseconds, 0 if one is due, -1 when not streaming.
+ */
+int32_t png_core_wait_ms(void)
+{
+	return png_stream_wait_ms(port_millis());
+}
@@ -0,0 +1,119 @@
+/**
+  ******************************************************************************
+  * @file    png_log.c
+  * @brief   Source file for the deferred log of the PNG module.
+  * @author  Vlad Kulikov
+  * @date    19.10.2026
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "png_log.h"
+#include "pango_port.h"
+
+struct png_log png_log;
+
+/**
+ * @brief Empties the log.
+ */
+void png_log_init(void)
+{
+	png_log.head = 0;
+	png_log.tail = 0;
+	png_log.dropped = 0;
+	png_log.in_flight = 0;
+}
+
+/**
+ * @brief Copies text into the ring, what doesn't fit is dropped.
+ *
+ * The main loop and the interrupts both write, so the copy is done with the
+ * interrupts off. It is a memcpy of a line at most.
+ */
+int png_log_write(const char *data, int len)
+{
+	uint32_t copied = 0, free_bytes, index, chunk;
+	uint32_t state;
+
+	if(len <= 0)
+	{
+		return 0;
+	}
+	state = port_critical_enter();
+	free_bytes = PNG_LOG_RING_SIZE - (png_log.head - png_log.tail);
+	if((uint32_t)len > free_bytes)
+	{
+		png_log.dropped += (uint32_t)len - free_bytes;
+	}
+	/* Up to the end of the ring, then from its start */
+	while(copied < (uint32_t)len && copied < free_bytes)
+	{
+		index = png_log.head & (PNG_LOG_RING_SIZE - 1);
+		chunk = PNG_LOG_RING_SIZE - index;
+		if(chunk > (uint32_t)len - copied)
+		{
+			chunk = (uint32_t)len - copied;
+		}
+		if(chunk > free_bytes - copied)
+		{
+			chunk = free_bytes - copied;
+		}
+		memcpy(&png_log.ring[index], data + copied, chunk);
+		png_log.head += chunk;
+		copied += chunk;
+	}
+	port_critical_exit(state);
+	return len;
+}
+
+/**
+ * @brief Starts the transmit of the text in the ring, if the port is idle.
+ *
+ * The transmit is of the text up to the end of the ring, the rest is sent
+ * by the next call once it is done.
+ */
+int png_log_drain(void)
+{
+	uint32_t state, index, size;
+
+	state = port_critical_enter();
+	if(png_log.in_flight != 0 || png_log.head == png_log.tail)
+	{
+		port_critical_exit(state);
+		return 0;
+	}
+	index = png_log.tail & (PNG_LOG_RING_SIZE - 1);
+	size = png_log.head - png_log.tail;
+	if(size > PNG_LOG_RING_SIZE - index)
+	{
+		size = PNG_LOG_RING_SIZE - index;
+	}
+	png_log.in_flight = (uint16_t)size;
+	port_critical_exit(state);
+
+	if(port_log_transmit_start((const uint8_t *)&png_log.ring[index], (uint16_t)size) != PORT_OK)
+	{
+		/* Tried again on the next drain */
+		png_log.in_flight = 0;
+		return 0;
+	}
+	return 1;
+}
+
+/**
+ * @brief Frees the text the port sent, called by the port when the transmit ends.
+ */
+void png_log_transmit_done(void)
+{
+	png_log.tail += png_log.in_flight;
+	png_log.in_flight = 0;
+}
+
+/**
+ * @brief Forgets the transmit the port gave up, its text is sent again by png_log_drain.
+ */
+void png_log_abort(void)
+{
+	png_log.in_flight = 0;
+}
@@ -0,0 +1,231 @@
+/**
+  ******************************************************************************
+  * @file    png_stream.c
+  * @brief   Source file for the streaming of the track of the unit.
+  * @author  Vlad Kulikov
+  * @date    19.10.2026
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "png_core.h"
+
+#define PNG_STREAM_MASK (PNG_STREAM_RING_SIZE - 1)
+
+struct png_stream png_stream = {.period_ms = PNG_STREAM_SAMPLE_MS, .active = OFF};
+
+/**
+ * @brief Moves a coordinate of the track by a random step, within 0 to PNG_STREAM_COORDINATE_MAX.
+ */
+static uint8_t png_stream_walk(uint8_t coordinate)
+{
+	uint32_t random_number = 0;
+	int step;
+
+	rand_uint128(&random_number);
+	step = (int)(random_number % (2 * PNG_STREAM_WALK_STEP + 1)) - PNG_STREAM_WALK_STEP;
+	if((int)coordinate + step < 0)
+	{
+		return 0;
+	}
+	if((int)coordinate + step > PNG_STREAM_COORDINATE_MAX)
+	{
+		return PNG_STREAM_COORDINATE_MAX;
+	}
+	return (uint8_t)(coordinate + step);
+}
+
+/**
+ * @brief Stops the streaming and empties the ring, the period is kept.
+ */
+void png_stream_init(void)
+{
+	uint32_t period_ms = png_stream.period_ms;
+
+	png_stream = (struct png_stream){0};
+	png_stream.period_ms = period_ms;
+	png_stream.active = OFF;
+}
+
+/**
+ * @brief Stops the streaming, the samples not sent are dropped.
+ */
+void png_stream_stop(void)
+{
+	png_stream.tail = png_stream.head;
+	png_stream.active = OFF;
+}
+
+/**
+ * @brief Sets the period of the samples.
+ *
+ * @param period_ms Period in milliseconds, at least 1.
+ */
+void png_stream_set_period(uint32_t period_ms)
+{
+	png_stream.period_ms = (period_ms == 0) ? 1 : period_ms;
+}
+
+/**
+ * @brief Starts the track at a random position, the first sample is taken at once.
+ *
+ * @param now_ms The time of port_millis.
+ */
+void png_stream_start(uint32_t now_ms)
+{
+	struct pango_client_data start = {0};
+
+	/* A start again goes on with the same track */
+	if(png_stream.active == ON)
+	{
+		return;
+	}
+	get_coordinates(&start);
+	png_stream.position.x = start.x_coor;
+	png_stream.position.y = start.y_coor;
+	png_stream.next_sample_ms = now_ms;
+	png_stream.active = ON;
+}
+
+/**
+ * @brief Takes the samples that are due, the ring keeps the newest when it is full.
+ *
+ * @param now_ms The time of port_millis.
+ * @return Number of samples taken.
+ */
+uint32_t png_stream_sample(uint32_t now_ms)
+{
+	uint32_t taken = 0;
+
+	if(png_stream.active != ON)
+	{
+		return 0;
+	}
+	/* Behind by more than the ring holds, the oldest of those samples would be dropped anyway */
+	if((int32_t)(now_ms - png_stream.next_sample_ms) >= 0 &&
+	   (now_ms - png_stream.next_sample_ms) / png_stream.period_ms >= PNG_STREAM_RING_SIZE)
+	{
+		uint32_t skipped = (now_ms - png_stream.next_sample_ms) / png_stream.period_ms - PNG_STREAM_RING_SIZE + 1;
+
+		png_stream.dropped += skipped;
+		png_stream.next_sample_ms += skipped * png_stream.period_ms;
+	}
+	/* Every period that passed gets its sample, also when the UART held the loop */
+	while((int32_t)(now_ms - png_stream.next_sample_ms) >= 0)
+	{
+		if(png_stream.head - png_stream.tail == PNG_STREAM_RING_SIZE)
+		{
+			++png_stream.tail;
+			++png_stream.dropped;
+		}
+		png_stream.ring[png_stream.head & PNG_STREAM_MASK] = png_stream.position;
+		++png_stream.head;
+		++taken;
+		png_stream.position.x = png_stream_walk(png_stream.position.x);
+		png_stream.position.y = png_stream_walk(png_stream.position.y);
+		png_stream.next_sample_ms += png_stream.period_ms;
+	}
+	return taken;
+}
+
+/**
+ * @brief Milliseconds until the next sample is due.
+ *
+ * @param now_ms The time of port_millis.
+ * @return The milliseconds, 0 if it is due, -1 when not streaming.
+ */
+int32_t png_stream_wait_ms(uint32_t now_ms)
+{
+	int32_t wait_ms = (int32_t)(png_stream.next_sample_ms - now_ms);
+
+	if(png_stream.active != ON)
+	{
+		return -1;
+	}
+	return (wait_ms < 0) ? 0 : wait_ms;
+}
+
+/**
+ * @brief Takes a batch out of the ring.
+ *
+ * @param mac_address The MAC address of the unit.
+ * @param min_count The batch is built only if at least that many samples are buffered, 1 to PNG_STREAM_BATCH.
+ * @param payload Room for PNG_STREAM_PAYLOAD_SIZE(PNG_STREAM_BATCH) bytes (output parameter).
+ * @return Size of the batch, 0 if fewer than min_count samples are buffered.
+ */
+uint8_t png_stream_build_batch(const uint8_t *mac_address, uint32_t min_count, uint8_t *payload)
+{
+	uint32_t buffered = png_stream.head - png_stream.tail;
+	uint8_t count = (uint8_t)((buffered < PNG_STREAM_BATCH) ? buffered : PNG_STREAM_BATCH);
+	struct png_sample last;
+	uint8_t size;
+
+	if(buffered == 0 || buffered < min_count)
+	{
+		return 0;
+	}
+	last = png_stream.ring[png_stream.tail & PNG_STREAM_MASK];
+	payload[0] = TRACK;
+	for(int i = 0; i < MAC_ADDRESS_LENGTH; ++i)
+	{
+		payload[1 + i] = mac_address[i];
+	}
+	payload[7] = png_stream.seq++;
+	payload[8] = count;
+	payload[9] = last.x;
+	payload[10] = last.y;
+	for(uint8_t i = 1; i < count; ++i)
+	{
+		struct png_sample sample = png_stream.ring[(png_stream.tail + i) & PNG_STREAM_MASK];
+
+		/* dx in the high nibble, dy in the low one, both two's complement */
+		payload[PNG_STREAM_HEADER_SIZE + i - 1] = (uint8_t)((((sample.x - last.x) & 0x0F) << 4) | ((sample.y - last.y) & 0x0F));
+		last = sample;
+	}
+	png_stream.tail += count;
+	size = PNG_STREAM_PAYLOAD_SIZE(count);
+	payload[size - 1] = crc8_compute(payload, size - 1);
+	return size;
+}
+
+/**
+ * @brief Reads a batch back into its samples, as the receiver does.
+ *
+ * @param payload The batch.
+ * @param length Size of the batch.
+ * @param mac_address Room for MAC_ADDRESS_LENGTH bytes (output parameter).
+ * @param seq Pointer to store the number of the batch (output parameter).
+ * @param samples Room for PNG_STREAM_MAX_DECODE samples (output parameter).
+ * @return Number of samples, 0 if the batch is not valid.
+ */
+uint8_t png_stream_decode(const uint8_t *payload, uint8_t length, uint8_t *mac_address, uint8_t *seq, struct png_sample *samples)
+{
+	uint8_t count;
+
+	if(length < PNG_STREAM_PAYLOAD_SIZE(1) || payload[0] != TRACK)
+	{
+		return 0;
+	}
+	count = payload[8];
+	if(count == 0 || count > PNG_STREAM_MAX_DECODE || length != PNG_STREAM_PAYLOAD_SIZE(count) ||
+	   crc8_compute(payload, length - 1) != payload[length - 1])
+	{
+		return 0;
+	}
+	for(int i = 0; i < MAC_ADDRESS_LENGTH; ++i)
+	{
+		mac_address[i] = payload[1 + i];
+	}
+	*seq = payload[7];
+	samples[0].x = payload[9];
+	samples[0].y = payload[10];
+	for(uint8_t i = 1; i < count; ++i)
+	{
+		uint8_t moves = payload[PNG_STREAM_HEADER_SIZE + i - 1];
+
+		/* Sign extension of the nibbles */
+		samples[i].x = (uint8_t)(samples[i - 1].x + (int8_t)(moves & 0xF0) / 16);
+		samples[i].y = (uint8_t)(samples[i - 1].y + (int8_t)(uint8_t)(moves << 4) / 16);
+	}
+	return count;
+}
@@ -1,7 +1,8 @@
 /**
   ******************************************************************************
   * @file    random_number_generator.c
-  * @brief   Source file for generating random numbers using the RNG peripheral.
+  * @brief   Source file for generating random numbers using the RNG peripheral,
+  * 		 through port_random.
   * @author  Vlad Kulikov
   * @date    23.12.2023
   ******************************************************************************
@@ -9,6 +10,7 @@
 
 /* Includes ------------------------------------------------------------------ */
 #include "random_number_generator.h"
+#include "pango_port.h"
 
 /**
  * @brief Generates random coordinates and assigns them to a pango_client_data structure.
@@ -37,28 +39,28 @@ void get_coordinates(struct pango_client_data *client_data)
 /**
  * @brief Generates a random 32-bit unsigned integer and restricts it to the range [0, 127].
  *
- * This function utilizes the Hardware Abstraction Layer (HAL) to generate a random number
- * using the hardware Random Number Generator (RNG). The generated number is then
+ * This function utilizes port_random to generate a random number, with the hardware
+ * Random Number Generator (RNG) on the board. The generated number is then
  * reduced to fit within the range [0, 127].
  *
  * @param insert_num Pointer to a variable to store the generated random number.
  *
  * The function handles errors in the RNG generation by printing an error message
- * and entering an infinite loop if the HAL_RNG_GenerateRandomNumber operation fails.
+ * and entering port_error_handler if the port_random operation fails.
  * The final random number is stored at the address pointed to by insert_num.
  */
 void rand_uint128(uint32_t *insert_num)
 {
-	HAL_StatusTypeDef status = 0;
+	port_status status = PORT_OK;
 
-	status = HAL_RNG_GenerateRandomNumber(RNG_PANGO, insert_num);
-	if(status != HAL_OK)
+	status = port_random(insert_num);
+	if(status != PORT_OK)
 	{
-		perror("HAL_RNG_GenerateRandomNumber");
+		perror("port_random");
 		printf("\r\n");
 
 		/* Entering an infinite loop */
-		Error_Handler();
+		port_error_handler();
 	}
 	/* inserting the random number inside the address and restricts it to the range [0, 127]*/
 	*insert_num =(uint8_t)(*insert_num % 128);
@@ -0,0 +1,178 @@
+/**
+ * @file 	button.c
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-19
+ * @brief 	Implementation of the button inputs of the BBB.
+ */
+
+#include "button.h"
+
+/**
+ * @brief Microseconds of the monotonic clock.
+ */
+static uint64_t button_now_us(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * @brief Request a line of a GPIO chip as an input with edge events.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int button_open_gpio(struct button *button, const char *chip, const char *line)
+{
+	struct gpio_v2_line_request request;
+	char *end;
+	unsigned long offset = strtoul(line, &end, 10);
+	int chip_fd;
+
+	if (*line == '\0' || *end != '\0')
+	{
+		fprintf(stderr, "button: '%s' is not a line of %s\n", line, chip);
+		return -1;
+	}
+	if ((chip_fd = open(chip, O_RDONLY | O_CLOEXEC)) == -1)
+	{
+		fprintf(stderr, "button: Unable to open %s - %s\n", chip, strerror(errno));
+		return -1;
+	}
+
+	/* Both edges, so the release is seen and a bounce of the release isn't taken for a press.  */
+	memset(&request, 0, sizeof(request));
+	request.offsets[0] = (uint32_t)offset;
+	request.num_lines = 1;
+	request.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_ACTIVE_LOW | GPIO_V2_LINE_FLAG_BIAS_PULL_UP |
+						   GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+	request.event_buffer_size = BUTTON_EVENTS;
+	strncpy(request.consumer, "pango button", sizeof(request.consumer) - 1);
+	if (ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &request) == -1)
+	{
+		fprintf(stderr, "button: Unable to request line %lu of %s - %s\n", offset, chip, strerror(errno));
+		close(chip_fd);
+		return -1;
+	}
+	close(chip_fd);
+
+	button->kind = BUTTON_GPIO;
+	button->fd = request.fd;
+	if (fcntl(button->fd, F_SETFL, fcntl(button->fd, F_GETFL, 0) | O_NONBLOCK) == -1)
+	{
+		perror("button: fcntl");
+		button_close(button);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Open a button, a UART or "CHIP:LINE" of a GPIO chip.
+ *
+ * @param button Pointer to the button.
+ * @param path The UART, or the GPIO chip and the offset of the line on it.
+ * @return 0 on success, -1 on error.
+ */
+int button_open(struct button *button, const char *path)
+{
+	const char *line = strchr(path, ':');
+
+	memset(button, 0, sizeof(*button));
+	button->fd = -1;
+	if (line != NULL)
+	{
+		char chip[64];
+
+		if ((size_t)(line - path) >= sizeof(chip))
+		{
+			fprintf(stderr, "button: '%s' is too long\n", path);
+			return -1;
+		}
+		memcpy(chip, path, line - path);
+		chip[line - path] = '\0';
+		return button_open_gpio(button, chip, line + 1);
+	}
+	button->kind = BUTTON_UART;
+	return init_uart(path, &button->fd, &button->options);
+}
+
+/**
+ * @brief Drain the probes that came back through a UART button, and tell a new press.
+ */
+static uint8_t button_uart_pressed(struct button *button)
+{
+	uint8_t probes[BUTTON_DRAIN_SIZE];
+	uint64_t now = button_now_us(), silent_us = now - button->last_probe_us;
+
+	while (read(button->fd, probes, sizeof(probes)) > 0)
+	{
+	}
+	button->last_probe_us = now;
+	return (silent_us >= BUTTON_RELEASE_US) ? TRUE : FALSE;
+}
+
+/**
+ * @brief Read the edges of a GPIO button, and tell a new press.
+ */
+static uint8_t button_gpio_pressed(struct button *button)
+{
+	struct gpio_v2_line_event events[BUTTON_EVENTS];
+	uint8_t pressed = FALSE;
+	ssize_t n;
+
+	while ((n = read(button->fd, events, sizeof(events))) > 0)
+	{
+		for (size_t i = 0; i < (size_t)n / sizeof(events[0]); ++i)
+		{
+			/* The line was still long enough before this edge, it isn't a bounce.  */
+			if (events[i].id == GPIO_V2_LINE_EVENT_RISING_EDGE &&
+				events[i].timestamp_ns - button->last_edge_ns >= BUTTON_DEBOUNCE_NS)
+			{
+				pressed = TRUE;
+			}
+			button->last_edge_ns = events[i].timestamp_ns;
+		}
+	}
+	return pressed;
+}
+
+/**
+ * @brief Handle the input of a button, once poll shows it.
+ *
+ * @param button Pointer to the button.
+ * @return TRUE on a new press, FALSE otherwise.
+ */
+uint8_t button_pressed(struct button *button)
+{
+	return (button->kind == BUTTON_GPIO) ? button_gpio_pressed(button) : button_uart_pressed(button);
+}
+
+/**
+ * @brief Called every tick of the event loop: a UART button is probed.
+ *
+ * @param button Pointer to the button.
+ */
+void button_tick(struct button *button)
+{
+	if (button->kind == BUTTON_UART)
+	{
+		/* The probe comes back through the button while it is held.  */
+		write(button->fd, "Hi", 2);
+	}
+}
+
+/**
+ * @brief Close a button.
+ *
+ * @param button Pointer to the button.
+ */
+void button_close(struct button *button)
+{
+	if (button->fd != -1)
+	{
+		close(button->fd);
+		button->fd = -1;
+	}
+}
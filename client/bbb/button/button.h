@@ -0,0 +1,109 @@
+/**
+ * @file 	button.h
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-19
+ * @brief 	Header file for the button inputs of the BBB.
+ *
+ * A button is one of two kinds, told apart by how it is given:
+ *
+ * - A UART, e.g. /dev/ttyO4: the button closes the loop from the TX to the RX
+ *   of the UART. A probe is written every tick by button_tick and comes
+ *   back while the button is held. A press is the first probe back after
+ *   BUTTON_RELEASE_US without any.
+ *
+ * - A line of a GPIO chip, "CHIP:LINE", e.g. /dev/gpiochip1:28: the line is
+ *   requested from the GPIO character device as an input with edge events,
+ *   and the kernel stamps every edge with CLOCK_MONOTONIC when it happens.
+ *   A press is an edge to the active level that comes BUTTON_DEBOUNCE_NS or
+ *   more after the edge before it: the bounces of the contact follow each
+ *   other closer than that. No thread and no second UART are needed, and the
+ *   stamps are exact however late the event loop reads the events.
+ *   The line is active low, a button that pulls it to the ground when pressed.
+ *
+ * The GPIO button can be tried on any Linux host with the gpio-sim module:
+ *
+ *   modprobe gpio-sim
+ *   mkdir -p /sys/kernel/config/gpio-sim/bbb/gpio-bank0/line0
+ *   echo 8 > /sys/kernel/config/gpio-sim/bbb/gpio-bank0/num_lines
+ *   echo 1 > /sys/kernel/config/gpio-sim/bbb/live
+ *   CHIP=$(cat /sys/kernel/config/gpio-sim/bbb/gpio-bank0/chip_name)
+ *   bbb_pango_client --button /dev/$CHIP:0 &
+ *   # a press, then a release:
+ *   echo pull-down > /sys/devices/platform/gpio-sim.0/$CHIP/sim_gpio0/pull
+ *   echo pull-up > /sys/devices/platform/gpio-sim.0/$CHIP/sim_gpio0/pull
+ */
+#ifndef BUTTON_PNG_H
+#define BUTTON_PNG_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+#include "./../../stm/uart/uart.h"
+#include "./../../png_enums.h"
+
+/* A UART button that sent no probe back for this long was released.  */
+#define BUTTON_RELEASE_US	100000
+/* The line of a GPIO button must be still for this long before a press.  */
+#define BUTTON_DEBOUNCE_NS	20000000ULL
+/* The bytes, or the edge events, read at once.  */
+#define BUTTON_DRAIN_SIZE	64
+#define BUTTON_EVENTS		16
+
+enum button_kind
+{
+	BUTTON_UART,
+	BUTTON_GPIO
+};
+
+/**
+ * @brief A button input.
+ */
+struct button
+{
+	uint8_t kind;		   /*enum button_kind*/
+	int fd;				   /*The UART, or the line request of the GPIO chip*/
+	struct termios options;
+	uint64_t last_probe_us; /*UART: the time the last probe came back*/
+	uint64_t last_edge_ns;	/*GPIO: the kernel time of the last edge*/
+};
+
+/**
+ * @brief Open a button, a UART or "CHIP:LINE" of a GPIO chip.
+ *
+ * @param button Pointer to the button.
+ * @param path The UART, or the GPIO chip and the offset of the line on it.
+ * @return 0 on success, -1 on error.
+ */
+int button_open(struct button *button, const char *path);
+
+/**
+ * @brief Handle the input of a button, once poll shows it.
+ *
+ * @param button Pointer to the button.
+ * @return TRUE on a new press, FALSE otherwise.
+ */
+uint8_t button_pressed(struct button *button);
+
+/**
+ * @brief Called every tick of the event loop: a UART button is probed.
+ *
+ * @param button Pointer to the button.
+ */
+void button_tick(struct button *button);
+
+/**
+ * @brief Close a button.
+ *
+ * @param button Pointer to the button.
+ */
+void button_close(struct button *button);
+
+#endif /*BUTTON_PNG_H*/
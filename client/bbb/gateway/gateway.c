@@ -0,0 +1,634 @@
+/**
+ * @file 	gateway.c
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-18
+ * @brief 	Implementation of the event loop of the BBB, for one unit or a gateway of several.
+ */
+
+#include "gateway.h"
+
+/* The poll events of the loop: the tick, the uplink, then the button and the data UART of every unit.  */
+#define GATEWAY_TIMER_EVENT		 0
+#define GATEWAY_UPLINK_EVENT	 1
+#define GATEWAY_FIRST_UNIT_EVENT 2
+#define GATEWAY_BUTTON_EVENT(i)	 (GATEWAY_FIRST_UNIT_EVENT + 2 * (i))
+#define GATEWAY_DATA_EVENT(i)	 (GATEWAY_FIRST_UNIT_EVENT + 2 * (i) + 1)
+
+/**
+ * @brief Open the UART and the button of a unit, given as "DATA_UART:BUTTON", see button.h.
+ *
+ * @param labelled The messages of the unit start with the name of its data UART.
+ * @return 0 on success, -1 on error.
+ */
+static int gateway_open_unit(struct gateway_unit *unit, char *uarts, uint8_t labelled)
+{
+	char *button = strchr(uarts, ':');
+
+	memset(unit, 0, sizeof(*unit));
+	unit->data_fd = unit->button.fd = -1;
+	if (button == NULL)
+	{
+		fprintf(stderr, "gateway: '%s' is not DATA_UART:BUTTON\n", uarts);
+		return -1;
+	}
+	*button++ = '\0';
+	if (labelled == TRUE)
+	{
+		snprintf(unit->label, sizeof(unit->label), "%s: ", uarts);
+	}
+	unit->status = ON;
+	if (init_uart(uarts, &unit->data_fd, &unit->data_options) == -1 ||
+		button_open(&unit->button, button) == -1)
+	{
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Start the exchange of a press: send the status to the STM, its reply is read by gateway_stm_data.
+ */
+static void gateway_start_exchange(struct gateway_unit *unit)
+{
+	/* A press during an exchange, or before the server answered the last event, is ignored.  */
+	if (unit->stm_waiting == TRUE || unit->waiting == TRUE)
+	{
+		return;
+	}
+	unit->pressed_us = monotonic_us();
+
+	/* sending the status to the STM controller, start/finish.  */
+	write(unit->data_fd, &unit->status, sizeof(unit->status));
+	unit->stm_waiting = TRUE;
+	unit->stm_deadline_us = unit->pressed_us + SMALL_DELAY * 1000ULL;
+}
+
+/**
+ * @brief Restart the STM of a unit after its third exchange without a reply.
+ */
+static void gateway_stm_timed_out(struct gateway_unit *unit)
+{
+	int restart = RESTART;
+
+	unit->stm_waiting = FALSE;
+	printf("%sNo data was received by the BBB in the time limit\n", unit->label);
+	if (++unit->stm_data_receive_error == RESTART)
+	{
+		write(unit->data_fd, &restart, sizeof(restart));
+		printf("%srestarting STM controller\n", unit->label);
+		unit->stm_data_receive_error = 0;
+	}
+}
+
+/**
+ * @brief Keep the last event of a unit in the store, and start or end its session offline.
+ *
+ * @return 0 on success, -1 when the event can't be stored either.
+ */
+static int gateway_store_event(struct gateway_unit *unit, struct store *store)
+{
+	if (store_append(store, unit->data_buff) == ERROR)
+	{
+		return -1;
+	}
+	if (unit->connected != CONNECTED)
+	{
+		unit->connected = CONNECTED;
+		unit->offline = TRUE;
+		memcpy(unit->session_event, unit->data_buff, sizeof(unit->session_event));
+		printf("%sThe server can't be reached, the parking has started and is kept until it can.\n\n\n", unit->label);
+	}
+	else
+	{
+		unit->connected = NOT_CONNECTED;
+		unit->offline = FALSE;
+		printf("%sThe parking has ended, it is paid once the stored events reach the server.\n\n\n", unit->label);
+	}
+	return 0;
+}
+
+/**
+ * @brief Show the city and the rate of a start by the snapshot, before the server answers.
+ */
+static void gateway_preview_start(struct gateway_unit *unit, const struct zone_snapshot *snapshot)
+{
+	const struct snapshot_zone *zone = snapshot_resolve(snapshot, unit->data_buff[7], unit->data_buff[8]);
+
+	unit->expected_zone = 0;
+	if (zone == NULL)
+	{
+		return;
+	}
+	unit->expected_zone = zone->id;
+	printf("%sParking in %s, %.2f ILS per hour now, %.1f ms after the button\n", unit->label, zone->name,
+		   (double)snapshot_rate(snapshot, zone, (int64_t)time(NULL)) / PROTOCOL_MINOR_UNITS_PER_MAJOR,
+		   (monotonic_us() - unit->pressed_us) / 1000.0);
+}
+
+/**
+ * @brief Handle a frame of the STM of a unit, and send its event to the server
+ *        without waiting for the reply, or keep it in the store.
+ *
+ * @return 0 on success, -1 when the connection failed.
+ */
+static int gateway_stm_frame(struct gateway_unit *unit, const uint8_t *payload, uint8_t length, int client_socket,
+							 struct store *store, const struct zone_snapshot *snapshot)
+{
+	uint8_t lost = FALSE;
+	uint8_t starting;
+
+	/* Nothing was asked from the STM, or the frame isn't an event: it is dropped.  */
+	if (unit->stm_waiting != TRUE || length != DATA_BUFF_SIZE)
+	{
+		return 0;
+	}
+	unit->stm_waiting = FALSE;
+	unit->stm_data_receive_error = 0;
+
+	if (received_data_from_stm(unit->status) == TRUE)
+	{
+		memcpy(unit->data_buff, payload, sizeof(unit->data_buff));
+		get_status(unit->data_buff, sizeof(unit->data_buff), &unit->status);
+		CRC_8_check(unit->data_buff, PANGO_DATA_SIZE, &unit->status);
+
+		starting = (already_connected_to_server_check(unit->status, unit->connected) == NOT_CONNECTED) ? TRUE : FALSE;
+		if (starting == TRUE || ready_to_quit(unit->status, unit->connected) == QUIT)
+		{
+			/* An offline session, and an event behind stored ones, goes to the store too.  */
+			if (client_socket != -1 && unit->offline != TRUE && store_pending(store) == 0)
+			{
+				if (protocol_send_events(client_socket, unit->data_buff, 1, &unit->waiting_seq) == 0)
+				{
+					unit->waiting = TRUE;
+				}
+				else
+				{
+					lost = TRUE;
+				}
+			}
+			if (unit->waiting != TRUE && gateway_store_event(unit, store) == ERROR)
+			{
+				/* The status is kept, the next press sends the same event.  */
+				printf("%sThe server can't be reached, please try again in a few seconds.\n", unit->label);
+				return (lost == TRUE) ? -1 : 0;
+			}
+			if (starting == TRUE)
+			{
+				gateway_preview_start(unit, snapshot);
+			}
+		}
+	}
+	/*Updating the value of the units status*/
+	updating_status_value(&unit->status);
+	return (lost == TRUE) ? -1 : 0;
+}
+
+/**
+ * @brief Read the data UART of a unit until it is empty, and handle every whole frame in it.
+ *
+ * @return 0 on success, -1 when the connection failed.
+ */
+static int gateway_stm_data(struct gateway_unit *unit, int client_socket, struct store *store,
+							const struct zone_snapshot *snapshot)
+{
+	uint8_t payload[UART_FRAME_MAX_PAYLOAD], length;
+	uint32_t dropped = unit->framer.dropped;
+	int result = 0;
+	ssize_t n;
+
+	do
+	{
+		size_t size;
+		uint8_t *space = uart_framer_space(&unit->framer, &size);
+
+		n = read(unit->data_fd, space, size);
+		if (n > 0)
+		{
+			uart_framer_commit(&unit->framer, (size_t)n);
+		}
+		/* The frames are taken out before the next read, so the ring has room for it.  */
+		while ((length = uart_framer_next(&unit->framer, payload)) != 0)
+		{
+			if (gateway_stm_frame(unit, payload, length, client_socket, store, snapshot) == -1)
+			{
+				/* The events of the next frames go to the store.  */
+				client_socket = -1;
+				result = -1;
+			}
+		}
+	} while (n > 0);
+
+	if (unit->framer.dropped != dropped)
+	{
+		printf("%s%u bytes of the STM dropped to find the next frame\n", unit->label, unit->framer.dropped - dropped);
+	}
+	return result;
+}
+
+/**
+ * @brief Handle the reply to the last event of a unit.
+ */
+static void gateway_event_reply(struct gateway_unit *unit, const struct protocol_reply *reply)
+{
+	char location[LOCATION_NAME_MAX_LEN];
+	double payment[PAYMENT_SIZE];
+
+	unit->waiting = FALSE;
+	printf("%s", unit->label);
+	if (unit->connected != CONNECTED)
+	{
+		/* A problem on the server side is shown as the 'ERROR' location, see crc8_server_side_value.  */
+		memset(location, '\0', sizeof(location));
+		if (reply->kind == PROTOCOL_REPLY_LOCATION)
+		{
+			memcpy(location, reply->location, sizeof(location));
+			/* The server is authoritative, a known unit may go on with the parking of its last session.  */
+			if (unit->expected_zone != 0 && reply->zone_id != unit->expected_zone)
+			{
+				printf("The server parks the unit in %.*s, not in the city shown\n%s", PROTOCOL_LOCATION_SIZE,
+					   reply->location, unit->label);
+			}
+		}
+		else
+		{
+			strncpy(location, "ERROR", sizeof(location));
+		}
+		crc8_server_side_value(&unit->status, location, sizeof(location), &unit->connected);
+		memcpy(unit->session_event, unit->data_buff, sizeof(unit->session_event));
+		if (unit->status == STAY_ON)
+		{
+			/* The next press starts the session again.  */
+			updating_status_value(&unit->status);
+		}
+		unit->next_quote_us = monotonic_us() + QUOTE_POLL_PERIOD_MS * 1000ULL;
+		printf("Location received %.1f ms after the button\n", (monotonic_us() - unit->pressed_us) / 1000.0);
+		return;
+	}
+
+	/* The session is over on the server either way.  */
+	unit->connected = NOT_CONNECTED;
+	if (reply->kind != PROTOCOL_REPLY_AMOUNT)
+	{
+		fprintf(stderr, "The server couldn't close the parking, error %u\n", reply->status);
+		return;
+	}
+	payment[0] = (double)reply->charge / PROTOCOL_MINOR_UNITS_PER_MAJOR;
+	payment[1] = (double)reply->seconds;
+	final_price_for_costumer(payment, PAYMENT_SIZE);
+	printf("Payment received %.1f ms after the button\n", (monotonic_us() - unit->pressed_us) / 1000.0);
+}
+
+/**
+ * @brief Route a reply to the unit whose request it answers.
+ */
+static void gateway_dispatch_reply(struct gateway_unit *unit, int unit_count, const struct protocol_reply *reply)
+{
+	for (int i = 0; i < unit_count; ++i)
+	{
+		if (unit[i].waiting == TRUE && unit[i].waiting_seq == reply->seq)
+		{
+			gateway_event_reply(&unit[i], reply);
+			return;
+		}
+		if (unit[i].quote_waiting == TRUE && unit[i].quote_seq == reply->seq)
+		{
+			unit[i].quote_waiting = FALSE;
+			/* A quote that comes after the session closed is dropped.  */
+			if (unit[i].connected == CONNECTED)
+			{
+				printf("%s", unit[i].label);
+				show_quote_reply(reply);
+			}
+			return;
+		}
+	}
+}
+
+/**
+ * @brief Ask for the running cost of every parked unit whose quote is due.
+ *
+ * @return 0 on success, -1 when a request can't be sent.
+ */
+static int gateway_request_quotes(struct gateway_unit *unit, int unit_count, int client_socket)
+{
+	uint64_t now = monotonic_us();
+
+	for (int i = 0; i < unit_count; ++i)
+	{
+		if (unit[i].connected == CONNECTED && unit[i].offline != TRUE && unit[i].waiting != TRUE &&
+			unit[i].quote_waiting != TRUE &&
+			now >= unit[i].next_quote_us && protocol_pending_count() < PROTOCOL_MAX_PENDING)
+		{
+			if (request_quote(&client_socket, unit[i].data_buff, sizeof(unit[i].data_buff), &unit[i].quote_seq) == ERROR)
+			{
+				return -1;
+			}
+			unit[i].quote_waiting = TRUE;
+			unit[i].next_quote_us = now + QUOTE_POLL_PERIOD_MS * 1000ULL;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Forget the requests of a lost connection, and close it.
+ *
+ * A unit whose event was lost keeps its status, so its next press sends the event again.
+ */
+static void gateway_link_lost(struct uplink *uplink, struct gateway_unit *unit, int unit_count)
+{
+	for (int i = 0; i < unit_count; ++i)
+	{
+		if (unit[i].waiting == TRUE)
+		{
+			unit[i].waiting = FALSE;
+			unit[i].status = (unit[i].connected == CONNECTED) ? OFF : ON;
+			printf("%sThe server can't be reached, please try again in a few seconds.\n", unit[i].label);
+		}
+		unit[i].quote_waiting = FALSE;
+	}
+	uplink_lost(uplink);
+}
+
+/**
+ * @brief Send the oldest events of the store in a HISTORY frame.
+ *
+ * @param waiting Set when a frame was sent and waits for its reply (output parameter).
+ * @param seq Pointer to store the sequence number of the frame (output parameter).
+ * @return 0 on success, -1 when the frame can't be sent.
+ */
+static int gateway_drain_store(struct store *store, int client_socket, uint8_t *waiting, uint32_t *seq)
+{
+	uint8_t records[STORE_DRAIN_BATCH * PROTOCOL_HISTORY_RECORD_SIZE];
+	uint32_t next;
+	int count = store_read(store, records, STORE_DRAIN_BATCH, &next);
+
+	if (count == ERROR)
+	{
+		return 0;
+	}
+	/* Only damaged events were read, there is nothing to send for them.  */
+	if (count == 0)
+	{
+		store_acknowledge(store, next);
+		return 0;
+	}
+	if (protocol_send_history(client_socket, records, (uint16_t)count, seq) == ERROR)
+	{
+		return -1;
+	}
+    *waiting = TRUE;
+	return 0;
+}
+
+/**
+ * @brief Handle the reply to a HISTORY frame: drop the events the server applied from the store.
+ *
+ * @param next_drain_us Pointer to the time the store may be sent next (output parameter).
+ */
+static void gateway_store_reply(struct store *store, const struct protocol_reply *reply, uint64_t *next_drain_us)
+{
+	if (reply->kind != PROTOCOL_REPLY_HISTORY || reply->status != PROTOCOL_HISTORY_OK)
+	{
+		fprintf(stderr, "The server couldn't take the stored events, error %u\n", reply->status);
+		*next_drain_us = monotonic_us() + GATEWAY_STORE_RETRY_MS * 1000ULL;
+		return;
+	}
+	store_acknowledge(store, reply->history_next);
+	printf("Stored events sent: %u applied, %u already known, %u rejected, %u still stored\n", reply->applied,
+		   reply->duplicates, reply->rejected, store_pending(store));
+}
+
+/**
+ * @brief Prepare a new connection: forget the replies of the old one and start the parked sessions again.
+ *
+ * The server takes the sessions over from the D.B, their replies are routed to no unit and dropped.
+ * A session that started offline is in the store, and is sent from there.
+ *
+ * @return 0 on success, -1 when an event can't be sent.
+ */
+static int gateway_link_made(struct gateway_unit *unit, int unit_count, int client_socket)
+{
+	uint32_t seq;
+
+	protocol_reset();
+	for (int i = 0; i < unit_count; ++i)
+	{
+		if (unit[i].connected == CONNECTED && unit[i].offline != TRUE &&
+			protocol_send_events(client_socket, unit[i].session_event, 1, &seq) == ERROR)
+		{
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Run the BBB: one unit, or a gateway of several STM units.
+ *
+ * @param uplink The connection to the server, not connected yet.
+ * @param store_path The file of the store, NULL for STORE_DEFAULT_PATH.
+ * @param unit_count Number of units.
+ * @param unit_uarts The UART and the button of every unit, "DATA_UART:BUTTON".
+ * @return 0 when the loop stops, 1 on an error in the arguments or the UARTs.
+ */
+int gateway_main(struct uplink *uplink, const char *store_path, int unit_count, char *unit_uarts[])
+{
+	/* The events the server hasn't got yet, and the HISTORY frame of them waiting for its reply.  */
+	struct store store = {.fd = -1};
+	uint8_t store_waiting = FALSE;
+	/* The zones and the tariffs pushed by the server, see snapshot.h.  */
+	struct zone_snapshot snapshot = {.valid = 0};
+	uint32_t store_seq = 0;
+	uint64_t next_drain_us = 0;
+	struct gateway_unit unit[GATEWAY_MAX_UNITS];
+	struct pollfd fds[GATEWAY_FIRST_UNIT_EVENT + 2 * GATEWAY_MAX_UNITS];
+	struct itimerspec tick = {{0, GATEWAY_TICK_MS * 1000000L}, {0, GATEWAY_TICK_MS * 1000000L}};
+	struct protocol_reply reply;
+	int timer_fd = -1, client_socket = -1, opened = 0, restart = RESTART;
+	uint8_t loop = TRUE, started = FALSE;
+	/* The connection the units were prepared for, see gateway_link_made.  */
+	uint32_t prepared = 0;
+	uint64_t next_heartbeat_us = 0;
+
+	if (unit_count < 1 || unit_count > GATEWAY_MAX_UNITS)
+	{
+		fprintf(stderr, "gateway: 1 to %d units of DATA_UART:BUTTON\n", GATEWAY_MAX_UNITS);
+		return 1;
+	}
+	for (; opened < unit_count; ++opened)
+	{
+		if (gateway_open_unit(&unit[opened], unit_uarts[opened], (unit_count > 1) ? TRUE : FALSE) == ERROR)
+		{
+			loop = QUIT;
+			++opened;
+			break;
+		}
+		init_poll_event(&fds[GATEWAY_BUTTON_EVENT(opened)], &unit[opened].button.fd);
+		init_poll_event(&fds[GATEWAY_DATA_EVENT(opened)], &unit[opened].data_fd);
+	}
+
+	/* Every timing of the loop is driven by the tick: the probes of the UART buttons,
+	   the exchanges with the STMs, the quotes, the heartbeats and the backoff of the uplink.  */
+	if (loop != QUIT && ((timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) == -1 ||
+						 timerfd_settime(timer_fd, 0, &tick, NULL) == -1))
+	{
+		perror("gateway: timerfd");
+		loop = QUIT;
+	}
+
+	/* Without the store the BBB still runs, but a press is turned away while the server can't be reached.  */
+	if (loop != QUIT && store_open(&store, store_path) == ERROR)
+	{
+		printf("The events can't be stored, the server must be reached for every parking\n");
+	}
+
+	/* One connection for all the units, kept open between their sessions and made again when lost.  */
+	if (loop != QUIT)
+	{
+		protocol_set_flags(PROTOCOL_FLAG_GATEWAY | PROTOCOL_FLAG_SNAPSHOT);
+		init_poll_event(&fds[GATEWAY_TIMER_EVENT], &timer_fd);
+		started = TRUE;
+		if (unit_count > 1)
+		{
+			printf("Gateway of %d units started\n", unit_count);
+		}
+	}
+
+	while (loop != QUIT)
+	{
+		uplink_poll_event(uplink, &fds[GATEWAY_UPLINK_EVENT]);
+		if (poll(fds, GATEWAY_FIRST_UNIT_EVENT + 2 * unit_count, -1) == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			perror("gateway: poll");
+			break;
+		}
+
+		client_socket = uplink_connected(uplink, fds[GATEWAY_UPLINK_EVENT].revents);
+		if (client_socket != -1 && uplink->connects != prepared)
+		{
+			prepared = uplink->connects;
+			next_heartbeat_us = 0;
+			store_waiting = FALSE;
+			next_drain_us = 0;
+			if (gateway_link_made(unit, unit_count, client_socket) == ERROR)
+			{
+				gateway_link_lost(uplink, unit, unit_count);
+				client_socket = -1;
+			}
+		}
+		if (client_socket != -1 && (fds[GATEWAY_UPLINK_EVENT].revents & (POLLIN | POLLHUP | POLLERR)))
+		{
+			if (protocol_complete(client_socket, &reply) == ERROR)
+			{
+				gateway_link_lost(uplink, unit, unit_count);
+				client_socket = -1;
+			}
+			else if (reply.kind == PROTOCOL_REPLY_SNAPSHOT)
+			{
+				if (snapshot_load(&snapshot, reply.snapshot, reply.snapshot_size) == 0)
+				{
+					printf("Zones and tariffs of version %u received\n", snapshot.version);
+				}
+				else
+				{
+					fprintf(stderr, "A bad snapshot of the zones was dropped\n");
+				}
+			}
+			else if (store_waiting == TRUE && reply.seq == store_seq)
+			{
+				store_waiting = FALSE;
+				gateway_store_reply(&store, &reply, &next_drain_us);
+			}
+			else
+			{
+				gateway_dispatch_reply(unit, unit_count, &reply);
+			}
+		}
+
+		for (int i = 0; i < unit_count; ++i)
+		{
+			if ((fds[GATEWAY_BUTTON_EVENT(i)].revents & POLLIN) && button_pressed(&unit[i].button) == TRUE)
+			{
+				gateway_start_exchange(&unit[i]);
+			}
+			if ((fds[GATEWAY_DATA_EVENT(i)].revents & POLLIN) &&
+				gateway_stm_data(&unit[i], client_socket, &store, &snapshot) == ERROR && client_socket != -1)
+			{
+				gateway_link_lost(uplink, unit, unit_count);
+				client_socket = -1;
+			}
+		}
+
+		if (fds[GATEWAY_TIMER_EVENT].revents & POLLIN)
+		{
+			uint64_t expirations;
+			uint64_t now = monotonic_us();
+
+			read(timer_fd, &expirations, sizeof(expirations));
+			for (int i = 0; i < unit_count; ++i)
+			{
+				button_tick(&unit[i].button);
+				if (unit[i].stm_waiting == TRUE && now >= unit[i].stm_deadline_us)
+				{
+					gateway_stm_timed_out(&unit[i]);
+				}
+			}
+			if (client_socket == -1)
+			{
+				continue;
+			}
+			if (gateway_request_quotes(unit, unit_count, client_socket) == ERROR)
+			{
+				gateway_link_lost(uplink, unit, unit_count);
+				continue;
+			}
+			/* One batch of the store at a time, the next goes once the server applied it.  */
+			if (store_pending(&store) != 0 && store_waiting != TRUE && now >= next_drain_us &&
+				protocol_pending_count() < PROTOCOL_MAX_PENDING &&
+				gateway_drain_store(&store, client_socket, &store_waiting, &store_seq) == ERROR)
+			{
+				gateway_link_lost(uplink, unit, unit_count);
+				continue;
+			}
+			/* The connection outlives the sessions, the heartbeats keep it while no unit is parked.  */
+			if (heartbeat_period != 0 && now >= next_heartbeat_us && protocol_pending_count() < PROTOCOL_MAX_PENDING)
+			{
+				if (send_heartbeat(&client_socket, NULL, 0) == ERROR)
+				{
+					gateway_link_lost(uplink, unit, unit_count);
+					continue;
+				}
+				next_heartbeat_us = now + heartbeat_period * 1000000ULL;
+			}
+			if (server_is_silent() == TRUE)
+			{
+				printf("The server stopped answering\n");
+				gateway_link_lost(uplink, unit, unit_count);
+			}
+		}
+	}
+
+	/*Closing resources*/
+	uplink_close(uplink);
+	store_close(&store);
+	if (timer_fd != -1)
+	{
+		close(timer_fd);
+	}
+	for (int i = 0; i < opened; ++i)
+	{
+		if (unit[i].data_fd != -1)
+		{
+			write(unit[i].data_fd, &restart, sizeof(restart));
+			close(unit[i].data_fd);
+		}
+		button_close(&unit[i].button);
+	}
+	printf("The end of the program\n");
+	return (started == TRUE) ? 0 : 1;
+}
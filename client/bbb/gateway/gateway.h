@@ -0,0 +1,98 @@
+/**
+ * @file 	gateway.h
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-18
+ * @brief 	Header file for the event loop of the BBB, for one unit or a gateway of several.
+ *
+ * One poll loop serves everything: a timerfd tick, the uplink, and the button
+ * and the data UART of every unit. Nothing waits in it but the poll, and
+ * a reply of the server once its first bytes came: the STM is given
+ * SMALL_DELAY to answer a press, counted by the tick, and the buttons are
+ * probed by the tick instead of a thread writing to them without a pause,
+ * or are GPIO lines whose edges wake the poll, see button.h.
+ * A single unit is a gateway of one.
+ *
+ * The STM sends its events in frames, see uart_frame.h: the data UART is
+ * read until it is empty into the ring of the unit, and every whole frame
+ * in it is handled, however the bytes were split between the reads.
+ *
+ * In gateway mode one BBB serves several STM units, each on the data UART of
+ * its STM and its own button.
+ * All the units share one persistent connection to the server, their events
+ * are sent pipelined with PROTOCOL_FLAG_GATEWAY and the server tells the
+ * sessions apart by the MAC address in every event.
+ * The replies are routed back to the units by the seq of their requests.
+ * Heartbeats keep the connection while no unit is parked. A lost connection
+ * is made again after its backoff, see tcp.h, and the parked units start
+ * their sessions again on it.
+ * While the server can't be reached a press isn't turned away: its event is
+ * kept in the store, see store.h, and the session starts or ends offline.
+ * Once connected, the store is sent in HISTORY frames of STORE_DRAIN_BATCH
+ * events, one at a time. The events of a unit reach the server in order:
+ * while the store isn't empty, and for the whole of a session that started
+ * offline, the new events go to the store behind the old ones.
+ *
+ * The connection asks for the snapshot of the zones and the tariffs with
+ * PROTOCOL_FLAG_SNAPSHOT, see snapshot.h: a START shows its city and its rate
+ * as soon as the STM frame arrives, online or offline, and the LOCATION reply
+ * confirms it later: the city of the server is the one billed.
+ *
+ * Usage: bbb_pango_client [--heartbeat SECONDS] [--server ADDRESS[:PORT],...] [--store FILE] --gateway DATA_UART:BUTTON [DATA_UART:BUTTON ...]
+ */
+#ifndef GATEWAY_PNG_H
+#define GATEWAY_PNG_H
+
+#include "./../../client.h"
+#include "./../button/button.h"
+#include "./../store/store.h"
+#include "./../snapshot/snapshot.h"
+#include "./../../../common/uart_frame/uart_frame.h"
+
+/* Every unit can have its event and its quote waiting for replies at once, and the heartbeat one more.  */
+#define GATEWAY_MAX_UNITS ((PROTOCOL_MAX_PENDING - 1) / 2)
+/* The period of the tick, and of the probes written to the buttons.  */
+#define GATEWAY_TICK_MS 20
+/* "DATA_UART: ", before the messages of a unit.  */
+#define GATEWAY_LABEL_SIZE 40
+/* The wait before the store is sent again, after the server couldn't take it.  */
+#define GATEWAY_STORE_RETRY_MS 5000
+
+/**
+ * @brief The state of one STM unit behind the gateway.
+ */
+struct gateway_unit
+{
+	char label[GATEWAY_LABEL_SIZE]; /*Before the messages of the unit, empty for a single unit*/
+	int data_fd;		/*UART of the STM*/
+	struct button button;
+	struct termios data_options;
+	uint8_t status;		/*The status sent to the STM on the next press*/
+	uint8_t connected;	/*The session of the unit has started on the server, or in the store*/
+	uint8_t offline;	/*The session started in the store, all its events go there*/
+	uint8_t stm_data_receive_error;
+	uint8_t stm_waiting;	/*The status was sent to the STM, its data is awaited*/
+	struct uart_framer framer; /*The bytes of the data UART, until they make a frame, see uart_frame.h*/
+	uint64_t stm_deadline_us; /*The STM is given up on after this*/
+	uint8_t data_buff[DATA_BUFF_SIZE]; /*The last event of the STM*/
+	uint8_t session_event[DATA_BUFF_SIZE]; /*The event that started the session*/
+	uint8_t expected_zone;	/*The zone the snapshot resolved for the last start, 0 for none*/
+	uint8_t waiting;	/*The last event waits for its reply*/
+	uint32_t waiting_seq;
+	uint8_t quote_waiting; /*A quote waits for its reply*/
+	uint32_t quote_seq;
+	uint64_t pressed_us;	  /*The time of the last button press*/
+	uint64_t next_quote_us;	  /*When the running cost is asked for next*/
+};
+
+/**
+ * @brief Run the BBB: one unit, or a gateway of several STM units.
+ *
+ * @param uplink The connection to the server, not connected yet.
+ * @param store_path The file of the store, NULL for STORE_DEFAULT_PATH.
+ * @param unit_count Number of units.
+ * @param unit_uarts The UART and the button of every unit, "DATA_UART:BUTTON".
+ * @return 0 when the loop stops, 1 on an error in the arguments or the UARTs.
+ */
+int gateway_main(struct uplink *uplink, const char *store_path, int unit_count, char *unit_uarts[]);
+
+#endif /*GATEWAY_PNG_H*/
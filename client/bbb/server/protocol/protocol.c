@@ -0,0 +1,456 @@
+/**
+ * @file 	protocol.c
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-18
+ * @brief 	Implementation of the BBB side of the v2 wire protocol.
+ */
+
+#include "protocol.h"
+
+/* Sequence number of the next frame, the server echoes it in the replies.  */
+static uint32_t next_seq = 1;
+
+/* Flags of the frames, see protocol_set_flags.  */
+static uint8_t frame_flags;
+
+/* The frames sent and not fully answered yet.  */
+static struct protocol_pending pending[PROTOCOL_MAX_PENDING];
+
+/**
+ * @brief Microseconds of the monotonic clock.
+ */
+static uint64_t protocol_now_us(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * @brief Read a little-endian field of 'size' bytes.
+ */
+static uint64_t protocol_get_le(const uint8_t *buff, uint8_t size)
+{
+	uint64_t value = 0;
+
+	for (uint8_t i = 0; i < size; ++i)
+	{
+		value |= (uint64_t)buff[i] << (8 * i);
+	}
+	return value;
+}
+
+/**
+ * @brief Write a little-endian field of 'size' bytes.
+ */
+static void protocol_put_le(uint8_t *buff, uint64_t value, uint8_t size)
+{
+	for (uint8_t i = 0; i < size; ++i)
+	{
+		buff[i] = (uint8_t)(value >> (8 * i));
+	}
+}
+
+/**
+ * @brief Receive exactly 'size' bytes.
+ *
+ * @return 0 on success, -1 on error or when the server closed the connection.
+ */
+static int protocol_receive_exact(int socket, uint8_t *buff, size_t size)
+{
+	size_t received = 0;
+
+	while (received < size)
+	{
+		ssize_t n = recv(socket, buff + received, size - received, 0);
+
+		if (n == 0)
+		{
+			fprintf(stderr, "protocol_receive_exact: the server closed the connection\n");
+			return -1;
+		}
+		if (n < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			perror("protocol_receive_exact: recv");
+			return -1;
+		}
+		received += (size_t)n;
+	}
+	return 0;
+}
+
+/**
+ * @brief Send a frame and keep a slot for the replies it waits for.
+ *
+ * @param type enum protocol_type of the frame.
+ * @param count The count field of the header.
+ * @param payload 'length' bytes after the header.
+ * @param replies Replies the frame is answered by.
+ * @return 0 on success, -1 on error.
+ */
+static int protocol_send_frame(int socket, uint8_t type, uint8_t count, const uint8_t *payload, uint16_t length,
+							   uint8_t replies, uint32_t *seq)
+{
+	uint8_t header[PROTOCOL_HEADER_SIZE];
+	struct protocol_pending *slot = NULL;
+	size_t sent = 0;
+
+	for (uint8_t i = 0; i < PROTOCOL_MAX_PENDING && slot == NULL; ++i)
+	{
+		if (pending[i].remaining == 0)
+		{
+			slot = &pending[i];
+		}
+	}
+	if (slot == NULL)
+	{
+		fprintf(stderr, "protocol_send_frame: %u frames are waiting for replies already\n", PROTOCOL_MAX_PENDING);
+		return -1;
+	}
+
+	*seq = next_seq++;
+	header[0] = PROTOCOL_V2_MAGIC;
+	header[1] = PROTOCOL_V2;
+	header[2] = type;
+	header[3] = frame_flags;
+	protocol_put_le(&header[4], *seq, 4);
+	protocol_put_le(&header[8], length, 2);
+	header[10] = count;
+	header[PROTOCOL_HEADER_CRC_OFFSET] = crc8_compute(header, PROTOCOL_HEADER_CRC_OFFSET);
+
+	/* The frame is sent in one call, so the server gets it in as few segments as possible.  */
+	while (sent < PROTOCOL_HEADER_SIZE + (size_t)length)
+	{
+		struct iovec iov[2];
+		struct msghdr message;
+		ssize_t n;
+
+		memset(&message, 0, sizeof(message));
+		message.msg_iov = iov;
+		if (sent < PROTOCOL_HEADER_SIZE)
+		{
+			iov[0].iov_base = header + sent;
+			iov[0].iov_len = PROTOCOL_HEADER_SIZE - sent;
+			iov[1].iov_base = (void *)payload;
+			iov[1].iov_len = length;
+			message.msg_iovlen = 2;
+		}
+		else
+		{
+			iov[0].iov_base = (void *)(payload + sent - PROTOCOL_HEADER_SIZE);
+			iov[0].iov_len = PROTOCOL_HEADER_SIZE + length - sent;
+			message.msg_iovlen = 1;
+		}
+		if ((n = sendmsg(socket, &message, MSG_NOSIGNAL)) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			perror("protocol_send_frame: sendmsg");
+			return -1;
+		}
+		sent += (size_t)n;
+	}
+
+	slot->seq = *seq;
+	slot->remaining = replies;
+	slot->sent_us = protocol_now_us();
+	return 0;
+}
+
+/**
+ * @brief Send an EVENTS frame.
+ *
+ * @param socket The socket connected to the server.
+ * @param events 'count' events of PROTOCOL_EVENT_SIZE bytes.
+ * @param count Number of events.
+ * @param seq Pointer to store the sequence number of the frame (output parameter).
+ * @return 0 on success, -1 on error.
+ */
+int protocol_send_events(int socket, const uint8_t *events, uint8_t count, uint32_t *seq)
+{
+	if (count == 0 || count > PROTOCOL_MAX_EVENTS)
+	{
+		fprintf(stderr, "protocol_send_events: %u events, 1 to %u\n", count, PROTOCOL_MAX_EVENTS);
+		return -1;
+	}
+	return protocol_send_frame(socket, PROTOCOL_TYPE_EVENTS, count, events, count * PROTOCOL_EVENT_SIZE, count, seq);
+}
+
+/**
+ * @brief Complete a HISTORY record: its seq, its age and its CRC-8 after the event.
+ *
+ * @param record The record, its first PROTOCOL_EVENT_SIZE bytes hold the event.
+ * @param seq The seq of the event in the store.
+ * @param age_s Seconds from the event to now.
+ */
+void protocol_put_history(uint8_t *record, uint32_t seq, uint32_t age_s)
+{
+	protocol_put_le(&record[PROTOCOL_EVENT_SIZE], seq, 4);
+	protocol_put_le(&record[PROTOCOL_EVENT_SIZE + 4], age_s, 4);
+	record[PROTOCOL_HISTORY_CRC_OFFSET] = crc8_compute(record, PROTOCOL_HISTORY_CRC_OFFSET);
+}
+
+/**
+ * @brief Send a HISTORY frame, answered by one reply.
+ *
+ * @param socket The socket connected to the server.
+ * @param records 'count' records of PROTOCOL_HISTORY_RECORD_SIZE bytes.
+ * @param count Number of records.
+ * @param seq Pointer to store the sequence number of the frame (output parameter).
+ * @return 0 on success, -1 on error.
+ */
+int protocol_send_history(int socket, const uint8_t *records, uint16_t count, uint32_t *seq)
+{
+	if (count == 0 || count > PROTOCOL_MAX_HISTORY)
+	{
+		fprintf(stderr, "protocol_send_history: %u records, 1 to %u\n", count, PROTOCOL_MAX_HISTORY);
+		return -1;
+	}
+	return protocol_send_frame(socket, PROTOCOL_TYPE_HISTORY, 0, records, count * PROTOCOL_HISTORY_RECORD_SIZE, 1,
+							   seq);
+}
+
+/**
+ * @brief Receive the payload of a SNAPSHOT frame, its header already checked.
+ *
+ * @param socket The socket connected to the server.
+ * @param header The header of the frame.
+ * @param length The length field of the header.
+ * @param reply Pointer to store the snapshot (output parameter).
+ * @return 0 on success, -1 on error.
+ */
+static int protocol_receive_snapshot(int socket, const uint8_t *header, uint16_t length, struct protocol_reply *reply)
+{
+	/* Kept until the next receive, the caller loads it before asking for another reply.  */
+	static uint8_t snapshot[PROTOCOL_MAX_SNAPSHOT];
+
+	if (header[10] != 0 || length == 0 || length > sizeof(snapshot))
+	{
+		fprintf(stderr, "protocol_receive_reply: bad snapshot header\n");
+		return -1;
+	}
+	if (protocol_receive_exact(socket, snapshot, length) == -1)
+	{
+		return -1;
+	}
+	memset(reply, 0, sizeof(*reply));
+	reply->seq = (uint32_t)protocol_get_le(&header[4], 4);
+	reply->kind = PROTOCOL_REPLY_SNAPSHOT;
+	reply->snapshot = snapshot;
+	reply->snapshot_size = length;
+	return 0;
+}
+
+/**
+ * @brief Receive one REPLY frame.
+ *
+ * @param socket The socket connected to the server.
+ * @param reply Pointer to store the reply (output parameter).
+ * @return 0 on success, -1 on error or when the server closed the connection.
+ */
+int protocol_receive_reply(int socket, struct protocol_reply *reply)
+{
+	uint8_t header[PROTOCOL_HEADER_SIZE];
+	uint8_t record[PROTOCOL_RECORD_HEADER_SIZE + PROTOCOL_MAX_RECORD_DATA];
+	uint8_t *data = &record[PROTOCOL_RECORD_HEADER_SIZE];
+	uint16_t length;
+
+	if (protocol_receive_exact(socket, header, sizeof(header)) == -1)
+	{
+		return -1;
+	}
+	length = (uint16_t)protocol_get_le(&header[8], 2);
+	if (header[0] == PROTOCOL_V2_MAGIC && header[1] == PROTOCOL_V2 && header[2] == PROTOCOL_TYPE_SNAPSHOT &&
+		header[PROTOCOL_HEADER_CRC_OFFSET] == crc8_compute(header, PROTOCOL_HEADER_CRC_OFFSET))
+	{
+		return protocol_receive_snapshot(socket, header, length, reply);
+	}
+	if (header[0] != PROTOCOL_V2_MAGIC || header[1] != PROTOCOL_V2 || header[2] != PROTOCOL_TYPE_REPLY ||
+		header[10] != 1 || length < PROTOCOL_RECORD_HEADER_SIZE || length > sizeof(record) ||
+		header[PROTOCOL_HEADER_CRC_OFFSET] != crc8_compute(header, PROTOCOL_HEADER_CRC_OFFSET))
+	{
+		fprintf(stderr, "protocol_receive_reply: bad reply header\n");
+		return -1;
+	}
+	if (protocol_receive_exact(socket, record, length) == -1)
+	{
+		return -1;
+	}
+	if (record[2] != length - PROTOCOL_RECORD_HEADER_SIZE)
+	{
+		fprintf(stderr, "protocol_receive_reply: bad record length\n");
+		return -1;
+	}
+
+	memset(reply, 0, sizeof(*reply));
+	reply->seq = (uint32_t)protocol_get_le(&header[4], 4);
+	reply->status = record[0];
+	reply->index = record[1];
+	switch (record[2])
+	{
+	case PROTOCOL_LOCATION_KEY_DATA_SIZE:
+		reply->has_udp_key = 1;
+		memcpy(reply->udp_key, &data[PROTOCOL_LOCATION_DATA_SIZE], PROTOCOL_UDP_KEY_SIZE);
+		/* fall through */
+	case PROTOCOL_LOCATION_DATA_SIZE:
+		reply->kind = PROTOCOL_REPLY_LOCATION;
+		reply->zone_id = (uint16_t)protocol_get_le(data, 2);
+		memcpy(reply->location, &data[2], PROTOCOL_LOCATION_SIZE);
+		break;
+	case PROTOCOL_AMOUNT_DATA_SIZE:
+		reply->kind = PROTOCOL_REPLY_AMOUNT;
+		reply->charge = (int64_t)protocol_get_le(data, 8);
+		reply->seconds = (int64_t)protocol_get_le(&data[8], 8);
+		break;
+	case PROTOCOL_HISTORY_DATA_SIZE:
+		reply->kind = PROTOCOL_REPLY_HISTORY;
+		reply->history_next = (uint32_t)protocol_get_le(data, 4);
+		reply->applied = (uint16_t)protocol_get_le(&data[4], 2);
+		reply->duplicates = (uint16_t)protocol_get_le(&data[6], 2);
+		reply->rejected = (uint16_t)protocol_get_le(&data[8], 2);
+		break;
+	default:
+		reply->kind = PROTOCOL_REPLY_ERROR;
+		break;
+	}
+	return 0;
+}
+
+/**
+ * @brief Set the flags of the frames sent from now on.
+ *
+ * @param flags PROTOCOL_FLAG_GATEWAY, PROTOCOL_FLAG_SNAPSHOT, PROTOCOL_FLAG_UDP_KEY or 0.
+ */
+void protocol_set_flags(uint8_t flags)
+{
+	frame_flags = flags;
+}
+
+/**
+ * @brief Forget the frames waiting for replies, when a new connection is made.
+ */
+void protocol_reset(void)
+{
+	memset(pending, 0, sizeof(pending));
+}
+
+/**
+ * @brief Number of frames waiting for replies.
+ */
+uint8_t protocol_pending_count(void)
+{
+	uint8_t count = 0;
+
+	for (uint8_t i = 0; i < PROTOCOL_MAX_PENDING; ++i)
+	{
+		count += (pending[i].remaining != 0);
+	}
+	return count;
+}
+
+/**
+ * @brief Monotonic time, in microseconds, the oldest frame waiting for replies was sent.
+ *
+ * @return The time, 0 when no frame is waiting.
+ */
+uint64_t protocol_oldest_pending_us(void)
+{
+	uint64_t oldest = 0;
+
+	for (uint8_t i = 0; i < PROTOCOL_MAX_PENDING; ++i)
+	{
+		if (pending[i].remaining != 0 && (oldest == 0 || pending[i].sent_us < oldest))
+		{
+			oldest = pending[i].sent_us;
+		}
+	}
+	return oldest;
+}
+
+/**
+ * @brief Receive the next reply, to any of the frames waiting for one.
+ *
+ * The replies may come in any order, they are matched by their sequence number.
+ * A snapshot answers no frame, it is returned with the kind PROTOCOL_REPLY_SNAPSHOT.
+ *
+ * @param socket The socket connected to the server.
+ * @param reply Pointer to store the reply, with its round trip time (output parameter).
+ * @return 0 on success, -1 on error or on a reply to no frame that was sent.
+ */
+int protocol_complete(int socket, struct protocol_reply *reply)
+{
+	if (protocol_receive_reply(socket, reply) == -1)
+	{
+		return -1;
+	}
+	/* A snapshot answers no frame, it is passed on as it is.  */
+	if (reply->kind == PROTOCOL_REPLY_SNAPSHOT)
+	{
+		return 0;
+	}
+	for (uint8_t i = 0; i < PROTOCOL_MAX_PENDING; ++i)
+	{
+		if (pending[i].remaining != 0 && pending[i].seq == reply->seq)
+		{
+			reply->rtt_us = (uint32_t)(protocol_now_us() - pending[i].sent_us);
+			--pending[i].remaining;
+			return 0;
+		}
+	}
+	fprintf(stderr, "protocol_complete: reply to frame %u, which isn't waiting for one\n", reply->seq);
+	return -1;
+}
+
+/**
+ * @brief Wait for the reply to a frame.
+ *
+ * Replies to other frames that come first are passed to 'handler'.
+ *
+ * @param socket The socket connected to the server.
+ * @param seq The sequence number of the frame.
+ * @param reply Pointer to store the reply (output parameter).
+ * @param handler Function called with the other replies, may be NULL.
+ * @return 0 on success, -1 on error.
+ */
+int protocol_wait(int socket, uint32_t seq, struct protocol_reply *reply, protocol_reply_handler handler)
+{
+	while (protocol_complete(socket, reply) == 0)
+	{
+		if (reply->seq == seq && reply->kind != PROTOCOL_REPLY_SNAPSHOT)
+		{
+			return 0;
+		}
+		if (handler != NULL)
+		{
+			handler(reply);
+		}
+	}
+	return -1;
+}
+
+/**
+ * @brief Send one event and wait for its reply.
+ *
+ * @param socket The socket connected to the server.
+ * @param event The event, PROTOCOL_EVENT_SIZE bytes.
+ * @param reply Pointer to store the reply (output parameter).
+ * @param handler Function called with the replies to earlier frames that come first, may be NULL.
+ * @return 0 on success, -1 on error.
+ */
+int protocol_request(int socket, const uint8_t *event, struct protocol_reply *reply, protocol_reply_handler handler)
+{
+	uint32_t seq;
+
+	if (protocol_send_events(socket, event, 1, &seq) == -1)
+	{
+		return -1;
+	}
+	return protocol_wait(socket, seq, reply, handler);
+}
@@ -0,0 +1,238 @@
+/**
+ * @file 	protocol.h
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-18
+ * @brief 	Header file for the BBB side of the v2 wire protocol.
+ *
+ * Every request is an EVENTS frame:
+ *	 ______________________________________________________________________
+ *	| magic | version | type | flags | seq      | length   | count | crc8 |
+ *	|   1   |    1    |  1   |   1   | 4        | 2        |   1   |  1   |
+ *	|_______|_________|______|_______|__________|__________|_______|______|
+ * followed by 'count' 10 byte events, the same events the STM sends.
+ * The server answers each event with a REPLY frame that has the seq of the request
+ * and one record: status, index of the event, data length and data.
+ * Up to PROTOCOL_MAX_PENDING frames may wait for their replies at once,
+ * the replies are matched to them by the seq, in whatever order they come.
+ * Multi-byte fields are little-endian. Must match server/protocol/protocol.h.
+ * In gateway mode every frame has PROTOCOL_FLAG_GATEWAY, the server then keeps
+ * the connection open and tells the sessions of the units apart by their MAC.
+ *
+ * The events stored while the server couldn't be reached, see store.h, are
+ * sent in HISTORY frames of up to PROTOCOL_MAX_HISTORY records, more than
+ * the count field holds, so it is 0 and the records are 'length' / 19:
+ *	 ____________________________________
+ *	| event | seq      | age      | crc8 |
+ *	|  10   | 4        | 4        |  1   |
+ *	|_______|__________|__________|______|
+ * 'seq' is the seq of the record in the store of the BBB, the server applies
+ * a (MAC, seq) once however often it comes; 'age' is the seconds from the
+ * event to the send of the frame. The CRC-8 covers the first 18 bytes.
+ * The server applies the whole frame at once, and answers it with one REPLY
+ * record of PROTOCOL_HISTORY_DATA_SIZE: the seq after the last record applied,
+ * and the records applied, the duplicates and the rejected ones.
+ *
+ * With PROTOCOL_FLAG_SNAPSHOT the server also sends SNAPSHOT frames, seq 0 and
+ * count 0, with the zone index and the tariffs, see snapshot.h. One comes before
+ * the first reply and another whenever the tariff version changed.
+ *
+ * With PROTOCOL_FLAG_UDP_KEY the reply to the start of a session has the UDP key
+ * of the unit after the location, the key its datagrams are tagged with, see
+ * server/udp/udp_ingest.h. It is good until the session ends.
+ */
+#ifndef PROTOCOL_PNG_H
+#define PROTOCOL_PNG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include "../../../../common/crc8/crc8.h"
+
+#define PROTOCOL_V2 2
+#define PROTOCOL_V2_MAGIC 0xA5
+#define PROTOCOL_HEADER_SIZE 12
+#define PROTOCOL_HEADER_CRC_OFFSET 11
+#define PROTOCOL_EVENT_SIZE 10
+#define PROTOCOL_MAX_EVENTS 64
+#define PROTOCOL_RECORD_HEADER_SIZE 3
+#define PROTOCOL_MAX_RECORD_DATA 255
+#define PROTOCOL_LOCATION_SIZE 12
+#define PROTOCOL_LOCATION_DATA_SIZE (2 + PROTOCOL_LOCATION_SIZE)
+#define PROTOCOL_UDP_KEY_SIZE 16
+#define PROTOCOL_LOCATION_KEY_DATA_SIZE (PROTOCOL_LOCATION_DATA_SIZE + PROTOCOL_UDP_KEY_SIZE)
+#define PROTOCOL_AMOUNT_DATA_SIZE 16
+#define PROTOCOL_MINOR_UNITS_PER_MAJOR 100
+#define PROTOCOL_FLAG_GATEWAY 0x02
+#define PROTOCOL_FLAG_SNAPSHOT 0x04
+#define PROTOCOL_FLAG_UDP_KEY 0x08
+#define PROTOCOL_MAX_SNAPSHOT 4096
+#define PROTOCOL_HISTORY_RECORD_SIZE 19
+#define PROTOCOL_HISTORY_CRC_OFFSET 18
+#define PROTOCOL_MAX_HISTORY 3072
+#define PROTOCOL_HISTORY_DATA_SIZE 10
+/* Status of the reply to a HISTORY frame that was applied.  */
+#define PROTOCOL_HISTORY_OK 0
+/* Frames sent and not answered yet at most.  */
+#define PROTOCOL_MAX_PENDING 8
+
+enum protocol_type
+{
+	PROTOCOL_TYPE_EVENTS = 1, /*BBB to server*/
+	PROTOCOL_TYPE_REPLY = 2,  /*Server to BBB*/
+	PROTOCOL_TYPE_HISTORY = 3, /*BBB to server, the stored events*/
+	PROTOCOL_TYPE_SNAPSHOT = 4, /*Server to BBB, the zone index and the tariffs*/
+};
+
+/**
+ * @brief A reply of the server to one event.
+ */
+struct protocol_reply
+{
+	uint8_t status;	 /*Status of the answered event, or the error of the server*/
+	uint8_t index;	 /*Index of the answered event in its frame*/
+	uint32_t seq;	 /*Sequence number of the answered frame*/
+	uint8_t kind;	 /*Which of the fields below are set, see enum protocol_reply_kind*/
+	uint16_t zone_id;
+	char location[PROTOCOL_LOCATION_SIZE];
+	uint8_t has_udp_key; /*The location came with the UDP key of the unit*/
+	uint8_t udp_key[PROTOCOL_UDP_KEY_SIZE];
+	int64_t charge;	 /*Minor units*/
+	int64_t seconds;
+	uint32_t history_next; /*The seq after the last stored event applied*/
+	uint16_t applied;	   /*Stored events applied, duplicates and rejected ones*/
+	uint16_t duplicates;
+	uint16_t rejected;
+	uint32_t rtt_us; /*Microseconds from the send of the frame to this reply*/
+	const uint8_t *snapshot; /*The SNAPSHOT payload, valid until the next receive*/
+	uint16_t snapshot_size;
+};
+
+/**
+ * @brief A frame waiting for its replies.
+ */
+struct protocol_pending
+{
+	uint32_t seq;
+	uint8_t remaining; /*Replies still to come, 0 when the slot is free*/
+	uint64_t sent_us;  /*Monotonic time the frame was sent*/
+};
+
+typedef void (*protocol_reply_handler)(const struct protocol_reply *reply);
+
+enum protocol_reply_kind
+{
+	PROTOCOL_REPLY_ERROR = 0,
+	PROTOCOL_REPLY_LOCATION = 1,
+	PROTOCOL_REPLY_AMOUNT = 2,
+	PROTOCOL_REPLY_HISTORY = 3,
+	PROTOCOL_REPLY_SNAPSHOT = 4, /*A SNAPSHOT frame, answers no frame*/
+};
+
+/**
+ * @brief Send an EVENTS frame.
+ *
+ * @param socket The socket connected to the server.
+ * @param events 'count' events of PROTOCOL_EVENT_SIZE bytes.
+ * @param count Number of events.
+ * @param seq Pointer to store the sequence number of the frame (output parameter).
+ * @return 0 on success, -1 on error.
+ */
+int protocol_send_events(int socket, const uint8_t *events, uint8_t count, uint32_t *seq);
+
+/**
+ * @brief Complete a HISTORY record: its seq, its age and its CRC-8 after the event.
+ *
+ * @param record The record, its first PROTOCOL_EVENT_SIZE bytes hold the event.
+ * @param seq The seq of the event in the store.
+ * @param age_s Seconds from the event to now.
+ */
+void protocol_put_history(uint8_t *record, uint32_t seq, uint32_t age_s);
+
+/**
+ * @brief Send a HISTORY frame, answered by one reply.
+ *
+ * @param socket The socket connected to the server.
+ * @param records 'count' records of PROTOCOL_HISTORY_RECORD_SIZE bytes.
+ * @param count Number of records.
+ * @param seq Pointer to store the sequence number of the frame (output parameter).
+ * @return 0 on success, -1 on error.
+ */
+int protocol_send_history(int socket, const uint8_t *records, uint16_t count, uint32_t *seq);
+
+/**
+ * @brief Receive one REPLY frame.
+ *
+ * @param socket The socket connected to the server.
+ * @param reply Pointer to store the reply (output parameter).
+ * @return 0 on success, -1 on error or when the server closed the connection.
+ */
+int protocol_receive_reply(int socket, struct protocol_reply *reply);
+
+/**
+ * @brief Set the flags of the frames sent from now on.
+ * @param flags PROTOCOL_FLAG_GATEWAY, PROTOCOL_FLAG_SNAPSHOT, PROTOCOL_FLAG_UDP_KEY or 0.
+ * @param flags PROTOCOL_FLAG_GATEWAY, PROTOCOL_FLAG_SNAPSHOT or 0.
+ */
+void protocol_set_flags(uint8_t flags);
+
+/**
+ * @brief Forget the frames waiting for replies, when a new connection is made.
+ */
+void protocol_reset(void);
+
+/**
+ * @brief Number of frames waiting for replies.
+ */
+uint8_t protocol_pending_count(void);
+
+/**
+ * @brief Monotonic time, in microseconds, the oldest frame waiting for replies was sent.
+ *
+ * The server answers every frame, heartbeats too, so an old one means it stopped answering.
+ *
+ * @return The time, 0 when no frame is waiting.
+ */
+uint64_t protocol_oldest_pending_us(void);
+
+/**
+ * @brief Receive the next reply, to any of the frames waiting for one.
+ *
+ * The replies may come in any order, they are matched by their sequence number.
+ * A snapshot answers no frame, it is returned with the kind PROTOCOL_REPLY_SNAPSHOT.
+ *
+ * @param socket The socket connected to the server.
+ * @param reply Pointer to store the reply, with its round trip time (output parameter).
+ * @return 0 on success, -1 on error or on a reply to no frame that was sent.
+ */
+int protocol_complete(int socket, struct protocol_reply *reply);
+
+/**
+ * @brief Wait for the reply to a frame.
+ *
+ * Replies to other frames that come first are passed to 'handler'.
+ *
+ * @param socket The socket connected to the server.
+ * @param seq The sequence number of the frame.
+ * @param reply Pointer to store the reply (output parameter).
+ * @param handler Function called with the other replies, may be NULL.
+ * @return 0 on success, -1 on error.
+ */
+int protocol_wait(int socket, uint32_t seq, struct protocol_reply *reply, protocol_reply_handler handler);
+
+/**
+ * @brief Send one event and wait for its reply.
+ *
+ * @param socket The socket connected to the server.
+ * @param event The event, PROTOCOL_EVENT_SIZE bytes.
+ * @param reply Pointer to store the reply (output parameter).
+ * @param handler Function called with the replies to earlier frames that come first, may be NULL.
+ * @return 0 on success, -1 on error.
+ */
+int protocol_request(int socket, const uint8_t *event, struct protocol_reply *reply, protocol_reply_handler handler);
+
+#endif /*PROTOCOL_PNG_H*/
@@ -10,38 +10,290 @@
 #include "tcp.h"
 
 /**
- * @brief Connects to a Pango server using TCP/IP.
- *
- * This function creates a socket, sets up the server address,
- * and connects to the Pango server.
+ * @brief Microseconds of the monotonic clock.
+ */
+static uint64_t uplink_now_us(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * @brief Parse one endpoint, "ADDRESS[:PORT]".
  *
- * @param   client_socket Pointer to store the client socket file descriptor.
- * @param   server_arg Pointer to a sockaddr_in structure containing server details.
- * @return  0 on successful connection, -1 on failure.
+ * @return 0 on success, -1 on error.
  */
-uint8_t connect_to_pango_server(int *client_socket, struct sockaddr_in *server_arg)
+static int uplink_parse_endpoint(struct sockaddr_in *endpoint, char *text)
 {
-	struct sockaddr_in *server_addr = (struct sockaddr_in *)(server_arg);
-	socklen_t server_addr_len = sizeof(*server_addr);
+	char *port = strchr(text, ':');
+	long port_number = UPLINK_DEFAULT_PORT;
 
-	if ((*client_socket = socket(AF_INET, SOCK_STREAM, 0)) == -1)
+	if (port != NULL)
 	{
-		perror("socket");
-		exit(EXIT_FAILURE);
+		char *end;
+
+		*port++ = '\0';
+		port_number = strtol(port, &end, 10);
+		if (*port == '\0' || *end != '\0' || port_number < 1 || port_number > 65535)
+		{
+			fprintf(stderr, "uplink: '%s' is not a port\n", port);
+			return -1;
+		}
+	}
+	memset(endpoint, 0, sizeof(*endpoint));
+	endpoint->sin_family = AF_INET;
+	endpoint->sin_port = htons((uint16_t)port_number);
+	if (inet_pton(AF_INET, text, &endpoint->sin_addr) != 1)
+	{
+		fprintf(stderr, "uplink: '%s' is not an IPv4 address\n", text);
+		return -1;
 	}
+	return 0;
+}
+
+/**
+ * @brief Initialize an uplink, not connected yet.
+ *
+ * @param link Pointer to the uplink.
+ * @param endpoints The servers, "ADDRESS[:PORT],ADDRESS[:PORT]...", NULL for UPLINK_DEFAULT_ENDPOINTS.
+ * @return 0 on success, -1 on an error in the endpoints.
+ */
+int uplink_init(struct uplink *link, const char *endpoints)
+{
+	char list[UPLINK_MAX_ENDPOINTS * (INET_ADDRSTRLEN + 7)];
+	char *save = NULL;
 
-	/*Defining the server address*/
-	memset(server_addr, 0, sizeof(*server_addr));
-	server_addr->sin_family = AF_INET;
-	server_addr->sin_port = htons(55152);
-	server_addr->sin_addr.s_addr = inet_addr("10.0.2.15");
+	memset(link, 0, sizeof(*link));
+	link->fd = -1;
+	link->backoff_ms = UPLINK_BACKOFF_INITIAL_MS;
+	/* BBBs started together by the same power cut mustn't draw the same jitter.  */
+	link->seed = (unsigned int)(uplink_now_us() ^ ((uint64_t)getpid() << 16));
 
-	/*Trying to connect to the server*/
-	if (connect(*client_socket, (struct sockaddr *)server_addr, server_addr_len) == -1)
+	if (endpoints == NULL)
+	{
+		endpoints = UPLINK_DEFAULT_ENDPOINTS;
+	}
+	if (strlen(endpoints) >= sizeof(list))
 	{
-		perror("connect");
-		/* Wasnt able to connect to the pango server */
+		fprintf(stderr, "uplink: the list of servers is too long\n");
+		return -1;
+	}
+	strcpy(list, endpoints);
+	for (char *text = strtok_r(list, ",", &save); text != NULL; text = strtok_r(NULL, ",", &save))
+	{
+		if (link->endpoint_count == UPLINK_MAX_ENDPOINTS)
+		{
+			fprintf(stderr, "uplink: at most %d servers\n", UPLINK_MAX_ENDPOINTS);
+			return -1;
+		}
+		if (uplink_parse_endpoint(&link->endpoint[link->endpoint_count], text) == -1)
+		{
+			return -1;
+		}
+		++link->endpoint_count;
+	}
+	if (link->endpoint_count == 0)
+	{
+		fprintf(stderr, "uplink: no server given\n");
 		return -1;
 	}
 	return 0;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Print the endpoint being connected to with a message.
+ */
+static void uplink_report(const struct uplink *link, const char *message)
+{
+	char address[INET_ADDRSTRLEN];
+
+	inet_ntop(AF_INET, &link->endpoint[link->current].sin_addr, address, sizeof(address));
+	printf("uplink: %s:%u: %s\n", address, ntohs(link->endpoint[link->current].sin_port), message);
+}
+
+/**
+ * @brief Set the time of the next round: the backoff, with jitter, and double the backoff.
+ */
+static void uplink_backoff(struct uplink *link)
+{
+	/* Half of the backoff is kept, so the rounds never come in a burst, and half is random.  */
+	uint32_t wait_ms = link->backoff_ms / 2 + (uint32_t)rand_r(&link->seed) % (link->backoff_ms / 2 + 1);
+
+	link->state = UPLINK_IDLE;
+	link->deadline_us = uplink_now_us() + wait_ms * 1000ULL;
+	link->backoff_ms = (link->backoff_ms * 2 < UPLINK_BACKOFF_MAX_MS) ? link->backoff_ms * 2 : UPLINK_BACKOFF_MAX_MS;
+	printf("The server can't be reached, trying again in %.1f s\n", wait_ms / 1000.0);
+}
+
+/**
+ * @brief The connect to the current endpoint failed: try the next one, or wait for the backoff after a round.
+ */
+static void uplink_endpoint_failed(struct uplink *link, int error);
+
+/**
+ * @brief Start a non-blocking connect to the current endpoint.
+ */
+static void uplink_start_connect(struct uplink *link)
+{
+	int flags;
+
+	if ((link->fd = socket(AF_INET, SOCK_STREAM, 0)) == -1)
+	{
+		perror("uplink: socket");
+		uplink_endpoint_failed(link, errno);
+		return;
+	}
+	flags = fcntl(link->fd, F_GETFL, 0);
+	if (flags == -1 || fcntl(link->fd, F_SETFL, flags | O_NONBLOCK) == -1)
+	{
+		perror("uplink: fcntl");
+		uplink_endpoint_failed(link, errno);
+		return;
+	}
+	link->state = UPLINK_CONNECTING;
+	link->deadline_us = uplink_now_us() + UPLINK_CONNECT_TIMEOUT_MS * 1000ULL;
+
+	/*Trying to connect to the server, the end of the connect is polled for*/
+	if (connect(link->fd, (const struct sockaddr *)&link->endpoint[link->current], sizeof(link->endpoint[0])) == -1 &&
+		errno != EINPROGRESS)
+	{
+		uplink_endpoint_failed(link, errno);
+	}
+}
+
+static void uplink_endpoint_failed(struct uplink *link, int error)
+{
+	uplink_report(link, strerror(error));
+	if (link->fd != -1)
+	{
+		close(link->fd);
+		link->fd = -1;
+	}
+	link->current = (link->current + 1) % link->endpoint_count;
+	if (++link->tried < link->endpoint_count)
+	{
+		uplink_start_connect(link);
+	}
+	else
+	{
+		uplink_backoff(link);
+	}
+}
+
+/**
+ * @brief The connect succeeded: set the options of the connection.
+ *
+ * The socket is made blocking again, with UPLINK_IO_TIMEOUT_MS timeouts: the frames
+ * of the protocol are read whole once poll shows their first bytes.
+ */
+static void uplink_finish_connect(struct uplink *link)
+{
+	struct timeval io_timeout = {UPLINK_IO_TIMEOUT_MS / 1000, (UPLINK_IO_TIMEOUT_MS % 1000) * 1000};
+	int flags = fcntl(link->fd, F_GETFL, 0), on = 1;
+
+	/* The events are small frames that wait for their replies, Nagle would only delay them.
+	   The keepalive finds a dead peer while no heartbeats are sent.  */
+	if (flags == -1 || fcntl(link->fd, F_SETFL, flags & ~O_NONBLOCK) == -1 ||
+		setsockopt(link->fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)) == -1 ||
+		setsockopt(link->fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on)) == -1 ||
+		setsockopt(link->fd, SOL_SOCKET, SO_RCVTIMEO, &io_timeout, sizeof(io_timeout)) == -1 ||
+		setsockopt(link->fd, SOL_SOCKET, SO_SNDTIMEO, &io_timeout, sizeof(io_timeout)) == -1)
+	{
+		perror("uplink: setsockopt");
+		uplink_endpoint_failed(link, errno);
+		return;
+	}
+	link->state = UPLINK_CONNECTED;
+	link->backoff_ms = UPLINK_BACKOFF_INITIAL_MS;
+	++link->connects;
+	uplink_report(link, "connected");
+}
+
+/**
+ * @brief Set the poll event of the uplink, a connect is started first when one is due.
+ *
+ * A round tries every endpoint once, from the one connected to last.
+ *
+ * @param link Pointer to the uplink.
+ * @param event The poll event: POLLOUT while connecting, POLLIN when connected, fd -1 when idle (output parameter).
+ */
+void uplink_poll_event(struct uplink *link, struct pollfd *event)
+{
+	if (link->state == UPLINK_IDLE && uplink_now_us() >= link->deadline_us)
+	{
+		link->tried = 0;
+		uplink_start_connect(link);
+	}
+	event->fd = link->fd;
+	event->events = (link->state == UPLINK_CONNECTING) ? POLLOUT : POLLIN;
+	event->revents = 0;
+}
+
+/**
+ * @brief Carry the connect in progress on after a poll, and get the socket once connected.
+ *
+ * @param link Pointer to the uplink.
+ * @param revents The revents of the poll event of the uplink.
+ * @return The socket when connected, -1 otherwise.
+ */
+int uplink_connected(struct uplink *link, short revents)
+{
+	if (link->state == UPLINK_CONNECTING)
+	{
+		int error = 0;
+		socklen_t error_len = sizeof(error);
+
+		if (revents & (POLLOUT | POLLERR | POLLHUP))
+		{
+			if (getsockopt(link->fd, SOL_SOCKET, SO_ERROR, &error, &error_len) == -1)
+			{
+				error = errno;
+			}
+			if (error == 0)
+			{
+				uplink_finish_connect(link);
+			}
+			else
+			{
+				uplink_endpoint_failed(link, error);
+			}
+		}
+		else if (uplink_now_us() >= link->deadline_us)
+		{
+			uplink_endpoint_failed(link, ETIMEDOUT);
+		}
+	}
+	return (link->state == UPLINK_CONNECTED) ? link->fd : -1;
+}
+
+/**
+ * @brief Close the connection after an error on it, the next round waits for the backoff.
+ *
+ * The next round starts from the next endpoint, the one that was lost is tried last.
+ *
+ * @param link Pointer to the uplink.
+ */
+void uplink_lost(struct uplink *link)
+{
+	uplink_close(link);
+	link->current = (link->current + 1) % link->endpoint_count;
+	printf("The connection to the server is lost\n");
+	uplink_backoff(link);
+}
+
+/**
+ * @brief Close the connection, when the program ends.
+ *
+ * @param link Pointer to the uplink.
+ */
+void uplink_close(struct uplink *link)
+{
+	if (link->fd != -1)
+	{
+		close(link->fd);
+		link->fd = -1;
+	}
+	link->state = UPLINK_IDLE;
+}
@@ -4,6 +4,14 @@
  * @date 	2024-01-05
  * @brief 	Header file for TCP/IP communication functions.
  *
+ * The BBB keeps one persistent connection to the server, the uplink, open
+ * between the parking sessions. It is connected without blocking, from the
+ * event loop of the BBB: the connect in progress is polled for POLLOUT and
+ * given UPLINK_CONNECT_TIMEOUT_MS, and the endpoints of the list are tried
+ * in turn. When they all fail, or the connection is lost, the next round
+ * waits for an exponential backoff with jitter, so many BBBs that lost the
+ * server together don't all come back in the same second.
+ *
  * @copyright Copyright (c) 2024
  */
 #ifndef TCP_PNG_H
@@ -14,24 +22,90 @@
 #include <stdlib.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
 #include "./../../../png_enums.h"
 
-/* Creating a struct for the server information regarding network.  */
-extern struct sockaddr_in server_addr;
+/* The server when no --server is given.  */
+#define UPLINK_DEFAULT_ENDPOINTS	"10.0.2.15:55152"
+#define UPLINK_DEFAULT_PORT			55152
+#define UPLINK_MAX_ENDPOINTS		4
+/* The longest a connect to one endpoint may take.  */
+#define UPLINK_CONNECT_TIMEOUT_MS	2000
+/* The longest a send or a receive on the connection may block, a request to a dead server fails instead.  */
+#define UPLINK_IO_TIMEOUT_MS		5000
+/* The backoff after the first failed round, doubled by every failed round up to UPLINK_BACKOFF_MAX_MS.  */
+#define UPLINK_BACKOFF_INITIAL_MS	500
+#define UPLINK_BACKOFF_MAX_MS		30000
+
+enum uplink_state
+{
+	UPLINK_IDLE,	   /*Not connected, waiting for the backoff*/
+	UPLINK_CONNECTING, /*A connect is in progress*/
+	UPLINK_CONNECTED
+};
+
+/**
+ * @brief The connection of the BBB to the server.
+ */
+struct uplink
+{
+	struct sockaddr_in endpoint[UPLINK_MAX_ENDPOINTS];
+	int endpoint_count;
+	int current;		  /*The endpoint connected to, or tried now, or tried first on the next round*/
+	int tried;			  /*Endpoints that failed in the current round*/
+	int fd;				  /*-1 while idle*/
+	uint8_t state;		  /*enum uplink_state*/
+	uint32_t connects;	  /*Connections made, a new connection shows as a change of it*/
+	uint32_t backoff_ms;  /*The wait after the next failed round, before the jitter*/
+	uint64_t deadline_us; /*The end of the connect in progress, or of the backoff*/
+	unsigned int seed;	  /*Of the jitter*/
+};
 
 /**
- * @brief Connects to a Pango server using TCP/IP.
+ * @brief Initialize an uplink, not connected yet.
  *
- * This function creates a socket, sets up the server address,
- * and connects to the Pango server.
+ * @param link Pointer to the uplink.
+ * @param endpoints The servers, "ADDRESS[:PORT],ADDRESS[:PORT]...", NULL for UPLINK_DEFAULT_ENDPOINTS.
+ * @return 0 on success, -1 on an error in the endpoints.
+ */
+int uplink_init(struct uplink *link, const char *endpoints);
+
+/**
+ * @brief Set the poll event of the uplink, a connect is started first when one is due.
  *
- * @param   client_socket Pointer to store the client socket file descriptor.
- * @param   server_arg Pointer to a sockaddr_in structure containing server details.
+ * @param link Pointer to the uplink.
+ * @param event The poll event: POLLOUT while connecting, POLLIN when connected, fd -1 when idle (output parameter).
+ */
+void uplink_poll_event(struct uplink *link, struct pollfd *event);
+
+/**
+ * @brief Carry the connect in progress on after a poll, and get the socket once connected.
+ *
+ * @param link Pointer to the uplink.
+ * @param revents The revents of the poll event of the uplink.
+ * @return The socket when connected, -1 otherwise.
+ */
+int uplink_connected(struct uplink *link, short revents);
+
+/**
+ * @brief Close the connection after an error on it, the next round waits for the backoff.
+ *
+ * @param link Pointer to the uplink.
+ */
+void uplink_lost(struct uplink *link);
+
+/**
+ * @brief Close the connection, when the program ends.
  *
- * @return  0 on successful connection, -1 on failure.
+ * @param link Pointer to the uplink.
  */
-uint8_t connect_to_pango_server(int *client_socket, struct sockaddr_in *server_arg);
+void uplink_close(struct uplink *link);
 
-#endif /*TCP_PNG_H*/
\ No newline at end of file
+#endif /*TCP_PNG_H*/
@@ -0,0 +1,151 @@
+/**
+ * @file 	snapshot.c
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-19
+ * @brief 	Implementation of the zone and tariff snapshot kept by the BBB.
+ */
+
+#include "snapshot.h"
+
+/**
+ * @brief Read a little-endian field.
+ */
+static uint32_t snapshot_get_le(const uint8_t *data, uint8_t size)
+{
+	uint32_t value = 0;
+
+	for (uint8_t i = 0; i < size; ++i)
+	{
+		value |= (uint32_t)data[i] << (8 * i);
+	}
+	return value;
+}
+
+/**
+ * @brief Take a snapshot pushed by the server.
+ *
+ * A snapshot that fails its CRC-8 or its bounds leaves none valid.
+ *
+ * @param snapshot Pointer to the snapshot.
+ * @param data The payload of the SNAPSHOT frame.
+ * @param size Size of the payload.
+ * @return 0 on success, -1 if the payload is bad.
+ */
+int snapshot_load(struct zone_snapshot *snapshot, const uint8_t *data, uint16_t size)
+{
+	uint16_t used = SNAPSHOT_HEADER_SIZE;
+
+	snapshot->valid = 0;
+	if (size < SNAPSHOT_HEADER_SIZE + 1 || data[size - 1] != crc8_compute(data, size - 1) ||
+		data[SNAPSHOT_OFFSET_COUNT] == 0 || data[SNAPSHOT_OFFSET_COUNT] > SNAPSHOT_MAX_OFFSETS ||
+		data[SNAPSHOT_ZONE_COUNT] > SNAPSHOT_MAX_ZONES ||
+		used + data[SNAPSHOT_OFFSET_COUNT] * SNAPSHOT_OFFSET_SIZE > size - 1)
+	{
+		return -1;
+	}
+	snapshot->version = snapshot_get_le(&data[SNAPSHOT_VERSION], 4);
+	snapshot->offset_count = data[SNAPSHOT_OFFSET_COUNT];
+	snapshot->border = data[SNAPSHOT_BORDER];
+	snapshot->max_coordinate = data[SNAPSHOT_MAX_COORDINATE];
+	memcpy(snapshot->quadrant, &data[SNAPSHOT_QUADRANT], SNAPSHOT_QUADRANTS);
+	snapshot->zone_count = data[SNAPSHOT_ZONE_COUNT];
+
+	for (uint8_t i = 0; i < snapshot->offset_count; ++i)
+	{
+		snapshot->offset_from[i] = snapshot_get_le(&data[used], 4);
+		snapshot->utc_offset[i] = (int32_t)snapshot_get_le(&data[used + 4], 4);
+		used += SNAPSHOT_OFFSET_SIZE;
+	}
+
+	for (uint8_t i = 0; i < snapshot->zone_count; ++i)
+	{
+		struct snapshot_zone *zone = &snapshot->zone[i];
+
+		if (used + 2 + SNAPSHOT_NAME_SIZE > size - 1)
+		{
+			return -1;
+		}
+		zone->id = data[used];
+		memcpy(zone->name, &data[used + 1], SNAPSHOT_NAME_SIZE);
+		zone->name[SNAPSHOT_NAME_SIZE] = '\0';
+		zone->run_count = data[used + 1 + SNAPSHOT_NAME_SIZE];
+		used += 2 + SNAPSHOT_NAME_SIZE;
+		if (zone->run_count == 0 || zone->run_count > SNAPSHOT_HOURS_PER_WEEK ||
+			used + zone->run_count * SNAPSHOT_RUN_SIZE > size - 1)
+		{
+			return -1;
+		}
+		for (uint8_t run = 0; run < zone->run_count; ++run)
+		{
+			zone->run_hour[run] = data[used];
+			zone->run_rate[run] = snapshot_get_le(&data[used + 1], 4);
+			used += SNAPSHOT_RUN_SIZE;
+		}
+	}
+	if (used != size - 1)
+	{
+		return -1;
+	}
+	snapshot->valid = 1;
+	return 0;
+}
+
+/**
+ * @brief Find the zone of coordinates, as the server would.
+ *
+ * @param snapshot Pointer to the snapshot.
+ * @param x X-coordinate.
+ * @param y Y-coordinate.
+ * @return Pointer to the zone, NULL if the snapshot is invalid or the coordinates are in no zone.
+ */
+const struct snapshot_zone *snapshot_resolve(const struct zone_snapshot *snapshot, uint8_t x, uint8_t y)
+{
+	uint8_t id;
+
+	if (snapshot->valid == 0 || x > snapshot->max_coordinate || y > snapshot->max_coordinate)
+	{
+		return NULL;
+	}
+	id = snapshot->quadrant[(x > snapshot->border) * 2 + (y > snapshot->border)];
+	for (uint8_t i = 0; i < snapshot->zone_count; ++i)
+	{
+		if (snapshot->zone[i].id == id)
+		{
+			return &snapshot->zone[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief The rate of a zone at a time.
+ *
+ * @param snapshot Pointer to the snapshot.
+ * @param zone Pointer to the zone, returned by snapshot_resolve.
+ * @param unix_time The time.
+ * @return Minor units per hour.
+ */
+uint32_t snapshot_rate(const struct zone_snapshot *snapshot, const struct snapshot_zone *zone, int64_t unix_time)
+{
+	int64_t local;
+	uint8_t hour;
+	uint8_t run = 0;
+	uint8_t offset = 0;
+
+	while (offset + 1 < snapshot->offset_count && snapshot->offset_from[offset + 1] <= unix_time)
+	{
+		++offset;
+	}
+	/* The week of the server starts at the epoch, in local time.  */
+	local = (unix_time + snapshot->utc_offset[offset]) % SNAPSHOT_SECONDS_PER_WEEK;
+	if (local < 0)
+	{
+		local += SNAPSHOT_SECONDS_PER_WEEK;
+	}
+	hour = (uint8_t)(local / SNAPSHOT_SECONDS_PER_HOUR);
+	while (run + 1 < zone->run_count && zone->run_hour[run + 1] <= hour)
+	{
+		++run;
+	}
+	return zone->run_rate[run];
+}
@@ -0,0 +1,109 @@
+/**
+ * @file 	snapshot.h
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-19
+ * @brief 	Header file for the zone and tariff snapshot kept by the BBB.
+ *
+ * The server pushes a snapshot of its zone index and of the rates of every
+ * zone, see protocol.h, so a START shows its city and the rate in effect as
+ * soon as the STM frame arrives, without waiting for the LOCATION reply.
+ * It is only for display: the server resolves the zone and bills the session
+ * on its own, and pushes a new snapshot whenever its tariff version changes.
+ * The layout must match server/tariff/tariff_snapshot.h:
+ *	 __________________________________________________________________________________________
+ *	| version | offset count | border | max | quadrants | zone count | offsets  | zones    | crc8 |
+ *	|    4    |      1       |   1    |  1  |     4     |     1      | variable | variable |  1   |
+ *	|_________|______________|________|_____|___________|____________|__________|__________|______|
+ * Every offset is the unix time it takes effect (u32) and the seconds added to
+ * the unix time to get the local time (i32), up to the next offset; the first
+ * one also holds before its time. Every zone is its id, its name of
+ * SNAPSHOT_NAME_SIZE bytes, the number of runs and the runs: the first hour of
+ * the epoch aligned week (u8) and the rate in minor units per hour (u32) up to the next run.
+ */
+#ifndef SNAPSHOT_PNG_H
+#define SNAPSHOT_PNG_H
+
+#include <stdint.h>
+#include <string.h>
+#include "../../../common/crc8/crc8.h"
+
+#define SNAPSHOT_NAME_SIZE 12
+#define SNAPSHOT_QUADRANTS 4
+#define SNAPSHOT_MAX_ZONES 16
+#define SNAPSHOT_HOURS_PER_WEEK 168
+#define SNAPSHOT_SECONDS_PER_HOUR 3600
+#define SNAPSHOT_SECONDS_PER_WEEK 604800
+#define SNAPSHOT_MAX_OFFSETS 32
+/* Offset of each field before the offsets.  */
+#define SNAPSHOT_VERSION 0
+#define SNAPSHOT_OFFSET_COUNT 4
+#define SNAPSHOT_BORDER 5
+#define SNAPSHOT_MAX_COORDINATE 6
+#define SNAPSHOT_QUADRANT 7
+#define SNAPSHOT_ZONE_COUNT 11
+#define SNAPSHOT_HEADER_SIZE 12
+#define SNAPSHOT_OFFSET_SIZE 8
+#define SNAPSHOT_RUN_SIZE 5
+
+/**
+ * @brief The rates of one zone.
+ */
+struct snapshot_zone
+{
+	uint8_t id;		 /*The zone id of the server*/
+	char name[SNAPSHOT_NAME_SIZE + 1];
+	uint8_t run_count;
+	uint8_t run_hour[SNAPSHOT_HOURS_PER_WEEK]; /*First hour of the week of every run, increasing*/
+	uint32_t run_rate[SNAPSHOT_HOURS_PER_WEEK]; /*Minor units per hour*/
+};
+
+/**
+ * @brief The last snapshot the server pushed.
+ */
+struct zone_snapshot
+{
+	uint8_t valid;		 /*0 before the first snapshot, and after a bad one*/
+	uint32_t version;	 /*The tariff version of the server*/
+	uint8_t offset_count;
+	int64_t offset_from[SNAPSHOT_MAX_OFFSETS]; /*Unix time every offset takes effect, increasing*/
+	int32_t utc_offset[SNAPSHOT_MAX_OFFSETS];  /*Seconds added to the unix time to get the local time*/
+	uint8_t border;
+	uint8_t max_coordinate;
+	uint8_t quadrant[SNAPSHOT_QUADRANTS]; /*Zone id of every quadrant, see tariff_snapshot.h*/
+	uint8_t zone_count;
+	struct snapshot_zone zone[SNAPSHOT_MAX_ZONES];
+};
+
+/**
+ * @brief Take a snapshot pushed by the server.
+ *
+ * A snapshot that fails its CRC-8 or its bounds leaves none valid.
+ *
+ * @param snapshot Pointer to the snapshot.
+ * @param data The payload of the SNAPSHOT frame.
+ * @param size Size of the payload.
+ * @return 0 on success, -1 if the payload is bad.
+ */
+int snapshot_load(struct zone_snapshot *snapshot, const uint8_t *data, uint16_t size);
+
+/**
+ * @brief Find the zone of coordinates, as the server would.
+ *
+ * @param snapshot Pointer to the snapshot.
+ * @param x X-coordinate.
+ * @param y Y-coordinate.
+ * @return Pointer to the zone, NULL if the snapshot is invalid or the coordinates are in no zone.
+ */
+const struct snapshot_zone *snapshot_resolve(const struct zone_snapshot *snapshot, uint8_t x, uint8_t y);
+
+/**
+ * @brief The rate of a zone at a time.
+ *
+ * @param snapshot Pointer to the snapshot.
+ * @param zone Pointer to the zone, returned by snapshot_resolve.
+ * @param unix_time The time.
+ * @return Minor units per hour.
+ */
+uint32_t snapshot_rate(const struct zone_snapshot *snapshot, const struct snapshot_zone *zone, int64_t unix_time);
+
+#endif /*SNAPSHOT_PNG_H*/
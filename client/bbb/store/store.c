@@ -0,0 +1,376 @@
+/**
+ * @file 	store.c
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-19
+ * @brief 	Implementation of the store and forward queue of the BBB.
+ */
+
+#include "store.h"
+
+/* Fields of a record in the file, little-endian.  */
+#define STORE_RECORD_SEQ		0
+#define STORE_RECORD_EVENT		4
+#define STORE_RECORD_BOOT		(STORE_RECORD_EVENT + PROTOCOL_EVENT_SIZE)
+#define STORE_RECORD_MONOTONIC	(STORE_RECORD_BOOT + 4)
+#define STORE_RECORD_WALL		(STORE_RECORD_MONOTONIC + 4)
+#define STORE_RECORD_CRC		(STORE_RECORD_SIZE - 1)
+/* Fields of a header copy.  */
+#define STORE_HEADER_MAGIC		0
+#define STORE_HEADER_CAPACITY	4
+#define STORE_HEADER_TAIL		8
+#define STORE_HEADER_CRC		(STORE_HEADER_SIZE - 1)
+
+/**
+ * @brief Read a little-endian field of 'size' bytes.
+ */
+static uint64_t store_get_le(const uint8_t *buff, uint8_t size)
+{
+	uint64_t value = 0;
+
+	for (uint8_t i = 0; i < size; ++i)
+	{
+		value |= (uint64_t)buff[i] << (8 * i);
+	}
+	return value;
+}
+
+/**
+ * @brief Write a little-endian field of 'size' bytes.
+ */
+static void store_put_le(uint8_t *buff, uint64_t value, uint8_t size)
+{
+	for (uint8_t i = 0; i < size; ++i)
+	{
+		buff[i] = (uint8_t)(value >> (8 * i));
+	}
+}
+
+/**
+ * @brief Seconds of the monotonic clock.
+ */
+static uint32_t store_monotonic_s(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint32_t)now.tv_sec;
+}
+
+/**
+ * @brief FNV-1a hash of the boot id, which changes on every boot.
+ *
+ * @return The hash, 0 when the boot id can't be read: every record then falls back on the wall clock.
+ */
+static uint32_t store_boot(void)
+{
+	char boot_id[64];
+	uint32_t hash = 2166136261U;
+	ssize_t n;
+	int fd = open(STORE_BOOT_ID_PATH, O_RDONLY | O_CLOEXEC);
+
+	if (fd == -1)
+	{
+		return 0;
+	}
+	n = read(fd, boot_id, sizeof(boot_id));
+	close(fd);
+	for (ssize_t i = 0; i < n; ++i)
+	{
+		hash = (hash ^ (uint8_t)boot_id[i]) * 16777619U;
+	}
+	return (n > 0 && hash != 0) ? hash : 1;
+}
+
+/**
+ * @brief The seq 'seq' is 'from' or after it, across the wrap of the seqs.
+ */
+static uint8_t store_seq_from(uint32_t seq, uint32_t from)
+{
+	return ((int32_t)(seq - from) >= 0) ? TRUE : FALSE;
+}
+
+/**
+ * @brief Offset of the slot of a seq in the file.
+ */
+static off_t store_slot_offset(uint32_t seq)
+{
+	return STORE_RECORDS_OFFSET + (off_t)(seq % STORE_CAPACITY) * STORE_RECORD_SIZE;
+}
+
+/**
+ * @brief Write 'tail' to the header copy not written last, and sync it.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int store_write_header(struct store *store)
+{
+	uint8_t header[STORE_HEADER_SIZE];
+	uint8_t copy = store->header_copy ^ 1;
+
+	memset(header, 0, sizeof(header));
+	store_put_le(&header[STORE_HEADER_MAGIC], STORE_MAGIC, 4);
+	store_put_le(&header[STORE_HEADER_CAPACITY], STORE_CAPACITY, 4);
+	store_put_le(&header[STORE_HEADER_TAIL], store->tail, 4);
+	header[STORE_HEADER_CRC] = crc8_compute(header, STORE_HEADER_CRC);
+	if (pwrite(store->fd, header, sizeof(header), (off_t)copy * STORE_HEADER_SIZE) != sizeof(header) ||
+		fdatasync(store->fd) == -1)
+	{
+		perror("store: write of the header");
+		return -1;
+	}
+	store->header_copy = copy;
+	return 0;
+}
+
+/**
+ * @brief Read the tail from the valid header copy with the larger one.
+ *
+ * @return 0 on success, -1 when neither copy is valid.
+ */
+static int store_read_header(struct store *store)
+{
+	uint8_t header[2][STORE_HEADER_SIZE];
+	uint8_t found = FALSE;
+
+	if (pread(store->fd, header, sizeof(header), 0) != sizeof(header))
+	{
+		return -1;
+	}
+	for (uint8_t copy = 0; copy < 2; ++copy)
+	{
+		uint32_t tail = (uint32_t)store_get_le(&header[copy][STORE_HEADER_TAIL], 4);
+
+		if (store_get_le(&header[copy][STORE_HEADER_MAGIC], 4) != STORE_MAGIC ||
+			store_get_le(&header[copy][STORE_HEADER_CAPACITY], 4) != STORE_CAPACITY ||
+			header[copy][STORE_HEADER_CRC] != crc8_compute(header[copy], STORE_HEADER_CRC))
+		{
+			continue;
+		}
+		if (found == FALSE || store_seq_from(tail, store->tail) == TRUE)
+		{
+			store->tail = tail;
+			store->header_copy = copy;
+			found = TRUE;
+		}
+	}
+	return (found == TRUE) ? 0 : -1;
+}
+
+/**
+ * @brief The record read from the slot of 'seq' is whole and is the record of 'seq'.
+ */
+static uint8_t store_record_valid(const uint8_t *record, uint32_t seq)
+{
+	return (record[STORE_RECORD_CRC] == crc8_compute(record, STORE_RECORD_CRC) &&
+			(uint32_t)store_get_le(&record[STORE_RECORD_SEQ], 4) == seq)
+			   ? TRUE
+			   : FALSE;
+}
+
+/**
+ * @brief Open the queue, or create it, and find the records it still holds.
+ *
+ * @param store Pointer to the queue.
+ * @param path The file, NULL for STORE_DEFAULT_PATH.
+ * @return 0 on success, -1 on error.
+ */
+int store_open(struct store *store, const char *path)
+{
+	uint8_t records[STORE_CAPACITY / 8][STORE_RECORD_SIZE];
+
+	memset(store, 0, sizeof(*store));
+	if (path == NULL)
+	{
+		path = STORE_DEFAULT_PATH;
+	}
+	if ((store->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600)) == -1)
+	{
+		fprintf(stderr, "store: Unable to open %s - %s\n", path, strerror(errno));
+		return -1;
+	}
+	store->boot = store_boot();
+
+	/* A new file, or one whose both header copies were lost: nothing in it can be trusted.  */
+	if (store_read_header(store) == -1)
+	{
+		store->tail = (uint32_t)time(NULL);
+		store->header_copy = 1;
+		if (ftruncate(store->fd, 0) == -1 ||
+			ftruncate(store->fd, STORE_RECORDS_OFFSET + (off_t)STORE_CAPACITY * STORE_RECORD_SIZE) == -1 ||
+			store_write_header(store) == -1)
+		{
+			perror("store: create");
+			store_close(store);
+			return -1;
+		}
+		store->head = store->tail;
+		return 0;
+	}
+
+	/* The records are appended in order, so the head follows the latest record from the tail on.  */
+	store->head = store->tail;
+	for (uint32_t first = 0; first < STORE_CAPACITY; first += STORE_CAPACITY / 8)
+	{
+		if (pread(store->fd, records, sizeof(records), store_slot_offset(first)) != sizeof(records))
+		{
+			perror("store: read");
+			store_close(store);
+			return -1;
+		}
+		for (uint32_t i = 0; i < STORE_CAPACITY / 8; ++i)
+		{
+			uint32_t seq = (uint32_t)store_get_le(&records[i][STORE_RECORD_SEQ], 4);
+
+			if ((seq % STORE_CAPACITY) == first + i && store_seq_from(seq, store->tail) == TRUE &&
+				seq - store->tail < STORE_CAPACITY && store_record_valid(records[i], seq) == TRUE &&
+				store_seq_from(seq, store->head) == TRUE)
+			{
+				store->head = seq + 1;
+			}
+		}
+	}
+	if (store_pending(store) != 0)
+	{
+		printf("store: %u events wait for the server\n", store_pending(store));
+	}
+	return 0;
+}
+
+/**
+ * @brief Append an event, synced to the file before it returns.
+ *
+ * @param store Pointer to the queue.
+ * @param event The event, PROTOCOL_EVENT_SIZE bytes.
+ * @return 0 on success, -1 on error.
+ */
+int store_append(struct store *store, const uint8_t *event)
+{
+	uint8_t record[STORE_RECORD_SIZE];
+
+	if (store->fd == -1)
+	{
+		return -1;
+	}
+	/* The slot of the new record holds the oldest one.  */
+	if (store_pending(store) == STORE_CAPACITY)
+	{
+		fprintf(stderr, "store: full, the oldest event is dropped\n");
+		++store->tail;
+		if (store_write_header(store) == -1)
+		{
+			return -1;
+		}
+	}
+
+	memset(record, 0, sizeof(record));
+	store_put_le(&record[STORE_RECORD_SEQ], store->head, 4);
+	memcpy(&record[STORE_RECORD_EVENT], event, PROTOCOL_EVENT_SIZE);
+	store_put_le(&record[STORE_RECORD_BOOT], store->boot, 4);
+	store_put_le(&record[STORE_RECORD_MONOTONIC], store_monotonic_s(), 4);
+	store_put_le(&record[STORE_RECORD_WALL], (uint64_t)time(NULL), 8);
+	record[STORE_RECORD_CRC] = crc8_compute(record, STORE_RECORD_CRC);
+	if (pwrite(store->fd, record, sizeof(record), store_slot_offset(store->head)) != sizeof(record) ||
+		fdatasync(store->fd) == -1)
+	{
+		perror("store: write");
+		return -1;
+	}
+	++store->head;
+	return 0;
+}
+
+/**
+ * @brief Number of records not acknowledged yet.
+ */
+uint32_t store_pending(const struct store *store)
+{
+	return store->head - store->tail;
+}
+
+/**
+ * @brief Read the oldest records as HISTORY records, aged to now.
+ *
+ * Slots that don't hold their record, torn or overwritten, are skipped.
+ *
+ * @param store Pointer to the queue.
+ * @param records Room for 'max' records of PROTOCOL_HISTORY_RECORD_SIZE bytes (output parameter).
+ * @param max Records to read at most.
+ * @param next Pointer to store the seq after the last record read (output parameter).
+ * @return Number of records read, -1 on error.
+ */
+int store_read(struct store *store, uint8_t *records, uint32_t max, uint32_t *next)
+{
+	uint8_t record[STORE_RECORD_SIZE];
+	uint32_t monotonic_now = store_monotonic_s(), count = 0;
+	int64_t wall_now = (int64_t)time(NULL);
+	uint32_t seq = store->tail;
+
+	for (; seq != store->head && count < max; ++seq)
+	{
+		uint8_t *history = &records[count * PROTOCOL_HISTORY_RECORD_SIZE];
+		int64_t age;
+
+		if (pread(store->fd, record, sizeof(record), store_slot_offset(seq)) != sizeof(record))
+		{
+			perror("store: read");
+			return -1;
+		}
+		if (store_record_valid(record, seq) == FALSE)
+		{
+			fprintf(stderr, "store: the event %u is damaged, it is dropped\n", seq);
+			continue;
+		}
+
+		/* The monotonic clock can't be set back, the wall clock only stands in for it across a reboot.  */
+		if (store->boot != 0 && (uint32_t)store_get_le(&record[STORE_RECORD_BOOT], 4) == store->boot)
+		{
+			age = monotonic_now - (uint32_t)store_get_le(&record[STORE_RECORD_MONOTONIC], 4);
+		}
+		else
+		{
+			age = wall_now - (int64_t)store_get_le(&record[STORE_RECORD_WALL], 8);
+		}
+		if (age < 0)
+		{
+			age = 0;
+		}
+		memcpy(history, &record[STORE_RECORD_EVENT], PROTOCOL_EVENT_SIZE);
+		protocol_put_history(history, seq, (age > UINT32_MAX) ? UINT32_MAX : (uint32_t)age);
+		++count;
+	}
+	*next = seq;
+	return (int)count;
+}
+
+/**
+ * @brief Drop the records before 'next', the server has them.
+ *
+ * @param store Pointer to the queue.
+ * @param next The seq of the first record still needed.
+ * @return 0 on success, -1 on error.
+ */
+int store_acknowledge(struct store *store, uint32_t next)
+{
+	/* An acknowledgement of records dropped already, or never stored, changes nothing.  */
+	if (store_seq_from(next, store->tail) == FALSE || next - store->tail > store_pending(store) ||
+		next == store->tail)
+	{
+		return 0;
+	}
+	store->tail = next;
+	return store_write_header(store);
+}
+
+/**
+ * @brief Close the queue.
+ *
+ * @param store Pointer to the queue.
+ */
+void store_close(struct store *store)
+{
+	if (store->fd != -1)
+	{
+		close(store->fd);
+		store->fd = -1;
+	}
+}
@@ -0,0 +1,123 @@
+/**
+ * @file 	store.h
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-19
+ * @brief 	Header file for the store and forward queue of the BBB.
+ *
+ * While the server can't be reached, the start and stop events of the units
+ * are kept in a file, and sent to the server in HISTORY frames once it can,
+ * see protocol.h. The file is a ring of STORE_CAPACITY records after
+ * two copies of a header:
+ *	 __________ __________ __________ __________       __________
+ *	| header A | header B | record 0 | record 1 | ... | record   |
+ *	|    16    |    16    |    32    |    32    |     | CAP - 1  |
+ *	|__________|__________|__________|__________|     |__________|
+ * The record of seq is in slot seq % STORE_CAPACITY.
+ * Every record is written once, in its own slot, and synced before the event
+ * is taken as done, and ends with a CRC-8: a record torn by a power cut
+ * fails it and is ignored, it was never reported as stored. The header holds
+ * 'tail', the seq of the oldest record the server hasn't acknowledged, and is
+ * written only when a batch is acknowledged, to the copy the last write
+ * didn't use, so one of them is always whole. On open the valid copy with
+ * the larger tail is taken, and the records from it on are found by a scan.
+ * The file never grows: a full ring drops its oldest record.
+ * Memory is bounded too, the records are read from the file a batch at a time.
+ * The server drops a (MAC, seq) it has already, so the seqs must never go back:
+ * a new file starts from the wall clock in seconds, past the seqs of a lost one.
+ *
+ * A record is stamped with the monotonic clock, which can't jump, and with
+ * the boot it was taken in; a record of an earlier boot falls back on the
+ * wall clock stamped with it.
+ */
+#ifndef STORE_PNG_H
+#define STORE_PNG_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include "./../../../common/crc8/crc8.h"
+#include "./../server/protocol/protocol.h"
+#include "./../../png_enums.h"
+
+/* The file when no --store is given.  */
+#define STORE_DEFAULT_PATH	"bbb_pango_events.queue"
+#define STORE_MAGIC			0x31515350 /*"PSQ1"*/
+/* Records the file holds, the oldest is dropped to make room for a new one past it.
+   Must match HISTORY_RESEND_SEQS in server/history/history_ingest.h.  */
+#define STORE_CAPACITY		1024
+#define STORE_HEADER_SIZE	16
+#define STORE_RECORD_SIZE	32
+#define STORE_RECORDS_OFFSET (2 * STORE_HEADER_SIZE)
+/* Records read from the file and sent in one HISTORY frame at most.  */
+#define STORE_DRAIN_BATCH	256
+#define STORE_BOOT_ID_PATH	"/proc/sys/kernel/random/boot_id"
+
+/**
+ * @brief The queue of the events the server hasn't got yet.
+ */
+struct store
+{
+	int fd;
+	uint32_t head; /*The seq of the next record*/
+	uint32_t tail; /*The seq of the oldest record not acknowledged*/
+	uint32_t boot; /*Hash of the boot id, a record of another boot has no valid monotonic stamp*/
+	uint8_t header_copy; /*The header copy written last*/
+};
+
+/**
+ * @brief Open the queue, or create it, and find the records it still holds.
+ *
+ * @param store Pointer to the queue.
+ * @param path The file, NULL for STORE_DEFAULT_PATH.
+ * @return 0 on success, -1 on error.
+ */
+int store_open(struct store *store, const char *path);
+
+/**
+ * @brief Append an event, synced to the file before it returns.
+ *
+ * @param store Pointer to the queue.
+ * @param event The event, PROTOCOL_EVENT_SIZE bytes.
+ * @return 0 on success, -1 on error.
+ */
+int store_append(struct store *store, const uint8_t *event);
+
+/**
+ * @brief Number of records not acknowledged yet.
+ */
+uint32_t store_pending(const struct store *store);
+
+/**
+ * @brief Read the oldest records as HISTORY records, aged to now.
+ *
+ * Slots that don't hold their record, torn or overwritten, are skipped.
+ *
+ * @param store Pointer to the queue.
+ * @param records Room for 'max' records of PROTOCOL_HISTORY_RECORD_SIZE bytes (output parameter).
+ * @param max Records to read at most.
+ * @param next Pointer to store the seq after the last record read (output parameter).
+ * @return Number of records read, -1 on error.
+ */
+int store_read(struct store *store, uint8_t *records, uint32_t max, uint32_t *next);
+
+/**
+ * @brief Drop the records before 'next', the server has them.
+ *
+ * @param store Pointer to the queue.
+ * @param next The seq of the first record still needed.
+ * @return 0 on success, -1 on error.
+ */
+int store_acknowledge(struct store *store, uint32_t next);
+
+/**
+ * @brief Close the queue.
+ *
+ * @param store Pointer to the queue.
+ */
+void store_close(struct store *store);
+
+#endif /*STORE_PNG_H*/
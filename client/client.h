@@ -17,44 +17,33 @@
 #include <stdint.h>
 #include <pthread.h>
 #include <errno.h>
+#include <time.h>
 #include <sys/types.h>
+#include <sys/timerfd.h>
 #include "./stm/uart/uart.h"
 #include "./bbb/poll_event/poll_functions.h"
 #include "./bbb/server/tcp/tcp.h"
+#include "./bbb/server/protocol/protocol.h"
+#include "../common/crc8/crc8.h"
 #include "./bbb/server/connection_check/server_connection_check_functions.h"
 #include "png_enums.h"
 
-#define CRC_POLYNOMIAL 				  0x8D
 #define PANGO_DATA_SIZE 	 	  	   9
 #define DATA_BUFF_SIZE 			PANGO_DATA_SIZE + 1
 #define PAYMENT_SIZE 				   2
 #define LOCATION_NAME_MAX_LEN         12
 #define ERROR 						  -1
+/* While parking, the running cost is asked from the server every QUOTE_POLL_PERIOD_MS,
+   without waiting for the replies, at most PROTOCOL_MAX_PENDING at once.  */
+#define QUOTE_POLL_PERIOD_MS 		5000
+/* Seconds between heartbeats by default, see --heartbeat. The server gives up on a
+   connection that misses HEARTBEAT_MISSED_LIMIT of them, and so does the BBB on a
+   server that leaves a frame unanswered for as long.  */
+#define HEARTBEAT_PERIOD_SECONDS	   2
+#define HEARTBEAT_MISSED_LIMIT		   3
 
-pthread_mutex_t mutex; 
-extern volatile int exit_app;
-
-/**
- * @brief Start-End function to control the application.
- *
- * This function continuously writes "Hi" to a file descriptor until the exit_app flag is set to 1.
- * It is intended for controlling the start and end of the application.
- *
- * @param arg A pointer to the file descriptor (int).
- * @return None.
- */
-void *start_end_func(void *arg);
-
-/**
- * @brief Calculate CRC-8 checksum for the given data and used in the CRC_8_check func. .
- *
- * This function calculates the CRC-8 checksum for the given data using a predefined polynomial.
- *
- * @param data Pointer to the data array.
- * @param length Length of the data array.
- * @return CRC-8 checksum.
- */
-uint8_t calculateCRC8(uint8_t* data, uint32_t length);
+/* Seconds between heartbeats, 0 when they are off.  */
+extern uint8_t heartbeat_period;
 
 /**
  * @brief Check CRC-8 validity for a data buffer.
@@ -105,6 +94,19 @@ uint8_t received_data_from_stm(uint8_t status);
 int send_data_and_receive_location (int *client_socket, uint8_t *data_buff,
 	uint8_t data_buff_size, uint8_t *location, uint8_t location_size);
 
+/**
+ * @brief Send the closing data to the server and receive the payment.
+ *
+ * @param client_socket Pointer to the client socket.
+ * @param data_buff The data buffer to send.
+ * @param data_buff_size The size of the data buffer.
+ * @param payment Pointer to store the amount to pay, in ILS, and the time parked.
+ * @param payment_size The number of elements of the payment array.
+ * @return 0 on success, -1 on error.
+ */
+int send_data_and_receive_payment(int *client_socket, uint8_t *data_buff, uint8_t data_buff_size,
+	double *payment, int payment_size);
+
 /**
  * @brief Update the status value by toggling between 0 and 1.
  *
@@ -126,4 +128,70 @@ void updating_status_value(uint8_t *status);
  */
 void final_price_for_costumer(double *payment, int size);
 
+/**
+ * @brief Ask the server for the cost of the session so far, without waiting for the reply.
+ *
+ * This function sends a QUOTE request, built from the last data received from the STM.
+ * The reply is handled by receive_quote when it comes.
+ *
+ * @param client_socket Pointer to the client socket.
+ * @param data_buff The last data buffer received from the STM.
+ * @param data_buff_size The size of the data buffer.
+ * @param seq Pointer to store the sequence number of the request (output parameter).
+ * @return 0 on success, -1 on error.
+ */
+int request_quote(int *client_socket, uint8_t *data_buff, uint8_t data_buff_size, uint32_t *seq);
+
+/**
+ * @brief Receive a reply that is waiting on the socket and show it.
+ *
+ * @param client_socket Pointer to the client socket.
+ * @return 0 on success, -1 on error.
+ */
+int receive_quote(int *client_socket);
+
+/**
+ * @brief Show a reply to a QUOTE request, the other replies are ignored.
+ *
+ * @param reply The reply.
+ * @return None.
+ */
+void show_quote_reply(const struct protocol_reply *reply);
+
+/**
+ * @brief Send a heartbeat, without waiting for its acknowledgment.
+ *
+ * The heartbeat carries heartbeat_period in the x_axis, so the server knows how long
+ * a silence means the BBB is gone. It belongs to no session.
+ *
+ * @param client_socket Pointer to the client socket.
+ * @param data_buff The last data buffer received from the STM, for the MAC, may be NULL.
+ * @param data_buff_size The size of the data buffer.
+ * @return 0 on success, -1 on error.
+ */
+int send_heartbeat(int *client_socket, uint8_t *data_buff, uint8_t data_buff_size);
+
+/**
+ * @brief Check if the server left a frame unanswered for HEARTBEAT_MISSED_LIMIT heartbeat periods.
+ *
+ * @return TRUE when the server stopped answering, FALSE otherwise or when the heartbeats are off.
+ */
+uint8_t server_is_silent(void);
+
+/**
+ * @brief Microseconds of the monotonic clock, for the latency of the replies.
+ *
+ * @return The time in microseconds.
+ */
+uint64_t monotonic_us(void);
+
+/**
+ * @brief Display the running parking information.
+ *
+ * @param quote An array containing the cost so far and the time parked.
+ * @param size The size of the quote array.
+ * @return None.
+ */
+void running_price_for_costumer(double *quote, int size);
+
 #endif /*CLIENT_H*/
\ No newline at end of file
@@ -7,63 +7,6 @@
 
 #include "client.h"
 
-/**
- * @brief Start-End function to control the application.
- *
- * This function continuously writes "Hi" to a file descriptor until the exit_app flag is set to 1.
- * It is intended for controlling the start and end of the application.
- *
- * Sends message via BBB UART_4, created for using the phisical button.
- * When the button is pressed the "Hi" message sent from UART_4 RX is received in UART_4 TX.
- * Thus starts/ends the communication with the server.
- * 
- * @param arg A pointer to the file descriptor (int).
- */
-void *start_end_func(void *arg)
-{
-    int fd = *((int *)arg);
-    /*  */
-    while (exit_app != TRUE)
-    {
-        if (write(fd, "Hi", 2) == 0)
-        {
-            // Write operation completed
-        }
-    }
-    pthread_exit(NULL);
-}
-
-/**
- * @brief Calculate CRC-8 checksum for the given data and used in the CRC_8_check func. .
- *
- * This function calculates the CRC-8 checksum for the given data using a predefined polynomial.
- *
- * @param data Pointer to the data array.
- * @param length Length of the data array.
- * @return CRC-8 checksum.
- */
-uint8_t calculateCRC8(uint8_t *data, uint32_t length)
-{
-    uint8_t crc = 0xFF;
-
-    for (uint32_t i = 0; i < length; i++)
-    {
-        crc ^= data[i];
-        for (uint8_t j = 0; j < 8; j++)
-        {
-            if (crc & 0x80)
-            {
-                crc = (crc << 1) ^ CRC_POLYNOMIAL;
-            }
-            else
-            {
-                crc <<= 1;
-            }
-        }
-    }
-    return crc;
-}
-
 /**
  * @brief Check CRC-8 validity for a data buffer.
  *
@@ -76,7 +19,7 @@ uint8_t calculateCRC8(uint8_t *data, uint32_t length)
  */
 void CRC_8_check(uint8_t buff[10], uint8_t buff_size, uint8_t *status)
 {
-    if (buff[9] != calculateCRC8(buff, buff_size))
+    if (buff[9] != crc8_compute(buff, buff_size))
     {
         printf("The CRC-8 check has failed\nThere is data corruption in the received data from the STM\n");
         if (*status == ON)
@@ -184,19 +127,192 @@ void updating_status_value(uint8_t *status)
 int send_data_and_receive_location(int *client_socket, uint8_t *data_buff, uint8_t data_buff_size,
                                    uint8_t *location, uint8_t location_size)
 {
-    /* Sending the data buffer to the server. */
-    if (send(*client_socket, data_buff, data_buff_size, 0) == -1)
+    struct protocol_reply reply;
+
+    /* Sending the data buffer to the server and receiving the client location name. */
+    if (data_buff_size != PROTOCOL_EVENT_SIZE || protocol_request(*client_socket, data_buff, &reply, NULL) == -1)
     {
-        perror("send");
         return -1;
     }
 
-    /* Receiving the client location name from the server. */
-    if (recv(*client_socket, location, location_size, 0) == -1)
+    /* A problem on the server side is shown as the 'ERROR' location, see crc8_server_side_value.  */
+    memset(location, '\0', location_size);
+    if (reply.kind == PROTOCOL_REPLY_LOCATION)
+    {
+        memcpy(location, reply.location, (location_size < PROTOCOL_LOCATION_SIZE) ? location_size : PROTOCOL_LOCATION_SIZE);
+    }
+    else
+    {
+        strncpy((char *)location, "ERROR", location_size);
+    }
+    return 0;
+}
+
+/**
+ * @brief Send the closing data to the server and receive the payment.
+ *
+ * @param client_socket Pointer to the client socket.
+ * @param data_buff The data buffer to send.
+ * @param data_buff_size The size of the data buffer.
+ * @param payment Pointer to store the amount to pay, in ILS, and the time parked.
+ * @param payment_size The number of elements of the payment array.
+ * @return 0 on success, -1 on error.
+ */
+int send_data_and_receive_payment(int *client_socket, uint8_t *data_buff, uint8_t data_buff_size,
+                                  double *payment, int payment_size)
+{
+    struct protocol_reply reply;
+
+    if (data_buff_size != PROTOCOL_EVENT_SIZE || payment_size < PAYMENT_SIZE ||
+        protocol_request(*client_socket, data_buff, &reply, show_quote_reply) == -1)
     {
-        perror("recv");
         return -1;
     }
+    if (reply.kind != PROTOCOL_REPLY_AMOUNT)
+    {
+        fprintf(stderr, "The server couldn't close the parking, error %u\n", reply.status);
+        return -1;
+    }
+    payment[0] = (double)reply.charge / PROTOCOL_MINOR_UNITS_PER_MAJOR;
+    payment[1] = (double)reply.seconds;
+    return 0;
+}
+
+/**
+ * @brief Ask the server for the cost of the session so far, without waiting for the reply.
+ *
+ * This function sends a QUOTE request, built from the last data received from the STM.
+ * The reply is handled by receive_quote when it comes.
+ *
+ * @param client_socket Pointer to the client socket.
+ * @param data_buff The last data buffer received from the STM.
+ * @param data_buff_size The size of the data buffer.
+ * @param seq Pointer to store the sequence number of the request (output parameter).
+ * @return 0 on success, -1 on error.
+ */
+int request_quote(int *client_socket, uint8_t *data_buff, uint8_t data_buff_size, uint32_t *seq)
+{
+    uint8_t quote_request[PROTOCOL_EVENT_SIZE];
+
+    if (data_buff_size != PROTOCOL_EVENT_SIZE)
+    {
+        return -1;
+    }
+
+    /* Same MAC and coordinates, with the QUOTE status and its own CRC-8.  */
+    memcpy(quote_request, data_buff, data_buff_size);
+    quote_request[0] = QUOTE;
+    quote_request[PANGO_DATA_SIZE] = crc8_compute(quote_request, PANGO_DATA_SIZE);
 
+    return protocol_send_events(*client_socket, quote_request, 1, seq);
+}
+
+/**
+ * @brief Receive a reply that is waiting on the socket and show it.
+ *
+ * @param client_socket Pointer to the client socket.
+ * @return 0 on success, -1 on error.
+ */
+int receive_quote(int *client_socket)
+{
+    struct protocol_reply reply;
+
+    if (protocol_complete(*client_socket, &reply) == -1)
+    {
+        return -1;
+    }
+    show_quote_reply(&reply);
     return 0;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Show a reply to a QUOTE request, the other replies are ignored.
+ *
+ * @param reply The reply.
+ * @return None.
+ */
+void show_quote_reply(const struct protocol_reply *reply)
+{
+    double quote[PAYMENT_SIZE];
+
+    if (reply->kind != PROTOCOL_REPLY_AMOUNT || reply->status != QUOTE)
+    {
+        return;
+    }
+    quote[0] = (double)reply->charge / PROTOCOL_MINOR_UNITS_PER_MAJOR;
+    quote[1] = (double)reply->seconds;
+    running_price_for_costumer(quote, PAYMENT_SIZE);
+    printf("(answered in %.1f ms)\n", reply->rtt_us / 1000.0);
+}
+
+/**
+ * @brief Send a heartbeat, without waiting for its acknowledgment.
+ *
+ * The heartbeat carries heartbeat_period in the x_axis, so the server knows how long
+ * a silence means the BBB is gone. It belongs to no session.
+ *
+ * @param client_socket Pointer to the client socket.
+ * @param data_buff The last data buffer received from the STM, for the MAC, may be NULL.
+ * @param data_buff_size The size of the data buffer.
+ * @return 0 on success, -1 on error.
+ */
+int send_heartbeat(int *client_socket, uint8_t *data_buff, uint8_t data_buff_size)
+{
+    uint8_t heartbeat[PROTOCOL_EVENT_SIZE] = {0};
+    uint32_t seq;
+
+    if (data_buff != NULL && data_buff_size == PROTOCOL_EVENT_SIZE)
+    {
+        memcpy(heartbeat, data_buff, PROTOCOL_EVENT_SIZE);
+    }
+    heartbeat[0] = HEARTBEAT;
+    heartbeat[7] = heartbeat_period;
+    heartbeat[8] = 0;
+    heartbeat[PANGO_DATA_SIZE] = crc8_compute(heartbeat, PANGO_DATA_SIZE);
+
+    return protocol_send_events(*client_socket, heartbeat, 1, &seq);
+}
+
+/**
+ * @brief Check if the server left a frame unanswered for HEARTBEAT_MISSED_LIMIT heartbeat periods.
+ *
+ * @return TRUE when the server stopped answering, FALSE otherwise or when the heartbeats are off.
+ */
+uint8_t server_is_silent(void)
+{
+    uint64_t oldest = protocol_oldest_pending_us();
+
+    return (heartbeat_period != 0 && oldest != 0 &&
+            monotonic_us() - oldest > (uint64_t)heartbeat_period * HEARTBEAT_MISSED_LIMIT * 1000000)
+               ? TRUE
+               : FALSE;
+}
+
+/**
+ * @brief Microseconds of the monotonic clock, for the latency of the replies.
+ *
+ * @return The time in microseconds.
+ */
+uint64_t monotonic_us(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * @brief Display the running parking information.
+ *
+ * @param quote An array containing the cost so far and the time parked.
+ * @param size The size of the quote array.
+ * @return None.
+ */
+void running_price_for_costumer(double *quote, int size)
+{
+    int hour = (((int)quote[1] / 60) / 60) % 24;
+    int minutes = ((int)quote[1] / 60) % 60;
+    int seconds = (int)quote[1] % 60;
+
+    printf("Parking for %d:%d:%d, %.2f ILS so far\n", hour, minutes, seconds, quote[0]);
+}
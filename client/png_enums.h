@@ -18,8 +18,13 @@ enum app_status
 	ON = 1,
 	OFF = 2,
 	RESTART = 3,
+	QUOTE = 4,
 	STAY_ON = 6,
-	STAY_OFF = 7
+	STAY_OFF = 7,
+	HEARTBEAT = 8, /*The BBB is alive, sent every heartbeat_period seconds*/
+	STREAM_START = 9, /*To the STM: stream the track of the unit, see png_stream.h of the STM*/
+	STREAM_STOP = 10, /*To the STM: send the rest of the track and stop*/
+	TRACK = 11		  /*From the STM: a batch of the track*/
 };
 
 enum quit
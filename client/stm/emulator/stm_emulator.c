@@ -0,0 +1,390 @@
+/**
+ * @file 	stm_emulator.c
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-19
+ * @brief 	Implementation of the STM emulator, the units of a BBB on a workstation.
+ */
+
+#include "stm_emulator.h"
+
+static volatile sig_atomic_t emulator_stop;
+
+/**
+ * @brief Microseconds of the monotonic clock.
+ */
+static uint64_t emulator_now_us(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void emulator_signal(int signal_number)
+{
+	(void)signal_number;
+	emulator_stop = 1;
+}
+
+/**
+ * @brief A percent chance.
+ */
+static uint8_t emulator_chance(unsigned percent)
+{
+	return ((unsigned)(rand() % 100) < percent) ? TRUE : FALSE;
+}
+
+/**
+ * @brief Open a raw pseudo-terminal, the master is non-blocking.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int emulator_open_pty(int *master, int *slave, char *path)
+{
+	struct termios options;
+
+	if ((*master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK)) == -1 || grantpt(*master) == -1 ||
+		unlockpt(*master) == -1 || ptsname_r(*master, path, EMULATOR_PATH_SIZE) != 0)
+	{
+		perror("stm_emulator: posix_openpt");
+		return -1;
+	}
+	if ((*slave = open(path, O_RDWR | O_NOCTTY)) == -1)
+	{
+		fprintf(stderr, "stm_emulator: Unable to open %s - %s\n", path, strerror(errno));
+		return -1;
+	}
+	/* Raw from the start, before the BBB sets it up: no byte of a frame is translated.  */
+	tcgetattr(*slave, &options);
+	cfmakeraw(&options);
+	tcsetattr(*slave, TCSANOW, &options);
+	return 0;
+}
+
+/**
+ * @brief Create the ptys of a unit and give it its MAC address.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int emulator_unit_init(struct emulated_unit *unit, int index, uint64_t first_press_us)
+{
+	memset(unit, 0, sizeof(*unit));
+	if (emulator_open_pty(&unit->data_fd, &unit->slave_fds[0], unit->data_path) == -1 ||
+		emulator_open_pty(&unit->button_fd, &unit->slave_fds[1], unit->button_path) == -1)
+	{
+		return -1;
+	}
+	/* A locally administered MAC, the last byte tells the units apart.  */
+	unit->event[1] = 0x02;
+	unit->event[2] = 0xEE;
+	unit->event[6] = (uint8_t)index;
+	unit->next_press_us = first_press_us;
+	return 0;
+}
+
+/**
+ * @brief Answer the status of the BBB with the event in a frame, with the faults drawn for it.
+ */
+static void emulator_answer(struct emulated_unit *unit, const struct emulator_faults *faults,
+							struct emulator_stats *stats, uint64_t now)
+{
+	uint8_t frame[UART_FRAME_SIZE(EMULATOR_EVENT_SIZE)];
+	size_t size;
+
+	unit->answer_us = 0;
+	if (emulator_chance(faults->silent) == TRUE)
+	{
+		++stats->faults[4];
+		return;
+	}
+	/* As pack_pango_buffer and get_coordinates on the STM.  */
+	unit->event[7] = (uint8_t)(rand() % 128);
+	unit->event[8] = (uint8_t)(rand() % 128);
+	unit->event[EMULATOR_EVENT_SIZE - 1] = crc8_compute(unit->event, EMULATOR_EVENT_SIZE - 1);
+	if (emulator_chance(faults->bad_crc) == TRUE)
+	{
+		unit->event[EMULATOR_EVENT_SIZE - 1] ^= 0x01;
+		++stats->faults[0];
+	}
+	size = uart_frame_encode(unit->event, EMULATOR_EVENT_SIZE, frame);
+
+	if (emulator_chance(faults->noise) == TRUE)
+	{
+		write(unit->data_fd, EMULATOR_NOISE, sizeof(EMULATOR_NOISE) - 1);
+		++stats->faults[3];
+	}
+	if (emulator_chance(faults->truncate) == TRUE)
+	{
+		/* The rest is never sent, the BBB has to find the next frame after it.  */
+		size = 1 + (size_t)rand() % (size - 1);
+		++stats->faults[1];
+	}
+	else if (emulator_chance(faults->split) == TRUE)
+	{
+		size_t first = 1 + (size_t)rand() % (size - 1);
+
+		unit->rest_size = size - first;
+		memcpy(unit->rest, &frame[first], unit->rest_size);
+		unit->rest_us = now + EMULATOR_SPLIT_MS * 1000ULL;
+		size = first;
+		++stats->faults[2];
+	}
+	write(unit->data_fd, frame, size);
+	++stats->answers;
+}
+
+/**
+ * @brief Read the statuses the BBB wrote to the STM of a unit.
+ */
+static void emulator_data(struct emulated_unit *unit, const struct emulator_faults *faults,
+						  struct emulator_stats *stats, uint64_t now, unsigned reply_ms)
+{
+	uint8_t statuses[64];
+	ssize_t n;
+
+	while ((n = read(unit->data_fd, statuses, sizeof(statuses))) > 0)
+	{
+		for (ssize_t i = 0; i < n; ++i)
+		{
+			if (statuses[i] == RESTART)
+			{
+				++stats->restarts;
+			}
+			if (statuses[i] != ON && statuses[i] != OFF)
+			{
+				/* The rest of the int of a RESTART, or a byte the STM would count as wrong.  */
+				continue;
+			}
+			++stats->statuses;
+			if (unit->pressed_us != 0)
+			{
+				uint64_t delay = now - unit->pressed_us;
+
+				++stats->delays;
+				stats->delay_min_us = (stats->delays == 1 || delay < stats->delay_min_us) ? delay : stats->delay_min_us;
+				stats->delay_max_us = (delay > stats->delay_max_us) ? delay : stats->delay_max_us;
+				stats->delay_sum_us += delay;
+				unit->pressed_us = 0;
+			}
+			unit->event[0] = statuses[i];
+			unit->answer_us = now + reply_ms * 1000ULL;
+			if (reply_ms == 0)
+			{
+				emulator_answer(unit, faults, stats, now);
+			}
+		}
+	}
+}
+
+/**
+ * @brief Read the probes the BBB wrote to the button of a unit, and close the loop while it is held.
+ */
+static void emulator_button(struct emulated_unit *unit, uint64_t now)
+{
+	uint8_t probes[64];
+	ssize_t n;
+
+	while ((n = read(unit->button_fd, probes, sizeof(probes))) > 0)
+	{
+		if (unit->release_us > now)
+		{
+			write(unit->button_fd, probes, (size_t)n);
+		}
+	}
+}
+
+/**
+ * @brief Run the BBB with the "DATA:BUTTON" of every unit after its own arguments.
+ *
+ * @return The pid of the BBB, -1 on error.
+ */
+static pid_t emulator_run_bbb(char *command[], int command_count, const struct emulated_unit *unit, int unit_count)
+{
+	static char unit_arguments[EMULATOR_MAX_UNITS][2 * EMULATOR_PATH_SIZE];
+	char *arguments[command_count + unit_count + 1];
+	pid_t pid;
+
+	for (int i = 0; i < command_count; ++i)
+	{
+		arguments[i] = command[i];
+	}
+	for (int i = 0; i < unit_count; ++i)
+	{
+		snprintf(unit_arguments[i], sizeof(unit_arguments[i]), "%s:%s", unit[i].data_path, unit[i].button_path);
+		arguments[command_count + i] = unit_arguments[i];
+	}
+	arguments[command_count + unit_count] = NULL;
+
+	if ((pid = fork()) == 0)
+	{
+		execvp(arguments[0], arguments);
+		fprintf(stderr, "stm_emulator: Unable to run %s - %s\n", arguments[0], strerror(errno));
+		_exit(127);
+	}
+	if (pid == -1)
+	{
+		perror("stm_emulator: fork");
+	}
+	return pid;
+}
+
+/**
+ * @brief Print the counters of the run.
+ */
+static void emulator_report(const struct emulator_stats *stats, double seconds)
+{
+	printf("\nstm_emulator: %.1f s, %lu presses, %lu statuses, %lu answers, %lu restarts\n", seconds,
+		   stats->presses, stats->statuses, stats->answers, stats->restarts);
+	printf("faults: %lu bad CRC, %lu truncated, %lu split, %lu noise, %lu silent\n", stats->faults[0],
+		   stats->faults[1], stats->faults[2], stats->faults[3], stats->faults[4]);
+	if (stats->delays != 0)
+	{
+		printf("press to status: min %.1f ms, avg %.1f ms, max %.1f ms\n", stats->delay_min_us / 1000.0,
+			   stats->delay_sum_us / 1000.0 / stats->delays, stats->delay_max_us / 1000.0);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	struct emulated_unit unit[EMULATOR_MAX_UNITS];
+	struct emulator_faults faults = {0};
+	struct emulator_stats stats = {0};
+	struct pollfd fds[2 * EMULATOR_MAX_UNITS];
+	struct sigaction action;
+	unsigned *fault_options[] = {&faults.bad_crc, &faults.truncate, &faults.split, &faults.noise, &faults.silent};
+	const char *fault_names[] = {"--bad-crc", "--truncate", "--split", "--noise", "--silent"};
+	int unit_count = 1, arg = 1;
+	unsigned reply_ms = 0;
+	double rate = 1.0, seconds = 10.0;
+	uint64_t start, end, press_period_us;
+	pid_t bbb = -1;
+
+	for (; arg < argc && strcmp(argv[arg], "--") != 0; arg += 2)
+	{
+		uint8_t known = FALSE;
+
+		if (arg + 1 >= argc)
+		{
+			fprintf(stderr, "stm_emulator: %s needs a value\n", argv[arg]);
+			return 1;
+		}
+		if (strcmp(argv[arg], "--units") == 0)
+		{
+			unit_count = atoi(argv[arg + 1]);
+			known = TRUE;
+		}
+		else if (strcmp(argv[arg], "--rate") == 0)
+		{
+			rate = atof(argv[arg + 1]);
+			known = TRUE;
+		}
+		else if (strcmp(argv[arg], "--seconds") == 0)
+		{
+			seconds = atof(argv[arg + 1]);
+			known = TRUE;
+		}
+		else if (strcmp(argv[arg], "--reply-ms") == 0)
+		{
+			reply_ms = (unsigned)atoi(argv[arg + 1]);
+			known = TRUE;
+		}
+		for (size_t i = 0; i < sizeof(fault_names) / sizeof(fault_names[0]); ++i)
+		{
+			if (strcmp(argv[arg], fault_names[i]) == 0)
+			{
+				*fault_options[i] = (unsigned)atoi(argv[arg + 1]);
+				known = TRUE;
+			}
+		}
+		if (known != TRUE)
+		{
+			fprintf(stderr, "stm_emulator: unknown option %s, see stm_emulator.h\n", argv[arg]);
+			return 1;
+		}
+	}
+	if (unit_count < 1 || unit_count > EMULATOR_MAX_UNITS || rate <= 0)
+	{
+		fprintf(stderr, "stm_emulator: 1 to %d units, and a positive rate\n", EMULATOR_MAX_UNITS);
+		return 1;
+	}
+	/* A release shorter than BUTTON_RELEASE_US of the BBB would be taken for the same press.  */
+	press_period_us = (uint64_t)(1000000.0 / rate);
+	if (press_period_us < 3 * BUTTON_HOLD_MS * 1000ULL)
+	{
+		press_period_us = 3 * BUTTON_HOLD_MS * 1000ULL;
+	}
+
+	srand((unsigned)time(NULL));
+	start = emulator_now_us();
+	for (int i = 0; i < unit_count; ++i)
+	{
+		/* The first presses are spread over a period, and come after the BBB is up.  */
+		if (emulator_unit_init(&unit[i], i, start + 500000 + press_period_us * i / unit_count) == -1)
+		{
+			return 1;
+		}
+		fds[2 * i].fd = unit[i].data_fd;
+		fds[2 * i + 1].fd = unit[i].button_fd;
+		fds[2 * i].events = fds[2 * i + 1].events = POLLIN;
+		printf("unit %d: %s:%s\n", i, unit[i].data_path, unit[i].button_path);
+	}
+	fflush(stdout);
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = emulator_signal;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	if (arg + 1 < argc && (bbb = emulator_run_bbb(&argv[arg + 1], argc - arg - 1, unit, unit_count)) == -1)
+	{
+		return 1;
+	}
+
+	end = start + (uint64_t)(seconds * 1000000.0);
+	while (emulator_stop == 0 && emulator_now_us() < end)
+	{
+		if (bbb > 0 && waitpid(bbb, NULL, WNOHANG) == bbb)
+		{
+			puts("stm_emulator: the BBB exited");
+			bbb = -1;
+			break;
+		}
+		uint64_t now;
+
+		/* The deadlines are checked every millisecond, the answers and presses need no better.  */
+		if (poll(fds, 2 * (nfds_t)unit_count, 1) == -1 && errno != EINTR)
+		{
+			perror("stm_emulator: poll");
+			break;
+		}
+		now = emulator_now_us();
+		for (int i = 0; i < unit_count; ++i)
+		{
+			emulator_data(&unit[i], &faults, &stats, now, reply_ms);
+			emulator_button(&unit[i], now);
+			if (unit[i].answer_us != 0 && now >= unit[i].answer_us)
+			{
+				emulator_answer(&unit[i], &faults, &stats, now);
+			}
+			if (unit[i].rest_size != 0 && now >= unit[i].rest_us)
+			{
+				write(unit[i].data_fd, unit[i].rest, unit[i].rest_size);
+				unit[i].rest_size = 0;
+			}
+			if (now >= unit[i].next_press_us)
+			{
+				unit[i].pressed_us = now;
+				unit[i].release_us = now + BUTTON_HOLD_MS * 1000ULL;
+				unit[i].next_press_us += press_period_us;
+				++stats.presses;
+			}
+		}
+	}
+
+	if (bbb > 0)
+	{
+		kill(bbb, SIGTERM);
+		waitpid(bbb, NULL, 0);
+	}
+	emulator_report(&stats, (emulator_now_us() - start) / 1000000.0);
+	return 0;
+}
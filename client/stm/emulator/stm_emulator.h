@@ -0,0 +1,108 @@
+/**
+ * @file 	stm_emulator.h
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-19
+ * @brief 	Header file for the STM emulator, the units of a BBB on a workstation.
+ *
+ * Every emulated unit is a pair of pseudo-terminals, one in place of the data
+ * UART of the STM and one in place of the UART loopback of its button:
+ *
+ * - The STM answers every ON or OFF the BBB writes with its event in a frame,
+ *   built as pack_pango_buffer and uart_frame_encode build it on the STM.
+ *   A RESTART is counted and the unit goes on.
+ * - The button is pressed every 1 / RATE seconds: for BUTTON_HOLD_MS the
+ *   probes the BBB writes to it are written back, as the closed loop does.
+ *
+ * Faults are injected into a share of the answers, each given in percent:
+ * a bad CRC-8 in the event, a frame cut short, a frame written in two parts
+ * with a pause between them, stray bytes before the frame, or no answer at all.
+ *
+ * The BBB is run by the emulator with the "DATA:BUTTON" ptys of the units
+ * added to its arguments, or the ptys are printed to give it by hand.
+ * At the end, the exchanges and the delay from a press to the status of the
+ * BBB on the data UART are printed.
+ *
+ * Usage: stm_emulator [--units N] [--rate PRESSES_PER_SECOND] [--seconds S] [--reply-ms MS]
+ *                     [--bad-crc %] [--truncate %] [--split %] [--noise %] [--silent %]
+ *                     [-- BBB_COMMAND ...]
+ * e.g.   stm_emulator --units 4 --rate 2 --bad-crc 5 -- ./bbb_pango_client_host --server 127.0.0.1 --gateway
+ */
+#ifndef STM_EMULATOR_H
+#define STM_EMULATOR_H
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <sys/wait.h>
+#include "./../../../common/uart_frame/uart_frame.h"
+#include "./../../png_enums.h"
+
+#define EMULATOR_MAX_UNITS 16
+#define EMULATOR_PATH_SIZE 64
+/* The event of pack_pango_buffer: status, MAC x6, x, y and the CRC-8.  */
+#define EMULATOR_EVENT_SIZE 10
+/* The button is held this long, longer than the tick of the BBB, see GATEWAY_TICK_MS.  */
+#define BUTTON_HOLD_MS 60
+/* The pause between the parts of a split frame.  */
+#define EMULATOR_SPLIT_MS 5
+/* The stray bytes written before a frame: a start byte and a length the frame doesn't have.  */
+#define EMULATOR_NOISE "\x7E\x55\x7E"
+
+/**
+ * @brief The share of the answers each fault is injected into, in percent.
+ */
+struct emulator_faults
+{
+	unsigned bad_crc;
+	unsigned truncate;
+	unsigned split;
+	unsigned noise;
+	unsigned silent;
+};
+
+/**
+ * @brief One emulated unit.
+ */
+struct emulated_unit
+{
+	int data_fd;   /*Master of the pty of the data UART*/
+	int button_fd; /*Master of the pty of the button*/
+	int slave_fds[2]; /*Kept open, so the masters don't fail while the BBB reopens the ptys*/
+	char data_path[EMULATOR_PATH_SIZE];
+	char button_path[EMULATOR_PATH_SIZE];
+	uint8_t event[EMULATOR_EVENT_SIZE]; /*The last event, without its CRC-8 until it is answered*/
+	uint64_t next_press_us;
+	uint64_t release_us; /*The button is held until then, 0 when it isn't*/
+	uint64_t pressed_us; /*The start of the last press*/
+	uint64_t answer_us;	 /*When the status of the BBB is answered, 0 for no answer*/
+	uint8_t rest[UART_FRAME_SIZE(EMULATOR_EVENT_SIZE)]; /*The second part of a split frame*/
+	size_t rest_size;
+	uint64_t rest_us;
+};
+
+/**
+ * @brief The counters printed at the end.
+ */
+struct emulator_stats
+{
+	unsigned long presses;
+	unsigned long statuses; /*ON and OFF the BBB wrote*/
+	unsigned long restarts;
+	unsigned long answers;
+	unsigned long faults[5]; /*In the order of struct emulator_faults*/
+	unsigned long delays;	 /*Presses the BBB wrote a status for*/
+	uint64_t delay_min_us;	 /*From a press to the status on the data UART*/
+	uint64_t delay_max_us;
+	uint64_t delay_sum_us;
+};
+
+#endif /*STM_EMULATOR_H*/
@@ -10,22 +10,25 @@
 #include "uart.h"
 
 /**
- * @brief Initializes UART communication on ttyO1.
+ * @brief Initializes UART communication on any UART device.
  *
- * This function opens the specified UART device file (/dev/ttyO1) and configures the communication settings.
+ * This function opens the UART device file and configures the communication settings:
+ * 115200 baud, 8N1, raw. Any tty works, a pseudo-terminal too, see stm_emulator.h.
  *
+ * @param path Path of the UART device file, e.g. /dev/ttyO1.
  * @param fd Pointer to store the file descriptor for the opened UART device.
  * @param opt Pointer to a termios structure for configuring UART communication settings.
+ * @return 0 on success, -1 if the device can't be opened.
  */
-void init_uart1(int *fd, void *opt)
+int init_uart(const char *path, int *fd, void *opt)
 {
     struct termios *options = (struct termios *)(opt);
 
-    *fd = open("/dev/ttyO1", O_RDWR | O_NOCTTY | O_NDELAY);
+    *fd = open(path, O_RDWR | O_NOCTTY | O_NDELAY);
     if (*fd == -1)
     {
-        perror("open_port: Unable to open /dev/ttyO1 - ");
-        // TODO: handle to error
+        fprintf(stderr, "open_port: Unable to open %s - %s\n", path, strerror(errno));
+        return -1;
     }
 
     tcgetattr(*fd, options);
@@ -37,44 +40,11 @@ void init_uart1(int *fd, void *opt)
     options->c_cflag &= ~CSIZE;
     options->c_cflag |= CS8;
     options->c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG);
-    options->c_iflag &= ~(IXON | IXOFF | IXANY);
-    options->c_oflag &= ~OPOST;
-    // options->c_cc[VMIN] = 0;
-    // options->c_cc[VTIME] = 10;
-    tcsetattr(*fd, TCSANOW, options);
-}
-
-/**
- * @brief Initializes UART communication on ttyO4.
- *
- * This function opens the specified UART device file (/dev/ttyO4) and configures the communication settings.
- *
- * @param fd Pointer to store the file descriptor for the opened UART device.
- * @param opt Pointer to a termios structure for configuring UART communication settings.
- */
-void init_uart4(int *fd, void *opt)
-{
-    struct termios *options = (struct termios *)(opt);
-
-    *fd = open("/dev/ttyO4", O_RDWR | O_NOCTTY | O_NDELAY);
-    if (*fd == -1)
-    {
-        perror("open_port: Unable to open /dev/ttyO4 - ");
-        // TODO: handle to error
-    }
-
-    tcgetattr(*fd, options);
-    cfsetispeed(options, B115200);
-    cfsetospeed(options, B115200);
-    options->c_cflag |= (CLOCAL | CREAD);
-    options->c_cflag &= ~PARENB;
-    options->c_cflag &= ~CSTOPB;
-    options->c_cflag &= ~CSIZE;
-    options->c_cflag |= CS8;
-    options->c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG);
-    options->c_iflag &= ~(IXON | IXOFF | IXANY);
+    /* The frames are binary, no byte may be translated or dropped.  */
+    options->c_iflag &= ~(IXON | IXOFF | IXANY | ICRNL | INLCR | IGNCR | ISTRIP | BRKINT);
     options->c_oflag &= ~OPOST;
     // options->c_cc[VMIN] = 0;
     // options->c_cc[VTIME] = 10;
     tcsetattr(*fd, TCSANOW, options);
+    return 0;
 }
\ No newline at end of file
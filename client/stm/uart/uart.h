@@ -13,33 +13,30 @@
 #include <fcntl.h>
 #include <stdio.h>
 #include <errno.h>
+#include <string.h>
 #include "./../../png_enums.h"
 
 #define NUM_OF_UARTS_USED   2
 #define UART1               0
 #define UART4               1
+/* The device files of the UARTs on the BBB, the defaults of --uart and --button.  */
+#define UART1_DEVICE        "/dev/ttyO1"
+#define UART4_DEVICE        "/dev/ttyO4"
 
 extern struct termios options;
 extern struct termios options2;
 
 /**
- * @brief Initializes UART communication on ttyO1.
+ * @brief Initializes UART communication on any UART device.
  *
- * This function opens the specified UART device file (/dev/ttyO1) and configures the communication settings.
+ * This function opens the UART device file and configures the communication settings:
+ * 115200 baud, 8N1, raw. Any tty works, a pseudo-terminal too, see stm_emulator.h.
  *
+ * @param path Path of the UART device file, e.g. /dev/ttyO1.
  * @param fd Pointer to store the file descriptor for the opened UART device.
  * @param opt Pointer to a termios structure for configuring UART communication settings.
+ * @return 0 on success, -1 if the device can't be opened.
  */
-void init_uart1(int *fd, void *opt);
-
-/**
- * @brief Initializes UART communication on ttyO4.
- *
- * This function opens the specified UART device file (/dev/ttyO4) and configures the communication settings.
- *
- * @param fd Pointer to store the file descriptor for the opened UART device.
- * @param opt Pointer to a termios structure for configuring UART communication settings.
- */
-void init_uart4(int *fd, void *opt);
+int init_uart(const char *path, int *fd, void *opt);
 
 #endif /*UART_PNG_H*/
\ No newline at end of file
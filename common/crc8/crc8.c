@@ -0,0 +1,284 @@
+/**
+ * @file    crc8.c
+ * @author  Vlad Kulikov
+ * @date    2026-10-18
+ * @brief   Implementation of the CRC-8 shared by the server, the BBB and the STM.
+ */
+#include "crc8.h"
+
+/* crc8_slice_table[0][b] is the CRC-8 of the byte b from a zero CRC,
+   crc8_slice_table[k][b] is the same followed by k zero bytes.
+   Generated from CRC8_POLYNOMIAL, kept const so the STM has it in flash.  */
+static const uint8_t crc8_slice_table[CRC8_SLICE][256] =
+{
+    {
+        0x00, 0x8D, 0x97, 0x1A, 0xA3, 0x2E, 0x34, 0xB9, 0xCB, 0x46, 0x5C, 0xD1, 0x68, 0xE5, 0xFF, 0x72,
+        0x1B, 0x96, 0x8C, 0x01, 0xB8, 0x35, 0x2F, 0xA2, 0xD0, 0x5D, 0x47, 0xCA, 0x73, 0xFE, 0xE4, 0x69,
+        0x36, 0xBB, 0xA1, 0x2C, 0x95, 0x18, 0x02, 0x8F, 0xFD, 0x70, 0x6A, 0xE7, 0x5E, 0xD3, 0xC9, 0x44,
+        0x2D, 0xA0, 0xBA, 0x37, 0x8E, 0x03, 0x19, 0x94, 0xE6, 0x6B, 0x71, 0xFC, 0x45, 0xC8, 0xD2, 0x5F,
+        0x6C, 0xE1, 0xFB, 0x76, 0xCF, 0x42, 0x58, 0xD5, 0xA7, 0x2A, 0x30, 0xBD, 0x04, 0x89, 0x93, 0x1E,
+        0x77, 0xFA, 0xE0, 0x6D, 0xD4, 0x59, 0x43, 0xCE, 0xBC, 0x31, 0x2B, 0xA6, 0x1F, 0x92, 0x88, 0x05,
+        0x5A, 0xD7, 0xCD, 0x40, 0xF9, 0x74, 0x6E, 0xE3, 0x91, 0x1C, 0x06, 0x8B, 0x32, 0xBF, 0xA5, 0x28,
+        0x41, 0xCC, 0xD6, 0x5B, 0xE2, 0x6F, 0x75, 0xF8, 0x8A, 0x07, 0x1D, 0x90, 0x29, 0xA4, 0xBE, 0x33,
+        0xD8, 0x55, 0x4F, 0xC2, 0x7B, 0xF6, 0xEC, 0x61, 0x13, 0x9E, 0x84, 0x09, 0xB0, 0x3D, 0x27, 0xAA,
+        0xC3, 0x4E, 0x54, 0xD9, 0x60, 0xED, 0xF7, 0x7A, 0x08, 0x85, 0x9F, 0x12, 0xAB, 0x26, 0x3C, 0xB1,
+        0xEE, 0x63, 0x79, 0xF4, 0x4D, 0xC0, 0xDA, 0x57, 0x25, 0xA8, 0xB2, 0x3F, 0x86, 0x0B, 0x11, 0x9C,
+        0xF5, 0x78, 0x62, 0xEF, 0x56, 0xDB, 0xC1, 0x4C, 0x3E, 0xB3, 0xA9, 0x24, 0x9D, 0x10, 0x0A, 0x87,
+        0xB4, 0x39, 0x23, 0xAE, 0x17, 0x9A, 0x80, 0x0D, 0x7F, 0xF2, 0xE8, 0x65, 0xDC, 0x51, 0x4B, 0xC6,
+        0xAF, 0x22, 0x38, 0xB5, 0x0C, 0x81, 0x9B, 0x16, 0x64, 0xE9, 0xF3, 0x7E, 0xC7, 0x4A, 0x50, 0xDD,
+        0x82, 0x0F, 0x15, 0x98, 0x21, 0xAC, 0xB6, 0x3B, 0x49, 0xC4, 0xDE, 0x53, 0xEA, 0x67, 0x7D, 0xF0,
+        0x99, 0x14, 0x0E, 0x83, 0x3A, 0xB7, 0xAD, 0x20, 0x52, 0xDF, 0xC5, 0x48, 0xF1, 0x7C, 0x66, 0xEB,
+    },
+    {
+        0x00, 0x3D, 0x7A, 0x47, 0xF4, 0xC9, 0x8E, 0xB3, 0x65, 0x58, 0x1F, 0x22, 0x91, 0xAC, 0xEB, 0xD6,
+        0xCA, 0xF7, 0xB0, 0x8D, 0x3E, 0x03, 0x44, 0x79, 0xAF, 0x92, 0xD5, 0xE8, 0x5B, 0x66, 0x21, 0x1C,
+        0x19, 0x24, 0x63, 0x5E, 0xED, 0xD0, 0x97, 0xAA, 0x7C, 0x41, 0x06, 0x3B, 0x88, 0xB5, 0xF2, 0xCF,
+        0xD3, 0xEE, 0xA9, 0x94, 0x27, 0x1A, 0x5D, 0x60, 0xB6, 0x8B, 0xCC, 0xF1, 0x42, 0x7F, 0x38, 0x05,
+        0x32, 0x0F, 0x48, 0x75, 0xC6, 0xFB, 0xBC, 0x81, 0x57, 0x6A, 0x2D, 0x10, 0xA3, 0x9E, 0xD9, 0xE4,
+        0xF8, 0xC5, 0x82, 0xBF, 0x0C, 0x31, 0x76, 0x4B, 0x9D, 0xA0, 0xE7, 0xDA, 0x69, 0x54, 0x13, 0x2E,
+        0x2B, 0x16, 0x51, 0x6C, 0xDF, 0xE2, 0xA5, 0x98, 0x4E, 0x73, 0x34, 0x09, 0xBA, 0x87, 0xC0, 0xFD,
+        0xE1, 0xDC, 0x9B, 0xA6, 0x15, 0x28, 0x6F, 0x52, 0x84, 0xB9, 0xFE, 0xC3, 0x70, 0x4D, 0x0A, 0x37,
+        0x64, 0x59, 0x1E, 0x23, 0x90, 0xAD, 0xEA, 0xD7, 0x01, 0x3C, 0x7B, 0x46, 0xF5, 0xC8, 0x8F, 0xB2,
+        0xAE, 0x93, 0xD4, 0xE9, 0x5A, 0x67, 0x20, 0x1D, 0xCB, 0xF6, 0xB1, 0x8C, 0x3F, 0x02, 0x45, 0x78,
+        0x7D, 0x40, 0x07, 0x3A, 0x89, 0xB4, 0xF3, 0xCE, 0x18, 0x25, 0x62, 0x5F, 0xEC, 0xD1, 0x96, 0xAB,
+        0xB7, 0x8A, 0xCD, 0xF0, 0x43, 0x7E, 0x39, 0x04, 0xD2, 0xEF, 0xA8, 0x95, 0x26, 0x1B, 0x5C, 0x61,
+        0x56, 0x6B, 0x2C, 0x11, 0xA2, 0x9F, 0xD8, 0xE5, 0x33, 0x0E, 0x49, 0x74, 0xC7, 0xFA, 0xBD, 0x80,
+        0x9C, 0xA1, 0xE6, 0xDB, 0x68, 0x55, 0x12, 0x2F, 0xF9, 0xC4, 0x83, 0xBE, 0x0D, 0x30, 0x77, 0x4A,
+        0x4F, 0x72, 0x35, 0x08, 0xBB, 0x86, 0xC1, 0xFC, 0x2A, 0x17, 0x50, 0x6D, 0xDE, 0xE3, 0xA4, 0x99,
+        0x85, 0xB8, 0xFF, 0xC2, 0x71, 0x4C, 0x0B, 0x36, 0xE0, 0xDD, 0x9A, 0xA7, 0x14, 0x29, 0x6E, 0x53,
+    },
+    {
+        0x00, 0xC8, 0x1D, 0xD5, 0x3A, 0xF2, 0x27, 0xEF, 0x74, 0xBC, 0x69, 0xA1, 0x4E, 0x86, 0x53, 0x9B,
+        0xE8, 0x20, 0xF5, 0x3D, 0xD2, 0x1A, 0xCF, 0x07, 0x9C, 0x54, 0x81, 0x49, 0xA6, 0x6E, 0xBB, 0x73,
+        0x5D, 0x95, 0x40, 0x88, 0x67, 0xAF, 0x7A, 0xB2, 0x29, 0xE1, 0x34, 0xFC, 0x13, 0xDB, 0x0E, 0xC6,
+        0xB5, 0x7D, 0xA8, 0x60, 0x8F, 0x47, 0x92, 0x5A, 0xC1, 0x09, 0xDC, 0x14, 0xFB, 0x33, 0xE6, 0x2E,
+        0xBA, 0x72, 0xA7, 0x6F, 0x80, 0x48, 0x9D, 0x55, 0xCE, 0x06, 0xD3, 0x1B, 0xF4, 0x3C, 0xE9, 0x21,
+        0x52, 0x9A, 0x4F, 0x87, 0x68, 0xA0, 0x75, 0xBD, 0x26, 0xEE, 0x3B, 0xF3, 0x1C, 0xD4, 0x01, 0xC9,
+        0xE7, 0x2F, 0xFA, 0x32, 0xDD, 0x15, 0xC0, 0x08, 0x93, 0x5B, 0x8E, 0x46, 0xA9, 0x61, 0xB4, 0x7C,
+        0x0F, 0xC7, 0x12, 0xDA, 0x35, 0xFD, 0x28, 0xE0, 0x7B, 0xB3, 0x66, 0xAE, 0x41, 0x89, 0x5C, 0x94,
+        0xF9, 0x31, 0xE4, 0x2C, 0xC3, 0x0B, 0xDE, 0x16, 0x8D, 0x45, 0x90, 0x58, 0xB7, 0x7F, 0xAA, 0x62,
+        0x11, 0xD9, 0x0C, 0xC4, 0x2B, 0xE3, 0x36, 0xFE, 0x65, 0xAD, 0x78, 0xB0, 0x5F, 0x97, 0x42, 0x8A,
+        0xA4, 0x6C, 0xB9, 0x71, 0x9E, 0x56, 0x83, 0x4B, 0xD0, 0x18, 0xCD, 0x05, 0xEA, 0x22, 0xF7, 0x3F,
+        0x4C, 0x84, 0x51, 0x99, 0x76, 0xBE, 0x6B, 0xA3, 0x38, 0xF0, 0x25, 0xED, 0x02, 0xCA, 0x1F, 0xD7,
+        0x43, 0x8B, 0x5E, 0x96, 0x79, 0xB1, 0x64, 0xAC, 0x37, 0xFF, 0x2A, 0xE2, 0x0D, 0xC5, 0x10, 0xD8,
+        0xAB, 0x63, 0xB6, 0x7E, 0x91, 0x59, 0x8C, 0x44, 0xDF, 0x17, 0xC2, 0x0A, 0xE5, 0x2D, 0xF8, 0x30,
+        0x1E, 0xD6, 0x03, 0xCB, 0x24, 0xEC, 0x39, 0xF1, 0x6A, 0xA2, 0x77, 0xBF, 0x50, 0x98, 0x4D, 0x85,
+        0xF6, 0x3E, 0xEB, 0x23, 0xCC, 0x04, 0xD1, 0x19, 0x82, 0x4A, 0x9F, 0x57, 0xB8, 0x70, 0xA5, 0x6D,
+    },
+    {
+        0x00, 0x7F, 0xFE, 0x81, 0x71, 0x0E, 0x8F, 0xF0, 0xE2, 0x9D, 0x1C, 0x63, 0x93, 0xEC, 0x6D, 0x12,
+        0x49, 0x36, 0xB7, 0xC8, 0x38, 0x47, 0xC6, 0xB9, 0xAB, 0xD4, 0x55, 0x2A, 0xDA, 0xA5, 0x24, 0x5B,
+        0x92, 0xED, 0x6C, 0x13, 0xE3, 0x9C, 0x1D, 0x62, 0x70, 0x0F, 0x8E, 0xF1, 0x01, 0x7E, 0xFF, 0x80,
+        0xDB, 0xA4, 0x25, 0x5A, 0xAA, 0xD5, 0x54, 0x2B, 0x39, 0x46, 0xC7, 0xB8, 0x48, 0x37, 0xB6, 0xC9,
+        0xA9, 0xD6, 0x57, 0x28, 0xD8, 0xA7, 0x26, 0x59, 0x4B, 0x34, 0xB5, 0xCA, 0x3A, 0x45, 0xC4, 0xBB,
+        0xE0, 0x9F, 0x1E, 0x61, 0x91, 0xEE, 0x6F, 0x10, 0x02, 0x7D, 0xFC, 0x83, 0x73, 0x0C, 0x8D, 0xF2,
+        0x3B, 0x44, 0xC5, 0xBA, 0x4A, 0x35, 0xB4, 0xCB, 0xD9, 0xA6, 0x27, 0x58, 0xA8, 0xD7, 0x56, 0x29,
+        0x72, 0x0D, 0x8C, 0xF3, 0x03, 0x7C, 0xFD, 0x82, 0x90, 0xEF, 0x6E, 0x11, 0xE1, 0x9E, 0x1F, 0x60,
+        0xDF, 0xA0, 0x21, 0x5E, 0xAE, 0xD1, 0x50, 0x2F, 0x3D, 0x42, 0xC3, 0xBC, 0x4C, 0x33, 0xB2, 0xCD,
+        0x96, 0xE9, 0x68, 0x17, 0xE7, 0x98, 0x19, 0x66, 0x74, 0x0B, 0x8A, 0xF5, 0x05, 0x7A, 0xFB, 0x84,
+        0x4D, 0x32, 0xB3, 0xCC, 0x3C, 0x43, 0xC2, 0xBD, 0xAF, 0xD0, 0x51, 0x2E, 0xDE, 0xA1, 0x20, 0x5F,
+        0x04, 0x7B, 0xFA, 0x85, 0x75, 0x0A, 0x8B, 0xF4, 0xE6, 0x99, 0x18, 0x67, 0x97, 0xE8, 0x69, 0x16,
+        0x76, 0x09, 0x88, 0xF7, 0x07, 0x78, 0xF9, 0x86, 0x94, 0xEB, 0x6A, 0x15, 0xE5, 0x9A, 0x1B, 0x64,
+        0x3F, 0x40, 0xC1, 0xBE, 0x4E, 0x31, 0xB0, 0xCF, 0xDD, 0xA2, 0x23, 0x5C, 0xAC, 0xD3, 0x52, 0x2D,
+        0xE4, 0x9B, 0x1A, 0x65, 0x95, 0xEA, 0x6B, 0x14, 0x06, 0x79, 0xF8, 0x87, 0x77, 0x08, 0x89, 0xF6,
+        0xAD, 0xD2, 0x53, 0x2C, 0xDC, 0xA3, 0x22, 0x5D, 0x4F, 0x30, 0xB1, 0xCE, 0x3E, 0x41, 0xC0, 0xBF,
+    },
+    {
+        0x00, 0x33, 0x66, 0x55, 0xCC, 0xFF, 0xAA, 0x99, 0x15, 0x26, 0x73, 0x40, 0xD9, 0xEA, 0xBF, 0x8C,
+        0x2A, 0x19, 0x4C, 0x7F, 0xE6, 0xD5, 0x80, 0xB3, 0x3F, 0x0C, 0x59, 0x6A, 0xF3, 0xC0, 0x95, 0xA6,
+        0x54, 0x67, 0x32, 0x01, 0x98, 0xAB, 0xFE, 0xCD, 0x41, 0x72, 0x27, 0x14, 0x8D, 0xBE, 0xEB, 0xD8,
+        0x7E, 0x4D, 0x18, 0x2B, 0xB2, 0x81, 0xD4, 0xE7, 0x6B, 0x58, 0x0D, 0x3E, 0xA7, 0x94, 0xC1, 0xF2,
+        0xA8, 0x9B, 0xCE, 0xFD, 0x64, 0x57, 0x02, 0x31, 0xBD, 0x8E, 0xDB, 0xE8, 0x71, 0x42, 0x17, 0x24,
+        0x82, 0xB1, 0xE4, 0xD7, 0x4E, 0x7D, 0x28, 0x1B, 0x97, 0xA4, 0xF1, 0xC2, 0x5B, 0x68, 0x3D, 0x0E,
+        0xFC, 0xCF, 0x9A, 0xA9, 0x30, 0x03, 0x56, 0x65, 0xE9, 0xDA, 0x8F, 0xBC, 0x25, 0x16, 0x43, 0x70,
+        0xD6, 0xE5, 0xB0, 0x83, 0x1A, 0x29, 0x7C, 0x4F, 0xC3, 0xF0, 0xA5, 0x96, 0x0F, 0x3C, 0x69, 0x5A,
+        0xDD, 0xEE, 0xBB, 0x88, 0x11, 0x22, 0x77, 0x44, 0xC8, 0xFB, 0xAE, 0x9D, 0x04, 0x37, 0x62, 0x51,
+        0xF7, 0xC4, 0x91, 0xA2, 0x3B, 0x08, 0x5D, 0x6E, 0xE2, 0xD1, 0x84, 0xB7, 0x2E, 0x1D, 0x48, 0x7B,
+        0x89, 0xBA, 0xEF, 0xDC, 0x45, 0x76, 0x23, 0x10, 0x9C, 0xAF, 0xFA, 0xC9, 0x50, 0x63, 0x36, 0x05,
+        0xA3, 0x90, 0xC5, 0xF6, 0x6F, 0x5C, 0x09, 0x3A, 0xB6, 0x85, 0xD0, 0xE3, 0x7A, 0x49, 0x1C, 0x2F,
+        0x75, 0x46, 0x13, 0x20, 0xB9, 0x8A, 0xDF, 0xEC, 0x60, 0x53, 0x06, 0x35, 0xAC, 0x9F, 0xCA, 0xF9,
+        0x5F, 0x6C, 0x39, 0x0A, 0x93, 0xA0, 0xF5, 0xC6, 0x4A, 0x79, 0x2C, 0x1F, 0x86, 0xB5, 0xE0, 0xD3,
+        0x21, 0x12, 0x47, 0x74, 0xED, 0xDE, 0x8B, 0xB8, 0x34, 0x07, 0x52, 0x61, 0xF8, 0xCB, 0x9E, 0xAD,
+        0x0B, 0x38, 0x6D, 0x5E, 0xC7, 0xF4, 0xA1, 0x92, 0x1E, 0x2D, 0x78, 0x4B, 0xD2, 0xE1, 0xB4, 0x87,
+    },
+    {
+        0x00, 0x37, 0x6E, 0x59, 0xDC, 0xEB, 0xB2, 0x85, 0x35, 0x02, 0x5B, 0x6C, 0xE9, 0xDE, 0x87, 0xB0,
+        0x6A, 0x5D, 0x04, 0x33, 0xB6, 0x81, 0xD8, 0xEF, 0x5F, 0x68, 0x31, 0x06, 0x83, 0xB4, 0xED, 0xDA,
+        0xD4, 0xE3, 0xBA, 0x8D, 0x08, 0x3F, 0x66, 0x51, 0xE1, 0xD6, 0x8F, 0xB8, 0x3D, 0x0A, 0x53, 0x64,
+        0xBE, 0x89, 0xD0, 0xE7, 0x62, 0x55, 0x0C, 0x3B, 0x8B, 0xBC, 0xE5, 0xD2, 0x57, 0x60, 0x39, 0x0E,
+        0x25, 0x12, 0x4B, 0x7C, 0xF9, 0xCE, 0x97, 0xA0, 0x10, 0x27, 0x7E, 0x49, 0xCC, 0xFB, 0xA2, 0x95,
+        0x4F, 0x78, 0x21, 0x16, 0x93, 0xA4, 0xFD, 0xCA, 0x7A, 0x4D, 0x14, 0x23, 0xA6, 0x91, 0xC8, 0xFF,
+        0xF1, 0xC6, 0x9F, 0xA8, 0x2D, 0x1A, 0x43, 0x74, 0xC4, 0xF3, 0xAA, 0x9D, 0x18, 0x2F, 0x76, 0x41,
+        0x9B, 0xAC, 0xF5, 0xC2, 0x47, 0x70, 0x29, 0x1E, 0xAE, 0x99, 0xC0, 0xF7, 0x72, 0x45, 0x1C, 0x2B,
+        0x4A, 0x7D, 0x24, 0x13, 0x96, 0xA1, 0xF8, 0xCF, 0x7F, 0x48, 0x11, 0x26, 0xA3, 0x94, 0xCD, 0xFA,
+        0x20, 0x17, 0x4E, 0x79, 0xFC, 0xCB, 0x92, 0xA5, 0x15, 0x22, 0x7B, 0x4C, 0xC9, 0xFE, 0xA7, 0x90,
+        0x9E, 0xA9, 0xF0, 0xC7, 0x42, 0x75, 0x2C, 0x1B, 0xAB, 0x9C, 0xC5, 0xF2, 0x77, 0x40, 0x19, 0x2E,
+        0xF4, 0xC3, 0x9A, 0xAD, 0x28, 0x1F, 0x46, 0x71, 0xC1, 0xF6, 0xAF, 0x98, 0x1D, 0x2A, 0x73, 0x44,
+        0x6F, 0x58, 0x01, 0x36, 0xB3, 0x84, 0xDD, 0xEA, 0x5A, 0x6D, 0x34, 0x03, 0x86, 0xB1, 0xE8, 0xDF,
+        0x05, 0x32, 0x6B, 0x5C, 0xD9, 0xEE, 0xB7, 0x80, 0x30, 0x07, 0x5E, 0x69, 0xEC, 0xDB, 0x82, 0xB5,
+        0xBB, 0x8C, 0xD5, 0xE2, 0x67, 0x50, 0x09, 0x3E, 0x8E, 0xB9, 0xE0, 0xD7, 0x52, 0x65, 0x3C, 0x0B,
+        0xD1, 0xE6, 0xBF, 0x88, 0x0D, 0x3A, 0x63, 0x54, 0xE4, 0xD3, 0x8A, 0xBD, 0x38, 0x0F, 0x56, 0x61,
+    },
+    {
+        0x00, 0x94, 0xA5, 0x31, 0xC7, 0x53, 0x62, 0xF6, 0x03, 0x97, 0xA6, 0x32, 0xC4, 0x50, 0x61, 0xF5,
+        0x06, 0x92, 0xA3, 0x37, 0xC1, 0x55, 0x64, 0xF0, 0x05, 0x91, 0xA0, 0x34, 0xC2, 0x56, 0x67, 0xF3,
+        0x0C, 0x98, 0xA9, 0x3D, 0xCB, 0x5F, 0x6E, 0xFA, 0x0F, 0x9B, 0xAA, 0x3E, 0xC8, 0x5C, 0x6D, 0xF9,
+        0x0A, 0x9E, 0xAF, 0x3B, 0xCD, 0x59, 0x68, 0xFC, 0x09, 0x9D, 0xAC, 0x38, 0xCE, 0x5A, 0x6B, 0xFF,
+        0x18, 0x8C, 0xBD, 0x29, 0xDF, 0x4B, 0x7A, 0xEE, 0x1B, 0x8F, 0xBE, 0x2A, 0xDC, 0x48, 0x79, 0xED,
+        0x1E, 0x8A, 0xBB, 0x2F, 0xD9, 0x4D, 0x7C, 0xE8, 0x1D, 0x89, 0xB8, 0x2C, 0xDA, 0x4E, 0x7F, 0xEB,
+        0x14, 0x80, 0xB1, 0x25, 0xD3, 0x47, 0x76, 0xE2, 0x17, 0x83, 0xB2, 0x26, 0xD0, 0x44, 0x75, 0xE1,
+        0x12, 0x86, 0xB7, 0x23, 0xD5, 0x41, 0x70, 0xE4, 0x11, 0x85, 0xB4, 0x20, 0xD6, 0x42, 0x73, 0xE7,
+        0x30, 0xA4, 0x95, 0x01, 0xF7, 0x63, 0x52, 0xC6, 0x33, 0xA7, 0x96, 0x02, 0xF4, 0x60, 0x51, 0xC5,
+        0x36, 0xA2, 0x93, 0x07, 0xF1, 0x65, 0x54, 0xC0, 0x35, 0xA1, 0x90, 0x04, 0xF2, 0x66, 0x57, 0xC3,
+        0x3C, 0xA8, 0x99, 0x0D, 0xFB, 0x6F, 0x5E, 0xCA, 0x3F, 0xAB, 0x9A, 0x0E, 0xF8, 0x6C, 0x5D, 0xC9,
+        0x3A, 0xAE, 0x9F, 0x0B, 0xFD, 0x69, 0x58, 0xCC, 0x39, 0xAD, 0x9C, 0x08, 0xFE, 0x6A, 0x5B, 0xCF,
+        0x28, 0xBC, 0x8D, 0x19, 0xEF, 0x7B, 0x4A, 0xDE, 0x2B, 0xBF, 0x8E, 0x1A, 0xEC, 0x78, 0x49, 0xDD,
+        0x2E, 0xBA, 0x8B, 0x1F, 0xE9, 0x7D, 0x4C, 0xD8, 0x2D, 0xB9, 0x88, 0x1C, 0xEA, 0x7E, 0x4F, 0xDB,
+        0x24, 0xB0, 0x81, 0x15, 0xE3, 0x77, 0x46, 0xD2, 0x27, 0xB3, 0x82, 0x16, 0xE0, 0x74, 0x45, 0xD1,
+        0x22, 0xB6, 0x87, 0x13, 0xE5, 0x71, 0x40, 0xD4, 0x21, 0xB5, 0x84, 0x10, 0xE6, 0x72, 0x43, 0xD7,
+    },
+    {
+        0x00, 0x60, 0xC0, 0xA0, 0x0D, 0x6D, 0xCD, 0xAD, 0x1A, 0x7A, 0xDA, 0xBA, 0x17, 0x77, 0xD7, 0xB7,
+        0x34, 0x54, 0xF4, 0x94, 0x39, 0x59, 0xF9, 0x99, 0x2E, 0x4E, 0xEE, 0x8E, 0x23, 0x43, 0xE3, 0x83,
+        0x68, 0x08, 0xA8, 0xC8, 0x65, 0x05, 0xA5, 0xC5, 0x72, 0x12, 0xB2, 0xD2, 0x7F, 0x1F, 0xBF, 0xDF,
+        0x5C, 0x3C, 0x9C, 0xFC, 0x51, 0x31, 0x91, 0xF1, 0x46, 0x26, 0x86, 0xE6, 0x4B, 0x2B, 0x8B, 0xEB,
+        0xD0, 0xB0, 0x10, 0x70, 0xDD, 0xBD, 0x1D, 0x7D, 0xCA, 0xAA, 0x0A, 0x6A, 0xC7, 0xA7, 0x07, 0x67,
+        0xE4, 0x84, 0x24, 0x44, 0xE9, 0x89, 0x29, 0x49, 0xFE, 0x9E, 0x3E, 0x5E, 0xF3, 0x93, 0x33, 0x53,
+        0xB8, 0xD8, 0x78, 0x18, 0xB5, 0xD5, 0x75, 0x15, 0xA2, 0xC2, 0x62, 0x02, 0xAF, 0xCF, 0x6F, 0x0F,
+        0x8C, 0xEC, 0x4C, 0x2C, 0x81, 0xE1, 0x41, 0x21, 0x96, 0xF6, 0x56, 0x36, 0x9B, 0xFB, 0x5B, 0x3B,
+        0x2D, 0x4D, 0xED, 0x8D, 0x20, 0x40, 0xE0, 0x80, 0x37, 0x57, 0xF7, 0x97, 0x3A, 0x5A, 0xFA, 0x9A,
+        0x19, 0x79, 0xD9, 0xB9, 0x14, 0x74, 0xD4, 0xB4, 0x03, 0x63, 0xC3, 0xA3, 0x0E, 0x6E, 0xCE, 0xAE,
+        0x45, 0x25, 0x85, 0xE5, 0x48, 0x28, 0x88, 0xE8, 0x5F, 0x3F, 0x9F, 0xFF, 0x52, 0x32, 0x92, 0xF2,
+        0x71, 0x11, 0xB1, 0xD1, 0x7C, 0x1C, 0xBC, 0xDC, 0x6B, 0x0B, 0xAB, 0xCB, 0x66, 0x06, 0xA6, 0xC6,
+        0xFD, 0x9D, 0x3D, 0x5D, 0xF0, 0x90, 0x30, 0x50, 0xE7, 0x87, 0x27, 0x47, 0xEA, 0x8A, 0x2A, 0x4A,
+        0xC9, 0xA9, 0x09, 0x69, 0xC4, 0xA4, 0x04, 0x64, 0xD3, 0xB3, 0x13, 0x73, 0xDE, 0xBE, 0x1E, 0x7E,
+        0x95, 0xF5, 0x55, 0x35, 0x98, 0xF8, 0x58, 0x38, 0x8F, 0xEF, 0x4F, 0x2F, 0x82, 0xE2, 0x42, 0x22,
+        0xA1, 0xC1, 0x61, 0x01, 0xAC, 0xCC, 0x6C, 0x0C, 0xBB, 0xDB, 0x7B, 0x1B, 0xB6, 0xD6, 0x76, 0x16,
+    },
+};
+
+/**
+ * @brief Calculate the CRC-8 one bit at a time, the reference implementation.
+ *
+ * @param data Pointer to the data.
+ * @param length Length of the data.
+ * @return CRC-8 checksum.
+ */
+uint8_t crc8_bitwise(const uint8_t *data, size_t length)
+{
+    uint8_t crc = CRC8_INITIAL_VALUE;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        for (uint8_t j = 0; j < 8; j++)
+        {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ CRC8_POLYNOMIAL) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief Calculate the CRC-8 with a 256 entry table.
+ *
+ * @param data Pointer to the data.
+ * @param length Length of the data.
+ * @return CRC-8 checksum.
+ */
+uint8_t crc8_table(const uint8_t *data, size_t length)
+{
+    uint8_t crc = CRC8_INITIAL_VALUE;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        crc = crc8_slice_table[0][crc ^ data[i]];
+    }
+    return crc;
+}
+
+/**
+ * @brief Calculate the CRC-8 CRC8_SLICE bytes at a time.
+ *
+ * The CRC is linear, so a block is the XOR of the contribution of each byte,
+ * and only the lookup of the first byte depends on the CRC of the previous block.
+ *
+ * @param data Pointer to the data.
+ * @param length Length of the data.
+ * @return CRC-8 checksum.
+ */
+uint8_t crc8_slice(const uint8_t *data, size_t length)
+{
+    uint8_t crc = CRC8_INITIAL_VALUE;
+    size_t i = 0;
+
+    for (; i + CRC8_SLICE <= length; i += CRC8_SLICE)
+    {
+        crc = crc8_slice_table[7][crc ^ data[i]] ^ crc8_slice_table[6][data[i + 1]] ^
+              crc8_slice_table[5][data[i + 2]] ^ crc8_slice_table[4][data[i + 3]] ^
+              crc8_slice_table[3][data[i + 4]] ^ crc8_slice_table[2][data[i + 5]] ^
+              crc8_slice_table[1][data[i + 6]] ^ crc8_slice_table[0][data[i + 7]];
+    }
+    for (; i < length; i++)
+    {
+        crc = crc8_slice_table[0][crc ^ data[i]];
+    }
+    return crc;
+}
+
+/**
+ * @brief Calculate the CRC-8 with the fastest implementation for the length.
+ *
+ * @param data Pointer to the data.
+ * @param length Length of the data.
+ * @return CRC-8 checksum.
+ */
+uint8_t crc8_compute(const uint8_t *data, size_t length)
+{
+    return (length < CRC8_SLICE_MIN_LENGTH) ? crc8_table(data, length) : crc8_slice(data, length);
+}
+
+/**
+ * @brief Verify a batch of frames that end with their CRC-8.
+ *
+ * The frames are walked CRC8_SLICE bytes at a time in one loop, without a call per frame.
+ * The lookup chain of a frame doesn't depend on the previous frame, so the CPU overlaps them;
+ * interleaving the frames by hand measured slower than this on x86.
+ *
+ * @param frames 'count' frames of 'frame_size' bytes one after the other.
+ * @param frame_size Size of a frame, CRC-8 included.
+ * @param count Number of frames.
+ * @param valid Array of 'count' flags, 1 when the CRC-8 of the frame matches (output parameter).
+ * @return Number of valid frames.
+ */
+size_t crc8_verify_batch(const uint8_t *frames, size_t frame_size, size_t count, uint8_t *valid)
+{
+    size_t data_size = frame_size - 1, valid_count = 0;
+
+    if (frame_size == 0)
+    {
+        return 0;
+    }
+
+    for (size_t n = 0; n < count; n++)
+    {
+        const uint8_t *frame = frames + n * frame_size;
+        uint8_t crc = CRC8_INITIAL_VALUE;
+        size_t i = 0;
+
+        for (; i + CRC8_SLICE <= data_size; i += CRC8_SLICE)
+        {
+            crc = crc8_slice_table[7][crc ^ frame[i]] ^ crc8_slice_table[6][frame[i + 1]] ^
+                  crc8_slice_table[5][frame[i + 2]] ^ crc8_slice_table[4][frame[i + 3]] ^
+                  crc8_slice_table[3][frame[i + 4]] ^ crc8_slice_table[2][frame[i + 5]] ^
+                  crc8_slice_table[1][frame[i + 6]] ^ crc8_slice_table[0][frame[i + 7]];
+        }
+        for (; i < data_size; i++)
+        {
+            crc = crc8_slice_table[0][crc ^ frame[i]];
+        }
+        valid[n] = (crc == frame[data_size]);
+        valid_count += valid[n];
+    }
+    return valid_count;
+}
@@ -0,0 +1,191 @@
+/**
+ * @file    crc8_bench.c
+ * @author  Vlad Kulikov
+ * @date    2026-10-18
+ * @brief   Benchmark of the CRC-8 implementations.
+ *
+ * Times every implementation on the sizes the system sends: the 10 byte
+ * events, the largest v2 frame and a bulk buffer, then the batch verification
+ * against a loop of single checks. Every result is checked against the
+ * bitwise implementation.
+ *
+ * Usage: ./crc8_bench [megabytes per run]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "crc8.h"
+
+#define BENCH_DEFAULT_MEGABYTES 16
+#define BENCH_ROUNDS 5
+#define BENCH_EVENT_SIZE 10
+
+typedef uint8_t (*bench_crc8_func)(const uint8_t *data, size_t length);
+
+/* A volatile sink, so the compiler keeps every CRC it doesn't otherwise use.  */
+static volatile uint8_t bench_sink;
+
+/**
+ * @brief Seconds of the monotonic clock.
+ */
+static double bench_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Time the CRC of every 'chunk' bytes of the buffer over BENCH_ROUNDS runs.
+ *
+ * @return The best run time in seconds.
+ */
+static double bench_func(bench_crc8_func func, const uint8_t *buff, size_t size, size_t chunk)
+{
+    double best = 0;
+
+    for (int round = 0; round < BENCH_ROUNDS; ++round)
+    {
+        double begin = bench_now(), elapsed;
+        uint8_t crc = 0;
+
+        for (size_t offset = 0; offset + chunk <= size; offset += chunk)
+        {
+            crc ^= func(buff + offset, chunk);
+        }
+        bench_sink = crc;
+        elapsed = bench_now() - begin;
+        if (round == 0 || elapsed < best)
+        {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Check every implementation against crc8_bitwise on all lengths up to 'max_length'.
+ *
+ * @return Number of mismatches.
+ */
+static size_t bench_check(const uint8_t *buff, size_t max_length)
+{
+    size_t mismatches = 0;
+
+    for (size_t length = 0; length <= max_length; ++length)
+    {
+        uint8_t reference = crc8_bitwise(buff, length);
+
+        if (crc8_table(buff, length) != reference || crc8_slice(buff, length) != reference ||
+            crc8_compute(buff, length) != reference)
+        {
+            if (mismatches++ == 0)
+            {
+                printf("  mismatch at length %zu\n", length);
+            }
+        }
+    }
+    return mismatches;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t megabytes = (argc > 1) ? strtoul(argv[1], NULL, 10) : BENCH_DEFAULT_MEGABYTES;
+    size_t size = megabytes << 20, events = size / BENCH_EVENT_SIZE, corrupted = 0;
+    const size_t chunks[] = {BENCH_EVENT_SIZE - 1, 12 + 64 * BENCH_EVENT_SIZE, 64 * 1024};
+    const char *chunk_names[] = {"event", "v2 frame", "bulk"};
+    const struct
+    {
+        const char *name;
+        bench_crc8_func func;
+    } funcs[] = {{"bitwise", crc8_bitwise}, {"table", crc8_table}, {"slice-8", crc8_slice}};
+    uint8_t *buff = malloc(size), *valid = malloc(events);
+    size_t mismatches, valid_count = 0;
+    double begin, loop_time, batch_time;
+
+    if (size == 0 || buff == NULL || valid == NULL)
+    {
+        perror("crc8_bench: malloc");
+        return EXIT_FAILURE;
+    }
+
+    srand(55152);
+    for (size_t i = 0; i < size; ++i)
+    {
+        buff[i] = (uint8_t)rand();
+    }
+
+    mismatches = bench_check(buff, 4096);
+    printf("crc8_bench: %zu MB per run, implementations %s\n", megabytes, mismatches ? "MISMATCH" : "bit-exact");
+
+    for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); ++c)
+    {
+        double bitwise_time = 0;
+
+        printf("  %s (%zu bytes)\n", chunk_names[c], chunks[c]);
+        for (size_t f = 0; f < sizeof(funcs) / sizeof(funcs[0]); ++f)
+        {
+            double elapsed = bench_func(funcs[f].func, buff, size, chunks[c]);
+
+            if (f == 0)
+            {
+                bitwise_time = elapsed;
+            }
+            printf("    %-8s %9.3f ms %8.1f MB/s  x%.2f\n", funcs[f].name, elapsed * 1e3,
+                   megabytes / elapsed, bitwise_time / elapsed);
+        }
+    }
+
+    /* Queued events with their CRC-8, one in a hundred corrupted.  */
+    for (size_t n = 0; n < events; ++n)
+    {
+        uint8_t *event = buff + n * BENCH_EVENT_SIZE;
+
+        event[BENCH_EVENT_SIZE - 1] = crc8_bitwise(event, BENCH_EVENT_SIZE - 1);
+        if (n % 100 == 99)
+        {
+            event[n % (BENCH_EVENT_SIZE - 1)] ^= 0x10;
+            ++corrupted;
+        }
+    }
+
+    loop_time = batch_time = 0;
+    for (int round = 0; round < BENCH_ROUNDS; ++round)
+    {
+        double elapsed;
+
+        begin = bench_now();
+        valid_count = 0;
+        for (size_t n = 0; n < events; ++n)
+        {
+            const uint8_t *event = buff + n * BENCH_EVENT_SIZE;
+
+            valid[n] = (crc8_compute(event, BENCH_EVENT_SIZE - 1) == event[BENCH_EVENT_SIZE - 1]);
+            valid_count += valid[n];
+        }
+        elapsed = bench_now() - begin;
+        loop_time = (round == 0 || elapsed < loop_time) ? elapsed : loop_time;
+        if (valid_count != events - corrupted)
+        {
+            ++mismatches;
+        }
+
+        begin = bench_now();
+        valid_count = crc8_verify_batch(buff, BENCH_EVENT_SIZE, events, valid);
+        elapsed = bench_now() - begin;
+        batch_time = (round == 0 || elapsed < batch_time) ? elapsed : batch_time;
+        if (valid_count != events - corrupted)
+        {
+            ++mismatches;
+        }
+    }
+    printf("  verify %zu events\n", events);
+    printf("    %-8s %9.3f ms %8.1f M events/s\n", "loop", loop_time * 1e3, events / loop_time / 1e6);
+    printf("    %-8s %9.3f ms %8.1f M events/s  x%.2f  %s\n", "batch", batch_time * 1e3, events / batch_time / 1e6,
+           loop_time / batch_time, mismatches ? "MISMATCH" : "bit-exact");
+
+    free(buff);
+    free(valid);
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+/**
+ * @file    siphash.c
+ * @author  Vlad Kulikov
+ * @date    2026-10-19
+ * @brief   Implementation of the SipHash-2-4 tag of the UDP datagrams of the units.
+ */
+#include "siphash.h"
+
+#define SIPHASH_ROTATE(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+
+/* One SipRound over the four words of the state.  */
+#define SIPHASH_ROUND(v0, v1, v2, v3)                                                     \
+    do                                                                                    \
+    {                                                                                     \
+        v0 += v1; v1 = SIPHASH_ROTATE(v1, 13); v1 ^= v0; v0 = SIPHASH_ROTATE(v0, 32);    \
+        v2 += v3; v3 = SIPHASH_ROTATE(v3, 16); v3 ^= v2;                                  \
+        v0 += v3; v3 = SIPHASH_ROTATE(v3, 21); v3 ^= v0;                                  \
+        v2 += v1; v1 = SIPHASH_ROTATE(v1, 17); v1 ^= v2; v2 = SIPHASH_ROTATE(v2, 32);    \
+    } while (0)
+
+/**
+ * @brief Read 'length' bytes, 8 at most, as a little-endian word.
+ */
+static uint64_t siphash_get_le(const uint8_t *data, size_t length)
+{
+    uint64_t value = 0;
+
+    for (size_t i = 0; i < length; ++i)
+    {
+        value |= (uint64_t)data[i] << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * @brief Calculate the SipHash-2-4 of data.
+ *
+ * @param key The SIPHASH_KEY_SIZE bytes of the key.
+ * @param data Pointer to the data.
+ * @param length Length of the data.
+ * @return The 64 bit tag.
+ */
+uint64_t siphash24(const uint8_t *key, const uint8_t *data, size_t length)
+{
+    uint64_t k0 = siphash_get_le(key, 8), k1 = siphash_get_le(&key[8], 8);
+    uint64_t v0 = k0 ^ 0x736f6d6570736575ULL, v1 = k1 ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = k0 ^ 0x6c7967656e657261ULL, v3 = k1 ^ 0x7465646279746573ULL;
+    size_t whole = length & ~(size_t)7;
+    uint64_t word;
+
+    for (size_t i = 0; i < whole; i += 8)
+    {
+        word = siphash_get_le(&data[i], 8);
+        v3 ^= word;
+        SIPHASH_ROUND(v0, v1, v2, v3);
+        SIPHASH_ROUND(v0, v1, v2, v3);
+        v0 ^= word;
+    }
+
+    /* The last word has the length in its top byte.  */
+    word = siphash_get_le(&data[whole], length - whole) | (uint64_t)(length & 0xFF) << 56;
+    v3 ^= word;
+    SIPHASH_ROUND(v0, v1, v2, v3);
+    SIPHASH_ROUND(v0, v1, v2, v3);
+    v0 ^= word;
+
+    v2 ^= 0xFF;
+    for (int i = 0; i < 4; ++i)
+    {
+        SIPHASH_ROUND(v0, v1, v2, v3);
+    }
+    return v0 ^ v1 ^ v2 ^ v3;
+}
@@ -0,0 +1,31 @@
+/**
+ * @file 	siphash.h
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-19
+ * @brief 	Header file for the SipHash-2-4 tag of the UDP datagrams of the units.
+ *
+ * SipHash-2-4 with a 128 bit key, as published by Aumasson and Bernstein.
+ * The server issues a key to a unit when its session starts, and the unit tags
+ * every datagram with it, so a datagram can't be forged by someone who only
+ * knows the MAC of the unit. The key is read little-endian from its 16 bytes.
+ */
+#ifndef SIPHASH_H
+#define SIPHASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SIPHASH_KEY_SIZE 16
+#define SIPHASH_TAG_SIZE 8
+
+/**
+ * @brief Calculate the SipHash-2-4 of data.
+ *
+ * @param key The SIPHASH_KEY_SIZE bytes of the key.
+ * @param data Pointer to the data.
+ * @param length Length of the data.
+ * @return The 64 bit tag.
+ */
+uint64_t siphash24(const uint8_t *key, const uint8_t *data, size_t length);
+
+#endif /*SIPHASH_H*/
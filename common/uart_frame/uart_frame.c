@@ -0,0 +1,127 @@
+/**
+ * @file    uart_frame.c
+ * @author  Vlad Kulikov
+ * @date    2026-10-19
+ * @brief   Implementation of the framing of the data the STM sends the BBB over the UART.
+ */
+#include "uart_frame.h"
+
+#define UART_FRAMER_MASK (UART_FRAMER_RING_SIZE - 1)
+
+/**
+ * @brief Build the frame of a payload.
+ *
+ * @param payload The payload.
+ * @param length Length of the payload, 1 to UART_FRAME_MAX_PAYLOAD.
+ * @param frame Room for UART_FRAME_SIZE(length) bytes (output parameter).
+ * @return Size of the frame, 0 if the length is out of range.
+ */
+size_t uart_frame_encode(const uint8_t *payload, uint8_t length, uint8_t *frame)
+{
+    if (length == 0 || length > UART_FRAME_MAX_PAYLOAD)
+    {
+        return 0;
+    }
+    frame[0] = UART_FRAME_SOF;
+    frame[1] = length;
+    memcpy(&frame[2], payload, length);
+    frame[2 + length] = crc8_compute(&frame[1], 1 + (size_t)length);
+    return UART_FRAME_SIZE(length);
+}
+
+/**
+ * @brief Empty the ring.
+ *
+ * @param framer Pointer to the framer.
+ */
+void uart_framer_init(struct uart_framer *framer)
+{
+    memset(framer, 0, sizeof(*framer));
+}
+
+/**
+ * @brief Get the free part of the ring a read may put its bytes in directly.
+ *
+ * @param framer Pointer to the framer.
+ * @param size Pointer to store the contiguous free bytes, 0 when the ring is full (output parameter).
+ * @return Pointer to the free bytes.
+ */
+uint8_t *uart_framer_space(struct uart_framer *framer, size_t *size)
+{
+    uint32_t index = framer->head & UART_FRAMER_MASK;
+    uint32_t free_bytes = UART_FRAMER_RING_SIZE - (framer->head - framer->tail);
+
+    /* Up to the end of the ring, the rest is given by the next call.  */
+    *size = (free_bytes < UART_FRAMER_RING_SIZE - index) ? free_bytes : UART_FRAMER_RING_SIZE - index;
+    return &framer->ring[index];
+}
+
+/**
+ * @brief Add the bytes a read put in the space of uart_framer_space.
+ *
+ * @param framer Pointer to the framer.
+ * @param size Bytes read.
+ */
+void uart_framer_commit(struct uart_framer *framer, size_t size)
+{
+    framer->head += (uint32_t)size;
+}
+
+/**
+ * @brief Take the next whole frame out of the ring.
+ *
+ * @param framer Pointer to the framer.
+ * @param payload Room for UART_FRAME_MAX_PAYLOAD bytes (output parameter).
+ * @return Length of the payload, 0 when no whole frame is in the ring yet.
+ */
+uint8_t uart_framer_next(struct uart_framer *framer, uint8_t *payload)
+{
+    uint8_t frame[UART_FRAME_SIZE(UART_FRAME_MAX_PAYLOAD)];
+
+    while (framer->head != framer->tail)
+    {
+        uint32_t buffered = framer->head - framer->tail;
+        uint8_t length;
+
+        if (framer->ring[framer->tail & UART_FRAMER_MASK] != UART_FRAME_SOF)
+        {
+            ++framer->tail;
+            ++framer->dropped;
+            continue;
+        }
+        if (buffered < 2)
+        {
+            return 0;
+        }
+        length = framer->ring[(framer->tail + 1) & UART_FRAMER_MASK];
+        if (length == 0 || length > UART_FRAME_MAX_PAYLOAD)
+        {
+            /* The SOF was a data byte, or the length was corrupted.  */
+            ++framer->tail;
+            ++framer->dropped;
+            continue;
+        }
+        if (buffered < UART_FRAME_SIZE(length))
+        {
+            return 0;
+        }
+
+        /* The frame may wrap around the end of the ring.  */
+        for (uint32_t i = 0; i < UART_FRAME_SIZE(length); ++i)
+        {
+            frame[i] = framer->ring[(framer->tail + i) & UART_FRAMER_MASK];
+        }
+        if (frame[2 + length] != crc8_compute(&frame[1], 1 + (size_t)length))
+        {
+            /* A frame may start inside this one, past the corrupted byte.  */
+            ++framer->tail;
+            ++framer->dropped;
+            continue;
+        }
+        framer->tail += UART_FRAME_SIZE(length);
+        ++framer->frames;
+        memcpy(payload, &frame[2], length);
+        return length;
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file 	uart_frame.h
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-19
+ * @brief 	Header file for the framing of the data the STM sends the BBB over the UART.
+ *
+ * A UART is a stream of bytes: a read may return part of a frame, or the end
+ * of one and the start of the next, and a byte may be lost or corrupted on
+ * the wire. So every payload is sent in a frame:
+ *	 _______________________________________
+ *	| sof  | length | payload      | crc8  |
+ *	|  1   |   1    | length       |   1   |
+ *	|______|________|______________|_______|
+ * the CRC-8 covers the length and the payload.
+ *
+ * The receiver puts the bytes of its reads into a ring, and takes the frames
+ * out of it with uart_framer_next. A byte that can't start a frame, a length
+ * out of range, or a frame that fails its CRC-8 drops a single byte, and the
+ * next UART_FRAME_SOF is tried: one corrupted byte costs the frame it is in,
+ * never the ones after it.
+ *
+ * Is shared by the BBB and the STM, so it has no system calls and no heap.
+ */
+#ifndef UART_FRAME_H
+#define UART_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "../crc8/crc8.h"
+
+#define UART_FRAME_SOF 0x7E
+#define UART_FRAME_OVERHEAD 3
+#define UART_FRAME_MAX_PAYLOAD 32
+#define UART_FRAME_SIZE(payload_size) ((payload_size) + UART_FRAME_OVERHEAD)
+/* Bytes the ring holds, a power of two: several frames the reader hasn't come to yet.  */
+#define UART_FRAMER_RING_SIZE 256
+
+/**
+ * @brief The receive side: the bytes read so far, and the frames found in them.
+ */
+struct uart_framer
+{
+	uint8_t ring[UART_FRAMER_RING_SIZE];
+	uint32_t head;	   /*Bytes put in so far, the ring index is head % UART_FRAMER_RING_SIZE*/
+	uint32_t tail;	   /*Bytes taken out so far*/
+	uint32_t frames;   /*Frames taken out*/
+	uint32_t dropped;  /*Bytes dropped while looking for the start of a frame*/
+};
+
+/**
+ * @brief Build the frame of a payload.
+ *
+ * @param payload The payload.
+ * @param length Length of the payload, 1 to UART_FRAME_MAX_PAYLOAD.
+ * @param frame Room for UART_FRAME_SIZE(length) bytes (output parameter).
+ * @return Size of the frame, 0 if the length is out of range.
+ */
+size_t uart_frame_encode(const uint8_t *payload, uint8_t length, uint8_t *frame);
+
+/**
+ * @brief Empty the ring.
+ *
+ * @param framer Pointer to the framer.
+ */
+void uart_framer_init(struct uart_framer *framer);
+
+/**
+ * @brief Get the free part of the ring a read may put its bytes in directly.
+ *
+ * @param framer Pointer to the framer.
+ * @param size Pointer to store the contiguous free bytes, 0 when the ring is full (output parameter).
+ * @return Pointer to the free bytes.
+ */
+uint8_t *uart_framer_space(struct uart_framer *framer, size_t *size);
+
+/**
+ * @brief Add the bytes a read put in the space of uart_framer_space.
+ *
+ * @param framer Pointer to the framer.
+ * @param size Bytes read.
+ */
+void uart_framer_commit(struct uart_framer *framer, size_t size);
+
+/**
+ * @brief Take the next whole frame out of the ring.
+ *
+ * @param framer Pointer to the framer.
+ * @param payload Room for UART_FRAME_MAX_PAYLOAD bytes (output parameter).
+ * @return Length of the payload, 0 when no whole frame is in the ring yet.
+ */
+uint8_t uart_framer_next(struct uart_framer *framer, uint8_t *payload);
+
+#endif /*UART_FRAME_H*/
@@ -0,0 +1,566 @@
+/**
+ * @file    batch_billing.c
+ * @author  Vlad Kulikov
+ * @date    2026-10-18
+ * @brief   Implementation of the batch billing kernels.
+ *
+ * The SIMD kernels follow tariff_cost step by step, with 64 bit lanes.
+ * The divisions of times by constants are multiplications by magic numbers,
+ * which are exact in the range the kernels accept (BILLING_MAX_VECTOR_TIME,
+ * BILLING_MAX_VECTOR_SPAN). The division of a cost by 3600 is done in double,
+ * which is exact for whole numbers below 2^51. So the charges are equal to the
+ * ones of tariff_cost, and the sessions out of that range are charged by it.
+ * So are the sessions that span a change of the offset of the local time.
+ */
+#include "batch_billing.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BILLING_HAVE_X86 1
+#else
+#define BILLING_HAVE_X86 0
+#endif
+
+/**
+ * @brief Charge the sessions [first, count) one by one.
+ */
+static void billing_kernel_scalar(const struct billing_batch *batch, const struct tariff_book *const *books,
+                                  uint16_t book_count, int64_t *charges, size_t first)
+{
+    for (size_t i = first; i < batch->count; ++i)
+    {
+        uint16_t version = batch->tariff_version[i];
+        const struct tariff_book *book = (version < book_count) ? books[version] : NULL;
+
+        charges[i] = tariff_cost(book, batch->zone_id[i], batch->start_time[i], batch->end_time[i]);
+    }
+}
+
+#if BILLING_HAVE_X86
+
+/* Byte offsets of the tables inside a struct tariff_zone.  */
+#define BILLING_OFFSET_MINUTE_COST offsetof(struct tariff_zone, minute_cost)
+#define BILLING_OFFSET_HOUR_RATE offsetof(struct tariff_zone, hour_rate)
+#define BILLING_OFFSET_DAY_CAP offsetof(struct tariff_zone, day_cap)
+#define BILLING_OFFSET_FULL_DAY_COST offsetof(struct tariff_zone, full_day_cost)
+
+/* floor(x / d) = (x * magic) >> shift, for every 0 <= x < 2^32.
+   A day is 128 * 675 seconds, so a day number is (time >> 7) / 675.  */
+#define BILLING_DAY_SHIFT 7
+#define BILLING_DIV675_MAGIC 3257812231LL
+#define BILLING_DIV675_SHIFT 41
+#define BILLING_DIV60_MAGIC 2290649225LL
+#define BILLING_DIV60_SHIFT 37
+/* For x < 2^31, a day number is below 2^25.  */
+#define BILLING_DIV7_MAGIC 2454267027LL
+#define BILLING_DIV7_SHIFT 34
+
+/* Adding 2^52 + 2^51 to a whole double in [-2^51, 2^51) puts the integer in the low mantissa bits.  */
+#define BILLING_MAGIC_DOUBLE 6755399441055744.0
+#define BILLING_MAGIC_BITS 0x4338000000000000LL
+
+/* Is read by the SIMD kernels in the lanes of sessions with an unknown zone or tariff version.  */
+static struct tariff_zone billing_empty_zone;
+
+/* -------------------------------------------------------------------------- */
+/* AVX2, 4 sessions at a time                                                  */
+/* -------------------------------------------------------------------------- */
+
+__attribute__((target("avx2"))) static inline __m256d billing_avx2_to_double(__m256i value)
+{
+    return _mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(value, _mm256_set1_epi64x(BILLING_MAGIC_BITS))),
+                         _mm256_set1_pd(BILLING_MAGIC_DOUBLE));
+}
+
+__attribute__((target("avx2"))) static inline __m256i billing_avx2_to_int(__m256d value)
+{
+    return _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(value, _mm256_set1_pd(BILLING_MAGIC_DOUBLE))),
+                            _mm256_set1_epi64x(BILLING_MAGIC_BITS));
+}
+
+/* floor(value / divisor) for whole non negative values below 2^51. The product with the
+   reciprocal is off by at most one, which the remainder corrects.  */
+__attribute__((target("avx2"))) static inline __m256i billing_avx2_large_div(__m256i value, double divisor)
+{
+    const __m256d divisor_vec = _mm256_set1_pd(divisor);
+    __m256d dividend = billing_avx2_to_double(value);
+    __m256d quotient = _mm256_floor_pd(_mm256_mul_pd(dividend, _mm256_set1_pd(1.0 / divisor)));
+    __m256d remainder = _mm256_sub_pd(dividend, _mm256_mul_pd(quotient, divisor_vec));
+
+    quotient = _mm256_sub_pd(quotient, _mm256_and_pd(_mm256_cmp_pd(remainder, _mm256_setzero_pd(), _CMP_LT_OQ), _mm256_set1_pd(1)));
+    quotient = _mm256_add_pd(quotient, _mm256_and_pd(_mm256_cmp_pd(remainder, divisor_vec, _CMP_GE_OQ), _mm256_set1_pd(1)));
+    return billing_avx2_to_int(quotient);
+}
+
+/* floor(value / divisor) for 0 <= value < 2^32, with one of the magic numbers above.  */
+__attribute__((target("avx2"))) static inline __m256i billing_avx2_small_div(__m256i value, long long magic, int shift)
+{
+    return _mm256_srli_epi64(_mm256_mul_epu32(value, _mm256_set1_epi64x(magic)), shift);
+}
+
+/* Day of the week (0-6) of a day number.  */
+__attribute__((target("avx2"))) static inline __m256i billing_avx2_weekday(__m256i day, __m256i *week)
+{
+    *week = billing_avx2_small_div(day, BILLING_DIV7_MAGIC, BILLING_DIV7_SHIFT);
+    return _mm256_sub_epi64(day, _mm256_mul_epu32(*week, _mm256_set1_epi64x(TARIFF_DAYS_PER_WEEK)));
+}
+
+/* Reads table[index] of every lane, 'zone' holds the address of the zone tariff of every lane.  */
+__attribute__((target("avx2"))) static inline __m256i billing_avx2_gather(__m256i zone, size_t table_offset, __m256i index)
+{
+    __m256i address = _mm256_add_epi64(zone, _mm256_set1_epi64x((long long)table_offset));
+
+    /* The lanes point in to different books, so the addresses are absolute and the base is 0.  */
+    return _mm256_i64gather_epi64((const long long *)0, _mm256_add_epi64(address, _mm256_slli_epi64(index, 3)), 1);
+}
+
+/* Cost in rate seconds from the start of the week up to the second 'second_of_week'.  */
+__attribute__((target("avx2"))) static inline __m256i billing_avx2_scaled_cost(__m256i zone, __m256i second_of_week)
+{
+    const __m256i last_hour = _mm256_set1_epi64x(TARIFF_HOURS_PER_WEEK - 1);
+    __m256i minute = billing_avx2_small_div(second_of_week, BILLING_DIV60_MAGIC, BILLING_DIV60_SHIFT);
+    __m256i hour = billing_avx2_small_div(minute, BILLING_DIV60_MAGIC, BILLING_DIV60_SHIFT);
+    __m256i second_of_minute = _mm256_sub_epi64(second_of_week, _mm256_mul_epu32(minute, _mm256_set1_epi64x(TARIFF_SECONDS_PER_MINUTE)));
+
+    /* The end of the week has no hour of its own, its second of minute is 0 anyway.  */
+    hour = _mm256_blendv_epi8(hour, last_hour, _mm256_cmpgt_epi64(hour, last_hour));
+
+    /* The rate is below 2^32 and the second below 60, so a 32 bit multiply is exact.  */
+    return _mm256_add_epi64(billing_avx2_gather(zone, BILLING_OFFSET_MINUTE_COST, minute),
+                            _mm256_mul_epu32(billing_avx2_gather(zone, BILLING_OFFSET_HOUR_RATE, hour), second_of_minute));
+}
+
+/* tariff_day_segment_cost of every lane, 'start' and 'end' are seconds (0-86400) of the day 'weekday'.  */
+__attribute__((target("avx2"))) static inline __m256i billing_avx2_day_segment(__m256i zone, __m256i weekday, __m256i start, __m256i end)
+{
+    __m256i day_start = _mm256_mul_epu32(weekday, _mm256_set1_epi64x(TARIFF_SECONDS_PER_DAY));
+    __m256i cost = _mm256_sub_epi64(billing_avx2_scaled_cost(zone, _mm256_add_epi64(day_start, end)),
+                                    billing_avx2_scaled_cost(zone, _mm256_add_epi64(day_start, start)));
+    __m256i cap = billing_avx2_gather(zone, BILLING_OFFSET_DAY_CAP, weekday);
+
+    cost = billing_avx2_large_div(cost, TARIFF_SECONDS_PER_HOUR);
+    return _mm256_blendv_epi8(cost, cap, _mm256_cmpgt_epi64(cost, cap));
+}
+
+/* tariff_whole_days_cost(last_day) - tariff_whole_days_cost(first_day) of every lane.  */
+__attribute__((target("avx2"))) static inline __m256i billing_avx2_whole_days(__m256i zone, __m256i first_day, __m256i last_day)
+{
+    __m256i first_week, last_week, weeks;
+    __m256i first_weekday = billing_avx2_weekday(first_day, &first_week);
+    __m256i last_weekday = billing_avx2_weekday(last_day, &last_week);
+    __m256i cost = _mm256_sub_epi64(billing_avx2_gather(zone, BILLING_OFFSET_FULL_DAY_COST, last_weekday),
+                                    billing_avx2_gather(zone, BILLING_OFFSET_FULL_DAY_COST, first_weekday));
+
+    /* The whole weeks, a week may cost more than 2^32 so the product is done in double.  */
+    weeks = _mm256_sub_epi64(last_week, first_week);
+    if (!_mm256_testz_si256(weeks, weeks))
+    {
+        __m256i week_cost = billing_avx2_gather(zone, BILLING_OFFSET_FULL_DAY_COST, _mm256_set1_epi64x(TARIFF_DAYS_PER_WEEK));
+
+        cost = _mm256_add_epi64(cost, billing_avx2_to_int(_mm256_mul_pd(billing_avx2_to_double(weeks), billing_avx2_to_double(week_cost))));
+    }
+    return cost;
+}
+
+/* Resolves the tariffs of the sessions [i, i + 4), 'vector' and 'scalar' are the masks of the lanes
+   charged by the kernel and by tariff_cost. The other lanes get an empty interval of an empty zone.
+   'offset_index' holds the entries of the offset schedules of the lanes before, and is updated.  */
+__attribute__((target("avx2"))) static inline void billing_avx2_lane_setup(const struct billing_batch *batch, size_t i,
+                                                                           const struct tariff_book *const *books, uint16_t book_count,
+                                                                           __m256i *offset_index, __m256i *zone, __m256i *start,
+                                                                           __m256i *end, __m256i *vector, __m256i *scalar)
+{
+    const __m256i max_time = _mm256_set1_epi64x(BILLING_MAX_VECTOR_TIME);
+    const __m256i min_time = _mm256_set1_epi64x(-BILLING_MAX_VECTOR_TIME);
+    __m256i version = _mm256_cvtepu16_epi64(_mm_loadl_epi64((const __m128i *)(batch->tariff_version + i)));
+    __m256i zone_id = _mm256_cvtepu16_epi64(_mm_loadl_epi64((const __m128i *)(batch->zone_id + i)));
+    __m256i known = _mm256_and_si256(_mm256_cmpgt_epi64(_mm256_set1_epi64x(book_count), version),
+                                     _mm256_cmpgt_epi64(_mm256_set1_epi64x(ZONE_COUNT), zone_id));
+    __m256i book = _mm256_mask_i64gather_epi64(_mm256_setzero_si256(), (const long long *)books, version, known, sizeof(*books));
+    __m256i offset_from = _mm256_add_epi64(book, _mm256_set1_epi64x(offsetof(struct tariff_book, utc_offset_from)));
+    __m256i index = *offset_index;
+    __m256i in_range, utc_offset, from, next_from, missed;
+
+    known = _mm256_andnot_si256(_mm256_cmpeq_epi64(book, _mm256_setzero_si256()), known);
+    *start = _mm256_loadu_si256((const __m256i *)(batch->start_time + i));
+    *end = _mm256_loadu_si256((const __m256i *)(batch->end_time + i));
+
+    /* The entry of the offset schedule in effect at the start is nearly always the one
+       of the lane before, it is searched like in tariff_utc_offset_index only when it isn't.  */
+    from = _mm256_mask_i64gather_epi64(_mm256_setzero_si256(), (const long long *)0,
+                                       _mm256_add_epi64(offset_from, _mm256_slli_epi64(index, 3)), known, 1);
+    next_from = _mm256_mask_i64gather_epi64(_mm256_setzero_si256(), (const long long *)0,
+                                            _mm256_add_epi64(offset_from, _mm256_slli_epi64(_mm256_add_epi64(index, _mm256_set1_epi64x(1)), 3)),
+                                            known, 1);
+    missed = _mm256_and_si256(_mm256_or_si256(_mm256_cmpgt_epi64(from, *start), _mm256_xor_si256(_mm256_cmpgt_epi64(next_from, *start), known)), known);
+    if (!_mm256_testz_si256(missed, missed))
+    {
+        index = _mm256_setzero_si256();
+        for (int step = TARIFF_MAX_UTC_OFFSETS / 2; step > 0; step /= 2)
+        {
+            __m256i next = _mm256_add_epi64(index, _mm256_set1_epi64x(step));
+
+            from = _mm256_mask_i64gather_epi64(_mm256_setzero_si256(), (const long long *)0,
+                                               _mm256_add_epi64(offset_from, _mm256_slli_epi64(next, 3)), known, 1);
+            index = _mm256_blendv_epi8(index, next, _mm256_andnot_si256(_mm256_cmpgt_epi64(from, *start), known));
+        }
+        next_from = _mm256_mask_i64gather_epi64(_mm256_setzero_si256(), (const long long *)0,
+                                                _mm256_add_epi64(offset_from, _mm256_slli_epi64(_mm256_add_epi64(index, _mm256_set1_epi64x(1)), 3)),
+                                                known, 1);
+        *offset_index = index;
+    }
+    utc_offset = _mm256_cvtepi32_epi64(
+        _mm256_mask_i64gather_epi32(_mm_setzero_si128(), (const int *)0,
+                                    _mm256_add_epi64(_mm256_add_epi64(book, _mm256_set1_epi64x(offsetof(struct tariff_book, utc_offset))),
+                                                     _mm256_slli_epi64(index, 2)),
+                                    _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(known, _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0))), 1));
+
+    in_range = _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi64(max_time, *start), _mm256_cmpgt_epi64(*start, min_time)),
+                                _mm256_and_si256(_mm256_cmpgt_epi64(max_time, *end), _mm256_cmpgt_epi64(*end, min_time)));
+    in_range = _mm256_andnot_si256(_mm256_cmpgt_epi64(_mm256_sub_epi64(*end, *start), _mm256_set1_epi64x(BILLING_MAX_VECTOR_SPAN)), in_range);
+    /* A session that spans a change of the offset is charged by tariff_cost.  */
+    in_range = _mm256_andnot_si256(_mm256_cmpgt_epi64(*end, next_from), in_range);
+
+    *vector = _mm256_and_si256(known, in_range);
+    *scalar = _mm256_andnot_si256(in_range, known);
+    *zone = _mm256_add_epi64(_mm256_add_epi64(book, _mm256_set1_epi64x(offsetof(struct tariff_book, zone))),
+                             _mm256_mul_epu32(zone_id, _mm256_set1_epi64x(sizeof(struct tariff_zone))));
+    *zone = _mm256_blendv_epi8(_mm256_set1_epi64x((long long)(uintptr_t)&billing_empty_zone), *zone, known);
+    *start = _mm256_and_si256(_mm256_add_epi64(*start, utc_offset), *vector);
+    *end = _mm256_and_si256(_mm256_add_epi64(*end, utc_offset), *vector);
+}
+
+__attribute__((target("avx2"))) static void billing_kernel_avx2(const struct billing_batch *batch, const struct tariff_book *const *books,
+                                                                 uint16_t book_count, int64_t *charges)
+{
+    const __m256i seconds_per_day = _mm256_set1_epi64x(TARIFF_SECONDS_PER_DAY);
+    __m256i offset_index = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + 4 <= batch->count; i += 4)
+    {
+        __m256i zone, start, end, vector, scalar, first_day, last_day, first_weekday, week, more_days, cost;
+        int scalar_lanes;
+
+        billing_avx2_lane_setup(batch, i, books, book_count, &offset_index, &zone, &start, &end, &vector, &scalar);
+
+        /* Times before the local epoch are not charged.  */
+        start = _mm256_andnot_si256(_mm256_cmpgt_epi64(_mm256_setzero_si256(), start), start);
+        end = _mm256_blendv_epi8(end, start, _mm256_cmpgt_epi64(start, end));
+
+        first_day = billing_avx2_small_div(_mm256_srli_epi64(start, BILLING_DAY_SHIFT), BILLING_DIV675_MAGIC, BILLING_DIV675_SHIFT);
+        last_day = billing_avx2_small_div(_mm256_srli_epi64(end, BILLING_DAY_SHIFT), BILLING_DIV675_MAGIC, BILLING_DIV675_SHIFT);
+        first_weekday = billing_avx2_weekday(first_day, &week);
+        more_days = _mm256_cmpgt_epi64(last_day, first_day);
+
+        /* From here on the times are seconds of the day they are in.  */
+        start = _mm256_sub_epi64(start, _mm256_mul_epu32(first_day, seconds_per_day));
+        end = _mm256_sub_epi64(end, _mm256_mul_epu32(last_day, seconds_per_day));
+
+        cost = billing_avx2_day_segment(zone, first_weekday, start, _mm256_blendv_epi8(end, seconds_per_day, more_days));
+
+        /* The last day and the whole days, only when a session of the group ends on a later day.  */
+        if (!_mm256_testz_si256(more_days, more_days))
+        {
+            __m256i next_day = _mm256_add_epi64(first_day, _mm256_set1_epi64x(1));
+            __m256i whole_days = _mm256_cmpgt_epi64(last_day, next_day);
+            __m256i rest = billing_avx2_day_segment(zone, billing_avx2_weekday(last_day, &week), _mm256_setzero_si256(), end);
+
+            if (!_mm256_testz_si256(whole_days, whole_days))
+            {
+                rest = _mm256_add_epi64(rest, _mm256_and_si256(whole_days, billing_avx2_whole_days(zone, next_day, last_day)));
+            }
+            cost = _mm256_add_epi64(cost, _mm256_and_si256(more_days, rest));
+        }
+        _mm256_storeu_si256((__m256i *)(charges + i), _mm256_and_si256(cost, vector));
+
+        scalar_lanes = _mm256_movemask_pd(_mm256_castsi256_pd(scalar));
+        for (size_t j = i; scalar_lanes != 0; ++j, scalar_lanes >>= 1)
+        {
+            if (scalar_lanes & 1)
+            {
+                charges[j] = tariff_cost(books[batch->tariff_version[j]], batch->zone_id[j], batch->start_time[j], batch->end_time[j]);
+            }
+        }
+    }
+    billing_kernel_scalar(batch, books, book_count, charges, i);
+}
+
+/* -------------------------------------------------------------------------- */
+/* SSE4.2, 2 sessions at a time, the table reads are scalar loads              */
+/* -------------------------------------------------------------------------- */
+
+__attribute__((target("sse4.2"))) static inline __m128d billing_sse_to_double(__m128i value)
+{
+    return _mm_sub_pd(_mm_castsi128_pd(_mm_add_epi64(value, _mm_set1_epi64x(BILLING_MAGIC_BITS))),
+                      _mm_set1_pd(BILLING_MAGIC_DOUBLE));
+}
+
+__attribute__((target("sse4.2"))) static inline __m128i billing_sse_to_int(__m128d value)
+{
+    return _mm_sub_epi64(_mm_castpd_si128(_mm_add_pd(value, _mm_set1_pd(BILLING_MAGIC_DOUBLE))),
+                         _mm_set1_epi64x(BILLING_MAGIC_BITS));
+}
+
+__attribute__((target("sse4.2"))) static inline __m128i billing_sse_large_div(__m128i value, double divisor)
+{
+    const __m128d divisor_vec = _mm_set1_pd(divisor);
+    __m128d dividend = billing_sse_to_double(value);
+    __m128d quotient = _mm_floor_pd(_mm_mul_pd(dividend, _mm_set1_pd(1.0 / divisor)));
+    __m128d remainder = _mm_sub_pd(dividend, _mm_mul_pd(quotient, divisor_vec));
+
+    quotient = _mm_sub_pd(quotient, _mm_and_pd(_mm_cmplt_pd(remainder, _mm_setzero_pd()), _mm_set1_pd(1)));
+    quotient = _mm_add_pd(quotient, _mm_and_pd(_mm_cmpge_pd(remainder, divisor_vec), _mm_set1_pd(1)));
+    return billing_sse_to_int(quotient);
+}
+
+__attribute__((target("sse4.2"))) static inline __m128i billing_sse_small_div(__m128i value, long long magic, int shift)
+{
+    return _mm_srli_epi64(_mm_mul_epu32(value, _mm_set1_epi64x(magic)), shift);
+}
+
+__attribute__((target("sse4.2"))) static inline __m128i billing_sse_weekday(__m128i day, __m128i *week)
+{
+    *week = billing_sse_small_div(day, BILLING_DIV7_MAGIC, BILLING_DIV7_SHIFT);
+    return _mm_sub_epi64(day, _mm_mul_epu32(*week, _mm_set1_epi64x(TARIFF_DAYS_PER_WEEK)));
+}
+
+__attribute__((target("sse4.2"))) static inline __m128i billing_sse_gather(const struct tariff_zone *const zone[2], size_t table_offset,
+                                                                           __m128i index)
+{
+    return _mm_set_epi64x(*(const int64_t *)((const char *)zone[1] + table_offset + _mm_extract_epi64(index, 1) * sizeof(int64_t)),
+                          *(const int64_t *)((const char *)zone[0] + table_offset + _mm_cvtsi128_si64(index) * sizeof(int64_t)));
+}
+
+__attribute__((target("sse4.2"))) static inline __m128i billing_sse_scaled_cost(const struct tariff_zone *const zone[2], __m128i second_of_week)
+{
+    const __m128i last_hour = _mm_set1_epi64x(TARIFF_HOURS_PER_WEEK - 1);
+    __m128i minute = billing_sse_small_div(second_of_week, BILLING_DIV60_MAGIC, BILLING_DIV60_SHIFT);
+    __m128i hour = billing_sse_small_div(minute, BILLING_DIV60_MAGIC, BILLING_DIV60_SHIFT);
+    __m128i second_of_minute = _mm_sub_epi64(second_of_week, _mm_mul_epu32(minute, _mm_set1_epi64x(TARIFF_SECONDS_PER_MINUTE)));
+
+    hour = _mm_blendv_epi8(hour, last_hour, _mm_cmpgt_epi64(hour, last_hour));
+    return _mm_add_epi64(billing_sse_gather(zone, BILLING_OFFSET_MINUTE_COST, minute),
+                         _mm_mul_epu32(billing_sse_gather(zone, BILLING_OFFSET_HOUR_RATE, hour), second_of_minute));
+}
+
+__attribute__((target("sse4.2"))) static inline __m128i billing_sse_day_segment(const struct tariff_zone *const zone[2], __m128i weekday,
+                                                                                __m128i start, __m128i end)
+{
+    __m128i day_start = _mm_mul_epu32(weekday, _mm_set1_epi64x(TARIFF_SECONDS_PER_DAY));
+    __m128i cost = _mm_sub_epi64(billing_sse_scaled_cost(zone, _mm_add_epi64(day_start, end)),
+                                 billing_sse_scaled_cost(zone, _mm_add_epi64(day_start, start)));
+    __m128i cap = billing_sse_gather(zone, BILLING_OFFSET_DAY_CAP, weekday);
+
+    cost = billing_sse_large_div(cost, TARIFF_SECONDS_PER_HOUR);
+    return _mm_blendv_epi8(cost, cap, _mm_cmpgt_epi64(cost, cap));
+}
+
+__attribute__((target("sse4.2"))) static inline __m128i billing_sse_whole_days(const struct tariff_zone *const zone[2], __m128i first_day,
+                                                                               __m128i last_day)
+{
+    __m128i first_week, last_week, weeks;
+    __m128i first_weekday = billing_sse_weekday(first_day, &first_week);
+    __m128i last_weekday = billing_sse_weekday(last_day, &last_week);
+    __m128i cost = _mm_sub_epi64(billing_sse_gather(zone, BILLING_OFFSET_FULL_DAY_COST, last_weekday),
+                                 billing_sse_gather(zone, BILLING_OFFSET_FULL_DAY_COST, first_weekday));
+
+    weeks = _mm_sub_epi64(last_week, first_week);
+    if (!_mm_testz_si128(weeks, weeks))
+    {
+        __m128i week_cost = billing_sse_gather(zone, BILLING_OFFSET_FULL_DAY_COST, _mm_set1_epi64x(TARIFF_DAYS_PER_WEEK));
+
+        cost = _mm_add_epi64(cost, billing_sse_to_int(_mm_mul_pd(billing_sse_to_double(weeks), billing_sse_to_double(week_cost))));
+    }
+    return cost;
+}
+
+__attribute__((target("sse4.2"))) static inline void billing_sse_lane_setup(const struct billing_batch *batch, size_t i,
+                                                                            const struct tariff_book *const *books, uint16_t book_count,
+                                                                            const struct tariff_zone *zone[2], __m128i *start, __m128i *end,
+                                                                            __m128i *vector, __m128i *scalar)
+{
+    const __m128i max_time = _mm_set1_epi64x(BILLING_MAX_VECTOR_TIME);
+    const __m128i min_time = _mm_set1_epi64x(-BILLING_MAX_VECTOR_TIME);
+    int64_t known[2], utc_offset[2], same_offset[2];
+    __m128i in_range, known_mask;
+
+    for (int j = 0; j < 2; ++j)
+    {
+        uint16_t version = batch->tariff_version[i + j];
+        uint16_t zone_id = batch->zone_id[i + j];
+        const struct tariff_book *book = (version < book_count && zone_id < ZONE_COUNT) ? books[version] : NULL;
+
+        known[j] = (book != NULL) ? -1 : 0;
+        zone[j] = (book != NULL) ? &book->zone[zone_id] : &billing_empty_zone;
+        utc_offset[j] = 0;
+        same_offset[j] = 0;
+        if (book != NULL)
+        {
+            uint8_t index = tariff_utc_offset_index(book, batch->start_time[i + j]);
+
+            /* A session that spans a change of the offset is charged by tariff_cost.  */
+            utc_offset[j] = book->utc_offset[index];
+            same_offset[j] = (batch->end_time[i + j] <= book->utc_offset_from[index + 1]) ? -1 : 0;
+        }
+    }
+    known_mask = _mm_loadu_si128((const __m128i *)known);
+
+    *start = _mm_loadu_si128((const __m128i *)(batch->start_time + i));
+    *end = _mm_loadu_si128((const __m128i *)(batch->end_time + i));
+    in_range = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi64(max_time, *start), _mm_cmpgt_epi64(*start, min_time)),
+                             _mm_and_si128(_mm_cmpgt_epi64(max_time, *end), _mm_cmpgt_epi64(*end, min_time)));
+    in_range = _mm_andnot_si128(_mm_cmpgt_epi64(_mm_sub_epi64(*end, *start), _mm_set1_epi64x(BILLING_MAX_VECTOR_SPAN)), in_range);
+    in_range = _mm_and_si128(in_range, _mm_loadu_si128((const __m128i *)same_offset));
+
+    *vector = _mm_and_si128(known_mask, in_range);
+    *scalar = _mm_andnot_si128(in_range, known_mask);
+    *start = _mm_and_si128(_mm_add_epi64(*start, _mm_loadu_si128((const __m128i *)utc_offset)), *vector);
+    *end = _mm_and_si128(_mm_add_epi64(*end, _mm_loadu_si128((const __m128i *)utc_offset)), *vector);
+}
+
+__attribute__((target("sse4.2"))) static void billing_kernel_sse(const struct billing_batch *batch, const struct tariff_book *const *books,
+                                                                 uint16_t book_count, int64_t *charges)
+{
+    const __m128i seconds_per_day = _mm_set1_epi64x(TARIFF_SECONDS_PER_DAY);
+    size_t i = 0;
+
+    for (; i + 2 <= batch->count; i += 2)
+    {
+        const struct tariff_zone *zone[2];
+        __m128i start, end, vector, scalar, first_day, last_day, first_weekday, week, more_days, cost;
+        int scalar_lanes;
+
+        billing_sse_lane_setup(batch, i, books, book_count, zone, &start, &end, &vector, &scalar);
+
+        start = _mm_andnot_si128(_mm_cmpgt_epi64(_mm_setzero_si128(), start), start);
+        end = _mm_blendv_epi8(end, start, _mm_cmpgt_epi64(start, end));
+
+        first_day = billing_sse_small_div(_mm_srli_epi64(start, BILLING_DAY_SHIFT), BILLING_DIV675_MAGIC, BILLING_DIV675_SHIFT);
+        last_day = billing_sse_small_div(_mm_srli_epi64(end, BILLING_DAY_SHIFT), BILLING_DIV675_MAGIC, BILLING_DIV675_SHIFT);
+        first_weekday = billing_sse_weekday(first_day, &week);
+        more_days = _mm_cmpgt_epi64(last_day, first_day);
+
+        start = _mm_sub_epi64(start, _mm_mul_epu32(first_day, seconds_per_day));
+        end = _mm_sub_epi64(end, _mm_mul_epu32(last_day, seconds_per_day));
+
+        cost = billing_sse_day_segment(zone, first_weekday, start, _mm_blendv_epi8(end, seconds_per_day, more_days));
+
+        if (!_mm_testz_si128(more_days, more_days))
+        {
+            __m128i next_day = _mm_add_epi64(first_day, _mm_set1_epi64x(1));
+            __m128i whole_days = _mm_cmpgt_epi64(last_day, next_day);
+            __m128i rest = billing_sse_day_segment(zone, billing_sse_weekday(last_day, &week), _mm_setzero_si128(), end);
+
+            if (!_mm_testz_si128(whole_days, whole_days))
+            {
+                rest = _mm_add_epi64(rest, _mm_and_si128(whole_days, billing_sse_whole_days(zone, next_day, last_day)));
+            }
+            cost = _mm_add_epi64(cost, _mm_and_si128(more_days, rest));
+        }
+        _mm_storeu_si128((__m128i *)(charges + i), _mm_and_si128(cost, vector));
+
+        scalar_lanes = _mm_movemask_pd(_mm_castsi128_pd(scalar));
+        for (size_t j = i; scalar_lanes != 0; ++j, scalar_lanes >>= 1)
+        {
+            if (scalar_lanes & 1)
+            {
+                charges[j] = tariff_cost(books[batch->tariff_version[j]], batch->zone_id[j], batch->start_time[j], batch->end_time[j]);
+            }
+        }
+    }
+    billing_kernel_scalar(batch, books, book_count, charges, i);
+}
+
+#endif /*BILLING_HAVE_X86*/
+
+/**
+ * @brief Get the best kernel the CPU supports.
+ *
+ * @return BILLING_KERNEL_AVX2, BILLING_KERNEL_SSE or BILLING_KERNEL_SCALAR.
+ */
+enum billing_kernel batch_billing_detect_kernel(void)
+{
+#if BILLING_HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return BILLING_KERNEL_AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.2"))
+    {
+        return BILLING_KERNEL_SSE;
+    }
+#endif
+    return BILLING_KERNEL_SCALAR;
+}
+
+/**
+ * @brief Get the name of a kernel, for logs.
+ *
+ * @param kernel The kernel.
+ * @return The name.
+ */
+const char *batch_billing_kernel_name(enum billing_kernel kernel)
+{
+    switch (kernel)
+    {
+    case BILLING_KERNEL_AVX2:
+        return "avx2";
+    case BILLING_KERNEL_SSE:
+        return "sse4.2";
+    case BILLING_KERNEL_SCALAR:
+        return "scalar";
+    case BILLING_KERNEL_AUTO:
+    default:
+        return "auto";
+    }
+}
+
+/**
+ * @brief Calculate the charge of every session of a batch.
+ *
+ * 'books' is indexed by the tariff version. A session whose version has no book,
+ * or whose zone is unknown, is charged 0 like in tariff_cost.
+ *
+ * @param batch Pointer to the sessions.
+ * @param books Array of tariff books indexed by the tariff version.
+ * @param book_count Number of entries in 'books'.
+ * @param charges Array of batch->count charges in minor units (output parameter).
+ * @param kernel The kernel to use, BILLING_KERNEL_AUTO for the fastest one.
+ * @return The kernel that was used, BILLING_KERNEL_SCALAR if the requested one is not supported.
+ */
+enum billing_kernel batch_billing_run(const struct billing_batch *batch, const struct tariff_book *const *books,
+                                      uint16_t book_count, int64_t *charges, enum billing_kernel kernel)
+{
+    enum billing_kernel supported = batch_billing_detect_kernel();
+
+    /* The SSE4.2 kernel has no gather and only 2 lanes, it was measured slower than
+       the scalar one (billing_bench), so it is only used when it is asked for.  */
+    if (kernel == BILLING_KERNEL_AUTO)
+    {
+        kernel = (supported == BILLING_KERNEL_AVX2) ? BILLING_KERNEL_AVX2 : BILLING_KERNEL_SCALAR;
+    }
+    else if (kernel > supported)
+    {
+        kernel = BILLING_KERNEL_SCALAR;
+    }
+
+    switch (kernel)
+    {
+#if BILLING_HAVE_X86
+    case BILLING_KERNEL_AVX2:
+        billing_kernel_avx2(batch, books, book_count, charges);
+        break;
+    case BILLING_KERNEL_SSE:
+        billing_kernel_sse(batch, books, book_count, charges);
+        break;
+#endif
+    case BILLING_KERNEL_SCALAR:
+    default:
+        kernel = BILLING_KERNEL_SCALAR;
+        billing_kernel_scalar(batch, books, book_count, charges, 0);
+        break;
+    }
+    return kernel;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file 	batch_billing.h
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-18
+ * @brief 	Header file containing declarations for the batch billing kernels.
+ *
+ * Is used by the end-of-day settlement, which charges every session at once.
+ * The sessions are given as a structure of arrays and the charges are calculated
+ * with SIMD (AVX2 or SSE4.2) when the CPU supports it, otherwise with the scalar
+ * tariff_cost function. Every kernel returns the same charges, to the last agora.
+ */
+#ifndef BATCH_BILLING_H
+#define BATCH_BILLING_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "../tariff/tariff.h"
+
+/* Longest session, in seconds, the SIMD kernels handle. Longer ones use the scalar path.  */
+#define BILLING_MAX_VECTOR_SPAN (1LL << 30)
+/* Largest absolute unix time the SIMD kernels handle.  */
+#define BILLING_MAX_VECTOR_TIME (1LL << 38)
+
+#ifndef BILLING_KERNEL
+#define BILLING_KERNEL
+enum billing_kernel
+{
+	BILLING_KERNEL_AUTO = 0, /*AVX2 when the CPU supports it, otherwise scalar*/
+	BILLING_KERNEL_SCALAR = 1,
+	BILLING_KERNEL_SSE = 2,
+	BILLING_KERNEL_AVX2 = 3,
+};
+#endif /*BILLING_KERNEL*/
+
+/**
+ * @brief The sessions of a batch, as a structure of arrays.
+ */
+struct billing_batch
+{
+	size_t count;					/*Number of sessions*/
+	const int64_t *start_time;		/*Unix time every session started*/
+	const int64_t *end_time;		/*Unix time every session ended*/
+	const uint16_t *zone_id;		/*Zone of every session*/
+	const uint16_t *tariff_version; /*Version of the tariffs every session is charged by*/
+};
+
+/**
+ * @brief Get the best kernel the CPU supports.
+ *
+ * @return BILLING_KERNEL_AVX2, BILLING_KERNEL_SSE or BILLING_KERNEL_SCALAR.
+ */
+enum billing_kernel batch_billing_detect_kernel(void);
+
+/**
+ * @brief Get the name of a kernel, for logs.
+ *
+ * @param kernel The kernel.
+ * @return The name.
+ */
+const char *batch_billing_kernel_name(enum billing_kernel kernel);
+
+/**
+ * @brief Calculate the charge of every session of a batch.
+ *
+ * 'books' is indexed by the tariff version. A session whose version has no book,
+ * or whose zone is unknown, is charged 0 like in tariff_cost.
+ *
+ * @param batch Pointer to the sessions.
+ * @param books Array of tariff books indexed by the tariff version.
+ * @param book_count Number of entries in 'books'.
+ * @param charges Array of batch->count charges in minor units (output parameter).
+ * @param kernel The kernel to use, BILLING_KERNEL_AUTO for the fastest one.
+ * @return The kernel that was used, BILLING_KERNEL_SCALAR if the requested one is not supported.
+ */
+enum billing_kernel batch_billing_run(const struct billing_batch *batch, const struct tariff_book *const *books,
+									  uint16_t book_count, int64_t *charges, enum billing_kernel kernel);
+
+#endif /*BATCH_BILLING_H*/
@@ -0,0 +1,209 @@
+/**
+ * @file    billing_bench.c
+ * @author  Vlad Kulikov
+ * @date    2026-10-18
+ * @brief   Benchmark of the batch billing kernels.
+ *
+ * Charges a batch of random sessions with every kernel the CPU supports,
+ * prints the throughput of each one and checks that every charge is equal
+ * to the one of the scalar kernel.
+ *
+ * Usage: ./billing_bench [number of sessions]
+ */
+#include <stdlib.h>
+#include <time.h>
+#include "batch_billing.h"
+
+#define BENCH_DEFAULT_SESSIONS 1000000
+#define BENCH_BOOK_COUNT 3
+#define BENCH_ROUNDS 5
+/* The sessions start during one settlement day, a week before the first change of
+   the offset of the local time after 2026-01-01, so the long ones span it.  */
+#define BENCH_FIRST_START 1767225600LL
+#define BENCH_START_RANGE TARIFF_SECONDS_PER_DAY
+
+/**
+ * @brief Random number in [0, range).
+ */
+static int64_t bench_random(int64_t range)
+{
+    return (int64_t)((((uint64_t)rand() << 31) ^ (uint64_t)rand()) % (uint64_t)range);
+}
+
+/**
+ * @brief Build a book with night rates, daily caps and a free day, every kind of rule of the price D.B.
+ *
+ * @param version Version of the book.
+ * @param rate Day rate in minor units per hour.
+ * @return Pointer to the book, NULL if the allocation failed.
+ */
+static struct tariff_book *bench_book_create(uint32_t version, int64_t rate)
+{
+    struct tariff_book *book = tariff_book_create(version);
+
+    if (book == NULL)
+    {
+        return NULL;
+    }
+    for (uint16_t zone_id = ZONE_INVALID + 1; zone_id < ZONE_COUNT; ++zone_id)
+    {
+        struct tariff_zone *zone = &book->zone[zone_id];
+        int64_t zone_rate = rate * zone_id;
+
+        tariff_zone_set_rate(zone, TARIFF_EVERY_DAY, 0, 24, zone_rate);
+        tariff_zone_set_rate(zone, TARIFF_EVERY_DAY, 0, 8, zone_rate / 2);
+        tariff_zone_set_rate(zone, TARIFF_EVERY_DAY, 20, 24, zone_rate / 2);
+        tariff_zone_set_daily_cap(zone, TARIFF_EVERY_DAY, zone_rate * 10);
+        tariff_zone_set_rate(zone, 6, 0, 24, (zone_id == ZONE_JERUSALEM) ? 0 : zone_rate);
+    }
+    tariff_book_precompute(book);
+    return book;
+}
+
+/**
+ * @brief Time the kernel over BENCH_ROUNDS runs.
+ *
+ * @return The best run time in seconds.
+ */
+static double bench_kernel(const struct billing_batch *batch, const struct tariff_book *const *books,
+                           int64_t *charges, enum billing_kernel kernel)
+{
+    double best = 0;
+
+    for (int round = 0; round < BENCH_ROUNDS; ++round)
+    {
+        struct timespec begin, end;
+        double elapsed;
+
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        batch_billing_run(batch, books, BENCH_BOOK_COUNT, charges, kernel);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        elapsed = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9;
+        if (round == 0 || elapsed < best)
+        {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t count = (argc > 1) ? strtoul(argv[1], NULL, 10) : BENCH_DEFAULT_SESSIONS;
+    const struct tariff_book *books[BENCH_BOOK_COUNT] = {NULL};
+    int64_t *start_time = malloc(count * sizeof(*start_time));
+    int64_t *end_time = malloc(count * sizeof(*end_time));
+    uint16_t *zone_id = malloc(count * sizeof(*zone_id));
+    uint16_t *tariff_version = malloc(count * sizeof(*tariff_version));
+    int64_t *reference = malloc(count * sizeof(*reference));
+    int64_t *charges = malloc(count * sizeof(*charges));
+    struct billing_batch batch = {count, start_time, end_time, zone_id, tariff_version};
+    int64_t first_start = BENCH_FIRST_START;
+    enum billing_kernel best_kernel = batch_billing_detect_kernel();
+    double scalar_time = 0;
+    int failed = 0;
+
+    if (count == 0 || !start_time || !end_time || !zone_id || !tariff_version || !reference || !charges)
+    {
+        perror("billing_bench: malloc");
+        return EXIT_FAILURE;
+    }
+
+    /* Version 0 has no book, so its sessions are charged 0.  */
+    tariff_time_zone_init();
+    books[1] = bench_book_create(1, 600);
+    books[2] = bench_book_create(2, 800);
+    if (books[1] == NULL || books[2] == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+    for (uint8_t i = 1; i < books[1]->utc_offset_count; ++i)
+    {
+        if (books[1]->utc_offset_from[i] >= BENCH_FIRST_START)
+        {
+            first_start = books[1]->utc_offset_from[i] - 7 * TARIFF_SECONDS_PER_DAY;
+            break;
+        }
+    }
+
+    srand(55152);
+    for (size_t i = 0; i < count; ++i)
+    {
+        int64_t duration;
+
+        /* Mostly short sessions, some of several days and a few empty or reversed ones.  */
+        switch (bench_random(10))
+        {
+        case 0:
+            duration = bench_random(30 * TARIFF_SECONDS_PER_DAY);
+            break;
+        case 1:
+            duration = bench_random(TARIFF_SECONDS_PER_HOUR) - TARIFF_SECONDS_PER_HOUR / 2;
+            break;
+        default:
+            duration = bench_random(10 * TARIFF_SECONDS_PER_HOUR);
+            break;
+        }
+        start_time[i] = first_start + bench_random(BENCH_START_RANGE);
+        end_time[i] = start_time[i] + duration;
+        zone_id[i] = (uint16_t)(ZONE_INVALID + 1 + bench_random(ZONE_COUNT - 1));
+        tariff_version[i] = (uint16_t)(1 + bench_random(BENCH_BOOK_COUNT - 1));
+
+        /* Now and then an unknown zone or tariff version.  */
+        if (bench_random(256) == 0)
+        {
+            zone_id[i] = (uint16_t)bench_random(ZONE_COUNT + 1);
+            tariff_version[i] = (uint16_t)bench_random(BENCH_BOOK_COUNT + 1);
+        }
+    }
+    /* A few sessions out of the range of the SIMD kernels.  */
+    if (count > 2)
+    {
+        start_time[1] = -(BILLING_MAX_VECTOR_TIME << 4);
+        end_time[2] = start_time[2] + BILLING_MAX_VECTOR_SPAN + TARIFF_SECONDS_PER_DAY;
+        tariff_version[1] = tariff_version[2] = 1;
+        zone_id[1] = zone_id[2] = ZONE_JERUSALEM;
+    }
+
+    printf("billing_bench: %zu sessions from %lld, best kernel: %s\n", count, (long long)first_start,
+           batch_billing_kernel_name(best_kernel));
+
+    scalar_time = bench_kernel(&batch, books, reference, BILLING_KERNEL_SCALAR);
+    printf("  %-7s %9.3f ms %8.1f M sessions/s\n", "scalar", scalar_time * 1e3, count / scalar_time / 1e6);
+
+    for (enum billing_kernel kernel = BILLING_KERNEL_SSE; kernel <= best_kernel; ++kernel)
+    {
+        double elapsed = bench_kernel(&batch, books, charges, kernel);
+        size_t mismatches = 0;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (charges[i] != reference[i])
+            {
+                if (mismatches++ == 0)
+                {
+                    printf("  %s: session %zu (%lld-%lld zone %u version %u) %lld != %lld\n",
+                           batch_billing_kernel_name(kernel), i, (long long)start_time[i], (long long)end_time[i],
+                           zone_id[i], tariff_version[i], (long long)charges[i], (long long)reference[i]);
+                }
+            }
+        }
+        printf("  %-7s %9.3f ms %8.1f M sessions/s  x%.2f  %s\n", batch_billing_kernel_name(kernel), elapsed * 1e3,
+               count / elapsed / 1e6, scalar_time / elapsed, mismatches ? "MISMATCH" : "bit-exact");
+        if (mismatches)
+        {
+            failed = 1;
+        }
+    }
+
+    tariff_book_destroy((struct tariff_book *)books[1]);
+    tariff_book_destroy((struct tariff_book *)books[2]);
+    free(start_time);
+    free(end_time);
+    free(zone_id);
+    free(tariff_version);
+    free(reference);
+    free(charges);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
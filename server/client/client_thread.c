@@ -4,165 +4,490 @@
  * @date    2024-01-06
  */
 #include "client_thread.h"
+#include "../history/history_ingest.h"
+#include "../udp/udp_ingest.h"
+#include "../tariff/tariff_snapshot.h"
 
 /**
- * @brief Pango client thread function.
- *
- * This function handles communication with the Pango client, processes received data,
- * updates the database, and performs various actions based on the status value.
+ * @brief Timer callback of the parking reminder of a session.
  *
- * @param arg A pointer to the pango_data structure.
+ * @param entry The parking timer of the session.
+ * @param session_arg The session.
  */
-void *pango_client(void *client_data_struct)
+static void session_parking_reminder(struct timer_entry *entry, void *session_arg)
 {
-	struct pango_data *client = (struct pango_data *)client_data_struct;
-	struct timeval time;
-	sqlite3_stmt *stmt;
+	struct client_session *session = (struct client_session *)session_arg;
+	struct pango_data *client = session->client;
 
-	/* Buffer that will store clients data in to clients_data_struct,
-	for an easier access of the data.  */
-	uint8_t client_data_buff[CLIENT_DATA_BUFFER_SIZE] = {0};
+	pthread_mutex_lock(&mutex);
+	if (client->connected == TRUE)
+	{
+		printf("SERVER: %s has been parked for %d hours\n", client->mac_address,
+			   (int)((server_clock_ns() - client->start_parking_ns) / SERVER_CLOCK_NS_PER_SECOND / (60 * 60)));
+	}
+	pthread_mutex_unlock(&mutex);
 
-	/* Value that indicates if a loop function should:
-	   keep running (STAY) or QUIT.  */
-	uint8_t return_value = STAY;
+	timer_wheel_add(&server_timers, entry, SESSION_PARKING_REMINDER_SECONDS * 1000ULL);
+}
 
-	/* Represents the clients application status.  */
-	uint8_t status = STATUS_INITIAL_VALUE;
+/**
+ * @brief Add the parking timer of a session once it is connected.
+ *
+ * A session taken over from the database has parked for a while already,
+ * its first reminder comes sooner.
+ *
+ * @param session The session.
+ */
+static void arm_parking_reminder(struct client_session *session)
+{
+	uint64_t parked;
 
-	/*  Indicates whether the client's data has been checked in the database.  */
-	uint8_t checked_database = FALSE;
+	if (session->reminder_armed == TRUE || session->client->connected != TRUE)
+	{
+		return;
+	}
+	/* The start was read from the exact clock, the coarse one may be behind it.  */
+	parked = (server_clock_ns() - session->client->start_parking_ns) / SERVER_CLOCK_NS_PER_SECOND;
+	timer_wheel_add(&server_timers, &session->parking_timer,
+					(parked < SESSION_MAX_PARKING_SECONDS) ? (SESSION_MAX_PARKING_SECONDS - parked) * 1000ULL : 0);
+	session->reminder_armed = TRUE;
+}
 
-	/* Representation of the time vlaue at the end of client_thread.  */
-	uint32_t end_time = 0;
+/**
+ * @brief Start a session of the connection on a client slot.
+ *
+ * @param session The session.
+ * @param client The slot of the session.
+ * @param mac_key The unit of the session, 0 for a connection of a single unit.
+ */
+static void open_client_session(struct client_session *session, struct pango_data *client, uint64_t mac_key)
+{
+	memset(session, 0, sizeof(*session));
+	session->client = client;
+	session->mac_key = mac_key;
+	session->active = TRUE;
+	session->status = STATUS_INITIAL_VALUE;
+	timer_entry_init(&session->parking_timer, session_parking_reminder, session);
+}
 
-	/* A message, that indicates a failure,
-	which will be sent to the client.  */
-	const char err_msg[ERROR_MESSAGE_SIZE] = "ERROR";
+/**
+ * @brief Find the session of the unit that sent an event on a gateway connection.
+ *
+ * A unit without a session is given the slot of a finished session of the
+ * connection, or a new slot.
+ *
+ * @param session The sessions of the connection, GATEWAY_MAX_SESSIONS of them.
+ * @param event The event, its CRC-8 already checked.
+ * @param connection The connection the sessions are answered on.
+ * @return The session, or NULL if no slot is left for the unit.
+ */
+static struct client_session *find_gateway_session(struct client_session *session, const uint8_t *event,
+												   struct protocol_connection *connection)
+{
+	uint64_t mac_key = protocol_event_mac_key(event);
+	struct client_session *free_session = NULL;
+	struct pango_data *client;
 
-	printf("Client %d connected\n\n", client->client_fd);
+	for (int i = 0; i < GATEWAY_MAX_SESSIONS; ++i)
+	{
+		if (session[i].active == TRUE && session[i].mac_key == mac_key)
+		{
+			return &session[i];
+		}
+		/* A finished session keeps its slot, the first one is reused before a new slot is taken.  */
+		if (session[i].active == FALSE &&
+			(free_session == NULL || (free_session->client == NULL && session[i].client != NULL)))
+		{
+			free_session = &session[i];
+		}
+	}
+	if (free_session == NULL)
+	{
+		return NULL;
+	}
 
-	while (return_value != QUIT)
+	client = free_session->client;
+	if (client == NULL)
 	{
-		if (wait_for_data_from_client(client_data_struct, &status, client_data_buff, sizeof(client_data_buff)) == CONNECTION_LOST)
+		client = session_acquire(connection->fd);
+		if (client == NULL)
 		{
-			/* Apon sudden disconnection sets the staus value to CONNECTION_LOST.  */
-			return_value = QUIT;
-			break;
+			return NULL;
 		}
+		client->connection = connection;
+	}
+	open_client_session(free_session, client, mac_key);
+	return free_session;
+}
+
+/**
+ * @brief Handle a heartbeat, which keeps the connection and all its sessions alive.
+ *
+ * The first heartbeat arms the idle timeout of the connection: HEARTBEAT_MISSED_LIMIT
+ * periods without any event and the connection is given up. Units that never send
+ * one are found by the TCP keepalive only, see tune_client_socket.
+ *
+ * @param connection The connection the heartbeat came on.
+ * @param session The sessions of the connection.
+ * @param event The heartbeat, its CRC-8 already checked.
+ */
+static void handle_heartbeat(struct protocol_connection *connection, struct client_session *session, const uint8_t *event)
+{
+	uint32_t period = (event[7] != 0) ? event[7] : HEARTBEAT_DEFAULT_PERIOD_SECONDS;
+	uint64_t now = server_clock_coarse_ns();
+
+	protocol_set_idle_timeout(connection, period * HEARTBEAT_MISSED_LIMIT);
 
-		/* Checking the received data for 'data corruption'.  */
-		switch (CRC_8_check(client_data_buff, PANGO_DATA_SIZE, &status))
+	pthread_mutex_lock(&mutex);
+	for (int i = 0; i < GATEWAY_MAX_SESSIONS; ++i)
+	{
+		if (session[i].active == TRUE)
 		{
-		/* Copying the client data from a buffer to a struct.  */
-		case TRUE:
-			store_client_data_in_struct(&status, client_data_buff, sizeof(client_data_buff), client_data_struct);
-			break;
-		/* CRC_8_check assigns the variable status the value CRC8_TEST_FAILED .  */
-		case FALSE:
-		default:
-			return_value = QUIT;
-			break;
+			__atomic_store_n(&session[i].client->last_seen_ns, now, __ATOMIC_RELAXED);
 		}
+	}
+	pthread_mutex_unlock(&mutex);
+
+	if (protocol_send_ack(connection, HEARTBEAT_APP) != PROTOCOL_OK)
+	{
+		perror("HEARTBEAT_APP: protocol_send_ack");
+	}
+}
 
-		switch (status)
+/**
+ * @brief Push the zone and tariff snapshot to a BBB that asked for it.
+ *
+ * It is sent once, then again whenever the tariff version changed, before the
+ * reply to the frame just received; an idle BBB gets it with the next heartbeat reply.
+ *
+ * @param connection The connection of the BBB.
+ */
+static void push_zone_snapshot(struct protocol_connection *connection)
+{
+	uint8_t snapshot[PROTOCOL_MAX_SNAPSHOT];
+	uint32_t version;
+	size_t size;
+	int token;
+
+	if (connection->snapshot != TRUE)
+	{
+		return;
+	}
+	token = tariff_read_lock();
+	version = tariff_current()->version;
+	if (connection->snapshot_sent == TRUE && connection->snapshot_version == version)
+	{
+		tariff_read_unlock(token);
+		return;
+	}
+	size = tariff_snapshot_encode(tariff_current(), snapshot, sizeof(snapshot));
+	tariff_read_unlock(token);
+
+	if (size == 0 || protocol_send_snapshot(connection, snapshot, (uint16_t)size) != PROTOCOL_OK)
+	{
+		perror("protocol_send_snapshot");
+		return;
+	}
+	connection->snapshot_sent = TRUE;
+	connection->snapshot_version = version;
+}
+
+/**
+ * @brief Handle one event of a session.
+ *
+ * @param session The session the event belongs to.
+ * @param event The event.
+ * @return QUIT when the session is over, STAY otherwise.
+ */
+static uint8_t handle_client_event(struct client_session *session, const uint8_t *event)
+{
+	struct pango_data *client = session->client;
+	sqlite3_stmt *stmt;
+	int token;
+
+	/* Value that indicates if the session should:
+	   keep running (STAY) or QUIT.  */
+	uint8_t return_value = STAY;
+
+	/* Checking the received data for 'data corruption'.  */
+	switch (CRC_8_check(event, PANGO_DATA_SIZE, &session->status))
+	{
+	/* Copying the client data from a buffer to a struct.  */
+	case TRUE:
+		store_client_data_in_struct(&session->status, event, CLIENT_DATA_BUFFER_SIZE, client);
+		break;
+	/* CRC_8_check assigns the variable status the value CRC8_TEST_FAILED .  */
+	case FALSE:
+	default:
+		return_value = QUIT;
+		break;
+	}
+
+	switch (session->status)
+	{
+	/* If the status vlaue, received by the client, says that the client wants to start using the app.  */
+	case START_APP:
+		/* If the MAC address already appears in the database of clients, the data extracted and updated.  */
+		if (clinet_exist_in_database_check(client->mac_address, sizeof(client->mac_address), &session->checked_database, &stmt) == TRUE)
 		{
-		/* If the status vlaue, received by the client, says that the client wants to start using the app.  */
-		case START_APP:
-			/* If the MAC address already appears in the database of clients, the data extracted and updated.  */
-			if (clinet_exist_in_database_check(client->mac_address, sizeof(client->mac_address), &checked_database, &stmt) == TRUE)
+			return_value = retriev_client_data(client, &stmt, &session->status);
+			if (return_value != QUIT)
 			{
-				return_value = retriev_client_data(client_data_struct, &stmt, &status);
-				if (return_value != QUIT)
-				{
-					/* in the next while loop iteration, after the client is already connected,
-					it won't check if the client already exists.  */
-					checked_database = TRUE;
-				}
-				else
-					break;
+				/* in the next while loop iteration, after the client is already connected,
+				it won't check if the client already exists.  */
+				session->checked_database = TRUE;
 			}
+			else
+				break;
+		}
 
-			/* When the mac address doesn't appear in the client data base.  */
-			if (new_client(checked_database) == TRUE)
-			{
-				/* Intitalizing and storing the clent data in the database.  */
-				return_value = process_client_data(client_data_struct, &stmt, &status);
-				if (return_value != QUIT)
-				{
-					/* Setting the clients running value of the thread with ON.
-					which flags the data base to update the clients data.  */
-					client->connected = TRUE;
-				}
-			}
-			break;
-		/* If the status vlaue, received by the client, says that the client wants to close the app.  */
-		case CLOSE_APP:
-			pthread_mutex_lock(&mutex);
+		/* When the mac address doesn't appear in the client data base.  */
+		if (new_client(session->checked_database) == TRUE)
+		{
+			/* Intitalizing and storing the clent data in the database.  */
+			/* Also sets the client as connected.  */
+			return_value = process_client_data(client, &stmt, &session->status);
+		}
+		break;
+	/* If the status vlaue, received by the client, says that the client wants to close the app.  */
+	case CLOSE_APP:
+		pthread_mutex_lock(&mutex);
 
-			if (update_client_data(&end_time, client_data_struct) == ERROR)
-			{
-				status = CLOSE_APP_ERROR;
-			}
+		if (update_client_data(&session->end_time, client) == ERROR)
+		{
+			session->status = CLOSE_APP_ERROR;
+		}
 
-			/* Setting off the running value of the thread.
-			which flags the data base to stop updating the clients data.  */
-			client->connected = FALSE;
+		/* Entered before the session stops being connected, so the repricing thread
+		   can't retire its tariff version before the charge is calculated.  */
+		token = tariff_read_lock();
 
-			pthread_mutex_unlock(&mutex);
-			return_value = QUIT;
-			break;
-		default:
-			break;
+		/* Setting off the running value of the thread.
+		which flags the data base to stop updating the clients data.  */
+		client->connected = FALSE;
+
+		pthread_mutex_unlock(&mutex);
+
+		/* Only the charge is calculated in the read section, it is sent once the section is left.  */
+		if (session->status == CLOSE_APP)
+		{
+			session->charge = calculate_payment(client, session->end_time);
 		}
+		tariff_read_unlock(token);
+		return_value = QUIT;
+		break;
+	/* If the status vlaue, received by the client, asks for the cost of the session so far.  */
+	case QUOTE_APP:
+		/* A lost connection is found by the next recv.  */
+		send_quote_to_client(client);
+		break;
+	default:
+		break;
 	}
+	return return_value;
+}
 
-	/* Handling the exit of the client, depanding on the status value */
-	switch (status)
+/**
+ * @brief Finish a session, depanding on its status value, and answer its last event.
+ *
+ * @param session The session.
+ */
+static void finish_client_session(struct client_session *session)
+{
+	struct pango_data *client = session->client;
+
+	switch (session->status)
 	{
 	/* Calculating and sanding the amount to pay, to the client.
 	And removing the clients data from the database.  */
 	case CLOSE_APP:
-		calculate_and_send_payment_data(client->time_start_parking, end_time, client->price, client->client_fd);
+		send_payment_data(client, session->charge, session->end_time);
 		pthread_mutex_lock(&mutex);
 		remove_client_data(client->mac_address, sizeof(client->mac_address));
 		pthread_mutex_unlock(&mutex);
+		/* The UDP key of the unit is good for this session only.  */
+		udp_unit_close(client->mac_key);
 		break;
 	/* Updeating the clients data in to the client data base.  */
 	case CONNECTION_LOST:
 		pthread_mutex_lock(&mutex);
-		update_client_data(&end_time, client_data_struct);
+		update_client_data(&session->end_time, client);
 		pthread_mutex_unlock(&mutex);
 		break;
 	case CRC8_TEST_FAILED:
 		puts("The CRC-8 value, of the received data, is different compared to the one the client sent");
-		if (send(client->client_fd, err_msg, sizeof(err_msg), 0) == -1)
+		if (protocol_send_error(client->connection, session->status) != PROTOCOL_OK)
 		{
-			perror("CRC8_TEST_FAILED: send");
+			perror("CRC8_TEST_FAILED: protocol_send_error");
 		}
 		break;
 	/* An error occurred in on of the inner functions of clinet_exist_in_database_check.  */
 	case ERROR_STATUS_IN_CLIENT_EXIST_SUBFUNCTIONS:
 		puts("Error in one of clinet_exist_in_database_check inner functions");
-		if (send(client->client_fd, err_msg, sizeof(err_msg), 0) == -1)
+		if (protocol_send_error(client->connection, session->status) != PROTOCOL_OK)
 		{
-			perror("ERROR_STATUS_IN_CLIENT_EXIST_SUBFUNCTIONS: send");
+			perror("ERROR_STATUS_IN_CLIENT_EXIST_SUBFUNCTIONS: protocol_send_error");
 		}
 		break;
 	case ERROR_STATUS_IN_NEW_CLIENT_SUBFUNCTIONS:
 		puts("Error in one of new_client inner functions");
-		if (send(client->client_fd, err_msg, sizeof(err_msg), 0) == -1)
+		if (protocol_send_error(client->connection, session->status) != PROTOCOL_OK)
+		{
+			perror("ERROR_STATUS_IN_NEW_CLIENT_SUBFUNCTIONS: protocol_send_error");
+		}
+		break;
+	/* The session can't be closed, its unit is told instead of waiting for the payment.  */
+	case CLOSE_APP_ERROR:
+		puts("Error in update_client_data while closing the session");
+		if (protocol_send_error(client->connection, session->status) != PROTOCOL_OK)
 		{
-			perror("ERROR_STATUS_IN_NEW_CLIENT_SUBFUNCTIONS: send");
+			perror("CLOSE_APP_ERROR: protocol_send_error");
 		}
 		break;
 	default:
 		break;
 	}
 
+	/* Before the session is reused, the reminder may run now and reads it.  */
+	timer_wheel_cancel(&server_timers, &session->parking_timer);
+	session->reminder_armed = FALSE;
+	printf("status = %d\n", session->status);
+	session->active = FALSE;
+}
+
+/**
+ * @brief Pango client thread function.
+ *
+ * This function handles communication with the Pango client, processes received data,
+ * updates the database, and performs various actions based on the status value.
+ * The connection of a single unit ends with its session. A gateway connection
+ * stays open and routes every event to the session of its unit by the MAC address.
+ *
+ * @param arg A pointer to the pango_data structure, a slot taken by session_acquire.
+ */
+void *pango_client(void *client_data_struct)
+{
+	struct pango_data *client = (struct pango_data *)client_data_struct;
+
+	/* The clients data, parsed in place in the receive ring of the connection
+	and stored in to clients_data_struct, for an easier access of the data.  */
+	const uint8_t *client_data_buff = NULL;
+
+	/* The sessions of the connection, only the first is used unless it is a gateway.  */
+	struct client_session session[GATEWAY_MAX_SESSIONS];
+	struct client_session *current;
+
+	/* Framing state of the connection, v1 or v2 is negotiated by the first byte.  */
+	struct protocol_connection connection;
+
+	protocol_connection_init(&connection, client->client_fd);
+	client->connection = &connection;
+	/* The session is opened by the first event, once it is known if the connection is a gateway.  */
+	memset(session, 0, sizeof(session));
+	session[0].client = client;
+
+	printf("Client %d connected\n\n", client->client_fd);
+
+	while (1)
+	{
+		uint8_t received = wait_for_data_from_client(client_data_struct, &session[0].status, &client_data_buff);
+
+		if (received == CONNECTION_LOST || received == CONNECTION_TIMED_OUT)
+		{
+			size_t lost = 0;
+
+			/* Apon sudden disconnection sets the staus value of every session to CONNECTION_LOST.  */
+			for (int i = 0; i < GATEWAY_MAX_SESSIONS; ++i)
+			{
+				if (session[i].active == TRUE)
+				{
+					session[i].status = CONNECTION_LOST;
+					pthread_mutex_lock(&mutex);
+					session[i].client->connected = FALSE;
+					pthread_mutex_unlock(&mutex);
+					++lost;
+				}
+			}
+			/* A dead BBB never closes its connection, its sessions would be billed forever.  */
+			if (received == CONNECTION_TIMED_OUT && lost != 0)
+			{
+				session_reclaimed(lost);
+			}
+			break;
+		}
+
+		/* The snapshot goes out ahead of the reply, so the BBB never shows a stale rate for long.  */
+		push_zone_snapshot(&connection);
+
+		/* The events a BBB stored while offline are applied in bulk, apart from the live sessions.  */
+		if (received == HISTORY_APP)
+		{
+			history_ingest(&connection);
+			continue;
+		}
+
+		/* A heartbeat belongs to no session, on a gateway connection neither.  */
+		if (client_data_buff[0] == HEARTBEAT_APP &&
+			client_data_buff[PROTOCOL_EVENT_CRC_OFFSET] == crc8_compute(client_data_buff, PANGO_DATA_SIZE))
+		{
+			handle_heartbeat(&connection, session, client_data_buff);
+			continue;
+		}
+
+		current = &session[0];
+		if (connection.gateway != TRUE && current->active == FALSE)
+		{
+			open_client_session(current, client, 0);
+		}
+		else if (connection.gateway == TRUE)
+		{
+			/* A corrupted MAC can't be routed, the event alone is answered with an error.  */
+			if (client_data_buff[PROTOCOL_EVENT_CRC_OFFSET] != crc8_compute(client_data_buff, PANGO_DATA_SIZE))
+			{
+				puts("The CRC-8 value, of the received data, is different compared to the one the client sent");
+				protocol_send_error(&connection, CRC8_TEST_FAILED);
+				continue;
+			}
+			current = find_gateway_session(session, client_data_buff, &connection);
+			if (current == NULL)
+			{
+				puts("No free client slot for a unit of the gateway");
+				protocol_send_error(&connection, ERROR);
+				continue;
+			}
+		}
+
+		if (handle_client_event(current, client_data_buff) == QUIT)
+		{
+			finish_client_session(current);
+			if (connection.gateway != TRUE)
+			{
+				break;
+			}
+		}
+		else
+		{
+			arm_parking_reminder(current);
+		}
+	}
+
 	/*closing resources*/
+	for (int i = 0; i < GATEWAY_MAX_SESSIONS; ++i)
+	{
+		if (session[i].active == TRUE)
+		{
+			finish_client_session(&session[i]);
+		}
+	}
+	protocol_connection_release(&connection);
 	close(client->client_fd);
-	printf("status = %d\n", status);
+	for (int i = 0; i < GATEWAY_MAX_SESSIONS; ++i)
+	{
+		if (session[i].client != NULL)
+		{
+			session_release(session[i].client);
+		}
+	}
 	printf("Client disconnected.\n");
 	pthread_exit(NULL);
-}
\ No newline at end of file
+}
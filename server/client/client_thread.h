@@ -15,9 +15,17 @@
 #include <sqlite3.h>
 #include <string.h>
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include "./new_client/new_client.h"
 #include "./existing_client/existing_client.h"
+#include "../tariff/tariff_rcu.h"
+#include "../protocol/protocol.h"
+#include "../timer/timer_wheel.h"
+#include "../clock/server_clock.h"
+#include "../../common/crc8/crc8.h"
 
 #ifndef COMMON_DEFINES
 #define COMMON_DEFINES
@@ -34,10 +42,27 @@
 
 #endif /*COMMON_DEFINES*/
 
-#define CRC_POLYNOMIAL 0x8D
 #define CLIENT_DATA_BUFFER_SIZE 10
 #define STATUS_INITIAL_VALUE 2
 #define PANGO_DATA_SIZE (CLIENT_DATA_BUFFER_SIZE - 1)
+/* Heartbeats a connection may miss before it is given up, and the period of the
+   heartbeats that don't have one.  */
+#define HEARTBEAT_MISSED_LIMIT 3
+#define HEARTBEAT_DEFAULT_PERIOD_SECONDS 2
+/* TCP keepalive of the client sockets: the first probe after CLIENT_KEEPALIVE_IDLE_SECONDS
+   of silence, one every CLIENT_KEEPALIVE_INTERVAL_SECONDS, CLIENT_KEEPALIVE_PROBES unanswered
+   ones and the connection is dropped. Finds the dead units that never send heartbeats.  */
+#define CLIENT_KEEPALIVE_IDLE_SECONDS 5
+#define CLIENT_KEEPALIVE_INTERVAL_SECONDS 2
+#define CLIENT_KEEPALIVE_PROBES 3
+/* Replies not acknowledged for this long drop the connection.  */
+#define CLIENT_USER_TIMEOUT_MS 10000
+/* Sessions a gateway connection may keep at once, one per unit behind the BBB.  */
+#define GATEWAY_MAX_SESSIONS 8
+/* A session parked this long is reported, and again every SESSION_PARKING_REMINDER_SECONDS
+   while it goes on: a unit that never closes its session is billed for all of it.  */
+#define SESSION_MAX_PARKING_SECONDS (12 * 60 * 60)
+#define SESSION_PARKING_REMINDER_SECONDS (60 * 60)
 
 #ifndef FLAG_STATE
 #define FLAG_STATE
@@ -55,6 +80,10 @@ enum app_status
 	START_APP = 1,
 	CLOSE_APP = 2,
 	CONNECTION_LOST = 3,
+	QUOTE_APP = 4, /*The client asks for the cost of the session so far*/
+	HEARTBEAT_APP = 8, /*The BBB is alive, the x_axis is its heartbeat period in seconds*/
+	CONNECTION_TIMED_OUT = 9, /*The connection went silent, see HEARTBEAT_MISSED_LIMIT*/
+	HISTORY_APP = 10, /*The BBB sent the events it stored while the server couldn't be reached*/
 };
 #endif /*APP_STATUS*/
 
@@ -78,22 +107,47 @@ enum loop_status
 
 #ifndef STRUCT_PANGO_DATA
 #define STRUCT_PANGO_DATA
-#pragma pack(push, 1)
 struct pango_data
 {
 	uint8_t status; /*A flag that indicates if the application has started or ended*/
 	char mac_address[MAC_ADDRESS_SIZE];
+	uint64_t mac_key; /*The MAC address as a number, mac_address is formatted only when it changes*/
 	uint8_t x_axis;
 	uint8_t y_axis;
 	uint8_t client_fd;
-	char location[12]; /*Where the clients location name will be stored*/
+	struct protocol_connection *connection; /*Framing of the connection, see protocol.h*/
+	uint16_t zone_id; /*Interned id of the zone (city) the client parked in*/
 	double price;
-	int time_start_parking;	  /*The time the client started to use the application*/
+	uint64_t start_parking_ns; /*Monotonic time the client started to use the application, see server_clock.h*/
 	volatile uint8_t connected; /*Indecates if the client is currently connecnted to the server and counting time*/
+	uint32_t tariff_version; /*Version of the tariffs the session is priced under*/
+	uint64_t priced_from_ns; /*Monotonic start of the part of the session that is not in the charge yet*/
+	int64_t charge;			 /*Charge, in minor units, of the session before priced_from_ns*/
+	volatile uint8_t pricing_seq; /*Odd while the repricing thread changes the three fields above, which are accessed with __atomic builtins*/
+	volatile uint8_t in_use; /*The slot belongs to a connection thread, see session_acquire*/
+	volatile uint64_t last_seen_ns; /*Coarse monotonic time of the last event or datagram of the unit, stored with __atomic_store_n*/
 };
-#pragma pack(pop)
 #endif /*STRUCT_PANGO_DATA*/
 
+/**
+ * @brief A parking session handled by a connection thread.
+ *
+ * A connection of a single unit has one session, a gateway connection has
+ * one per unit, told apart by the MAC address of the events.
+ */
+struct client_session
+{
+	struct pango_data *client; /*Slot of the session, NULL until the first event of a new unit*/
+	uint64_t mac_key;		   /*The unit of a gateway session*/
+	uint8_t active;			   /*The session has events that are not finished yet*/
+	uint8_t status;			   /*Represents the clients application status*/
+	uint8_t checked_database;  /*Indicates whether the client's data has been checked in the database*/
+	uint64_t end_time;		   /*Monotonic time at the end of the session, see server_clock_ns*/
+	int64_t charge;			   /*Charge of a closed session, calculated as it stopped being connected*/
+	uint8_t reminder_armed;	   /*parking_timer was added since the session started*/
+	struct timer_entry parking_timer; /*Reminds of a session parked past SESSION_MAX_PARKING_SECONDS*/
+};
+
 extern sqlite3 *db_client;
 extern sqlite3 *db_prices;
 extern pthread_mutex_t mutex;
@@ -107,22 +161,12 @@ extern pthread_mutex_t mutex;
  *
  * @param client_arg Pointer to the structure containing client data.
  * @param status Pointer to the status variable to be updated based on connection status.
- * @param client_buff Pointer to the buffer to store received client data.
- * @param client_buff_size Size of the client data buffer.
- * @return CONNECTION_LOST if the client disconnects unexpectedly, 0 otherwise.
+ * @param client_buff Pointer to the received client data, in the receive ring of the connection (output parameter).
+ * @return CONNECTION_LOST if the client disconnects unexpectedly,
+ *         CONNECTION_TIMED_OUT if it went silent or TCP gave up on it,
+ *         HISTORY_APP if it sent a HISTORY frame instead of an event, 0 otherwise.
  */
-uint8_t wait_for_data_from_client(void *client_arg, uint8_t *status, uint8_t *client_buff, uint8_t client_buff_size);
-
-/**
- * @brief Calculate CRC-8 checksum for the given data and used in the CRC_8_check function.
- *
- * This function calculates the CRC-8 checksum for the given data using a predefined polynomial.
- *
- * @param data Pointer to the data array.
- * @param length Length of the data array.
- * @return CRC-8 checksum.
- */
-uint8_t calculateCRC8(uint8_t *data, uint32_t length);
+uint8_t wait_for_data_from_client(void *client_arg, uint8_t *status, const uint8_t **client_buff);
 
 /**
  * @brief Check CRC-8 validity for a data buffer.
@@ -136,7 +180,7 @@ uint8_t calculateCRC8(uint8_t *data, uint32_t length);
  *
  * @return TRUE if the CRC-8 check is successful, FALSE otherwise.
  */
-uint8_t CRC_8_check(uint8_t buff[10], uint8_t buff_size, uint8_t *status);
+uint8_t CRC_8_check(const uint8_t *buff, uint8_t buff_size, uint8_t *status);
 
 /**
  * @brief Store client data in the struct: client_data_struct.
@@ -149,9 +193,20 @@ uint8_t CRC_8_check(uint8_t buff[10], uint8_t buff_size, uint8_t *status);
  * @param client_buff_size Size of the client data buffer.
  * @param client_arg Pointer to the structure for storing client data.
  */
-void store_client_data_in_struct(uint8_t *status, uint8_t *client_buff,
+void store_client_data_in_struct(uint8_t *status, const uint8_t *client_buff,
 								 uint8_t client_buff_size, void *client_arg);
 
+/**
+ * @brief Format a MAC address key as the text stored in the database.
+ *
+ * The bytes are written in hex without leading zeros, separated by ':'.
+ *
+ * @param mac_key The MAC address, see protocol_event_mac_key.
+ * @param mac_address Buffer for the text (output parameter).
+ * @param mac_address_size Size of the buffer.
+ */
+void format_mac_address(uint64_t mac_key, char *mac_address, uint8_t mac_address_size);
+
 /**
  * @brief Check the existence of a client in the database based on MAC address.
  *
@@ -198,25 +253,49 @@ uint8_t new_client(uint8_t checked_database_value);
  * @brief Update client data in the database based on the parking duration.
  *
  * This function calculates the parking duration, updates the database with the calculated
- * time used, and sets the provided 'end' parameter with the current time.
+ * time used, and sets the provided 'end' parameter with the current monotonic time.
  *
- * @param end Pointer to the variable that will be updated with the current time.
+ * @param end Pointer to the variable that will be updated with the current time, see server_clock_ns.
  * @param client_struct Pointer to the client data structure.
  */
-uint8_t update_client_data(uint32_t *end, void *client_data_struct);
+uint8_t update_client_data(uint64_t *end, void *client_data_struct);
+
+/**
+ * @brief Calculate the payment amount of a session.
+ *
+ * The part already charged by the repricing thread plus the rest by the time-of-day
+ * tariffs of every version in effect since.
+ * Is called inside a read section of the tariffs, after the client stopped being connected.
+ *
+ * @param client_data_struct Pointer to the client data structure.
+ * @param end End time of parking, see server_clock_ns.
+ * @return The charge in minor units.
+ */
+int64_t calculate_payment(void *client_data_struct, uint64_t end);
 
 /**
- * @brief Calculate and send payment data to the client.
+ * @brief Send payment data to the client.
  *
- * This function calculates the parking duration and payment amount based on the start and end times
- * and sends the payment data to the client.
+ * Is called outside of the read section of the tariffs, a stalled client
+ * must not keep the repricing thread from retiring a version.
  *
- * @param start_time Start time of parking.
- * @param end_time End time of parking.
- * @param parking_price_per_second Price per second of parking.
- * @param client_fd File descriptor of the client.
+ * @param client_data_struct Pointer to the client data structure.
+ * @param cost The charge calculated by calculate_payment.
+ * @param end End time of parking, see server_clock_ns.
  */
-void calculate_and_send_payment_data(int start_time, int end_time, double parking_price_per_second, uint8_t client_fd);
+void send_payment_data(void *client_data_struct, int64_t cost, uint64_t end);
+
+/**
+ * @brief Send the cost of the session so far to the client, without ending the session.
+ *
+ * The quote is calculated from the session in memory and the published tariffs,
+ * without the database and without the mutex, so the client can ask for it every few seconds.
+ * The reply has the shape of the payment data, {0, 0} when the session hasn't started.
+ *
+ * @param client_data_struct Pointer to the client data structure.
+ * @return QUIT if there is an error during the send operation, STAY otherwise.
+ */
+uint8_t send_quote_to_client(void *client_data_struct);
 
 /**
  * @brief Remove client data from the database based on MAC address.
@@ -228,4 +307,59 @@ void calculate_and_send_payment_data(int start_time, int end_time, double parkin
  */
 void remove_client_data(uint8_t *mac_address_arg, uint8_t mac_address_size);
 
+/**
+ * @brief Set the client slots that connections and gateway sessions are given.
+ *
+ * @param clients The slots, shared with the database update and repricing threads.
+ * @param count Number of slots.
+ */
+void session_table_init(struct pango_data *clients, size_t count);
+
+/**
+ * @brief Take a free client slot for a connection or a gateway session.
+ *
+ * The slot is cleared and keeps the socket of the connection.
+ *
+ * @param fd The socket of the connection.
+ * @return The slot, or NULL if all of them are taken.
+ */
+struct pango_data *session_acquire(int fd);
+
+/**
+ * @brief Give a slot back once the connection thread is done with it.
+ *
+ * @param client The slot, see session_acquire.
+ */
+void session_release(struct pango_data *client);
+
+/**
+ * @brief Find the session a connection is counting the time of for a unit.
+ *
+ * Is called with the mutex locked.
+ *
+ * @param mac_key The MAC address of the unit, see protocol_event_mac_key.
+ * @return The slot of the session, NULL if no connection has the unit connected.
+ */
+struct pango_data *session_connected(uint64_t mac_key);
+
+/**
+ * @brief Set the TCP keepalive and user timeout of a client socket.
+ *
+ * @param fd The socket of the connection.
+ * @return TRUE on success, FALSE if one of the options can't be set.
+ */
+uint8_t tune_client_socket(int fd);
+
+/**
+ * @brief Count sessions reclaimed from connections that went silent.
+ *
+ * @param count Number of sessions of the connection.
+ */
+void session_reclaimed(size_t count);
+
+/**
+ * @brief Number of sessions reclaimed from connections that went silent so far.
+ */
+size_t session_reclaimed_count(void);
+
 #endif /*CLIENT_THREAD_H*/
\ No newline at end of file
@@ -6,6 +6,13 @@
  */
 #include "client_thread.h"
 
+/* The client slots of main, taken by connections and by the sessions of gateways.  */
+static struct pango_data *session_slots;
+static size_t session_slot_count;
+
+/* Sessions reclaimed from connections that went silent.  */
+static size_t reclaimed_sessions;
+
 /**
  * @brief Wait for data from the client and handle disconnection.
  *
@@ -15,19 +22,26 @@
  *
  * @param client_arg Pointer to the structure containing client data.
  * @param status Pointer to the status variable to be updated based on connection status.
- * @param client_buff Pointer to the buffer to store received client data.
- * @param client_buff_size Size of the client data buffer.
- * @return CONNECTION_LOST if the client disconnects unexpectedly, 0 otherwise.
+ * @param client_buff Pointer to the received client data, in the receive ring of the connection (output parameter).
+ * @return CONNECTION_LOST if the client disconnects unexpectedly,
+ *         CONNECTION_TIMED_OUT if it went silent or TCP gave up on it,
+ *         HISTORY_APP if it sent a HISTORY frame instead of an event, 0 otherwise.
  */
-uint8_t wait_for_data_from_client(void *client_arg, uint8_t *status, uint8_t *client_buff, uint8_t client_buff_size)
+uint8_t wait_for_data_from_client(void *client_arg, uint8_t *status, const uint8_t **client_buff)
 {
     struct pango_data *client = (struct pango_data *)client_arg;
-    /* Waiting for the client data from the BBB.  */
-    if (recv(client->client_fd, client_buff, client_buff_size, 0) == 0)
+    /* Waiting for the client data from the BBB, a whole event of either protocol version.  */
+    uint8_t result = protocol_receive_event(client->connection, client_buff);
+
+    if (result == PROTOCOL_HISTORY)
     {
-        /* The thread enteres if the client suddenly disscinnected.  */
+        return HISTORY_APP;
+    }
+    if (result != PROTOCOL_OK)
+    {
+        /* The thread enteres if the client suddenly disscinnected or sent a frame that can't be parsed.  */
         *status = CONNECTION_LOST;
-        printf("The client disconnected suddenly\n");
+        puts((result == PROTOCOL_TIMEOUT) ? "The client went silent" : "The client disconnected suddenly");
 
         /* The thread changes the running status,
            so the updating data base thread wont change the time value,
@@ -38,38 +52,11 @@ uint8_t wait_for_data_from_client(void *client_arg, uint8_t *status, uint8_t *cl
 
         pthread_mutex_unlock(&mutex);
 
-        return CONNECTION_LOST;
+        return (result == PROTOCOL_TIMEOUT) ? CONNECTION_TIMED_OUT : CONNECTION_LOST;
     }
     return 0;
 }
 
-/**
- * @brief Calculate CRC-8 checksum for the given data and used in the CRC_8_check function.
- *
- * This function calculates the CRC-8 checksum for the given data using a predefined polynomial.
- *
- * @param data Pointer to the data array.
- * @param length Length of the data array.
- * @return CRC-8 checksum.
- */
-uint8_t calculateCRC8(uint8_t* data, uint32_t length) {
-    uint8_t crc = 0xFF;
-
-    for (uint32_t i = 0; i < length; i++) {
-        crc ^= data[i];
-
-        for (uint8_t j = 0; j < 8; j++) {
-            if (crc & 0x80) {
-                crc = (crc << 1) ^ CRC_POLYNOMIAL;
-            } else {
-                crc <<= 1;
-            }
-        }
-    }
-
-    return crc;
-}
-
 /**
  * @brief Check CRC-8 validity for a data buffer.
  *
@@ -82,9 +69,9 @@ uint8_t calculateCRC8(uint8_t* data, uint32_t length) {
  *
  * @return TRUE if the CRC-8 check is successful, FALSE otherwise.
  */
-uint8_t CRC_8_check(uint8_t buff[10], uint8_t buff_size, uint8_t *status )
+uint8_t CRC_8_check(const uint8_t *buff, uint8_t buff_size, uint8_t *status )
 {
-	if(buff[9] == calculateCRC8(buff, buff_size))
+	if(buff[9] == crc8_compute(buff, buff_size))
     {
         printf("The CRC-8 check is successful\n");
         return TRUE;
@@ -108,39 +95,44 @@ uint8_t CRC_8_check(uint8_t buff[10], uint8_t buff_size, uint8_t *status )
  * @param client_buff_size Size of the client data buffer.
  * @param client_arg Pointer to the structure for storing client data.
  */
-void store_client_data_in_struct(uint8_t *status, uint8_t *client_buff,
+void store_client_data_in_struct(uint8_t *status, const uint8_t *client_buff,
                                uint8_t client_buff_size, void *client_arg)
 {
     struct pango_data *client = (struct pango_data *)client_arg;
     if (*status != CRC8_TEST_FAILED)
     {
-        int offset = 0;
-        for (size_t i = 0; i < 8; ++i)
+        uint64_t mac_key = protocol_event_mac_key(client_buff);
+
+        *status = client_buff[0];
+        client->x_axis = client_buff[7];
+        client->y_axis = client_buff[8];
+        __atomic_store_n(&client->last_seen_ns, server_clock_coarse_ns(), __ATOMIC_RELAXED);
+
+        /* The text form is only needed by the database, and a connection keeps its MAC.  */
+        if (mac_key != client->mac_key || client->mac_address[0] == '\0')
         {
-            if (i == 0)
-            {
-                *status = client_buff[0];
-            }
-            if (i > 0 && i < 7)
-            {
-                if (i == 6)
-                {
-                    offset += sprintf(client->mac_address + offset, "%x", client_buff[i]);
-                }
-                else
-                {
-                    offset += sprintf(client->mac_address + offset, "%x%c", client_buff[i], ':');
-                }
-            }
-            else
-            {
-                client->x_axis = client_buff[i];
-                client->y_axis = client_buff[i + 1];
-            }
+            client->mac_key = mac_key;
+            format_mac_address(mac_key, client->mac_address, sizeof(client->mac_address));
         }
     }
 }
 
+/**
+ * @brief Format a MAC address key as the text stored in the database.
+ *
+ * The bytes are written in hex without leading zeros, separated by ':'.
+ *
+ * @param mac_key The MAC address, see protocol_event_mac_key.
+ * @param mac_address Buffer for the text (output parameter).
+ * @param mac_address_size Size of the buffer.
+ */
+void format_mac_address(uint64_t mac_key, char *mac_address, uint8_t mac_address_size)
+{
+    snprintf(mac_address, mac_address_size, "%x:%x:%x:%x:%x:%x",
+             (unsigned)(mac_key >> 40) & 0xFF, (unsigned)(mac_key >> 32) & 0xFF, (unsigned)(mac_key >> 24) & 0xFF,
+             (unsigned)(mac_key >> 16) & 0xFF, (unsigned)(mac_key >> 8) & 0xFF, (unsigned)mac_key & 0xFF);
+}
+
 /**
  * @brief Check the existence of a client in the database based on MAC address.
  *
@@ -227,24 +219,23 @@ uint8_t new_client(uint8_t checked_database_value)
  * @brief Update client data in the database based on the parking duration.
  *
  * This function calculates the parking duration, updates the database with the calculated
- * time used, and sets the provided 'end' parameter with the current time.
+ * time used, and sets the provided 'end' parameter with the current monotonic time.
  *
- * @param end Pointer to the variable that will be updated with the current time.
+ * @param end Pointer to the variable that will be updated with the current time, see server_clock_ns.
  * @param client_struct Pointer to the client data structure.
  */
-uint8_t update_client_data(uint32_t *end, void *client_data_struct)
+uint8_t update_client_data(uint64_t *end, void *client_data_struct)
 {
     struct pango_data *client = (struct pango_data *)(client_data_struct);
-    struct timeval time;
     char update_clinet_data[100];
     uint8_t return_value = 0;
 
     /*Getting the final time value for the amount the client has to pay*/
-    gettimeofday(&time, NULL);
-    *end = time.tv_sec;
+    *end = server_clock_ns();
 
+    /* The D.B keeps whole seconds.  */
     if (sprintf(update_clinet_data, "UPDATE your_table SET TIME_USED = %d WHERE MAC_ADR = '%s';",
-                (int)(*end - client->time_start_parking), client->mac_address) < 0)
+                (int)((*end - client->start_parking_ns) / SERVER_CLOCK_NS_PER_SECOND), client->mac_address) < 0)
     {
         perror("update_client_data: sprintf");
         return CLOSE_APP_ERROR;
@@ -261,32 +252,100 @@ uint8_t update_client_data(uint32_t *end, void *client_data_struct)
 }
 
 /**
- * @brief Calculate and send payment data to the client.
+ * @brief Calculate the payment amount of a session.
+ *
+ * The part already charged by the repricing thread plus the rest by the time-of-day
+ * tariffs of every version in effect since.
+ * Is called inside a read section of the tariffs, after the client stopped being connected.
+ *
+ * @param client_data_struct Pointer to the client data structure.
+ * @param end End time of parking, see server_clock_ns.
+ * @return The charge in minor units.
+ */
+int64_t calculate_payment(void *client_data_struct, uint64_t end)
+{
+    struct pango_data *client = (struct pango_data *)(client_data_struct);
+
+    /* The tariffs are by the time of day, the only part priced by the wall clock.  */
+    return client->charge + tariff_session_cost(client->tariff_version, client->zone_id,
+                                                server_clock_to_wall(client->priced_from_ns),
+                                                server_clock_to_wall(end));
+}
+
+/**
+ * @brief Send payment data to the client.
  *
- * This function calculates the parking duration and payment amount based on the start and end times
- * and sends the payment data to the client.
+ * Is called outside of the read section of the tariffs, a stalled client
+ * must not keep the repricing thread from retiring a version.
  *
- * @param start_time Start time of parking.
- * @param end_time End time of parking.
- * @param parking_price_per_second Price per second of parking.
- * @param client_fd File descriptor of the client.
+ * @param client_data_struct Pointer to the client data structure.
+ * @param cost The charge calculated by calculate_payment.
+ * @param end End time of parking, see server_clock_ns.
  */
-void calculate_and_send_payment_data(int start_time, int end_time,double parking_price_per_second, uint8_t client_fd)
+void send_payment_data(void *client_data_struct, int64_t cost, uint64_t end)
 {
-    int elapsed_time_seconds = end_time - start_time;
-    double pay[2];
-
-    /* Inserting the data of price and time in to a buff.  */
-    pay[0] = parking_price_per_second * elapsed_time_seconds;
-    pay[1] = elapsed_time_seconds;
-    /*Sending the data to the client*/
-    sleep(1);
-    if (send(client_fd, pay, sizeof(pay), 0) == -1)
+    struct pango_data *client = (struct pango_data *)(client_data_struct);
+    int64_t elapsed_time_seconds = (end - client->start_parking_ns) / SERVER_CLOCK_NS_PER_SECOND;
+
+    /*Sending the data to the client, the v1 units get it in shekels*/
+    if (protocol_send_amount(client->connection, CLOSE_APP, cost, elapsed_time_seconds) != PROTOCOL_OK)
     { // Sending thw payment data
         perror("Error send func,in pay");
     }
 }
 
+/**
+ * @brief Send the cost of the session so far to the client, without ending the session.
+ *
+ * The quote is calculated from the session in memory and the published tariffs,
+ * without the database and without the mutex, so the client can ask for it every few seconds.
+ * The reply has the shape of the payment data, {0, 0} when the session hasn't started.
+ *
+ * @param client_data_struct Pointer to the client data structure.
+ * @return QUIT if there is an error during the send operation, STAY otherwise.
+ */
+uint8_t send_quote_to_client(void *client_data_struct)
+{
+    struct pango_data *client = (struct pango_data *)(client_data_struct);
+    uint64_t now = server_clock_ns();
+    int64_t quote_charge = 0, quote_seconds = 0;
+
+    if (client->connected == TRUE)
+    {
+        uint32_t tariff_version;
+        uint64_t priced_from_ns;
+        int64_t charge;
+        uint8_t seq;
+        /* Entered before the pricing is read, so its version can't be retired meanwhile.  */
+        int token = tariff_read_lock();
+
+        /* Only the repricing thread changes the pricing of a connected session,
+           the copy is retried until it wasn't changed while being read.  */
+        do
+        {
+            seq = __atomic_load_n(&client->pricing_seq, __ATOMIC_ACQUIRE);
+            tariff_version = __atomic_load_n(&client->tariff_version, __ATOMIC_RELAXED);
+            priced_from_ns = __atomic_load_n(&client->priced_from_ns, __ATOMIC_RELAXED);
+            charge = __atomic_load_n(&client->charge, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        } while ((seq & 1) || seq != __atomic_load_n(&client->pricing_seq, __ATOMIC_RELAXED));
+
+        charge += tariff_session_cost(tariff_version, client->zone_id, server_clock_to_wall(priced_from_ns),
+                                      server_clock_to_wall(now));
+        tariff_read_unlock(token);
+
+        quote_charge = charge;
+        quote_seconds = (now - client->start_parking_ns) / SERVER_CLOCK_NS_PER_SECOND;
+    }
+
+    if (protocol_send_amount(client->connection, QUOTE_APP, quote_charge, quote_seconds) != PROTOCOL_OK)
+    {
+        perror("send_quote_to_client: protocol_send_amount");
+        return QUIT;
+    }
+    return STAY;
+}
+
 /**
  * @brief Remove client data from the database based on MAC address.
  *
@@ -315,4 +374,124 @@ void remove_client_data(uint8_t *mac_address_arg, uint8_t mac_address_size)
     {
         perror("remove_client_data: sqlite3_exec in status");
     }
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Set the client slots that connections and gateway sessions are given.
+ *
+ * @param clients The slots, shared with the database update and repricing threads.
+ * @param count Number of slots.
+ */
+void session_table_init(struct pango_data *clients, size_t count)
+{
+    session_slots = clients;
+    session_slot_count = count;
+}
+
+/**
+ * @brief Take a free client slot for a connection or a gateway session.
+ *
+ * The slot is cleared and keeps the socket of the connection.
+ *
+ * @param fd The socket of the connection.
+ * @return The slot, or NULL if all of them are taken.
+ */
+struct pango_data *session_acquire(int fd)
+{
+    struct pango_data *client = NULL;
+
+    /* The database update and repricing threads walk the slots under the mutex.  */
+    pthread_mutex_lock(&mutex);
+    for (size_t i = 0; i < session_slot_count; ++i)
+    {
+        if (session_slots[i].in_use == FALSE)
+        {
+            client = &session_slots[i];
+            memset(client, 0, sizeof(*client));
+            client->client_fd = fd;
+            client->in_use = TRUE;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+    return client;
+}
+
+/**
+ * @brief Give a slot back once the connection thread is done with it.
+ *
+ * @param client The slot, see session_acquire.
+ */
+void session_release(struct pango_data *client)
+{
+    pthread_mutex_lock(&mutex);
+    client->connected = FALSE;
+    client->connection = NULL;
+    client->in_use = FALSE;
+    pthread_mutex_unlock(&mutex);
+}
+
+/**
+ * @brief Find the session a connection is counting the time of for a unit.
+ *
+ * Is called with the mutex locked.
+ *
+ * @param mac_key The MAC address of the unit, see protocol_event_mac_key.
+ * @return The slot of the session, NULL if no connection has the unit connected.
+ */
+struct pango_data *session_connected(uint64_t mac_key)
+{
+    for (size_t i = 0; i < session_slot_count; ++i)
+    {
+        if (session_slots[i].in_use == TRUE && session_slots[i].connected == TRUE &&
+            session_slots[i].mac_key == mac_key)
+        {
+            return &session_slots[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Set the TCP keepalive and user timeout of a client socket.
+ *
+ * @param fd The socket of the connection.
+ * @return TRUE on success, FALSE if one of the options can't be set.
+ */
+uint8_t tune_client_socket(int fd)
+{
+    int on = 1, idle = CLIENT_KEEPALIVE_IDLE_SECONDS, interval = CLIENT_KEEPALIVE_INTERVAL_SECONDS,
+        probes = CLIENT_KEEPALIVE_PROBES;
+    unsigned int user_timeout = CLIENT_USER_TIMEOUT_MS;
+
+    if (setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on)) == -1 ||
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle)) == -1 ||
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval)) == -1 ||
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &probes, sizeof(probes)) == -1 ||
+        setsockopt(fd, IPPROTO_TCP, TCP_USER_TIMEOUT, &user_timeout, sizeof(user_timeout)) == -1)
+    {
+        perror("tune_client_socket: setsockopt");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Count sessions reclaimed from connections that went silent.
+ *
+ * @param count Number of sessions of the connection.
+ */
+void session_reclaimed(size_t count)
+{
+    size_t total = __atomic_add_fetch(&reclaimed_sessions, count, __ATOMIC_RELAXED);
+
+    printf("Reclaimed %zu sessions of a silent connection, %zu so far\n", count, total);
+}
+
+/**
+ * @brief Number of sessions reclaimed from connections that went silent so far.
+ */
+size_t session_reclaimed_count(void)
+{
+    return __atomic_load_n(&reclaimed_sessions, __ATOMIC_RELAXED);
+}
@@ -31,7 +31,7 @@ uint8_t retriev_client_data(void *client_data_struct, sqlite3_stmt **stmt, uint8
     (
         retrieve_time_start_parking_value_from_database(client_data_struct, *stmt) == QUIT ||
         update_client_and_continue_time(client_data_struct, *stmt) == QUIT ||
-        retrieve_parking_price_per_city_from_database(client_data_struct, *stmt) == QUIT
+        retrieve_parking_price_per_zone(client_data_struct) == QUIT
     )
     {
         *status = ERROR_STATUS_IN_CLIENT_EXIST_SUBFUNCTIONS;
@@ -87,8 +87,9 @@ uint8_t retrieve_time_start_parking_value_from_database(void *client_struct, sql
         return_value = sqlite3_step(stmt);
         if (return_value == SQLITE_ROW)
         {
-            client->time_start_parking = sqlite3_column_int(stmt, 0);
-            printf("client->time_start_parking = %d\n", client->time_start_parking);
+            /* The time used so far, until update_client_and_continue_time turns it into the start.  */
+            client->start_parking_ns = (uint64_t)sqlite3_column_int(stmt, 0) * SERVER_CLOCK_NS_PER_SECOND;
+            printf("time used so far = %d\n", sqlite3_column_int(stmt, 0));
         }
     }
     sqlite3_finalize(stmt);
@@ -98,8 +99,8 @@ uint8_t retrieve_time_start_parking_value_from_database(void *client_struct, sql
 /**
  * @brief Update client information and continue counting time.
  *
- * This function updates the time, running status, and location for a client.
- * It retrieves the client's location from the 'your_table' table in the client database
+ * This function updates the time, running status, and zone id for a client.
+ * It retrieves the client's zone id from the 'your_table' table in the client database
  * and updates the client structure accordingly.
  *
  * @param client_struct Pointer to the structure containing client data.
@@ -111,28 +112,26 @@ uint8_t update_client_and_continue_time(void *client_struct, sqlite3_stmt *stmt_
 {
     struct pango_data *client = (struct pango_data *)(client_struct);
     sqlite3_stmt *stmt = (sqlite3_stmt *)(stmt_arg);
-    struct timeval time;
     
-    char location_data[150];
+    char zone_data[MAX_BUFF_SIZE];
     uint8_t return_value = 0;
 
     /* Continue counting the time from the last time value stored in the data base.  */
-    gettimeofday(&time, NULL);
-    client->time_start_parking = time.tv_sec - client->time_start_parking;
+    client->start_parking_ns = server_clock_ns() - client->start_parking_ns;
 
     /* Updating the thread that the clinet resumes the app usage.  */
     client->connected = TRUE;
 
-    /* Retrieving the location stored in the client database,
-       so it can extract the price by the location name.  */
-    if (sprintf(location_data, "SELECT LOCATION FROM your_table WHERE MAC_ADR = '%s';",
+    /* Retrieving the zone id stored in the client database,
+       so it can extract the price by the zone id.  */
+    if (sprintf(zone_data, "SELECT ZONE_ID FROM your_table WHERE MAC_ADR = '%s';",
                 client->mac_address) < 0)
     {
         perror("update_client_and_continue_time: sprintf");
         return QUIT;
     }
 
-    return_value = sqlite3_prepare_v2(db_client, location_data, -1, &stmt, 0);
+    return_value = sqlite3_prepare_v2(db_client, zone_data, -1, &stmt, 0);
     if (return_value != SQLITE_OK)
     {
         perror("update_client_and_continue_time: sqlite3_prepare_v2");
@@ -143,9 +142,8 @@ uint8_t update_client_and_continue_time(void *client_struct, sqlite3_stmt *stmt_
         return_value = sqlite3_step(stmt);
         if (return_value == SQLITE_ROW)
         {
-            const unsigned char *location = sqlite3_column_text(stmt, 0);
-            strcpy(client->location, (const char *)location);
-            printf("Retrieved location: %s\n", client->location);
+            client->zone_id = (uint16_t)sqlite3_column_int(stmt, 0);
+            printf("Retrieved location: %s\n", zone_name(client->zone_id));
         }
     }
 
@@ -43,20 +43,26 @@ enum loop_status
 
 #ifndef STRUCT_PANGO_DATA
 #define STRUCT_PANGO_DATA
-#pragma pack(push,1)
 struct pango_data
 {
 	uint8_t status; /*A flag that indicates if the application has started or ended*/
 	char mac_address[MAC_ADDRESS_SIZE];
+	uint64_t mac_key; /*The MAC address as a number, mac_address is formatted only when it changes*/
 	uint8_t x_axis;
 	uint8_t y_axis;
 	uint8_t client_fd;
-	char location[12]; /*Where the clients location name will be stored*/
+	struct protocol_connection *connection; /*Framing of the connection, see protocol.h*/
+	uint16_t zone_id; /*Interned id of the zone (city) the client parked in*/
 	double price;
-	int time_start_parking;	  /*The time the client started to use the application*/
+	uint64_t start_parking_ns; /*Monotonic time the client started to use the application, see server_clock.h*/
 	volatile uint8_t running; /*Indecates if the client is currently connecnted to the server and counting time*/
+	uint32_t tariff_version; /*Version of the tariffs the session is priced under*/
+	uint64_t priced_from_ns; /*Monotonic start of the part of the session that is not in the charge yet*/
+	int64_t charge;			 /*Charge, in minor units, of the session before priced_from_ns*/
+	volatile uint8_t pricing_seq; /*Odd while the repricing thread changes the three fields above, which are accessed with __atomic builtins*/
+	volatile uint8_t in_use; /*The slot belongs to a connection thread, see session_acquire*/
+	volatile uint64_t last_seen_ns; /*Coarse monotonic time of the last event or datagram of the unit, stored with __atomic_store_n*/
 };
-#pragma pack(pop)
 #endif /*STRUCT_PANGO_DATA*/
 
 extern sqlite3 *db_client;
@@ -94,8 +100,8 @@ uint8_t retrieve_time_start_parking_value_from_database(void *client_struct, sql
 /**
  * @brief Update client information and continue counting time.
  *
- * This function updates the time, running status, and location for a client.
- * It retrieves the client's location from the 'your_table' table in the client database
+ * This function updates the time, running status, and zone id for a client.
+ * It retrieves the client's zone id from the 'your_table' table in the client database
  * and updates the client structure accordingly.
  *
  * @param client_struct Pointer to the structure containing client data.
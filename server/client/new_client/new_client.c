@@ -14,6 +14,7 @@
  * - Initializes and retrieves the start time for the client.
  * - Acquires a mutex to protect shared resources.
  * - Executes database operations, including retrieving parking prices and inserting client data.
+ * - Marks the client as connected, so its time is counted.
  * - Sends the client's location.
  *
  * If any critical error occurs during database operations, the function sets the status
@@ -32,7 +33,7 @@ uint8_t process_client_data(void *client_data_struct, sqlite3_stmt **stmt, uint8
     pthread_mutex_lock(&mutex);
     if
     (
-        retrieve_parking_price_per_city_from_database(client_data_struct, *stmt) == QUIT ||
+        retrieve_parking_price_per_zone(client_data_struct) == QUIT ||
         insert_client_data_into_database(client_data_struct) == QUIT
     )
     {
@@ -43,6 +44,9 @@ uint8_t process_client_data(void *client_data_struct, sqlite3_stmt **stmt, uint8
     }
     else
     {
+        /* Setting the clients running value of the thread with ON.
+           which flags the data base to update the clients data.  */
+        ((struct pango_data *)client_data_struct)->connected = TRUE;
         pthread_mutex_unlock(&mutex);
         /* Sending the city name of the client to the client.  */
         send_client_location(client_data_struct);
@@ -53,64 +57,56 @@ uint8_t process_client_data(void *client_data_struct, sqlite3_stmt **stmt, uint8
 /**
  * @brief Initialize and get the start time for the client.
  *
- * This function initializes the start time for the client using the current system time
- * and retrieves the client's location using the location_func.
+ * This function initializes the start time for the client using the monotonic clock
+ * and determines the client's zone id from its coordinates.
  *
  * @param client_data_struct Pointer to the structure containing client data.
  */
 void initialize_and_get_start_time(void *client_data_struct)
 {
     struct pango_data *client = (struct pango_data *)(client_data_struct);
-    struct timeval time;
 
     /*Initializing and geting the value of the time the client started using the app */
-    gettimeofday(&time, NULL);
-    client->time_start_parking = time.tv_sec;
+    client->start_parking_ns = server_clock_ns();
 
-    /*Returns the location*/
-    location_func(client->x_axis, client->y_axis, client->location);
+    /*Returns the zone id*/
+    client->zone_id = zone_id_from_coordinates(client->x_axis, client->y_axis);
 }
 
 /**
- * @brief Retrieve the price from the database based on the client's location.
+ * @brief Retrieve the price based on the client's zone.
  *
- * This function constructs and executes an SQL statement to retrieve the price
- * associated with the specified city from the 'city_parking' table in the database.
- * The retrieved price is then stored in the client structure.
+ * This function looks up the price associated with the client's zone id
+ * in the current tariff book, which is loaded from the price database.
+ * The retrieved price and the tariff version are stored in the client structure,
+ * so the session is charged by the tariffs it started under.
+ * Is called with the mutex locked, in the same section that sets 'connected',
+ * so the repricing thread sees every session of an old version.
  *
  * @param client_data_struct Pointer to the structure containing client data.
- * @param stmt_arg Pointer to the SQLite statement structure.
- * @return QUIT if there is an error, STAY otherwise.
+ * @return QUIT if the zone id is unknown, STAY otherwise.
  */
-uint8_t retrieve_parking_price_per_city_from_database(void *client_data_struct, sqlite3_stmt *stmt_arg)
+uint8_t retrieve_parking_price_per_zone(void *client_data_struct)
 {
     struct pango_data *client = (struct pango_data *)(client_data_struct);
-    sqlite3_stmt *stmt = (sqlite3_stmt *)(stmt_arg);
-   
-    char price_data[150];
-    int return_value = 0;
-    if (sprintf(price_data, "SELECT * FROM city_parking WHERE CITY = '%s';",
-                client->location) < 0)
-    {
-        perror("retrieve_price_from_database: sprintf");
-       return QUIT;
-    }
-    return_value = sqlite3_prepare_v2(db_prices, price_data, -1, &stmt, 0);
-    if (return_value != SQLITE_OK)
+    const struct tariff_book *book;
+    int token;
+
+    if (client->zone_id >= ZONE_COUNT)
     {
-        perror("retrieve_price_from_database: sqlite3_prepare_v2");
+        printf("retrieve_parking_price_per_zone: unknown zone id %u\n", client->zone_id);
         return QUIT;
     }
-    else
-    {
-        return_value = sqlite3_step(stmt);
-        if (return_value == SQLITE_ROW)
-        {
-            client->price = sqlite3_column_double(stmt, 1);
-            printf("Retrieved value: %.3f\n", client->price);
-        }
-    }
-    sqlite3_finalize(stmt);
+    token = tariff_read_lock();
+    book = tariff_current();
+    client->price = book->price[client->zone_id];
+    client->tariff_version = book->version;
+    tariff_read_unlock(token);
+
+    /* Nothing is charged yet, the whole session is priced by this version.  */
+    client->priced_from_ns = client->start_parking_ns;
+    client->charge = 0;
+    printf("Retrieved value: %.3f (tariff version %u)\n", client->price, client->tariff_version);
     return STAY;
 }
 
@@ -125,12 +121,13 @@ uint8_t retrieve_parking_price_per_city_from_database(void *client_data_struct,
 uint8_t insert_client_data_into_database(void *client_data_struct)
 {
     struct pango_data *client = (struct pango_data *)(client_data_struct);
-    char insert_query[150];
+    char insert_query[200];
     int val = 0;
 
     /*Inserting the received data from the client in to the client data base*/
-    if (sprintf(insert_query, "INSERT INTO your_table (MAC_ADR , TIME_USED , LOCATION ) VALUES ('%s', %d,'%s');",
-                client->mac_address, 0, client->location) < 0)
+    if (sprintf(insert_query, "INSERT INTO your_table (MAC_ADR , TIME_USED , ZONE_ID , START_TIME ) VALUES ('%s', %d, %u, %lld);",
+                client->mac_address, 0, client->zone_id,
+                (long long)server_clock_to_wall(client->start_parking_ns)) < 0)
     {
         perror("insert_client_data_into_database: sprintf");
         return QUIT;
@@ -147,53 +144,29 @@ uint8_t insert_client_data_into_database(void *client_data_struct)
 /**
  * @brief Send the client's current location to the client.
  *
- * This function sends the name of the city the client is currently at to the client using the send function.
+ * This function translates the client's zone id to the name of the city the client is currently at
+ * and sends it to the client using the send function.
  *
  * @param client_data_struct Pointer to the structure containing client data.
- * @return QUIT if there is an error during the send operation, otherwise, returns void.
+ * @return QUIT if there is an error during the send operation, STAY otherwise.
  */
 uint8_t send_client_location(void *client_data_struct)
 {
     struct pango_data *client = (struct pango_data *)(client_data_struct);
-   
-    /* Send the name of the city the client curently at.  */
-    if (send(client->client_fd, client->location, sizeof(client->location), 0) == -1)
-    {
-        perror("Error send_client_location: send");
-        return QUIT;
-    }
-}
+    uint8_t udp_key[PROTOCOL_UDP_KEY_SIZE];
+    const uint8_t *key = NULL;
 
-/**
- * @brief Determine location based on coordinates.
- *
- * This function determines the location based on the given x and y coordinates.
- * If the coordinates are out of range, an error message is stored in the provided buffer.
- *
- * @param x X-coordinate (0-127).
- * @param y Y-coordinate (0-127).
- * @param buff Buffer to store the location or error message.
- */
-void location_func(uint8_t x, uint8_t y, char *buff)
-{
-    if (x < 0 || x > 127 || y < 0 || y > 127)
-    {
-        sprintf(buff, "%s", "ERROR"); // If a vlue is an error
-    }
-    else if (x <= 70 && y <= 70)
-    {
-        sprintf(buff, "%s", "Ashkelon");
-    }
-    else if (x <= 70 && y > 70)
+    /* A unit that asked for it is sent a new key for its UDP datagrams, see udp_ingest.h.  */
+    if (client->connection->udp_key == TRUE && udp_unit_open(client, udp_key) == TRUE)
     {
-        sprintf(buff, "%s", "Jerusalem");
+        key = udp_key;
     }
-    else if (x > 70 && y <= 70)
-    {
-        sprintf(buff, "%s", "Petah-Tikva");
-    }
-    else if (x > 70 && y > 70)
+
+    /* Send the name of the city the client curently at.  */
+    if (protocol_send_location(client->connection, client->zone_id, zone_name(client->zone_id), key) != PROTOCOL_OK)
     {
-        sprintf(buff, "%s", "Herzliya");
+        perror("Error send_client_location: protocol_send_location");
+        return QUIT;
     }
-}
\ No newline at end of file
+    return STAY;
+}
@@ -14,6 +14,11 @@
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include "../../zone/zone_index.h"
+#include "../../tariff/tariff_rcu.h"
+#include "../../protocol/protocol.h"
+#include "../../udp/udp_ingest.h"
+#include "../../clock/server_clock.h"
 
 #ifndef LOOP_STATUS
 #define LOOP_STATUS
@@ -50,20 +55,26 @@ enum statement_status
 
 #ifndef STRUCT_PANGO_DATA
 #define STRUCT_PANGO_DATA
-#pragma pack(push,1)
 struct pango_data
 {
 	uint8_t status; /*A flag that indicates if the application has started or ended*/
 	char mac_address[MAC_ADDRESS_SIZE];
+	uint64_t mac_key; /*The MAC address as a number, mac_address is formatted only when it changes*/
 	uint8_t x_axis;
 	uint8_t y_axis;
 	uint8_t client_fd;
-	char location[12]; /*Where the clients location name will be stored*/
+	struct protocol_connection *connection; /*Framing of the connection, see protocol.h*/
+	uint16_t zone_id; /*Interned id of the zone (city) the client parked in*/
 	double price;
-	int time_start_parking;	  /*The time the client started to use the application*/
+	uint64_t start_parking_ns; /*Monotonic time the client started to use the application, see server_clock.h*/
 	volatile uint8_t connected; /*Indecates if the client is currently connecnted to the server and counting time*/
+	uint32_t tariff_version; /*Version of the tariffs the session is priced under*/
+	uint64_t priced_from_ns; /*Monotonic start of the part of the session that is not in the charge yet*/
+	int64_t charge;			 /*Charge, in minor units, of the session before priced_from_ns*/
+	volatile uint8_t pricing_seq; /*Odd while the repricing thread changes the three fields above, which are accessed with __atomic builtins*/
+	volatile uint8_t in_use; /*The slot belongs to a connection thread, see session_acquire*/
+	volatile uint64_t last_seen_ns; /*Coarse monotonic time of the last event or datagram of the unit, stored with __atomic_store_n*/
 };
-#pragma pack(pop)
 #endif /*STRUCT_PANGO_DATA*/
 
 extern sqlite3 *db_client;
@@ -78,6 +89,7 @@ extern pthread_mutex_t mutex;
  * - Initializes and retrieves the start time for the client.
  * - Acquires a mutex to protect shared resources.
  * - Executes database operations, including retrieving parking prices and inserting client data.
+ * - Marks the client as connected, so its time is counted.
  * - Sends the client's location.
  *
  * If any critical error occurs during database operations, the function sets the status
@@ -94,24 +106,26 @@ uint8_t process_client_data(void *client_data_struct, sqlite3_stmt **stmt, uint8
  * @brief Initialize and get the start time for the client.
  *
  * This function initializes the start time for the client using the current system time
- * and retrieves the client's location using the location_func.
+ * and determines the client's zone id from its coordinates.
  *
  * @param client_data_struct Pointer to the structure containing client data.
  */
 void initialize_and_get_start_time(void *client_data_struct);
 
 /**
- * @brief Retrieve the price from the database based on the client's location.
+ * @brief Retrieve the price based on the client's zone.
  *
- * This function constructs and executes an SQL statement to retrieve the price
- * associated with the specified city from the 'city_parking' table in the database.
- * The retrieved price is then stored in the client structure.
+ * This function looks up the price associated with the client's zone id
+ * in the current tariff book, which is loaded from the price database.
+ * The retrieved price and the tariff version are stored in the client structure,
+ * so the session is charged by the tariffs it started under.
+ * Is called with the mutex locked, in the same section that sets 'connected',
+ * so the repricing thread sees every session of an old version.
  *
  * @param client_data_struct Pointer to the structure containing client data.
- * @param stmt_arg Pointer to the SQLite statement structure.
- * @return QUIT if there is an error, STAY otherwise.
+ * @return QUIT if the zone id is unknown, STAY otherwise.
  */
-uint8_t retrieve_parking_price_per_city_from_database(void *client_data_struct, sqlite3_stmt *stmt_arg);
+uint8_t retrieve_parking_price_per_zone(void *client_data_struct);
 
 /**
  * @brief Insert client data into the database.
@@ -126,23 +140,12 @@ uint8_t insert_client_data_into_database(void *client_data_struct);
 /**
  * @brief Send the client's current location to the client.
  *
- * This function sends the name of the city the client is currently at to the client using the send function.
+ * This function translates the client's zone id to the name of the city the client is currently at
+ * and sends it to the client using the send function.
  *
  * @param client_data_struct Pointer to the structure containing client data.
- * @return QUIT if there is an error during the send operation, otherwise, returns void.
+ * @return QUIT if there is an error during the send operation, STAY otherwise.
  */
 uint8_t send_client_location(void *client_data_struct);
 
-/**
- * @brief Determine location based on coordinates.
- *
- * This function determines the location based on the given x and y coordinates.
- * If the coordinates are out of range, an error message is stored in the provided buffer.
- *
- * @param x X-coordinate (0-127).
- * @param y Y-coordinate (0-127).
- * @param buff Buffer to store the location or error message.
- */
-void location_func(uint8_t x, uint8_t y, char *buff);
-
 #endif /*NEW_CLIENT_H*/
\ No newline at end of file
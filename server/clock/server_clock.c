@@ -0,0 +1,104 @@
+/**
+ * @file    server_clock.c
+ * @author  Vlad Kulikov
+ * @date    2026-10-19
+ * @brief   Implementation of the time source of the server.
+ */
+#include "server_clock.h"
+
+/* Added to CLOCK_MONOTONIC, which starts at boot: a session taken over from the D.B
+   may have started long before, its start must still be a positive time.  */
+#define SERVER_CLOCK_BIAS_NS (100ULL * 365 * 24 * 60 * 60 * SERVER_CLOCK_NS_PER_SECOND)
+
+/* The wall clock minus the monotonic one, when the server started.  */
+static int64_t server_clock_wall_offset_ns;
+/* Written by the thread that drives server_timers, read by every thread.  */
+static uint64_t server_clock_coarse;
+
+/**
+ * @brief Read the wall clock against the monotonic one, and set the coarse time.
+ *
+ * @return 0 on success, -1 on error.
+ */
+int server_clock_init(void)
+{
+    struct timespec wall;
+    uint64_t monotonic_ns = server_clock_ns();
+
+    if (clock_gettime(CLOCK_REALTIME, &wall) == -1)
+    {
+        perror("server_clock_init: clock_gettime");
+        return -1;
+    }
+    server_clock_wall_offset_ns = (int64_t)wall.tv_sec * (int64_t)SERVER_CLOCK_NS_PER_SECOND + wall.tv_nsec -
+                                  (int64_t)monotonic_ns;
+    __atomic_store_n(&server_clock_coarse, monotonic_ns, __ATOMIC_RELAXED);
+    return 0;
+}
+
+/**
+ * @brief Get the monotonic time, for billing.
+ *
+ * @return Nanoseconds since an arbitrary point.
+ */
+uint64_t server_clock_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * SERVER_CLOCK_NS_PER_SECOND + (uint64_t)now.tv_nsec + SERVER_CLOCK_BIAS_NS;
+}
+
+/**
+ * @brief Get the coarse monotonic time, for the hot paths.
+ *
+ * @return Nanoseconds since the same point as server_clock_ns, up to SERVER_CLOCK_COARSE_PERIOD_MS late.
+ */
+uint64_t server_clock_coarse_ns(void)
+{
+    return __atomic_load_n(&server_clock_coarse, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Set the coarse time to the monotonic time now.
+ */
+void server_clock_coarse_update(void)
+{
+    __atomic_store_n(&server_clock_coarse, server_clock_ns(), __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Timer callback that refreshes the coarse time and adds its timer again.
+ *
+ * @param entry The timer of the coarse time.
+ * @param arg Not used.
+ */
+void server_clock_tick(struct timer_entry *entry, void *arg)
+{
+    server_clock_coarse_update();
+    timer_wheel_add(&server_timers, entry, SERVER_CLOCK_COARSE_PERIOD_MS);
+}
+
+/**
+ * @brief Convert a monotonic time to the wall clock.
+ *
+ * @param monotonic_ns Nanoseconds of server_clock_ns.
+ * @return Unix time in seconds.
+ */
+int64_t server_clock_to_wall(uint64_t monotonic_ns)
+{
+    return ((int64_t)monotonic_ns + server_clock_wall_offset_ns) / (int64_t)SERVER_CLOCK_NS_PER_SECOND;
+}
+
+/**
+ * @brief Convert a wall clock time to the monotonic time.
+ *
+ * @param wall_seconds Unix time in seconds.
+ * @return Nanoseconds of server_clock_ns, 0 for a time a century before the server started.
+ */
+uint64_t server_clock_from_wall(int64_t wall_seconds)
+{
+    int64_t monotonic_ns = wall_seconds * (int64_t)SERVER_CLOCK_NS_PER_SECOND - server_clock_wall_offset_ns;
+
+    return (monotonic_ns > 0) ? (uint64_t)monotonic_ns : 0;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file 	server_clock.h
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-19
+ * @brief 	Header file containing declarations for the time source of the server.
+ *
+ * The sessions are timed by 64 bit nanoseconds of CLOCK_MONOTONIC, so a step
+ * of the wall clock (NTP, a changed time zone, a manual set) can't make a
+ * session longer, shorter or negative. The wall clock is read once, when the
+ * server starts, and the monotonic time is converted to it only where the
+ * wall time is needed: the D.B, and the time-of-day tariffs.
+ *
+ * The paths that only need to know about when something happened (the last
+ * event of a unit, the last receive of a connection) read a coarse copy of the
+ * monotonic time instead, refreshed every SERVER_CLOCK_COARSE_PERIOD_MS by a
+ * timer of server_timers.
+ */
+#ifndef SERVER_CLOCK_H
+#define SERVER_CLOCK_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "../timer/timer_wheel.h"
+
+#define SERVER_CLOCK_NS_PER_SECOND 1000000000ULL
+#define SERVER_CLOCK_NS_PER_MS 1000000ULL
+/* The coarse time is this late at most, plus the lateness of the timers.  */
+#define SERVER_CLOCK_COARSE_PERIOD_MS TIMER_WHEEL_TICK_MS
+
+/**
+ * @brief Read the wall clock against the monotonic one, and set the coarse time.
+ *
+ * @return 0 on success, -1 on error.
+ */
+int server_clock_init(void);
+
+/**
+ * @brief Get the monotonic time, for billing.
+ *
+ * @return Nanoseconds since an arbitrary point.
+ */
+uint64_t server_clock_ns(void);
+
+/**
+ * @brief Get the coarse monotonic time, for the hot paths.
+ *
+ * @return Nanoseconds since the same point as server_clock_ns, up to SERVER_CLOCK_COARSE_PERIOD_MS late.
+ */
+uint64_t server_clock_coarse_ns(void);
+
+/**
+ * @brief Set the coarse time to the monotonic time now.
+ */
+void server_clock_coarse_update(void);
+
+/**
+ * @brief Timer callback that refreshes the coarse time and adds its timer again.
+ *
+ * @param entry The timer of the coarse time.
+ * @param arg Not used.
+ */
+void server_clock_tick(struct timer_entry *entry, void *arg);
+
+/**
+ * @brief Convert a monotonic time to the wall clock.
+ *
+ * @param monotonic_ns Nanoseconds of server_clock_ns.
+ * @return Unix time in seconds.
+ */
+int64_t server_clock_to_wall(uint64_t monotonic_ns);
+
+/**
+ * @brief Convert a wall clock time to the monotonic time.
+ *
+ * @param wall_seconds Unix time in seconds.
+ * @return Nanoseconds of server_clock_ns, 0 for a time a century before the server started.
+ */
+uint64_t server_clock_from_wall(int64_t wall_seconds);
+
+#endif /*SERVER_CLOCK_H*/
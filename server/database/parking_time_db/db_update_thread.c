@@ -3,38 +3,39 @@
 /**
  * @brief Update the database with client information.
  *
- * This function runs as a thread, periodically updating the database with client information.
+ * This function runs as a thread, updating the database with client information
+ * every NUMBER_OF_SECONDS_BETWEEN_BACKUPS seconds. It drives the timer wheel of the
+ * server: it sleeps until the next timer expires, and runs the timers of the
+ * connections and the sessions too, and the tick of the coarse clock.
  *
  * @param arg A pointer to the pango_data structure.
  * @return None.
  */
 void *db_update(void *address_buffer_of_clinets_data_structs)
 {
-	struct pango_data *client = (struct pango_data *)address_buffer_of_clinets_data_structs;
-	struct timeval time;
+	struct timer_entry flush_timer, clock_timer;
 	uint8_t is_backup_time = 0, quit_loop_flag = 0;
-	int database_backup_start_time = 0; 
 	/*flag is responsibale to quit the while loop. It happens when the server is quiting*/	  
-	
-	set_start_time(&database_backup_start_time);
 
-	/* Is used in case of start_db_bkup and current_db_backup having the same time value.
-	It differentiate the two since current_db_backup gets it value 1 second later.  */
-	sleep(1); 
+	timer_entry_init(&flush_timer, db_flush_tick, address_buffer_of_clinets_data_structs);
+	timer_wheel_add(&server_timers, &flush_timer, NUMBER_OF_SECONDS_BETWEEN_BACKUPS * 1000);
+	/* The tick of the coarse clock the hot paths read, see server_clock.h.  */
+	timer_entry_init(&clock_timer, server_clock_tick, NULL);
+	timer_wheel_add(&server_timers, &clock_timer, SERVER_CLOCK_COARSE_PERIOD_MS);
 
-	while (quit_loop_flag != TRUE)
+	/* The main thread wakes the wheel after it sets 'return_thread'.  */
+	while (return_thread != TRUE)
 	{
-		pthread_mutex_lock(&mutex);
+		timer_wheel_run(&server_timers);
+	}
+	timer_wheel_cancel(&server_timers, &flush_timer);
+	timer_wheel_cancel(&server_timers, &clock_timer);
 
-		/* Checks if the difference in time between start_db_bkup and current_db_backup is 5 seconds.  */
-		time_to_backup(database_backup_start_time, &is_backup_time);
-		/* Exits the update database thread, if there was a flag to quit ,from the main thread.  */
-		return_database_update_thread(return_thread, address_buffer_of_clinets_data_structs, &is_backup_time, &quit_loop_flag);
-		/* Update clients' data in the database.  */
-		update_clients(address_buffer_of_clinets_data_structs, is_backup_time);
+	pthread_mutex_lock(&mutex);
+	/* Updates the clients' data one last time before the thread exits.  */
+	return_database_update_thread(return_thread, address_buffer_of_clinets_data_structs, &is_backup_time, &quit_loop_flag);
+	pthread_mutex_unlock(&mutex);
 
-		pthread_mutex_unlock(&mutex);
-	}
 	printf("Out of update db thread\n");
 	pthread_exit(NULL);
 }
\ No newline at end of file
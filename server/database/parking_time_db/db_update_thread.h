@@ -16,6 +16,8 @@
 #include <sys/time.h>
 #include <sqlite3.h>
 #include <unistd.h>
+#include "../../timer/timer_wheel.h"
+#include "../../clock/server_clock.h"
 
 #ifndef COMMON_DEFINES
 #define COMMON_DEFINES
@@ -34,20 +36,26 @@
 
 #ifndef STRUCT_PANGO_DATA
 #define STRUCT_PANGO_DATA
-#pragma pack(push, 1)
 struct pango_data
 {
 	uint8_t status; /*A flag that indicates if the application has started or ended*/
 	char mac_address[MAC_ADDRESS_SIZE];
+	uint64_t mac_key; /*The MAC address as a number, mac_address is formatted only when it changes*/
 	uint8_t x_axis;
 	uint8_t y_axis;
 	uint8_t client_fd;
-	char location[12]; /*Where the clients location name will be stored*/
+	struct protocol_connection *connection; /*Framing of the connection, see protocol.h*/
+	uint16_t zone_id; /*Interned id of the zone (city) the client parked in*/
 	double price;
-	int time_start_parking;		/*The time the client started to use the application*/
+	uint64_t start_parking_ns; /*Monotonic time the client started to use the application, see server_clock.h*/
 	volatile uint8_t connected; /*Indecates if the client is currently connecnted to the server and counting time*/
+	uint32_t tariff_version; /*Version of the tariffs the session is priced under*/
+	uint64_t priced_from_ns; /*Monotonic start of the part of the session that is not in the charge yet*/
+	int64_t charge;			 /*Charge, in minor units, of the session before priced_from_ns*/
+	volatile uint8_t pricing_seq; /*Odd while the repricing thread changes the three fields above, which are accessed with __atomic builtins*/
+	volatile uint8_t in_use; /*The slot belongs to a connection thread, see session_acquire*/
+	volatile uint64_t last_seen_ns; /*Coarse monotonic time of the last event or datagram of the unit, stored with __atomic_store_n*/
 };
-#pragma pack(pop)
 #endif /*STRUCT_PANGO_DATA*/
 
 /* In case you want to change the number of clients, 
@@ -72,23 +80,15 @@ extern volatile uint8_t return_thread;
 extern int flag;
 
 /**
- * @brief Set the start time for database backup.
+ * @brief Timer callback of the periodic backup of the clients' data.
  *
- * Initializes the time when the backup of the database starts.
+ * Updates the clients' data in the database and adds its timer again,
+ * NUMBER_OF_SECONDS_BETWEEN_BACKUPS later.
  *
- * @param start_database_backup Pointer to the variable that will store the start time.
- */
-void set_start_time(int *start_database_backup);
-
-/**
- * @brief Check if it is time to backup the database.
- *
- * Checks if it is time to backup the database based on the predefined interval.
- *
- * @param database_backup_start_time Start time of the database backup.
- * @param back_up_flag Pointer to the flag indicating if it is time to backup.
+ * @param entry The timer of the backup.
+ * @param address_buffer_of_clients_data_structs Pointer to the buffer containing clients' data structures.
  */
-void time_to_backup(int database_backup_start_time, uint8_t *back_up_flag);
+void db_flush_tick(struct timer_entry *entry, void *address_buffer_of_clinets_data_structs);
 
 /**
  * @brief Update clients' data in the database.
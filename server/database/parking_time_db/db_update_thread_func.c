@@ -7,44 +7,22 @@
 #include "db_update_thread.h"
 
 /**
- * @brief Set the start time for database backup.
+ * @brief Timer callback of the periodic backup of the clients' data.
  *
- * Initializes the time when the backup of the database starts.
+ * Updates the clients' data in the database and adds its timer again,
+ * NUMBER_OF_SECONDS_BETWEEN_BACKUPS later.
  *
- * @param start_database_backup Pointer to the variable that will store the start time.
- */
-void set_start_time(int *start_database_backup)
-{
-    struct timeval time;
-    /*Initializes the time the backup started*/
-    gettimeofday(&time, NULL);
-    *start_database_backup = time.tv_sec;
-}
-
-
-/**
- * @brief Check if it is time to backup the database.
- *
- * Checks if it is time to backup the database based on the predefined interval.
- *
- * @param database_backup_start_time Start time of the database backup.
- * @param back_up_flag Pointer to the flag indicating if it is time to backup.
+ * @param entry The timer of the backup.
+ * @param address_buffer_of_clients_data_structs Pointer to the buffer containing clients' data structures.
  */
-void time_to_backup(int database_backup_start_time, uint8_t *back_up_flag)
+void db_flush_tick(struct timer_entry *entry, void *address_buffer_of_clinets_data_structs)
 {
-    struct timeval time;
-    int current_time = 0;
+    pthread_mutex_lock(&mutex);
+    update_clients(address_buffer_of_clinets_data_structs, TRUE);
+    pthread_mutex_unlock(&mutex);
 
-    gettimeofday(&time, NULL);
-    current_time = time.tv_sec;
-    if (((current_time - database_backup_start_time) % NUMBER_OF_SECONDS_BETWEEN_BACKUPS) == 0)
-    {
-        *back_up_flag = TRUE;
-    }
-    else
-    {
-        *back_up_flag = FALSE;
-    }
+    /* Added again after the update, so a slow update delays the next one instead of piling them up.  */
+    timer_wheel_add(&server_timers, entry, NUMBER_OF_SECONDS_BETWEEN_BACKUPS * 1000);
 }
 
 /**
@@ -62,21 +40,18 @@ void update_clients(void *address_buffer_of_clinets_data_structs, uint8_t is_bac
         return;
 
     struct pango_data *client = (struct pango_data *)address_buffer_of_clinets_data_structs;
-    struct timeval time;
     char update_clinet_data[MAX_BUFF_SIZE];
-    int current_time = 0;
+    /* One reading of the clock for all the clients of the backup.  */
+    uint64_t current_time = server_clock_ns();
 
     for (int i = 0; i < UPDATE_THREAD_MAX_NUM_CLIENTS; ++i)
     {
         /*Cheks if a client is currently using the app*/
         if (client[i].connected == TRUE)
         {
-            /* Getting the current time for updating the the app usage of all the currently using clients.  */
-            gettimeofday(&time, NULL);
-            current_time = time.tv_sec;
             /* Preparing the sqlite3 command to updating the TIME_USED value for all the connected clients.  */
             if (sprintf(update_clinet_data, "UPDATE your_table SET TIME_USED = %d WHERE MAC_ADR = '%s';",
-                        (int)(current_time - client[i].time_start_parking), client[i].mac_address) < 0)
+                        (int)((current_time - client[i].start_parking_ns) / SERVER_CLOCK_NS_PER_SECOND), client[i].mac_address) < 0)
             {
                 perror("return_database_update_thread: sprintf");
             }
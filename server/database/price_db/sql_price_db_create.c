@@ -1,5 +1,7 @@
 #include <stdio.h>
 #include <sqlite3.h>
+#include "../../zone/zone_index.h"
+#include "../schema/database_schema.h"
 
 int main(){
 	sqlite3 *db;
@@ -14,46 +16,49 @@ int main(){
 	}	
 	
 	//const char *create_table_query = "CREATE TABLE IF NOT EXISTS your_table (col1 INT, col2 TEXT, col3 REAL, col4 TEXT);";
-	const char *create_table_query = "CREATE TABLE IF NOT EXISTS city_parking (CITY TEXT, PRICE REAL);";
+	const char *create_table_query = "CREATE TABLE IF NOT EXISTS city_parking (CITY TEXT, PRICE REAL, ZONE_ID INT, VERSION INT);"
+		"CREATE TABLE IF NOT EXISTS tariff_rule (ZONE_ID INT, WEEKDAY INT, START_HOUR INT, END_HOUR INT, RATE INT, VERSION INT);"
+		"CREATE TABLE IF NOT EXISTS tariff_daily_cap (ZONE_ID INT, WEEKDAY INT, CAP INT, VERSION INT);"
+		"CREATE TABLE IF NOT EXISTS tariff_version (VERSION INTEGER PRIMARY KEY, EFFECTIVE_TIME INT);";
 	
 	rc = sqlite3_exec(db, create_table_query, 0, 0, 0);
 	if (rc != SQLITE_OK) {
     fprintf(stderr, "Cannot open database: %s\n", sqlite3_errmsg(db));
     // Handle the error, possibly close resources and exit the program
 	}
-	
-	//sprintf(insert_query, "INSERT INTO your_table (col1, col2, col3, col4) VALUES (%d, '%s', %f, '%s');",
-    //    value1, value2, value3, value4);
-    sprintf(insert_query, "INSERT INTO city_parking (CITY , PRICE ) VALUES ('%s', %f);",
-        "Ashkelon", 0.006);
-	rc = sqlite3_exec(db, insert_query, 0, 0, 0);
-	if (rc != SQLITE_OK) {
-    fprintf(stderr, "Cannot open database: %s\n", sqlite3_errmsg(db));
-    // Handle the error, possibly close resources and exit the program
-	}
-	
-	sprintf(insert_query, "INSERT INTO city_parking (CITY , PRICE ) VALUES ('%s', %f);",
-        "Jerusalem", 0.012);
-	rc = sqlite3_exec(db, insert_query, 0, 0, 0);
-	if (rc != SQLITE_OK) {
-    fprintf(stderr, "Cannot open database: %s\n", sqlite3_errmsg(db));
-    // Handle the error, possibly close resources and exit the program
+
+	/* A database file created before zone ids and tariff versions existed gets the ZONE_ID and VERSION columns.  */
+	if (database_prepare_price_schema(db) != TRUE) {
+    fprintf(stderr, "Cannot upgrade database: %s\n", sqlite3_errmsg(db));
 	}
 	
-	sprintf(insert_query, "INSERT INTO city_parking (CITY , PRICE ) VALUES ('%s', %f);",
-        "Petah-Tikva", 0.008);
-	rc = sqlite3_exec(db, insert_query, 0, 0, 0);
-	if (rc != SQLITE_OK) {
-    fprintf(stderr, "Cannot open database: %s\n", sqlite3_errmsg(db));
-    // Handle the error, possibly close resources and exit the program
+	/* Price per second of every zone, indexed by the zone id.  */
+	const double price_per_zone[ZONE_COUNT] = {
+		[ZONE_ASHKELON] = 0.006,
+		[ZONE_JERUSALEM] = 0.012,
+		[ZONE_PETAH_TIKVA] = 0.008,
+		[ZONE_HERZLIYA] = 0.010,
+	};
+
+	/* The prices are seeded into an empty database only: the rows of a tariff version
+	   are never changed by a build, and a new price is a new tariff version.
+	   The flat price holds every hour of every day: no time-of-day rule and no daily cap.  */
+	for (unsigned int id = ZONE_INVALID + 1; id < ZONE_COUNT; ++id) {
+		sprintf(insert_query, "INSERT INTO city_parking (CITY , PRICE , ZONE_ID , VERSION ) SELECT '%s', %f, %u, 1"
+			" WHERE NOT EXISTS (SELECT 1 FROM tariff_version)"
+			" AND NOT EXISTS (SELECT 1 FROM city_parking WHERE ZONE_ID = %u AND VERSION = 1);",
+			zone_name(id), price_per_zone[id], id, id);
+		rc = sqlite3_exec(db, insert_query, 0, 0, 0);
+		if (rc != SQLITE_OK) {
+		fprintf(stderr, "Cannot open database: %s\n", sqlite3_errmsg(db));
+		// Handle the error, possibly close resources and exit the program
+		}
 	}
-	
-	sprintf(insert_query, "INSERT INTO city_parking (CITY , PRICE ) VALUES ('%s', %f);",
-        "Herzliya", 0.010);
-	rc = sqlite3_exec(db, insert_query, 0, 0, 0);
+
+	/* The first version of the tariffs is in effect since ever.  */
+	rc = sqlite3_exec(db, "INSERT INTO tariff_version SELECT 1, 0 WHERE NOT EXISTS (SELECT 1 FROM tariff_version);", 0, 0, 0);
 	if (rc != SQLITE_OK) {
-    fprintf(stderr, "Cannot open database: %s\n", sqlite3_errmsg(db));
-    // Handle the error, possibly close resources and exit the program
+	fprintf(stderr, "Cannot open database: %s\n", sqlite3_errmsg(db));
 	}
 	
 	sqlite3_close(db);
@@ -0,0 +1,208 @@
+/**
+ * @file    tariff_loader.c
+ * @author  Vlad Kulikov
+ * @date    2026-10-18
+ * @brief   Implementation of loading the tariffs from the price database.
+ */
+#include "tariff_loader.h"
+
+/**
+ * @brief Read the price per second of every zone from the 'city_parking' rows of the version of a book.
+ *
+ * @param db The price database handle.
+ * @param book Pointer to the book.
+ * @return TRUE on success, FALSE otherwise.
+ */
+static uint8_t tariff_load_prices(sqlite3 *db, struct tariff_book *book)
+{
+    const char *select_query = "SELECT ZONE_ID, PRICE FROM city_parking WHERE ZONE_ID IS NOT NULL AND VERSION = ?;";
+    sqlite3_stmt *stmt;
+
+    if (sqlite3_prepare_v2(db, select_query, -1, &stmt, 0) != SQLITE_OK)
+    {
+        fprintf(stderr, "tariff_load_prices: %s\n", sqlite3_errmsg(db));
+        return FALSE;
+    }
+    sqlite3_bind_int64(stmt, 1, book->version);
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        int zone_id = sqlite3_column_int(stmt, 0);
+        if (zone_id > ZONE_INVALID && zone_id < ZONE_COUNT)
+        {
+            book->price[zone_id] = sqlite3_column_double(stmt, 1);
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    for (uint16_t i = ZONE_INVALID + 1; i < ZONE_COUNT; ++i)
+    {
+        printf("Price of %s: %.3f\n", zone_name(i), book->price[i]);
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Apply the 'tariff_rule' rows of the version of a book to it.
+ *
+ * @param db The price database handle.
+ * @param book Pointer to the book.
+ * @return TRUE on success, FALSE otherwise.
+ */
+static uint8_t tariff_load_rules(sqlite3 *db, struct tariff_book *book)
+{
+    const char *select_query = "SELECT ZONE_ID, WEEKDAY, START_HOUR, END_HOUR, RATE FROM tariff_rule WHERE VERSION = ? ORDER BY rowid;";
+    sqlite3_stmt *stmt;
+
+    if (sqlite3_prepare_v2(db, select_query, -1, &stmt, 0) != SQLITE_OK)
+    {
+        fprintf(stderr, "tariff_load_rules: %s\n", sqlite3_errmsg(db));
+        return FALSE;
+    }
+    sqlite3_bind_int64(stmt, 1, book->version);
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        int zone_id = sqlite3_column_int(stmt, 0);
+        if (zone_id <= ZONE_INVALID || zone_id >= ZONE_COUNT)
+        {
+            continue;
+        }
+        tariff_zone_set_rate(&book->zone[zone_id], sqlite3_column_int(stmt, 1), sqlite3_column_int(stmt, 2),
+                             sqlite3_column_int(stmt, 3), sqlite3_column_int64(stmt, 4));
+    }
+    sqlite3_finalize(stmt);
+    return TRUE;
+}
+
+/**
+ * @brief Apply the 'tariff_daily_cap' rows of the version of a book to it.
+ *
+ * @param db The price database handle.
+ * @param book Pointer to the book.
+ * @return TRUE on success, FALSE otherwise.
+ */
+static uint8_t tariff_load_daily_caps(sqlite3 *db, struct tariff_book *book)
+{
+    const char *select_query = "SELECT ZONE_ID, WEEKDAY, CAP FROM tariff_daily_cap WHERE VERSION = ? ORDER BY rowid;";
+    sqlite3_stmt *stmt;
+
+    if (sqlite3_prepare_v2(db, select_query, -1, &stmt, 0) != SQLITE_OK)
+    {
+        fprintf(stderr, "tariff_load_daily_caps: %s\n", sqlite3_errmsg(db));
+        return FALSE;
+    }
+    sqlite3_bind_int64(stmt, 1, book->version);
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        int zone_id = sqlite3_column_int(stmt, 0);
+        if (zone_id <= ZONE_INVALID || zone_id >= ZONE_COUNT)
+        {
+            continue;
+        }
+        tariff_zone_set_daily_cap(&book->zone[zone_id], sqlite3_column_int(stmt, 1), sqlite3_column_int64(stmt, 2));
+    }
+    sqlite3_finalize(stmt);
+    return TRUE;
+}
+
+/**
+ * @brief Build a tariff book from the price database.
+ *
+ * @param db The price database handle.
+ * @param version Version of the tariffs.
+ * @return Pointer to the book, NULL on error.
+ */
+struct tariff_book *tariff_load(sqlite3 *db, uint32_t version)
+{
+    struct tariff_book *book = tariff_book_create(version);
+
+    if (book == NULL)
+    {
+        return NULL;
+    }
+    if (tariff_load_prices(db, book) != TRUE)
+    {
+        tariff_book_destroy(book);
+        return NULL;
+    }
+
+    /* The flat price per second of the zone is the default rate for every hour.  */
+    for (uint16_t i = ZONE_INVALID + 1; i < ZONE_COUNT; ++i)
+    {
+        int64_t rate_per_hour = llround(book->price[i] * TARIFF_SECONDS_PER_HOUR * TARIFF_MINOR_UNITS_PER_MAJOR);
+        tariff_zone_set_rate(&book->zone[i], TARIFF_EVERY_DAY, 0, TARIFF_HOURS_PER_DAY, rate_per_hour);
+    }
+
+    if (tariff_load_rules(db, book) != TRUE || tariff_load_daily_caps(db, book) != TRUE)
+    {
+        tariff_book_destroy(book);
+        return NULL;
+    }
+    tariff_book_precompute(book);
+    return book;
+}
+
+/**
+ * @brief Find the version of the tariffs in effect at a time.
+ *
+ * @param db The price database handle.
+ * @param now Unix time.
+ * @param version The highest version with EFFECTIVE_TIME <= now, 1 if there is none (output parameter).
+ * @param effective_time Unix time the version took effect, 0 if there is none (output parameter).
+ * @return TRUE on success, FALSE otherwise.
+ */
+uint8_t tariff_version_in_effect(sqlite3 *db, int64_t now, uint32_t *version, int64_t *effective_time)
+{
+    const char *select_query =
+        "SELECT VERSION, EFFECTIVE_TIME FROM tariff_version WHERE EFFECTIVE_TIME <= ? ORDER BY VERSION DESC LIMIT 1;";
+    sqlite3_stmt *stmt;
+
+    if (sqlite3_prepare_v2(db, select_query, -1, &stmt, 0) != SQLITE_OK)
+    {
+        fprintf(stderr, "tariff_version_in_effect: %s\n", sqlite3_errmsg(db));
+        return FALSE;
+    }
+    sqlite3_bind_int64(stmt, 1, now);
+
+    *version = 1;
+    *effective_time = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        *version = (uint32_t)sqlite3_column_int64(stmt, 0);
+        *effective_time = sqlite3_column_int64(stmt, 1);
+    }
+    sqlite3_finalize(stmt);
+    return TRUE;
+}
+
+/**
+ * @brief Find the next scheduled version of the tariffs.
+ *
+ * @param db The price database handle.
+ * @param current_version The version in effect.
+ * @param version The lowest version above current_version (output parameter).
+ * @param effective_time Unix time the version takes effect (output parameter).
+ * @return TRUE if a version is scheduled, FALSE otherwise.
+ */
+uint8_t tariff_next_version(sqlite3 *db, uint32_t current_version, uint32_t *version, int64_t *effective_time)
+{
+    const char *select_query =
+        "SELECT VERSION, EFFECTIVE_TIME FROM tariff_version WHERE VERSION > ? ORDER BY VERSION LIMIT 1;";
+    sqlite3_stmt *stmt;
+    uint8_t found = FALSE;
+
+    if (sqlite3_prepare_v2(db, select_query, -1, &stmt, 0) != SQLITE_OK)
+    {
+        fprintf(stderr, "tariff_next_version: %s\n", sqlite3_errmsg(db));
+        return FALSE;
+    }
+    sqlite3_bind_int64(stmt, 1, current_version);
+
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        *version = (uint32_t)sqlite3_column_int64(stmt, 0);
+        *effective_time = sqlite3_column_int64(stmt, 1);
+        found = TRUE;
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file 	tariff_loader.h
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-18
+ * @brief 	Header file containing declarations for loading the tariffs from the price database.
+ *
+ * The tariff of a zone starts as a flat rate taken from the PRICE of the zone in 'city_parking'.
+ * The rows of 'tariff_rule' (ZONE_ID, WEEKDAY, START_HOUR, END_HOUR, RATE) override the rate
+ * for ranges of hours, in the order they were inserted, and the rows of
+ * 'tariff_daily_cap' (ZONE_ID, WEEKDAY, CAP) limit the charge of one day.
+ * A WEEKDAY of -1 means every day, rates and caps are in minor units (agorot).
+ * The rows of 'tariff_version' (VERSION, EFFECTIVE_TIME) schedule new versions of the tariffs.
+ * Every row of the three other tables has the VERSION it belongs to, and a book is built
+ * from the rows of its own version only, so any version can be built again later.
+ */
+#ifndef TARIFF_LOADER_H
+#define TARIFF_LOADER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <sqlite3.h>
+#include "../../tariff/tariff.h"
+
+/**
+ * @brief Build a tariff book from the price database.
+ *
+ * @param db The price database handle.
+ * @param version Version of the tariffs.
+ * @return Pointer to the book, NULL on error.
+ */
+struct tariff_book *tariff_load(sqlite3 *db, uint32_t version);
+
+/**
+ * @brief Find the version of the tariffs in effect at a time.
+ *
+ * @param db The price database handle.
+ * @param now Unix time.
+ * @param version The highest version with EFFECTIVE_TIME <= now, 1 if there is none (output parameter).
+ * @param effective_time Unix time the version took effect, 0 if there is none (output parameter).
+ * @return TRUE on success, FALSE otherwise.
+ */
+uint8_t tariff_version_in_effect(sqlite3 *db, int64_t now, uint32_t *version, int64_t *effective_time);
+
+/**
+ * @brief Find the next scheduled version of the tariffs.
+ *
+ * @param db The price database handle.
+ * @param current_version The version in effect.
+ * @param version The lowest version above current_version (output parameter).
+ * @param effective_time Unix time the version takes effect (output parameter).
+ * @return TRUE if a version is scheduled, FALSE otherwise.
+ */
+uint8_t tariff_next_version(sqlite3 *db, uint32_t current_version, uint32_t *version, int64_t *effective_time);
+
+#endif /*TARIFF_LOADER_H*/
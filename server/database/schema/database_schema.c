@@ -0,0 +1,291 @@
+/**
+ * @file    database_schema.c
+ * @author  Vlad Kulikov
+ * @date    2026-10-18
+ * @brief   Implementation of creating and upgrading the database schemas.
+ */
+#include "database_schema.h"
+#include "../../zone/zone_index.h"
+
+/**
+ * @brief Check if a table has a column.
+ *
+ * @param db The database handle.
+ * @param table Name of the table.
+ * @param column Name of the column.
+ * @param found Pointer to store TRUE if the column exists, FALSE otherwise (output parameter).
+ * @return TRUE on success, FALSE otherwise.
+ */
+static uint8_t database_has_column(sqlite3 *db, const char *table, const char *column, uint8_t *found)
+{
+    char query[SCHEMA_QUERY_SIZE];
+    sqlite3_stmt *stmt;
+
+    *found = FALSE;
+    if (snprintf(query, sizeof(query), "PRAGMA table_info(%s);", table) < 0)
+    {
+        perror("database_has_column: snprintf");
+        return FALSE;
+    }
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, 0) != SQLITE_OK)
+    {
+        fprintf(stderr, "database_has_column: %s\n", sqlite3_errmsg(db));
+        return FALSE;
+    }
+    /* The second column of table_info is the column name.  */
+    while (*found == FALSE && sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        if (strcmp((const char *)sqlite3_column_text(stmt, 1), column) == 0)
+        {
+            *found = TRUE;
+        }
+    }
+    sqlite3_finalize(stmt);
+    return TRUE;
+}
+
+/**
+ * @brief Add a column to a table if the table doesn't have it yet.
+ *
+ * Database files created by older versions of the server keep working,
+ * the missing column is added with a NULL value in the existing rows.
+ *
+ * @param db The database handle.
+ * @param table Name of the table.
+ * @param column Name of the column.
+ * @param type SQL type of the column.
+ * @return TRUE on success, FALSE otherwise.
+ */
+uint8_t database_add_column_if_missing(sqlite3 *db, const char *table, const char *column, const char *type)
+{
+    char query[SCHEMA_QUERY_SIZE];
+    uint8_t found;
+
+    if (database_has_column(db, table, column, &found) != TRUE)
+    {
+        return FALSE;
+    }
+    if (found == TRUE)
+    {
+        return TRUE;
+    }
+
+    if (snprintf(query, sizeof(query), "ALTER TABLE %s ADD COLUMN %s %s;", table, column, type) < 0)
+    {
+        perror("database_add_column_if_missing: snprintf");
+        return FALSE;
+    }
+    if (sqlite3_exec(db, query, 0, 0, 0) != SQLITE_OK)
+    {
+        fprintf(stderr, "database_add_column_if_missing: %s\n", sqlite3_errmsg(db));
+        return FALSE;
+    }
+    printf("Added column %s to %s\n", column, table);
+    return TRUE;
+}
+
+/**
+ * @brief Fill the ZONE_ID of the rows written before zone ids existed, by their zone name.
+ *
+ * @param db The database handle.
+ * @param table Name of the table.
+ * @param name_column Name of the column that holds the zone name.
+ * @return TRUE on success, FALSE otherwise.
+ */
+static uint8_t database_fill_zone_ids(sqlite3 *db, const char *table, const char *name_column)
+{
+    char query[SCHEMA_QUERY_SIZE];
+
+    for (uint16_t id = ZONE_INVALID + 1; id < ZONE_COUNT; ++id)
+    {
+        if (snprintf(query, sizeof(query), "UPDATE %s SET ZONE_ID = %u WHERE ZONE_ID IS NULL AND %s = '%s';",
+                     table, id, name_column, zone_name(id)) < 0)
+        {
+            perror("database_fill_zone_ids: snprintf");
+            return FALSE;
+        }
+        if (sqlite3_exec(db, query, 0, 0, 0) != SQLITE_OK)
+        {
+            fprintf(stderr, "database_fill_zone_ids: %s\n", sqlite3_errmsg(db));
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Create the client database tables and upgrade old ones.
+ *
+ * @param db The client database handle.
+ * @return TRUE on success, FALSE otherwise.
+ */
+uint8_t database_prepare_client_schema(sqlite3 *db)
+{
+    uint8_t has_location;
+    const char *create_table_query =
+        "CREATE TABLE IF NOT EXISTS your_table (MAC_ADR TEXT, TIME_USED INT, ZONE_ID INT);"
+        "CREATE INDEX IF NOT EXISTS your_table_mac ON your_table (MAC_ADR);"
+        "CREATE TABLE IF NOT EXISTS history_event (MAC_ADR TEXT, SEQ INT, STATUS INT, EVENT_TIME INT,"
+        " PRIMARY KEY (MAC_ADR, SEQ)) WITHOUT ROWID;"
+        "CREATE TABLE IF NOT EXISTS parking_history (MAC_ADR TEXT, ZONE_ID INT, START_TIME INT, END_TIME INT, CHARGE INT);";
+
+    if (sqlite3_exec(db, create_table_query, 0, 0, 0) != SQLITE_OK)
+    {
+        fprintf(stderr, "database_prepare_client_schema: %s\n", sqlite3_errmsg(db));
+        return FALSE;
+    }
+    /* Tables created before zone ids existed, have a LOCATION TEXT column instead.
+       Their sessions would resume in ZONE_INVALID and be charged nothing, so the id is taken from it.  */
+    if (database_add_column_if_missing(db, "your_table", "ZONE_ID", "INT") != TRUE ||
+        database_has_column(db, "your_table", "LOCATION", &has_location) != TRUE ||
+        (has_location == TRUE && database_fill_zone_ids(db, "your_table", "LOCATION") != TRUE))
+    {
+        return FALSE;
+    }
+    /* Unix time the session started, NULL in the rows of older versions.  */
+    return database_add_column_if_missing(db, "your_table", "START_TIME", "INT");
+}
+
+/**
+ * @brief Give the rows of a price table a VERSION, the ones written before versions existed get every version.
+ *
+ * Done when the table gets its VERSION column. A database without any version
+ * gets version 1, in effect since ever, like tariff_version_in_effect assumes.
+ *
+ * @param db The price database handle.
+ * @param table Name of the table.
+ * @param columns The columns of the table but VERSION, separated by commas.
+ * @return TRUE on success, FALSE otherwise.
+ */
+static uint8_t database_version_rows(sqlite3 *db, const char *table, const char *columns)
+{
+    char query[SCHEMA_QUERY_SIZE];
+    uint8_t has_version;
+    int length;
+
+    /* Only once, a row added later without a VERSION belongs to no version.  */
+    if (database_has_column(db, table, "VERSION", &has_version) != TRUE)
+    {
+        return FALSE;
+    }
+    if (has_version == TRUE)
+    {
+        return TRUE;
+    }
+    if (database_add_column_if_missing(db, table, "VERSION", "INT") != TRUE)
+    {
+        return FALSE;
+    }
+    /* The rules of a version are applied in the order of their rowid, the copies keep it.  */
+    length = snprintf(query, sizeof(query),
+                      "INSERT INTO tariff_version SELECT 1, 0 WHERE NOT EXISTS (SELECT 1 FROM tariff_version)"
+                      " AND EXISTS (SELECT 1 FROM %s WHERE VERSION IS NULL);"
+                      "INSERT INTO %s (%s, VERSION) SELECT %s, tariff_version.VERSION FROM %s, tariff_version"
+                      " WHERE %s.VERSION IS NULL ORDER BY tariff_version.VERSION, %s.rowid;"
+                      "DELETE FROM %s WHERE VERSION IS NULL;",
+                      table, table, columns, columns, table, table, table, table);
+    if (length < 0 || (size_t)length >= sizeof(query))
+    {
+        fprintf(stderr, "database_version_rows: %s: query too long\n", table);
+        return FALSE;
+    }
+    if (sqlite3_exec(db, query, 0, 0, 0) != SQLITE_OK)
+    {
+        fprintf(stderr, "database_version_rows: %s\n", sqlite3_errmsg(db));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Make the rows of a price table read only once their version is in effect.
+ *
+ * @param db The price database handle.
+ * @param table Name of the table.
+ * @return TRUE on success, FALSE otherwise.
+ */
+static uint8_t database_protect_published_rows(sqlite3 *db, const char *table)
+{
+    static const char *const events[] = {"INSERT", "UPDATE", "DELETE"};
+    char query[SCHEMA_QUERY_SIZE];
+
+    for (size_t i = 0; i < sizeof(events) / sizeof(events[0]); ++i)
+    {
+        /* An INSERT has only the new row, an UPDATE may not move a row out of its version either.  */
+        int length = snprintf(query, sizeof(query),
+                              "CREATE TRIGGER IF NOT EXISTS %s_%s_published BEFORE %s ON %s"
+                              " WHEN EXISTS (SELECT 1 FROM tariff_version WHERE VERSION = %s.VERSION"
+                              " AND EFFECTIVE_TIME <= CAST(strftime('%%s', 'now') AS INT))"
+                              " BEGIN SELECT RAISE(ABORT, 'the tariff version is in effect'); END;",
+                              table, events[i], events[i], table, (i == 0) ? "NEW" : "OLD");
+        if (length < 0 || (size_t)length >= sizeof(query))
+        {
+            fprintf(stderr, "database_protect_published_rows: %s: query too long\n", table);
+            return FALSE;
+        }
+        if (sqlite3_exec(db, query, 0, 0, 0) != SQLITE_OK)
+        {
+            fprintf(stderr, "database_protect_published_rows: %s\n", sqlite3_errmsg(db));
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Upgrade the price database so every city row carries its zone id and tariff version.
+ *
+ * Rows written before zone ids existed are matched by the city name.
+ * The tariff tables are created empty when they don't exist.
+ * A row of 'tariff_version' (VERSION, EFFECTIVE_TIME) schedules a new version of the tariffs,
+ * made of the rows of 'city_parking', 'tariff_rule' and 'tariff_daily_cap' with that VERSION.
+ * Rows written before versions existed were part of every version, so they are copied to each one.
+ * Once a version is in effect (EFFECTIVE_TIME <= now, unix time) its rows and its
+ * 'tariff_version' row can't be changed anymore, triggers abort the statement.
+ *
+ * @param db The price database handle.
+ * @return TRUE on success, FALSE otherwise.
+ */
+uint8_t database_prepare_price_schema(sqlite3 *db)
+{
+    const char *create_tariff_tables_query =
+        "CREATE TABLE IF NOT EXISTS tariff_rule (ZONE_ID INT, WEEKDAY INT, START_HOUR INT, END_HOUR INT, RATE INT, VERSION INT);"
+        "CREATE TABLE IF NOT EXISTS tariff_daily_cap (ZONE_ID INT, WEEKDAY INT, CAP INT, VERSION INT);"
+        "CREATE TABLE IF NOT EXISTS tariff_version (VERSION INTEGER PRIMARY KEY, EFFECTIVE_TIME INT);";
+    const char *protect_versions_query =
+        "CREATE TRIGGER IF NOT EXISTS tariff_version_UPDATE_published BEFORE UPDATE ON tariff_version"
+        " WHEN OLD.EFFECTIVE_TIME <= CAST(strftime('%s', 'now') AS INT)"
+        " BEGIN SELECT RAISE(ABORT, 'the tariff version is in effect'); END;"
+        "CREATE TRIGGER IF NOT EXISTS tariff_version_DELETE_published BEFORE DELETE ON tariff_version"
+        " WHEN OLD.EFFECTIVE_TIME <= CAST(strftime('%s', 'now') AS INT)"
+        " BEGIN SELECT RAISE(ABORT, 'the tariff version is in effect'); END;";
+
+    if (sqlite3_exec(db, create_tariff_tables_query, 0, 0, 0) != SQLITE_OK)
+    {
+        fprintf(stderr, "database_prepare_price_schema: %s\n", sqlite3_errmsg(db));
+        return FALSE;
+    }
+
+    if (database_add_column_if_missing(db, "city_parking", "ZONE_ID", "INT") != TRUE ||
+        database_fill_zone_ids(db, "city_parking", "CITY") != TRUE)
+    {
+        return FALSE;
+    }
+
+    /* The rows of older files are versioned before they become read only.  */
+    if (database_version_rows(db, "city_parking", "CITY, PRICE, ZONE_ID") != TRUE ||
+        database_version_rows(db, "tariff_rule", "ZONE_ID, WEEKDAY, START_HOUR, END_HOUR, RATE") != TRUE ||
+        database_version_rows(db, "tariff_daily_cap", "ZONE_ID, WEEKDAY, CAP") != TRUE)
+    {
+        return FALSE;
+    }
+    if (database_protect_published_rows(db, "city_parking") != TRUE ||
+        database_protect_published_rows(db, "tariff_rule") != TRUE ||
+        database_protect_published_rows(db, "tariff_daily_cap") != TRUE ||
+        sqlite3_exec(db, protect_versions_query, 0, 0, 0) != SQLITE_OK)
+    {
+        fprintf(stderr, "database_prepare_price_schema: %s\n", sqlite3_errmsg(db));
+        return FALSE;
+    }
+    return TRUE;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file 	database_schema.h
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-18
+ * @brief 	Header file containing declarations for creating and upgrading the database schemas.
+ */
+#ifndef DATABASE_SCHEMA_H
+#define DATABASE_SCHEMA_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sqlite3.h>
+
+#ifndef STATEMENT_STATUS
+#define STATEMENT_STATUS
+enum statement_status
+{
+	FALSE = 0,
+	TRUE = !FALSE
+};
+#endif /*STATEMENT_STATUS*/
+
+#define SCHEMA_QUERY_SIZE 512
+
+/**
+ * @brief Add a column to a table if the table doesn't have it yet.
+ *
+ * Database files created by older versions of the server keep working,
+ * the missing column is added with a NULL value in the existing rows.
+ *
+ * @param db The database handle.
+ * @param table Name of the table.
+ * @param column Name of the column.
+ * @param type SQL type of the column.
+ * @return TRUE on success, FALSE otherwise.
+ */
+uint8_t database_add_column_if_missing(sqlite3 *db, const char *table, const char *column, const char *type);
+
+/**
+ * @brief Create the client database tables and upgrade old ones.
+ *
+ * 'your_table' holds the sessions in progress. 'history_event' holds the
+ * (MAC, seq) of the stored events a BBB sent in a HISTORY frame and may send
+ * again, so a frame sent again is applied once, and 'parking_history' the
+ * sessions they ended.
+ *
+ * @param db The client database handle.
+ * @return TRUE on success, FALSE otherwise.
+ */
+uint8_t database_prepare_client_schema(sqlite3 *db);
+
+/**
+ * @brief Upgrade the price database so every city row carries its zone id and tariff version.
+ *
+ * Rows written before zone ids existed are matched by the city name.
+ * The tariff tables are created empty when they don't exist.
+ * A row of 'tariff_version' (VERSION, EFFECTIVE_TIME) schedules a new version of the tariffs,
+ * made of the rows of 'city_parking', 'tariff_rule' and 'tariff_daily_cap' with that VERSION.
+ * Rows written before versions existed were part of every version, so they are copied to each one.
+ * Once a version is in effect (EFFECTIVE_TIME <= now, unix time) its rows and its
+ * 'tariff_version' row can't be changed anymore, triggers abort the statement.
+ *
+ * @param db The price database handle.
+ * @return TRUE on success, FALSE otherwise.
+ */
+uint8_t database_prepare_price_schema(sqlite3 *db);
+
+#endif /*DATABASE_SCHEMA_H*/
@@ -0,0 +1,396 @@
+/**
+ * @file    history_ingest.c
+ * @author  Vlad Kulikov
+ * @date    2026-10-19
+ * @brief   Implementation of applying the events a BBB stored while offline.
+ */
+#include "history_ingest.h"
+
+/* The statements of a frame, prepared once and bound for every record.  */
+enum history_statement
+{
+    HISTORY_SEEN,
+    HISTORY_FIND,
+    HISTORY_START,
+    HISTORY_ARCHIVE,
+    HISTORY_END,
+    HISTORY_FORGET,
+    HISTORY_STATEMENTS
+};
+
+static const char *history_queries[HISTORY_STATEMENTS] = {
+    "INSERT OR IGNORE INTO history_event (MAC_ADR, SEQ, STATUS, EVENT_TIME) VALUES (?, ?, ?, ?);",
+    "SELECT TIME_USED, ZONE_ID, START_TIME FROM your_table WHERE MAC_ADR = ?;",
+    "INSERT INTO your_table (MAC_ADR, TIME_USED, ZONE_ID, START_TIME) VALUES (?, ?, ?, ?);",
+    "INSERT INTO parking_history (MAC_ADR, ZONE_ID, START_TIME, END_TIME, CHARGE) VALUES (?, ?, ?, ?, ?);",
+    "DELETE FROM your_table WHERE MAC_ADR = ?;",
+    "DELETE FROM history_event WHERE MAC_ADR = ? AND SEQ >= ? AND SEQ < ?;",
+};
+
+/**
+ * @brief Run a statement that returns no rows, and make it ready for the next record.
+ *
+ * @return TRUE on success, FALSE otherwise.
+ */
+static uint8_t history_exec(sqlite3_stmt *stmt)
+{
+    int result = sqlite3_step(stmt);
+
+    sqlite3_reset(stmt);
+    if (result != SQLITE_DONE)
+    {
+        fprintf(stderr, "history_ingest: %s\n", sqlite3_errmsg(db_client));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Get the book of a version, inside a read section of the tariffs.
+ *
+ * A version that was already retired is loaded from the price database,
+ * its rows don't change once it took effect.
+ *
+ * @param version The version.
+ * @param loaded The book loaded for an earlier record of the frame, replaced by the new one
+ *        (input/output parameter).
+ * @return Pointer to the book, NULL on error.
+ */
+static const struct tariff_book *history_book(uint32_t version, struct tariff_book **loaded)
+{
+    const struct tariff_book *book = tariff_version_book(version);
+
+    if (book != NULL)
+    {
+        return book;
+    }
+    if (*loaded == NULL || (*loaded)->version != version)
+    {
+        tariff_book_destroy(*loaded);
+        *loaded = tariff_load(db_prices, version);
+    }
+    return *loaded;
+}
+
+/**
+ * @brief Calculate the charge of a stored session, inside a read section of the tariffs.
+ *
+ * The session is priced under the version in effect at its start, and split at the
+ * effective time of every later version, like tariff_session_cost.
+ *
+ * @param zone_id The zone id.
+ * @param start_time Unix time the session started.
+ * @param end_time Unix time the session ended.
+ * @param loaded See history_book (input/output parameter).
+ * @param charge The charge in minor units (output parameter).
+ * @return TRUE on success, FALSE otherwise.
+ */
+static uint8_t history_cost(uint16_t zone_id, int64_t start_time, int64_t end_time,
+                            struct tariff_book **loaded, int64_t *charge)
+{
+    uint32_t version, next_version;
+    int64_t effective_time, next_time;
+
+    *charge = 0;
+    if (tariff_version_in_effect(db_prices, start_time, &version, &effective_time) != TRUE)
+    {
+        return FALSE;
+    }
+    while (start_time < end_time)
+    {
+        const struct tariff_book *book = history_book(version, loaded);
+        int64_t part_end = end_time;
+        uint8_t next = tariff_next_version(db_prices, version, &next_version, &next_time);
+
+        if (book == NULL)
+        {
+            return FALSE;
+        }
+        if (next == TRUE && next_time < end_time)
+        {
+            part_end = (next_time > start_time) ? next_time : start_time;
+        }
+        *charge += tariff_cost(book, zone_id, start_time, part_end);
+        if (next != TRUE || next_time >= end_time)
+        {
+            break;
+        }
+        start_time = part_end;
+        version = next_version;
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Delete the rows of a unit the BBB can't send again, HISTORY_RESEND_SEQS or more behind a seq.
+ *
+ * The seqs may wrap: the rows from half the seq space behind the seq are taken as older,
+ * the ones after it are never deleted.
+ *
+ * @param mac_address The MAC of the unit.
+ * @param seq The seq of a record of the unit just applied.
+ * @return TRUE on success, FALSE otherwise.
+ */
+static uint8_t history_forget(sqlite3_stmt **stmt, const char *mac_address, uint32_t seq)
+{
+    uint32_t oldest = seq - (HISTORY_RESEND_SEQS - 1), older = seq - (UINT32_MAX / 2);
+    uint8_t wrapped = (older > oldest) ? TRUE : FALSE;
+    int64_t range[2][2] = {{older, oldest}, {0, oldest}};
+
+    if (wrapped == TRUE)
+    {
+        range[0][1] = (int64_t)UINT32_MAX + 1;
+    }
+    for (int i = 0; i < ((wrapped == TRUE) ? 2 : 1); ++i)
+    {
+        sqlite3_bind_text(stmt[HISTORY_FORGET], 1, mac_address, -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt[HISTORY_FORGET], 2, range[i][0]);
+        sqlite3_bind_int64(stmt[HISTORY_FORGET], 3, range[i][1]);
+        if (history_exec(stmt[HISTORY_FORGET]) != TRUE)
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Open the session of a unit from a stored start.
+ *
+ * @return HISTORY_APPLIED, HISTORY_DUPLICATE, HISTORY_REJECTED or HISTORY_FAILED.
+ */
+static uint8_t history_start(sqlite3_stmt **stmt, const uint8_t *event, const char *mac_address,
+                             int64_t event_time, int64_t now)
+{
+    uint16_t zone_id = zone_id_from_coordinates(event[7], event[8]);
+    int found;
+
+    /* The unit started again once the server was back, the session is known.  */
+    if (session_connected(protocol_event_mac_key(event)) != NULL)
+    {
+        return HISTORY_DUPLICATE;
+    }
+    sqlite3_bind_text(stmt[HISTORY_FIND], 1, mac_address, -1, SQLITE_STATIC);
+    found = sqlite3_step(stmt[HISTORY_FIND]);
+    sqlite3_reset(stmt[HISTORY_FIND]);
+    if (found == SQLITE_ROW)
+    {
+        return HISTORY_DUPLICATE;
+    }
+    if (found != SQLITE_DONE)
+    {
+        fprintf(stderr, "history_ingest: %s\n", sqlite3_errmsg(db_client));
+        return HISTORY_FAILED;
+    }
+    if (zone_id == ZONE_INVALID || zone_id >= ZONE_COUNT)
+    {
+        return HISTORY_REJECTED;
+    }
+
+    /* TIME_USED is what a connection that takes the session over counts on from.  */
+    sqlite3_bind_text(stmt[HISTORY_START], 1, mac_address, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt[HISTORY_START], 2, (now > event_time) ? now - event_time : 0);
+    sqlite3_bind_int(stmt[HISTORY_START], 3, zone_id);
+    sqlite3_bind_int64(stmt[HISTORY_START], 4, event_time);
+    return (history_exec(stmt[HISTORY_START]) == TRUE) ? HISTORY_APPLIED : HISTORY_FAILED;
+}
+
+/**
+ * @brief End the session of a unit from a stored stop, and charge it.
+ *
+ * Is called inside a read section of the tariffs.
+ *
+ * @param loaded See history_book (input/output parameter).
+ * @return HISTORY_APPLIED, HISTORY_REJECTED or HISTORY_FAILED.
+ */
+static uint8_t history_stop(sqlite3_stmt **stmt, const uint8_t *event, const char *mac_address,
+                            int64_t event_time, struct tariff_book **loaded)
+{
+    int64_t start_time, charge;
+    uint16_t zone_id;
+    int found;
+
+    /* A connection counts the time of the unit, the session is its own to end.  */
+    if (session_connected(protocol_event_mac_key(event)) != NULL)
+    {
+        return HISTORY_REJECTED;
+    }
+    sqlite3_bind_text(stmt[HISTORY_FIND], 1, mac_address, -1, SQLITE_STATIC);
+    found = sqlite3_step(stmt[HISTORY_FIND]);
+    if (found != SQLITE_ROW)
+    {
+        sqlite3_reset(stmt[HISTORY_FIND]);
+        if (found != SQLITE_DONE)
+        {
+            fprintf(stderr, "history_ingest: %s\n", sqlite3_errmsg(db_client));
+            return HISTORY_FAILED;
+        }
+        /* A stop without a start.  */
+        return HISTORY_REJECTED;
+    }
+    zone_id = (uint16_t)sqlite3_column_int(stmt[HISTORY_FIND], 1);
+    /* The rows of older versions have no START_TIME, they know the time used only.  */
+    start_time = (sqlite3_column_type(stmt[HISTORY_FIND], 2) != SQLITE_NULL)
+                     ? sqlite3_column_int64(stmt[HISTORY_FIND], 2)
+                     : event_time - sqlite3_column_int64(stmt[HISTORY_FIND], 0);
+    sqlite3_reset(stmt[HISTORY_FIND]);
+    if (start_time > event_time)
+    {
+        start_time = event_time;
+    }
+    charge = 0;
+    if (zone_id < ZONE_COUNT && history_cost(zone_id, start_time, event_time, loaded, &charge) != TRUE)
+    {
+        return HISTORY_FAILED;
+    }
+
+    sqlite3_bind_text(stmt[HISTORY_ARCHIVE], 1, mac_address, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt[HISTORY_ARCHIVE], 2, zone_id);
+    sqlite3_bind_int64(stmt[HISTORY_ARCHIVE], 3, start_time);
+    sqlite3_bind_int64(stmt[HISTORY_ARCHIVE], 4, event_time);
+    sqlite3_bind_int64(stmt[HISTORY_ARCHIVE], 5, charge);
+    sqlite3_bind_text(stmt[HISTORY_END], 1, mac_address, -1, SQLITE_STATIC);
+    if (history_exec(stmt[HISTORY_ARCHIVE]) != TRUE || history_exec(stmt[HISTORY_END]) != TRUE)
+    {
+        return HISTORY_FAILED;
+    }
+    udp_unit_close(protocol_event_mac_key(event));
+    printf("SERVER: %s parked offline for %lld seconds, charged %lld\n", mac_address,
+           (long long)(event_time - start_time), (long long)charge);
+    return HISTORY_APPLIED;
+}
+
+/**
+ * @brief Apply one record whose CRC-8 matched, inside the transaction.
+ *
+ * @return HISTORY_APPLIED, HISTORY_DUPLICATE, HISTORY_REJECTED or HISTORY_FAILED.
+ */
+static uint8_t history_apply(sqlite3_stmt **stmt, const uint8_t *event, uint32_t seq, int64_t event_time,
+                             int64_t now, struct tariff_book **loaded)
+{
+    char mac_address[MAC_ADDRESS_SIZE];
+
+    /* The event has its own CRC-8, it was taken by the BBB as it came from the unit.  */
+    if (event[PROTOCOL_EVENT_CRC_OFFSET] != crc8_compute(event, PANGO_DATA_SIZE) ||
+        (event[0] != START_APP && event[0] != CLOSE_APP))
+    {
+        return HISTORY_REJECTED;
+    }
+    format_mac_address(protocol_event_mac_key(event), mac_address, sizeof(mac_address));
+
+    /* The (MAC, seq) is kept first: a record that is there already was applied by an earlier frame.  */
+    sqlite3_bind_text(stmt[HISTORY_SEEN], 1, mac_address, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt[HISTORY_SEEN], 2, seq);
+    sqlite3_bind_int(stmt[HISTORY_SEEN], 3, event[0]);
+    sqlite3_bind_int64(stmt[HISTORY_SEEN], 4, event_time);
+    if (history_exec(stmt[HISTORY_SEEN]) != TRUE)
+    {
+        return HISTORY_FAILED;
+    }
+    if (sqlite3_changes(db_client) == 0)
+    {
+        return HISTORY_DUPLICATE;
+    }
+    if (history_forget(stmt, mac_address, seq) != TRUE)
+    {
+        return HISTORY_FAILED;
+    }
+
+    return (event[0] == START_APP) ? history_start(stmt, event, mac_address, event_time, now)
+                                   : history_stop(stmt, event, mac_address, event_time, loaded);
+}
+
+/**
+ * @brief Apply the records of the HISTORY frame a connection received, and answer it.
+ *
+ * @param connection Pointer to the state, see protocol_receive_event.
+ */
+void history_ingest(struct protocol_connection *connection)
+{
+    sqlite3_stmt *stmt[HISTORY_STATEMENTS] = {NULL};
+    struct tariff_book *loaded = NULL;
+    uint8_t valid[PROTOCOL_MAX_HISTORY];
+    uint16_t outcomes[HISTORY_FAILED] = {0};
+    uint8_t outcome = HISTORY_APPLIED, status = PROTOCOL_HISTORY_OK, seen = FALSE;
+    uint32_t next = 0, seq, age_s;
+    size_t valid_count;
+    int64_t now = server_clock_to_wall(server_clock_ns());
+    int token;
+
+    valid_count = crc8_verify_batch(connection->history, PROTOCOL_HISTORY_RECORD_SIZE, connection->history_count, valid);
+
+    /* The same order as the close of a live session: the tariffs, then the mutex.  */
+    token = tariff_read_lock();
+    pthread_mutex_lock(&mutex);
+    if (sqlite3_exec(db_client, "BEGIN IMMEDIATE;", 0, 0, 0) != SQLITE_OK)
+    {
+        fprintf(stderr, "history_ingest: %s\n", sqlite3_errmsg(db_client));
+        outcome = HISTORY_FAILED;
+    }
+    for (int i = 0; i < HISTORY_STATEMENTS && outcome != HISTORY_FAILED; ++i)
+    {
+        if (sqlite3_prepare_v2(db_client, history_queries[i], -1, &stmt[i], 0) != SQLITE_OK)
+        {
+            fprintf(stderr, "history_ingest: %s\n", sqlite3_errmsg(db_client));
+            outcome = HISTORY_FAILED;
+        }
+    }
+
+    for (uint16_t i = 0; i < connection->history_count && outcome != HISTORY_FAILED; ++i)
+    {
+        const uint8_t *record = &connection->history[i * PROTOCOL_HISTORY_RECORD_SIZE];
+
+        if (valid[i] == 0)
+        {
+            ++outcomes[HISTORY_REJECTED];
+            continue;
+        }
+        protocol_history_fields(connection, record, &seq, &age_s);
+        outcome = history_apply(stmt, record, seq, now - age_s, now, &loaded);
+        if (outcome != HISTORY_FAILED)
+        {
+            ++outcomes[outcome];
+        }
+        /* The seqs of the BBB may wrap, the reply names the one after the latest.  */
+        if (seen == FALSE || (int32_t)(seq + 1 - next) > 0)
+        {
+            next = seq + 1;
+            seen = TRUE;
+        }
+    }
+
+    for (int i = 0; i < HISTORY_STATEMENTS; ++i)
+    {
+        sqlite3_finalize(stmt[i]);
+    }
+    if (outcome != HISTORY_FAILED && sqlite3_exec(db_client, "COMMIT;", 0, 0, 0) != SQLITE_OK)
+    {
+        fprintf(stderr, "history_ingest: %s\n", sqlite3_errmsg(db_client));
+        outcome = HISTORY_FAILED;
+    }
+    if (outcome == HISTORY_FAILED)
+    {
+        sqlite3_exec(db_client, "ROLLBACK;", 0, 0, 0);
+        memset(outcomes, 0, sizeof(outcomes));
+        status = ERROR;
+    }
+    pthread_mutex_unlock(&mutex);
+    tariff_read_unlock(token);
+    tariff_book_destroy(loaded);
+
+    /* Nothing the BBB may drop, it sends the records again.  */
+    if (status == PROTOCOL_HISTORY_OK && valid_count == 0)
+    {
+        status = CRC8_TEST_FAILED;
+    }
+    printf("Client %d sent %u stored events: %u applied, %u already known, %u rejected\n", connection->fd,
+           connection->history_count, outcomes[HISTORY_APPLIED], outcomes[HISTORY_DUPLICATE],
+           outcomes[HISTORY_REJECTED]);
+
+    if (protocol_send_history_result(connection, status, next, outcomes[HISTORY_APPLIED],
+                                     outcomes[HISTORY_DUPLICATE], outcomes[HISTORY_REJECTED]) != PROTOCOL_OK)
+    {
+        /* A lost connection is found by the next recv.  */
+        perror("history_ingest: protocol_send_history_result");
+    }
+}
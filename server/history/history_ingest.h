@@ -0,0 +1,66 @@
+/**
+ * @file 	history_ingest.h
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-19
+ * @brief 	Header file containing declarations for applying the events a BBB stored while offline.
+ *
+ * A BBB that can't reach the server keeps the start and stop events of its
+ * units, and sends them later, thousands at once, in a HISTORY frame, see
+ * protocol.h. The records of a frame are checked in one crc8_verify_batch
+ * call and applied in one transaction, under one mutex section:
+ *
+ * - A (MAC, seq) in 'history_event' was applied already, by a frame the BBB
+ *   sent again because the reply was lost, and is counted as a duplicate.
+ * - A start opens a row of 'your_table' from the time of the event, unless the
+ *   unit has a session already, live or in the table: a duplicate too.
+ * - A stop ends the row of the unit: the session is charged from its start to
+ *   the time of the event, under the tariff version in effect at its start,
+ *   and moved to 'parking_history'. A unit a connection has live is left to
+ *   it, and a stop without a start is rejected.
+ *
+ * The time of an event is the time of the frame less the age of the record,
+ * so the clock of the BBB never matters.
+ *
+ * A BBB sends again only the records its store still holds, at most
+ * HISTORY_RESEND_SEQS seqs behind its newest one, so once a record is applied
+ * the rows of its MAC further behind it are deleted from 'history_event'.
+ */
+#ifndef HISTORY_INGEST_H
+#define HISTORY_INGEST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <sqlite3.h>
+#include "../client/client_thread.h"
+#include "../protocol/protocol.h"
+#include "../udp/udp_ingest.h"
+#include "../zone/zone_index.h"
+#include "../tariff/tariff_rcu.h"
+#include "../database/price_db/tariff_loader.h"
+#include "../clock/server_clock.h"
+#include "../../common/crc8/crc8.h"
+
+/* The records the store of a BBB holds, STORE_CAPACITY in client/bbb/store/store.h.  */
+#define HISTORY_RESEND_SEQS 1024
+
+#ifndef HISTORY_OUTCOME
+#define HISTORY_OUTCOME
+enum history_outcome
+{
+	HISTORY_APPLIED,
+	HISTORY_DUPLICATE,
+	HISTORY_REJECTED,
+	HISTORY_FAILED, /*The database failed, the whole frame is rolled back*/
+};
+#endif /*HISTORY_OUTCOME*/
+
+/**
+ * @brief Apply the records of the HISTORY frame a connection received, and answer it.
+ *
+ * @param connection Pointer to the state, see protocol_receive_event.
+ */
+void history_ingest(struct protocol_connection *connection);
+
+#endif /*HISTORY_INGEST_H*/
@@ -21,6 +21,8 @@ sqlite3 *db_client;
 sqlite3 *db_prices;	
 /* A flag that when turnd on calls the 'update database thread' to return to the main thread.  */				
 volatile uint8_t return_thread;	
+/* The timers of the server, driven by the 'update database thread'.  */
+struct timer_wheel server_timers;
 
 int main(void){	
 	/*Initalizing data for the TCP server*/
@@ -30,11 +32,17 @@ int main(void){
 	struct pango_data client[SERVER_MAX_NUM_CLIENTS];
 	memset(client, 0, sizeof(client));		
 	/*The thread reserved for the clients*/
-	pthread_t thread[SERVER_MAX_NUM_CLIENTS], db_upd_thr;
+	pthread_t thread[SERVER_MAX_NUM_CLIENTS], db_upd_thr, reprice_thr, udp_thr;
 	socklen_t 	server_addr_len = sizeof(server_addr),	
 				client_addr_len = sizeof(client_addr);
 	uint8_t return_value = 0;
+	/*The version of the tariffs in effect when the server starts*/
+	uint32_t tariff_version = 0;
+	int64_t tariff_effective_time = 0;
+	struct tariff_book *tariff_book;
 
+	/* The tariffs follow the local time of Israel, summer time included.  */
+	tariff_time_zone_init();
 	
 	return_value = sqlite3_open("pango_client_database.db", &db_client);
 	if (return_value != SQLITE_OK) {
@@ -42,10 +50,8 @@ int main(void){
 		exit(EXIT_FAILURE);
 	}
 
-	const char *create_table_query = "CREATE TABLE IF NOT EXISTS your_table (MAC_ADR TEXT, TIME_USED INT, LOCATION TEXT);";
-	return_value = sqlite3_exec(db_client, create_table_query, 0, 0, 0);
-	if(return_value != SQLITE_OK){
-		perror("main_server:main:sqlite3_exec:create_table_query");
+	if(database_prepare_client_schema(db_client) != TRUE){
+		perror("main_server:main:database_prepare_client_schema");
 		exit(EXIT_FAILURE);
 	}
 
@@ -54,6 +60,20 @@ int main(void){
 		perror("main_server:main:sqlite3_open:parking_prices_per_city.db");
 		exit(EXIT_FAILURE);
 	}
+
+	if(database_prepare_price_schema(db_prices) != TRUE ||
+	   tariff_version_in_effect(db_prices, time(NULL), &tariff_version, &tariff_effective_time) != TRUE){
+		perror("main_server:main:database_prepare_price_schema");
+		exit(EXIT_FAILURE);
+	}
+
+	/* Precomputing the prices and time-of-day tariffs of every zone,
+	   so the client threads don't query the price D.B.  */
+	tariff_book = tariff_load(db_prices, tariff_version);
+	if(tariff_book == NULL || tariff_rcu_init(tariff_book, tariff_effective_time) != TRUE){
+		perror("main_server:main:tariff_load");
+		exit(EXIT_FAILURE);
+	}
 	
 	puts("SERVER: Starting");
 	
@@ -84,6 +104,12 @@ int main(void){
 		perror("listen");
 		exit(EXIT_FAILURE);
 	}
+	/* The sessions are timed by the monotonic clock, the wall clock is read here once.  */
+	if(server_clock_init() != 0 || timer_wheel_init(&server_timers) != 0){
+		perror("main_server:main:timer_wheel_init");
+		exit(EXIT_FAILURE);
+	}
+
 	/* Creatig a thread that updates the database.  */
 	if(pthread_create(&db_upd_thr, NULL, db_update,(void *)client) == -1){
 		perror("pthread_create db_thread");
@@ -92,16 +118,41 @@ int main(void){
 	/*The mutex is created here so if there is an error in the code above I wouldnt need to close it every time*/
 	pthread_mutex_init(&mutex, NULL);
 
-	for(int i = 0; i <= SERVER_MAX_NUM_CLIENTS; ++i){
+	/* Creatig a thread that publishes new tariff versions and reprices the active sessions.  */
+	if(pthread_create(&reprice_thr, NULL, tariff_reprice,(void *)client) != 0){
+		perror("pthread_create reprice_thread");
+	}
+
+	/* Creatig a thread that receives the positions and liveness pings of the units over UDP.  */
+	if(pthread_create(&udp_thr, NULL, udp_ingest,NULL) != 0){
+		perror("pthread_create udp_thread");
+	}
+
+	/*Connections are given free slots, a gateway takes more of them for the sessions of its units*/
+	session_table_init(client, SERVER_MAX_NUM_CLIENTS);
+
+	for(int i = 0; i < SERVER_MAX_NUM_CLIENTS; ++i){
+		struct pango_data *slot;
 
 		/*Waiting for a request from a client to connect to the server*/
-		if((client[i].client_fd = accept(server_sockfd, (struct sockaddr*)&client_addr, &client_addr_len)) == -1){
+		if((client_sockfd = accept(server_sockfd, (struct sockaddr*)&client_addr, &client_addr_len)) == -1){
 			perror("accept");
+			continue;
+		}
+
+		/*A dead unit is found within seconds, even one that sends no heartbeats*/
+		tune_client_socket(client_sockfd);
+
+		if((slot = session_acquire(client_sockfd)) == NULL){
+			puts("SERVER: no free client slot");
+			close(client_sockfd);
+			continue;
 		}
 
 		/*Allocating a thread to every new client*/
-		if(pthread_create(&thread[i], NULL, pango_client, (void *)&client[i]) == -1){
+		if(pthread_create(&thread[i], NULL, pango_client, (void *)slot) != 0){
 			perror("pthread_create");
+			session_release(slot);
 			close(client_sockfd);
 		}
 	}
@@ -115,11 +166,20 @@ int main(void){
 	
 	/*Changing the value so the db_upd_thr thread updates and stores the clients data in the Data Base and exits it thread*/
 	return_thread = RETURN_THE_DATABASE_UPDATE_THREAD;
+	timer_wheel_wake(&server_timers);
 
 	if(pthread_join(db_upd_thr, NULL) == -1){
 		perror("pthread_join:");
 	}
 
+	if(pthread_join(reprice_thr, NULL) != 0){
+		perror("pthread_join: reprice_thr");
+	}
+
+	if(pthread_join(udp_thr, NULL) != 0){
+		perror("pthread_join: udp_thr");
+	}
+
 	if(close(server_sockfd) == -1){ 
 		perror("close server_sockfd");
 	}
@@ -134,6 +194,8 @@ int main(void){
         perror("main_server:main:sqlite3_close(db_client)");
     }
 
+	tariff_rcu_destroy();
+	timer_wheel_destroy(&server_timers);
 	pthread_mutex_destroy(&mutex);
 	puts("Server quits");
 
@@ -17,6 +17,13 @@
 #include <stdint.h>
 #include "client/client_thread.h"
 #include "database/parking_time_db/db_update_thread.h"
+#include "database/schema/database_schema.h"
+#include "database/price_db/tariff_loader.h"
+#include "tariff/tariff_rcu.h"
+#include "tariff/tariff_reprice.h"
+#include "udp/udp_ingest.h"
+#include "timer/timer_wheel.h"
+#include "clock/server_clock.h"
 
 #ifndef COMMON_DEFINES
 #define COMMON_DEFINES
@@ -45,20 +52,26 @@ extern volatile uint8_t return_thread;
 
 #ifndef STRUCT_PANGO_DATA
 #define STRUCT_PANGO_DATA
-#pragma pack(push, 1)
 struct pango_data
 {
 	uint8_t status; /*A flag that indicates if the application has started or ended*/
 	char mac_address[MAC_ADDRESS_SIZE];
+	uint64_t mac_key; /*The MAC address as a number, mac_address is formatted only when it changes*/
 	uint8_t x_axis;
 	uint8_t y_axis;
 	uint8_t client_fd;
-	char location[12]; /*Where the clients location name will be stored*/
+	struct protocol_connection *connection; /*Framing of the connection, see protocol.h*/
+	uint16_t zone_id; /*Interned id of the zone (city) the client parked in*/
 	double price;
-	int time_start_parking;	  /*The time the client started to use the application*/
+	uint64_t start_parking_ns; /*Monotonic time the client started to use the application, see server_clock.h*/
 	volatile uint8_t connected; /*Indecates if the client is currently connecnted to the server and counting time*/
+	uint32_t tariff_version; /*Version of the tariffs the session is priced under*/
+	uint64_t priced_from_ns; /*Monotonic start of the part of the session that is not in the charge yet*/
+	int64_t charge;			 /*Charge, in minor units, of the session before priced_from_ns*/
+	volatile uint8_t pricing_seq; /*Odd while the repricing thread changes the three fields above, which are accessed with __atomic builtins*/
+	volatile uint8_t in_use; /*The slot belongs to a connection thread, see session_acquire*/
+	volatile uint64_t last_seen_ns; /*Coarse monotonic time of the last event or datagram of the unit, stored with __atomic_store_n*/
 };
-#pragma pack(pop)
 #endif /*STRUCT_PANGO_DATA*/
 
 
@@ -0,0 +1,637 @@
+/**
+ * @file    protocol.c
+ * @author  Vlad Kulikov
+ * @date    2026-10-18
+ * @brief   Implementation of the BBB <-> server wire protocol.
+ */
+#include "protocol.h"
+
+/**
+ * @brief Read a 16 bit field in the byte order of the frame.
+ */
+static uint16_t protocol_get_u16(const uint8_t *buff, uint8_t flags)
+{
+    if (flags & PROTOCOL_FLAG_BIG_ENDIAN)
+    {
+        return (uint16_t)((buff[0] << 8) | buff[1]);
+    }
+    return (uint16_t)(buff[0] | (buff[1] << 8));
+}
+
+/**
+ * @brief Read a 32 bit field in the byte order of the frame.
+ */
+static uint32_t protocol_get_u32(const uint8_t *buff, uint8_t flags)
+{
+    if (flags & PROTOCOL_FLAG_BIG_ENDIAN)
+    {
+        return ((uint32_t)protocol_get_u16(buff, flags) << 16) | protocol_get_u16(buff + 2, flags);
+    }
+    return protocol_get_u16(buff, flags) | ((uint32_t)protocol_get_u16(buff + 2, flags) << 16);
+}
+
+/**
+ * @brief Write a little-endian field of 'size' bytes.
+ */
+static void protocol_put_le(uint8_t *buff, uint64_t value, uint8_t size)
+{
+    for (uint8_t i = 0; i < size; ++i)
+    {
+        buff[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+/**
+ * @brief Bytes received and not consumed yet.
+ */
+static uint32_t protocol_buffered(const struct protocol_connection *connection)
+{
+    return connection->head - connection->tail;
+}
+
+/**
+ * @brief Receive until at least 'size' bytes are buffered.
+ *
+ * Every recv takes all the free space of the ring, both parts of it when
+ * it wraps, so frames that arrive together cost one system call.
+ *
+ * @return PROTOCOL_OK, PROTOCOL_CLOSED, PROTOCOL_TIMEOUT or PROTOCOL_ERROR.
+ */
+static uint8_t protocol_fill(struct protocol_connection *connection, uint32_t size)
+{
+    while (protocol_buffered(connection) < size)
+    {
+        uint32_t start = connection->head & (PROTOCOL_RING_SIZE - 1);
+        uint32_t free_space = PROTOCOL_RING_SIZE - protocol_buffered(connection);
+        uint32_t first = (free_space < PROTOCOL_RING_SIZE - start) ? free_space : PROTOCOL_RING_SIZE - start;
+        struct iovec iov[2] = {{&connection->ring[start], first}, {connection->ring, free_space - first}};
+        struct msghdr msg = {0};
+        ssize_t n;
+
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (free_space > first) ? 2 : 1;
+        n = recvmsg(connection->fd, &msg, 0);
+        if (n == 0)
+        {
+            /* The idle timer shuts the read side down, the peer didn't close anything.  */
+            return (connection->timed_out) ? PROTOCOL_TIMEOUT : PROTOCOL_CLOSED;
+        }
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            /* The keepalive or the user timeout of TCP gave up on the peer.  */
+            if (errno == ETIMEDOUT)
+            {
+                return PROTOCOL_TIMEOUT;
+            }
+            perror("protocol_fill: recvmsg");
+            return PROTOCOL_ERROR;
+        }
+        connection->head += (uint32_t)n;
+        connection->last_receive_ns = server_clock_coarse_ns();
+    }
+    return PROTOCOL_OK;
+}
+
+/**
+ * @brief Get 'size' buffered bytes as one contiguous block, without consuming them.
+ *
+ * The block is parsed in place in the ring; only a block that wraps around
+ * the end of the ring is copied out, into 'wrapped', so 'size' must not be
+ * above PROTOCOL_MAX_FRAME_SIZE. Valid until the next fill.
+ *
+ * @return Pointer to the block.
+ */
+static const uint8_t *protocol_peek(struct protocol_connection *connection, uint32_t size)
+{
+    uint32_t start = connection->tail & (PROTOCOL_RING_SIZE - 1);
+    uint32_t first = PROTOCOL_RING_SIZE - start;
+
+    if (size <= first)
+    {
+        return &connection->ring[start];
+    }
+    memcpy(connection->wrapped, &connection->ring[start], first);
+    memcpy(connection->wrapped + first, connection->ring, size - first);
+    return connection->wrapped;
+}
+
+/**
+ * @brief Send a whole buffer.
+ *
+ * @return PROTOCOL_OK or PROTOCOL_ERROR.
+ */
+static uint8_t protocol_send_all(int fd, const uint8_t *buff, size_t size)
+{
+    size_t sent = 0;
+
+    while (sent < size)
+    {
+        ssize_t n = send(fd, buff + sent, size - sent, MSG_NOSIGNAL);
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("protocol_send_all: send");
+            return PROTOCOL_ERROR;
+        }
+        sent += (size_t)n;
+    }
+    return PROTOCOL_OK;
+}
+
+/**
+ * @brief Receive the payload of a HISTORY frame into its own buffer.
+ *
+ * The part already in the ring is copied out, the rest is received straight
+ * into the buffer: a frame of thousands of records doesn't fit the ring.
+ *
+ * @return PROTOCOL_OK, PROTOCOL_CLOSED, PROTOCOL_TIMEOUT or PROTOCOL_ERROR.
+ */
+static uint8_t protocol_receive_history(struct protocol_connection *connection, uint16_t length)
+{
+    uint32_t buffered = protocol_buffered(connection), received, start, first;
+
+    if (connection->history == NULL &&
+        (connection->history = malloc(PROTOCOL_MAX_HISTORY * PROTOCOL_HISTORY_RECORD_SIZE)) == NULL)
+    {
+        perror("protocol_receive_history: malloc");
+        return PROTOCOL_ERROR;
+    }
+    /* The part in the ring may be larger than 'wrapped', so it is copied without protocol_peek.  */
+    received = (buffered < length) ? buffered : length;
+    start = connection->tail & (PROTOCOL_RING_SIZE - 1);
+    first = PROTOCOL_RING_SIZE - start;
+    if (received <= first)
+    {
+        memcpy(connection->history, &connection->ring[start], received);
+    }
+    else
+    {
+        memcpy(connection->history, &connection->ring[start], first);
+        memcpy(connection->history + first, connection->ring, received - first);
+    }
+    connection->tail += received;
+
+    while (received < length)
+    {
+        ssize_t n = recv(connection->fd, connection->history + received, length - received, 0);
+
+        if (n == 0)
+        {
+            return (connection->timed_out) ? PROTOCOL_TIMEOUT : PROTOCOL_CLOSED;
+        }
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == ETIMEDOUT)
+            {
+                return PROTOCOL_TIMEOUT;
+            }
+            perror("protocol_receive_history: recv");
+            return PROTOCOL_ERROR;
+        }
+        received += (uint32_t)n;
+        connection->last_receive_ns = server_clock_coarse_ns();
+    }
+    connection->history_count = length / PROTOCOL_HISTORY_RECORD_SIZE;
+    return PROTOCOL_OK;
+}
+
+/**
+ * @brief Receive the next v2 EVENTS frame into the ring.
+ *
+ * A HISTORY frame is received into 'history' instead, see protocol_receive_history.
+ *
+ * @return PROTOCOL_OK, PROTOCOL_HISTORY, PROTOCOL_CLOSED, PROTOCOL_TIMEOUT or PROTOCOL_ERROR.
+ */
+static uint8_t protocol_receive_frame(struct protocol_connection *connection)
+{
+    const uint8_t *header;
+    uint8_t result = protocol_fill(connection, PROTOCOL_HEADER_SIZE);
+    uint16_t length;
+
+    if (result != PROTOCOL_OK)
+    {
+        return result;
+    }
+    header = protocol_peek(connection, PROTOCOL_HEADER_SIZE);
+
+    /* A corrupted header leaves no way to find the next frame, so the connection is dropped.  */
+    if (header[0] != PROTOCOL_V2_MAGIC || header[1] != PROTOCOL_V2 ||
+        header[PROTOCOL_HEADER_CRC_OFFSET] != crc8_compute(header, PROTOCOL_HEADER_CRC_OFFSET))
+    {
+        fprintf(stderr, "protocol_receive_frame: bad header\n");
+        return PROTOCOL_ERROR;
+    }
+    length = protocol_get_u16(&header[8], header[3]);
+    if (header[2] == PROTOCOL_TYPE_HISTORY && header[10] == 0 && length != 0 &&
+        length % PROTOCOL_HISTORY_RECORD_SIZE == 0 && length / PROTOCOL_HISTORY_RECORD_SIZE <= PROTOCOL_MAX_HISTORY)
+    {
+        connection->seq = protocol_get_u32(&header[4], header[3]);
+        connection->event_index = 0;
+        connection->history_flags = header[3];
+        if (header[3] & PROTOCOL_FLAG_GATEWAY)
+        {
+            connection->gateway = 1;
+        }
+        if (header[3] & PROTOCOL_FLAG_SNAPSHOT)
+        {
+            connection->snapshot = 1;
+        }
+        connection->tail += PROTOCOL_HEADER_SIZE;
+        result = protocol_receive_history(connection, length);
+        return (result == PROTOCOL_OK) ? PROTOCOL_HISTORY : result;
+    }
+    if (header[2] != PROTOCOL_TYPE_EVENTS || header[10] > PROTOCOL_MAX_EVENTS ||
+        length != header[10] * PROTOCOL_EVENT_SIZE)
+    {
+        fprintf(stderr, "protocol_receive_frame: bad frame type %u, %u events in %u bytes\n",
+                header[2], header[10], length);
+        return PROTOCOL_ERROR;
+    }
+
+    result = protocol_fill(connection, PROTOCOL_HEADER_SIZE + length);
+    if (result != PROTOCOL_OK)
+    {
+        return result;
+    }
+    /* The fill may have moved a wrapped header, so the frame is peeked again as a whole.  */
+    header = protocol_peek(connection, PROTOCOL_HEADER_SIZE + length);
+    connection->seq = protocol_get_u32(&header[4], header[3]);
+    if (header[3] & PROTOCOL_FLAG_GATEWAY)
+    {
+        connection->gateway = 1;
+    }
+    if (header[3] & PROTOCOL_FLAG_SNAPSHOT)
+    {
+        connection->snapshot = 1;
+    }
+    if (header[3] & PROTOCOL_FLAG_UDP_KEY)
+    {
+        connection->udp_key = 1;
+    }
+    connection->events = header + PROTOCOL_HEADER_SIZE;
+    connection->frame_size = PROTOCOL_HEADER_SIZE + length;
+    connection->event_count = header[10];
+    connection->next_event = 0;
+    return PROTOCOL_OK;
+}
+
+/**
+ * @brief Send a v2 REPLY frame with one record, answering the current event.
+ *
+ * @return PROTOCOL_OK or PROTOCOL_ERROR.
+ */
+static uint8_t protocol_send_record(struct protocol_connection *connection, uint8_t status,
+                                    const uint8_t *data, uint8_t data_size)
+{
+    uint8_t frame[PROTOCOL_HEADER_SIZE + PROTOCOL_RECORD_HEADER_SIZE + UINT8_MAX];
+    uint16_t length = PROTOCOL_RECORD_HEADER_SIZE + data_size;
+
+    frame[0] = PROTOCOL_V2_MAGIC;
+    frame[1] = PROTOCOL_V2;
+    frame[2] = PROTOCOL_TYPE_REPLY;
+    frame[3] = 0;
+    protocol_put_le(&frame[4], connection->seq, 4);
+    protocol_put_le(&frame[8], length, 2);
+    frame[10] = 1;
+    frame[PROTOCOL_HEADER_CRC_OFFSET] = crc8_compute(frame, PROTOCOL_HEADER_CRC_OFFSET);
+
+    frame[PROTOCOL_HEADER_SIZE] = status;
+    frame[PROTOCOL_HEADER_SIZE + 1] = connection->event_index;
+    frame[PROTOCOL_HEADER_SIZE + 2] = data_size;
+    if (data_size > 0)
+    {
+        memcpy(&frame[PROTOCOL_HEADER_SIZE + PROTOCOL_RECORD_HEADER_SIZE], data, data_size);
+    }
+
+    return protocol_send_all(connection->fd, frame, PROTOCOL_HEADER_SIZE + length);
+}
+
+/**
+ * @brief Timer callback of the idle timeout of a connection.
+ *
+ * The timer isn't moved on every receive: when it expires it checks the
+ * time of the last receive, and is added again for the rest of the timeout
+ * when the connection wasn't silent long enough.
+ */
+static void protocol_idle_expired(struct timer_entry *entry, void *connection_arg)
+{
+    struct protocol_connection *connection = (struct protocol_connection *)connection_arg;
+    uint64_t idle_ms = (uint64_t)connection->idle_timeout * 1000;
+    uint64_t silent_ms = (server_clock_coarse_ns() - connection->last_receive_ns) / SERVER_CLOCK_NS_PER_MS;
+
+    if (idle_ms == 0)
+    {
+        return;
+    }
+    if (silent_ms < idle_ms)
+    {
+        timer_wheel_add(&server_timers, entry, idle_ms - silent_ms);
+        return;
+    }
+    connection->timed_out = 1;
+    /* Wakes the receive of the connection thread, which returns PROTOCOL_TIMEOUT.  */
+    if (shutdown(connection->fd, SHUT_RD) == -1)
+    {
+        perror("protocol_idle_expired: shutdown");
+    }
+}
+
+/**
+ * @brief Initialize the protocol state of a new connection.
+ *
+ * @param connection Pointer to the state.
+ * @param fd The socket of the connection.
+ */
+void protocol_connection_init(struct protocol_connection *connection, int fd)
+{
+    memset(connection, 0, sizeof(*connection));
+    connection->fd = fd;
+    connection->last_receive_ns = server_clock_coarse_ns();
+    timer_entry_init(&connection->idle_timer, protocol_idle_expired, connection);
+}
+
+/**
+ * @brief Release the protocol state of a connection, before its memory is.
+ *
+ * @param connection Pointer to the state.
+ */
+void protocol_connection_release(struct protocol_connection *connection)
+{
+    /* Waits for the timer if it runs now, it must not shut down a socket the fd is reused for.  */
+    timer_wheel_cancel(&server_timers, &connection->idle_timer);
+    free(connection->history);
+    connection->history = NULL;
+}
+
+/**
+ * @brief Receive the next event, in either version.
+ *
+ * The event is parsed in place in the receive ring of the connection.
+ * The events of a v2 frame are returned one by one before the next frame is read.
+ *
+ * A HISTORY frame is returned as PROTOCOL_HISTORY, its records are in 'history'
+ * until the next call.
+ *
+ * @param connection Pointer to the state.
+ * @param event Pointer to the PROTOCOL_EVENT_SIZE bytes of the event, valid until the next call (output parameter).
+ * @return PROTOCOL_OK, PROTOCOL_HISTORY, PROTOCOL_CLOSED, PROTOCOL_TIMEOUT or PROTOCOL_ERROR.
+ */
+uint8_t protocol_receive_event(struct protocol_connection *connection, const uint8_t **event)
+{
+    uint8_t result;
+
+    /* The first byte tells the version, it is left in the ring for the parsing below.  */
+    if (connection->version == 0)
+    {
+        result = protocol_fill(connection, 1);
+        if (result != PROTOCOL_OK)
+        {
+            return result;
+        }
+        connection->version = (connection->ring[connection->tail & (PROTOCOL_RING_SIZE - 1)] == PROTOCOL_V2_MAGIC)
+                                  ? PROTOCOL_V2
+                                  : PROTOCOL_V1;
+        printf("Client %d speaks protocol v%u\n", connection->fd, connection->version);
+    }
+
+    if (connection->version == PROTOCOL_V1)
+    {
+        result = protocol_fill(connection, PROTOCOL_EVENT_SIZE);
+        if (result != PROTOCOL_OK)
+        {
+            return result;
+        }
+        *event = protocol_peek(connection, PROTOCOL_EVENT_SIZE);
+        connection->tail += PROTOCOL_EVENT_SIZE;
+        return PROTOCOL_OK;
+    }
+
+    /* The frame stays in the ring until its last event is handled.
+       A frame may carry no events at all.  */
+    while (connection->next_event >= connection->event_count)
+    {
+        connection->tail += connection->frame_size;
+        connection->frame_size = 0;
+        connection->event_count = 0;
+        result = protocol_receive_frame(connection);
+        if (result != PROTOCOL_OK)
+        {
+            return result;
+        }
+    }
+    connection->event_index = connection->next_event++;
+    *event = &connection->events[connection->event_index * PROTOCOL_EVENT_SIZE];
+    return PROTOCOL_OK;
+}
+
+/**
+ * @brief Parse the MAC address of an event into a key.
+ *
+ * @param event The event.
+ * @return The 48 bits of the MAC address, the first byte the most significant.
+ */
+uint64_t protocol_event_mac_key(const uint8_t *event)
+{
+    uint64_t key = 0;
+
+    for (uint8_t i = 0; i < PROTOCOL_MAC_SIZE; ++i)
+    {
+        key = (key << 8) | event[PROTOCOL_EVENT_MAC_OFFSET + i];
+    }
+    return key;
+}
+
+/**
+ * @brief Answer the current event with the location of the client.
+ *
+ * @param connection Pointer to the state.
+ * @param zone_id The zone id.
+ * @param name Name of the zone, PROTOCOL_LOCATION_SIZE bytes.
+ * @param udp_key The PROTOCOL_UDP_KEY_SIZE bytes of the UDP key of the session,
+ *        NULL when the connection didn't ask for one.
+ * @return PROTOCOL_OK or PROTOCOL_ERROR.
+ */
+uint8_t protocol_send_location(struct protocol_connection *connection, uint16_t zone_id, const char *name,
+                               const uint8_t *udp_key)
+{
+    uint8_t data[2 + PROTOCOL_LOCATION_SIZE + PROTOCOL_UDP_KEY_SIZE];
+
+    if (connection->version != PROTOCOL_V2)
+    {
+        return protocol_send_all(connection->fd, (const uint8_t *)name, PROTOCOL_LOCATION_SIZE);
+    }
+    protocol_put_le(data, zone_id, 2);
+    memcpy(&data[2], name, PROTOCOL_LOCATION_SIZE);
+    if (udp_key == NULL)
+    {
+        return protocol_send_record(connection, PROTOCOL_STATUS_START, data, 2 + PROTOCOL_LOCATION_SIZE);
+    }
+    memcpy(&data[2 + PROTOCOL_LOCATION_SIZE], udp_key, PROTOCOL_UDP_KEY_SIZE);
+    return protocol_send_record(connection, PROTOCOL_STATUS_START, data, sizeof(data));
+}
+
+/**
+ * @brief Answer the current event with an amount, the payment or a quote.
+ *
+ * @param connection Pointer to the state.
+ * @param status The status of the event that is answered.
+ * @param charge The amount in minor units.
+ * @param seconds The time parked.
+ * @return PROTOCOL_OK or PROTOCOL_ERROR.
+ */
+uint8_t protocol_send_amount(struct protocol_connection *connection, uint8_t status, int64_t charge, int64_t seconds)
+{
+    uint8_t data[2 * sizeof(int64_t)];
+
+    /* v1 units expect shekels and seconds as doubles in the order of the host.  */
+    if (connection->version != PROTOCOL_V2)
+    {
+        double pay[2] = {(double)charge / PROTOCOL_MINOR_UNITS_PER_MAJOR, (double)seconds};
+        return protocol_send_all(connection->fd, (const uint8_t *)pay, sizeof(pay));
+    }
+    protocol_put_le(data, (uint64_t)charge, sizeof(int64_t));
+    protocol_put_le(&data[sizeof(int64_t)], (uint64_t)seconds, sizeof(int64_t));
+    return protocol_send_record(connection, status, data, sizeof(data));
+}
+
+/**
+ * @brief Answer the current event with an error.
+ *
+ * @param connection Pointer to the state.
+ * @param error The error status.
+ * @return PROTOCOL_OK or PROTOCOL_ERROR.
+ */
+uint8_t protocol_send_error(struct protocol_connection *connection, uint8_t error)
+{
+    const char err_msg[] = "ERROR";
+
+    if (connection->version != PROTOCOL_V2)
+    {
+        return protocol_send_all(connection->fd, (const uint8_t *)err_msg, sizeof(err_msg) - 1);
+    }
+    return protocol_send_record(connection, error, NULL, 0);
+}
+
+/**
+ * @brief Acknowledge the current event, a record without data.
+ *
+ * v1 has no acknowledgments, so nothing is sent on a v1 connection.
+ *
+ * @param connection Pointer to the state.
+ * @param status The status of the event that is acknowledged.
+ * @return PROTOCOL_OK or PROTOCOL_ERROR.
+ */
+uint8_t protocol_send_ack(struct protocol_connection *connection, uint8_t status)
+{
+    if (connection->version != PROTOCOL_V2)
+    {
+        return PROTOCOL_OK;
+    }
+    return protocol_send_record(connection, status, NULL, 0);
+}
+
+/**
+ * @brief Parse the seq and the age of a record of the last HISTORY frame.
+ *
+ * @param connection Pointer to the state.
+ * @param record The record, in 'history'.
+ * @param seq Pointer to store the seq of the event in the store of the BBB (output parameter).
+ * @param age_s Pointer to store the seconds from the event to the send of the frame (output parameter).
+ */
+void protocol_history_fields(const struct protocol_connection *connection, const uint8_t *record,
+                             uint32_t *seq, uint32_t *age_s)
+{
+    *seq = protocol_get_u32(&record[PROTOCOL_HISTORY_SEQ_OFFSET], connection->history_flags);
+    *age_s = protocol_get_u32(&record[PROTOCOL_HISTORY_AGE_OFFSET], connection->history_flags);
+}
+
+/**
+ * @brief Answer the last HISTORY frame.
+ *
+ * @param connection Pointer to the state.
+ * @param status PROTOCOL_HISTORY_OK, or the error that left the frame unapplied.
+ * @param next The seq after the last record applied, the BBB drops the records before it.
+ * @param applied Records applied.
+ * @param duplicates Records that were applied already, or whose session the server has already.
+ * @param rejected Records that failed their CRC-8 or fit no session.
+ * @return PROTOCOL_OK or PROTOCOL_ERROR.
+ */
+uint8_t protocol_send_history_result(struct protocol_connection *connection, uint8_t status, uint32_t next,
+                                     uint16_t applied, uint16_t duplicates, uint16_t rejected)
+{
+    uint8_t data[PROTOCOL_HISTORY_DATA_SIZE];
+
+    protocol_put_le(data, next, 4);
+    protocol_put_le(&data[4], applied, 2);
+    protocol_put_le(&data[6], duplicates, 2);
+    protocol_put_le(&data[8], rejected, 2);
+    return protocol_send_record(connection, status, data, sizeof(data));
+}
+
+/**
+ * @brief Send a SNAPSHOT frame, which answers no event.
+ *
+ * @param connection Pointer to the state.
+ * @param snapshot The payload, its CRC-8 included, see tariff_snapshot_encode.
+ * @param size Size of the payload, up to PROTOCOL_MAX_SNAPSHOT.
+ * @return PROTOCOL_OK or PROTOCOL_ERROR.
+ */
+uint8_t protocol_send_snapshot(struct protocol_connection *connection, const uint8_t *snapshot, uint16_t size)
+{
+    uint8_t frame[PROTOCOL_HEADER_SIZE + PROTOCOL_MAX_SNAPSHOT];
+
+    if (connection->version != PROTOCOL_V2 || size == 0 || size > PROTOCOL_MAX_SNAPSHOT)
+    {
+        return PROTOCOL_ERROR;
+    }
+    frame[0] = PROTOCOL_V2_MAGIC;
+    frame[1] = PROTOCOL_V2;
+    frame[2] = PROTOCOL_TYPE_SNAPSHOT;
+    frame[3] = 0;
+    protocol_put_le(&frame[4], 0, 4);
+    protocol_put_le(&frame[8], size, 2);
+    frame[10] = 0;
+    frame[PROTOCOL_HEADER_CRC_OFFSET] = crc8_compute(frame, PROTOCOL_HEADER_CRC_OFFSET);
+    memcpy(&frame[PROTOCOL_HEADER_SIZE], snapshot, size);
+
+    return protocol_send_all(connection->fd, frame, PROTOCOL_HEADER_SIZE + size);
+}
+
+/**
+ * @brief Give up on the peer when it sends nothing for a while.
+ *
+ * The next receive returns PROTOCOL_TIMEOUT after 'seconds' of silence.
+ *
+ * @param connection Pointer to the state.
+ * @param seconds Longest silence, 0 to wait forever.
+ * @return PROTOCOL_OK or PROTOCOL_ERROR.
+ */
+uint8_t protocol_set_idle_timeout(struct protocol_connection *connection, uint32_t seconds)
+{
+    if (connection->idle_timeout == seconds)
+    {
+        return PROTOCOL_OK;
+    }
+    connection->idle_timeout = seconds;
+    if (seconds == 0)
+    {
+        timer_wheel_cancel(&server_timers, &connection->idle_timer);
+    }
+    else
+    {
+        timer_wheel_add(&server_timers, &connection->idle_timer, (uint64_t)seconds * 1000);
+    }
+    return PROTOCOL_OK;
+}
@@ -0,0 +1,286 @@
+/**
+ * @file 	protocol.h
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-18
+ * @brief 	Header file containing declarations for the BBB <-> server wire protocol.
+ *
+ * Version 1 is a bare 10 byte event (status, MAC x6, x, y, CRC-8) per request,
+ * answered by a raw 12 byte location name, a raw double[2] payment in host order or "ERROR".
+ *
+ * Version 2 frames the events:
+ *	 ______________________________________________________________________
+ *	| magic | version | type | flags | seq      | length   | count | crc8 |
+ *	|   1   |    1    |  1   |   1   | 4        | 2        |   1   |  1   |
+ *	|_______|_________|______|_______|__________|__________|_______|______|
+ * followed by 'length' bytes of payload. The CRC-8 covers the first 11 bytes.
+ * An EVENTS frame carries 'count' v1 events, each with its own CRC-8.
+ * A REPLY frame carries 'count' records: status, index of the event in the
+ * request frame, data length and data, and has the seq of the request frame.
+ * The BBB may send more frames before the replies come, and matches the
+ * replies to its requests by the seq and index only, so they may come in any order.
+ * Multi-byte fields are little-endian, unless the sender sets PROTOCOL_FLAG_BIG_ENDIAN;
+ * they are encoded byte by byte, so the order of the host never matters.
+ * A BBB may send heartbeats, events that belong to no session and are answered
+ * by a record without data; once they come, a silent connection is given up.
+ * A BBB in gateway mode sets PROTOCOL_FLAG_GATEWAY: its connection is persistent
+ * and carries the sessions of several units, told apart by the MAC of each event.
+ * A HISTORY frame carries up to PROTOCOL_MAX_HISTORY events stored by a BBB
+ * while the server couldn't be reached, more than the count field holds, so
+ * the count is 0 and the records are 'length' / PROTOCOL_HISTORY_RECORD_SIZE:
+ * the event, the u32 seq of the event in the store of the BBB, the u32 seconds
+ * from the event to the send of the frame and a CRC-8 over the first 18 bytes.
+ * It is received whole into its own buffer, not the ring, and answered by one
+ * record of PROTOCOL_HISTORY_DATA_SIZE, see protocol_send_history_result.
+ * A BBB that sets PROTOCOL_FLAG_SNAPSHOT is sent a SNAPSHOT frame, count 0 and
+ * seq 0, with the zone index and the tariffs, see tariff_snapshot.h, so it
+ * shows the city and the rate without a round trip. It is sent before the
+ * reply to the first frame, and again before the next reply once the tariff
+ * version changed. The payload ends with its own CRC-8.
+ * A BBB that sets PROTOCOL_FLAG_UDP_KEY is sent the key of the UDP datagrams of
+ * a unit, PROTOCOL_UDP_KEY_SIZE bytes after the location in the reply to its
+ * start, see udp_ingest.h. The key is good until the session of the unit ends.
+ *
+ * The version is negotiated by the first byte of the connection: the v2 magic
+ * is never a v1 status, so old units keep working unchanged.
+ */
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/time.h>
+#include "../../common/crc8/crc8.h"
+#include "../timer/timer_wheel.h"
+#include "../clock/server_clock.h"
+
+#define PROTOCOL_V1 1
+#define PROTOCOL_V2 2
+#define PROTOCOL_V2_MAGIC 0xA5
+#define PROTOCOL_HEADER_SIZE 12
+#define PROTOCOL_HEADER_CRC_OFFSET 11
+/* A v1 event, which is also the record of a v2 EVENTS frame.  */
+#define PROTOCOL_EVENT_SIZE 10
+#define PROTOCOL_EVENT_CRC_OFFSET 9
+#define PROTOCOL_MAX_EVENTS 64
+#define PROTOCOL_MAX_PAYLOAD (PROTOCOL_MAX_EVENTS * PROTOCOL_EVENT_SIZE)
+#define PROTOCOL_MAX_FRAME_SIZE (PROTOCOL_HEADER_SIZE + PROTOCOL_MAX_PAYLOAD)
+#define PROTOCOL_EVENT_MAC_OFFSET 1
+#define PROTOCOL_MAC_SIZE 6
+/* Receive ring of a connection, a power of two that holds the largest frame.  */
+#define PROTOCOL_RING_SIZE 2048
+/* Status, index and length of a reply record.  */
+#define PROTOCOL_RECORD_HEADER_SIZE 3
+#define PROTOCOL_LOCATION_SIZE 12
+/* Status of the event that starts a session, its reply carries the location.  */
+#define PROTOCOL_STATUS_START 1
+#define PROTOCOL_FLAG_BIG_ENDIAN 0x01
+#define PROTOCOL_FLAG_GATEWAY 0x02
+#define PROTOCOL_FLAG_SNAPSHOT 0x04
+#define PROTOCOL_FLAG_UDP_KEY 0x08
+/* The key of the UDP datagrams of a unit, a SipHash-2-4 key.  */
+#define PROTOCOL_UDP_KEY_SIZE 16
+/* The largest SNAPSHOT payload, the BBB receives it into a buffer of this size.  */
+#define PROTOCOL_MAX_SNAPSHOT 4096
+/* The records of a HISTORY frame.  */
+#define PROTOCOL_HISTORY_RECORD_SIZE 19
+#define PROTOCOL_HISTORY_SEQ_OFFSET PROTOCOL_EVENT_SIZE
+#define PROTOCOL_HISTORY_AGE_OFFSET (PROTOCOL_EVENT_SIZE + 4)
+#define PROTOCOL_HISTORY_CRC_OFFSET 18
+#define PROTOCOL_MAX_HISTORY 3072
+#define PROTOCOL_HISTORY_DATA_SIZE 10
+/* Status of the reply to a HISTORY frame that was applied.  */
+#define PROTOCOL_HISTORY_OK 0
+/* Minor currency units in one major unit, v1 sends the amounts in shekels.  */
+#define PROTOCOL_MINOR_UNITS_PER_MAJOR 100
+
+#ifndef PROTOCOL_TYPE
+#define PROTOCOL_TYPE
+enum protocol_type
+{
+	PROTOCOL_TYPE_EVENTS = 1, /*BBB to server*/
+	PROTOCOL_TYPE_REPLY = 2,  /*Server to BBB*/
+	PROTOCOL_TYPE_HISTORY = 3, /*BBB to server, the events it stored while offline*/
+	PROTOCOL_TYPE_SNAPSHOT = 4, /*Server to BBB, the zone index and the tariffs*/
+};
+#endif /*PROTOCOL_TYPE*/
+
+#ifndef PROTOCOL_RESULT
+#define PROTOCOL_RESULT
+enum protocol_result
+{
+	PROTOCOL_OK = 0,
+	PROTOCOL_CLOSED = 1, /*The peer closed the connection*/
+	PROTOCOL_ERROR = 2,	 /*A socket error or a frame that can't be parsed*/
+	PROTOCOL_TIMEOUT = 3, /*The peer was silent past the idle timeout, or TCP gave up on it*/
+	PROTOCOL_HISTORY = 4, /*A HISTORY frame was received instead of an event*/
+};
+#endif /*PROTOCOL_RESULT*/
+
+/**
+ * @brief The protocol state of one connection.
+ */
+struct protocol_connection
+{
+	int fd;
+	uint8_t version;	 /*0 until the first byte is received*/
+	uint8_t gateway;	 /*Set by the first v2 frame with PROTOCOL_FLAG_GATEWAY, never cleared*/
+	uint8_t snapshot;	 /*Set by the first v2 frame with PROTOCOL_FLAG_SNAPSHOT, never cleared*/
+	uint8_t udp_key;	 /*Set by the first v2 EVENTS frame with PROTOCOL_FLAG_UDP_KEY, never cleared*/
+	uint8_t snapshot_sent; /*A SNAPSHOT frame was sent, of the tariff version below*/
+	uint32_t snapshot_version;
+	uint32_t idle_timeout; /*Seconds of silence the connection is given up after, 0 for never*/
+	volatile uint64_t last_receive_ns; /*Coarse monotonic time data was last received, see server_clock.h*/
+	volatile uint8_t timed_out; /*Set by the idle timer before it shuts the connection down*/
+	struct timer_entry idle_timer; /*Checks the silence of the connection on server_timers*/
+	uint32_t seq;		 /*Sequence number of the frame being handled*/
+	uint8_t event_index; /*Index of the event being handled in its frame*/
+	uint8_t event_count; /*Events of the frame*/
+	uint8_t next_event;	 /*Index of the next event to handle*/
+	const uint8_t *events; /*Events of the frame, in the ring or in 'wrapped'*/
+	uint32_t frame_size;   /*Bytes of the frame held in the ring until its last event is handled*/
+	uint32_t head;		   /*Bytes received so far, the ring index is head % PROTOCOL_RING_SIZE*/
+	uint32_t tail;		   /*Bytes consumed so far*/
+	uint8_t ring[PROTOCOL_RING_SIZE];
+	uint8_t wrapped[PROTOCOL_MAX_FRAME_SIZE]; /*A frame that wraps around the end of the ring, made contiguous*/
+	uint8_t *history;	   /*Records of the last HISTORY frame, allocated by the first one*/
+	uint16_t history_count;
+	uint8_t history_flags; /*Flags of the HISTORY frame, the byte order of its records*/
+};
+
+/**
+ * @brief Initialize the protocol state of a new connection.
+ *
+ * @param connection Pointer to the state.
+ * @param fd The socket of the connection.
+ */
+void protocol_connection_init(struct protocol_connection *connection, int fd);
+
+/**
+ * @brief Release the protocol state of a connection, before its memory is.
+ *
+ * @param connection Pointer to the state.
+ */
+void protocol_connection_release(struct protocol_connection *connection);
+
+/**
+ * @brief Receive the next event, in either version.
+ *
+ * The event is parsed in place in the receive ring of the connection.
+ * The events of a v2 frame are returned one by one before the next frame is read.
+ *
+ * A HISTORY frame is returned as PROTOCOL_HISTORY, its records are in 'history'
+ * until the next call.
+ *
+ * @param connection Pointer to the state.
+ * @param event Pointer to the PROTOCOL_EVENT_SIZE bytes of the event, valid until the next call (output parameter).
+ * @return PROTOCOL_OK, PROTOCOL_HISTORY, PROTOCOL_CLOSED, PROTOCOL_TIMEOUT or PROTOCOL_ERROR.
+ */
+uint8_t protocol_receive_event(struct protocol_connection *connection, const uint8_t **event);
+
+/**
+ * @brief Parse the MAC address of an event into a key.
+ *
+ * @param event The event.
+ * @return The 48 bits of the MAC address, the first byte the most significant.
+ */
+uint64_t protocol_event_mac_key(const uint8_t *event);
+
+/**
+ * @brief Answer the current event with the location of the client.
+ *
+ * @param connection Pointer to the state.
+ * @param zone_id The zone id.
+ * @param name Name of the zone, PROTOCOL_LOCATION_SIZE bytes.
+ * @param udp_key The PROTOCOL_UDP_KEY_SIZE bytes of the UDP key of the session,
+ *        NULL when the connection didn't ask for one.
+ * @return PROTOCOL_OK or PROTOCOL_ERROR.
+ */
+uint8_t protocol_send_location(struct protocol_connection *connection, uint16_t zone_id, const char *name,
+							   const uint8_t *udp_key);
+
+/**
+ * @brief Answer the current event with an amount, the payment or a quote.
+ *
+ * @param connection Pointer to the state.
+ * @param status The status of the event that is answered.
+ * @param charge The amount in minor units.
+ * @param seconds The time parked.
+ * @return PROTOCOL_OK or PROTOCOL_ERROR.
+ */
+uint8_t protocol_send_amount(struct protocol_connection *connection, uint8_t status, int64_t charge, int64_t seconds);
+
+/**
+ * @brief Answer the current event with an error.
+ *
+ * @param connection Pointer to the state.
+ * @param error The error status.
+ * @return PROTOCOL_OK or PROTOCOL_ERROR.
+ */
+uint8_t protocol_send_error(struct protocol_connection *connection, uint8_t error);
+
+/**
+ * @brief Acknowledge the current event, a record without data.
+ *
+ * v1 has no acknowledgments, so nothing is sent on a v1 connection.
+ *
+ * @param connection Pointer to the state.
+ * @param status The status of the event that is acknowledged.
+ * @return PROTOCOL_OK or PROTOCOL_ERROR.
+ */
+uint8_t protocol_send_ack(struct protocol_connection *connection, uint8_t status);
+
+/**
+ * @brief Parse the seq and the age of a record of the last HISTORY frame.
+ *
+ * @param connection Pointer to the state.
+ * @param record The record, in 'history'.
+ * @param seq Pointer to store the seq of the event in the store of the BBB (output parameter).
+ * @param age_s Pointer to store the seconds from the event to the send of the frame (output parameter).
+ */
+void protocol_history_fields(const struct protocol_connection *connection, const uint8_t *record,
+							 uint32_t *seq, uint32_t *age_s);
+
+/**
+ * @brief Answer the last HISTORY frame.
+ *
+ * @param connection Pointer to the state.
+ * @param status PROTOCOL_HISTORY_OK, or the error that left the frame unapplied.
+ * @param next The seq after the last record applied, the BBB drops the records before it.
+ * @param applied Records applied.
+ * @param duplicates Records that were applied already, or whose session the server has already.
+ * @param rejected Records that failed their CRC-8 or fit no session.
+ * @return PROTOCOL_OK or PROTOCOL_ERROR.
+ */
+uint8_t protocol_send_history_result(struct protocol_connection *connection, uint8_t status, uint32_t next,
+									 uint16_t applied, uint16_t duplicates, uint16_t rejected);
+
+/**
+ * @brief Send a SNAPSHOT frame, which answers no event.
+ *
+ * @param connection Pointer to the state.
+ * @param snapshot The payload, its CRC-8 included, see tariff_snapshot_encode.
+ * @param size Size of the payload, up to PROTOCOL_MAX_SNAPSHOT.
+ * @return PROTOCOL_OK or PROTOCOL_ERROR.
+ */
+uint8_t protocol_send_snapshot(struct protocol_connection *connection, const uint8_t *snapshot, uint16_t size);
+
+/**
+ * @brief Give up on the peer when it sends nothing for a while.
+ *
+ * The next receive returns PROTOCOL_TIMEOUT after 'seconds' of silence.
+ * The silence is checked by a timer on server_timers, which shuts the read
+ * side of the socket down to wake the receive.
+ *
+ * @param connection Pointer to the state.
+ * @param seconds Longest silence, 0 to wait forever.
+ * @return PROTOCOL_OK or PROTOCOL_ERROR.
+ */
+uint8_t protocol_set_idle_timeout(struct protocol_connection *connection, uint32_t seconds);
+
+#endif /*PROTOCOL_H*/
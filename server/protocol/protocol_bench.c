@@ -0,0 +1,253 @@
+/**
+ * @file    protocol_bench.c
+ * @author  Vlad Kulikov
+ * @date    2026-10-19
+ * @brief   Benchmark of the receive path of the v2 protocol.
+ *
+ * First a HISTORY frame is received whose payload starts 2 bytes before the
+ * end of the receive ring, with the ring full behind it: the frames before it
+ * are written at once, before the receive starts, and sized so each fill of
+ * the ring starts where the one before left it. Then full EVENTS frames, and
+ * a HISTORY frame of PROTOCOL_MAX_HISTORY records every few of them, are sent
+ * by a thread over the socket pair and the receive of their events is timed.
+ * Every event and every record is checked against what was sent.
+ * Built with AddressSanitizer, see the Makefile.
+ *
+ * Usage: ./protocol_bench [rounds]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "protocol.h"
+
+#define BENCH_DEFAULT_ROUNDS 200
+/* Full EVENTS frames before each HISTORY frame of a round.  */
+#define BENCH_FRAMES_PER_ROUND 3
+#define BENCH_HISTORY_PAYLOAD (PROTOCOL_MAX_HISTORY * PROTOCOL_HISTORY_RECORD_SIZE)
+#define BENCH_HISTORY_SIZE (PROTOCOL_HEADER_SIZE + BENCH_HISTORY_PAYLOAD)
+/* The frames written before the receive starts, up to the first HISTORY frame.  */
+#define BENCH_PREFIX_SIZE (2 * PROTOCOL_RING_SIZE + BENCH_HISTORY_SIZE)
+
+struct timer_wheel server_timers;
+
+/**
+ * @brief The frames of the run.
+ */
+struct bench_frames
+{
+    int fd;
+    size_t rounds;
+    uint8_t prefix[BENCH_PREFIX_SIZE];
+    size_t prefix_size;
+    size_t prefix_events;
+    uint8_t round[BENCH_FRAMES_PER_ROUND * PROTOCOL_MAX_FRAME_SIZE + BENCH_HISTORY_SIZE];
+    size_t round_size;
+    uint32_t seq;
+};
+
+/**
+ * @brief Seconds of the monotonic clock.
+ */
+static double bench_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Write a little-endian field.
+ */
+static void bench_put_le(uint8_t *buff, uint32_t value, uint8_t size)
+{
+    for (uint8_t i = 0; i < size; i++)
+    {
+        buff[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+/**
+ * @brief Fill a v2 header.
+ */
+static void bench_header(uint8_t *header, uint8_t type, uint32_t seq, uint16_t length, uint8_t count)
+{
+    header[0] = PROTOCOL_V2_MAGIC;
+    header[1] = PROTOCOL_V2;
+    header[2] = type;
+    header[3] = PROTOCOL_FLAG_GATEWAY;
+    bench_put_le(&header[4], seq, 4);
+    bench_put_le(&header[8], length, 2);
+    header[10] = count;
+    header[PROTOCOL_HEADER_CRC_OFFSET] = crc8_compute(header, PROTOCOL_HEADER_CRC_OFFSET);
+}
+
+/**
+ * @brief The event 'i' of the frame of 'seq', every byte depends on both.
+ */
+static void bench_event(uint8_t *event, uint32_t seq, size_t i)
+{
+    for (size_t b = 0; b < PROTOCOL_EVENT_CRC_OFFSET; b++)
+    {
+        event[b] = (uint8_t)(seq * 31 + i * 7 + b);
+    }
+    event[PROTOCOL_EVENT_CRC_OFFSET] = crc8_compute(event, PROTOCOL_EVENT_CRC_OFFSET);
+}
+
+/**
+ * @brief Append an EVENTS frame of 'count' events.
+ *
+ * @return Size of the frame.
+ */
+static size_t bench_events_frame(uint8_t *buff, uint32_t seq, uint8_t count)
+{
+    bench_header(buff, PROTOCOL_TYPE_EVENTS, seq, count * PROTOCOL_EVENT_SIZE, count);
+    for (uint8_t i = 0; i < count; i++)
+    {
+        bench_event(&buff[PROTOCOL_HEADER_SIZE + i * PROTOCOL_EVENT_SIZE], seq, i);
+    }
+    return PROTOCOL_HEADER_SIZE + count * PROTOCOL_EVENT_SIZE;
+}
+
+/**
+ * @brief Append a HISTORY frame of PROTOCOL_MAX_HISTORY records, the same records every time.
+ *
+ * @return Size of the frame.
+ */
+static size_t bench_history_frame(uint8_t *buff, uint32_t seq)
+{
+    bench_header(buff, PROTOCOL_TYPE_HISTORY, seq, BENCH_HISTORY_PAYLOAD, 0);
+    for (size_t i = 0; i < BENCH_HISTORY_PAYLOAD; i++)
+    {
+        buff[PROTOCOL_HEADER_SIZE + i] = (uint8_t)(i * 13 + i / 251);
+    }
+    return BENCH_HISTORY_SIZE;
+}
+
+/**
+ * @brief Build the frames before the first HISTORY frame.
+ *
+ * The first fill takes the whole ring. 3 full frames and 4 of one event leave
+ * 4 bytes, so the next header fills the ring again from 2044. 3 full frames,
+ * one of one event and 5 empty ones take 2038 more bytes and leave 10, so
+ * the HISTORY header fills it from 2034 on: its payload starts at 2046, with
+ * 2036 bytes of it in the ring, wrapped around the end.
+ */
+static void bench_build_prefix(struct bench_frames *frames)
+{
+    static const uint8_t counts[] = {64, 64, 64, 1, 1, 1, 1, 64, 64, 64, 1, 0, 0, 0, 0, 0};
+    size_t size = 0;
+
+    for (size_t i = 0; i < sizeof(counts); i++)
+    {
+        size += bench_events_frame(&frames->prefix[size], frames->seq++, counts[i]);
+        frames->prefix_events += counts[i];
+    }
+    size += bench_history_frame(&frames->prefix[size], frames->seq++);
+    frames->prefix_size = size;
+}
+
+/**
+ * @brief Send the frames of every round.
+ */
+static void *bench_write(void *frames_arg)
+{
+    struct bench_frames *frames = (struct bench_frames *)frames_arg;
+
+    for (size_t round = 0; round < frames->rounds; round++)
+    {
+        if (write(frames->fd, frames->round, frames->round_size) != (ssize_t)frames->round_size)
+        {
+            perror("protocol_bench: write");
+            break;
+        }
+    }
+    shutdown(frames->fd, SHUT_WR);
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t rounds = (argc > 1) ? strtoul(argv[1], NULL, 10) : BENCH_DEFAULT_ROUNDS;
+    size_t events = 0, histories = 0, wrong = 0, history_records;
+    struct bench_frames *frames = calloc(1, sizeof(*frames));
+    struct protocol_connection *connection = malloc(sizeof(*connection));
+    const uint8_t *event;
+    uint8_t expected[PROTOCOL_EVENT_SIZE];
+    pthread_t thread;
+    int fds[2];
+    double begin, elapsed;
+    uint8_t result;
+
+    if (frames == NULL || connection == NULL || socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1)
+    {
+        perror("protocol_bench");
+        return 1;
+    }
+    server_clock_init();
+    timer_wheel_init(&server_timers);
+
+    /* The seqs of the rounds repeat, their events are checked by the seq and the index alone.  */
+    frames->fd = fds[1];
+    frames->rounds = rounds;
+    bench_build_prefix(frames);
+    for (size_t i = 0; i < BENCH_FRAMES_PER_ROUND; i++)
+    {
+        frames->round_size += bench_events_frame(&frames->round[frames->round_size], frames->seq + i, PROTOCOL_MAX_EVENTS);
+    }
+    frames->round_size += bench_history_frame(&frames->round[frames->round_size], frames->seq + BENCH_FRAMES_PER_ROUND);
+
+    if (write(fds[1], frames->prefix, frames->prefix_size) != (ssize_t)frames->prefix_size)
+    {
+        perror("protocol_bench: write");
+        return 1;
+    }
+    protocol_connection_init(connection, fds[0]);
+    if (pthread_create(&thread, NULL, bench_write, frames) != 0)
+    {
+        perror("protocol_bench: pthread_create");
+        return 1;
+    }
+
+    begin = bench_now();
+    while ((result = protocol_receive_event(connection, &event)) == PROTOCOL_OK || result == PROTOCOL_HISTORY)
+    {
+        if (result == PROTOCOL_HISTORY)
+        {
+            ++histories;
+            if (connection->history_count != PROTOCOL_MAX_HISTORY ||
+                memcmp(connection->history, &frames->prefix[frames->prefix_size - BENCH_HISTORY_PAYLOAD],
+                       BENCH_HISTORY_PAYLOAD) != 0)
+            {
+                ++wrong;
+            }
+            continue;
+        }
+        bench_event(expected, connection->seq, connection->event_index);
+        if (memcmp(event, expected, PROTOCOL_EVENT_SIZE) != 0)
+        {
+            ++wrong;
+        }
+        ++events;
+    }
+    elapsed = bench_now() - begin;
+    pthread_join(thread, NULL);
+    protocol_connection_release(connection);
+    history_records = histories * PROTOCOL_MAX_HISTORY;
+
+    printf("protocol_bench: a HISTORY frame wrapped around the ring, then %zu rounds of %d full EVENTS frames\n"
+           "  and a HISTORY frame of %d records\n", rounds, BENCH_FRAMES_PER_ROUND, PROTOCOL_MAX_HISTORY);
+    printf("  receive %7.1f ns per event, history records included\n", elapsed * 1e9 / (events + history_records));
+    printf("  %zu events, %zu HISTORY frames, %zu wrong\n", events, histories, wrong);
+
+    if (result != PROTOCOL_CLOSED || wrong != 0 || histories != rounds + 1 ||
+        events != frames->prefix_events + rounds * BENCH_FRAMES_PER_ROUND * PROTOCOL_MAX_EVENTS)
+    {
+        fprintf(stderr, "protocol_bench: FAILED\n");
+        return 1;
+    }
+    free(connection);
+    free(frames);
+    return 0;
+}
@@ -0,0 +1,435 @@
+/**
+ * @file    tariff.c
+ * @author  Vlad Kulikov
+ * @date    2026-10-18
+ * @brief   Implementation of the time-of-day tariff engine.
+ */
+#include "tariff.h"
+
+/**
+ * @brief Convert a weekday (Sunday = 0) to the day index of the epoch aligned week.
+ *
+ * @param weekday Day of the week (Sunday = 0).
+ * @return The day index in the tables.
+ */
+static int tariff_day_index(int weekday)
+{
+    return (weekday + TARIFF_DAYS_PER_WEEK - TARIFF_EPOCH_WEEKDAY) % TARIFF_DAYS_PER_WEEK;
+}
+
+/**
+ * @brief Cumulative cost, in rate seconds, from the local epoch up to a local time.
+ *
+ * @param zone Pointer to the zone tariff.
+ * @param local_time Seconds since the local epoch.
+ * @return The cumulative cost in rate seconds.
+ */
+static int64_t tariff_scaled_cost(const struct tariff_zone *zone, int64_t local_time)
+{
+    int64_t week = local_time / TARIFF_SECONDS_PER_WEEK;
+    int64_t second_of_week = local_time % TARIFF_SECONDS_PER_WEEK;
+
+    return week * zone->minute_cost[TARIFF_MINUTES_PER_WEEK] +
+           zone->minute_cost[second_of_week / TARIFF_SECONDS_PER_MINUTE] +
+           zone->hour_rate[second_of_week / TARIFF_SECONDS_PER_HOUR] * (second_of_week % TARIFF_SECONDS_PER_MINUTE);
+}
+
+/**
+ * @brief Cost of a part of a single day, without the cap of that day.
+ *
+ * @param zone Pointer to the zone tariff.
+ * @param start Local start time.
+ * @param end Local end time, not later than the next midnight.
+ * @return The cost in minor units.
+ */
+static int64_t tariff_day_uncapped_cost(const struct tariff_zone *zone, int64_t start, int64_t end)
+{
+    return (tariff_scaled_cost(zone, end) - tariff_scaled_cost(zone, start)) / TARIFF_SECONDS_PER_HOUR;
+}
+
+/**
+ * @brief Cost of a part of a single day, limited by the cap of that day.
+ *
+ * @param zone Pointer to the zone tariff.
+ * @param start Local start time.
+ * @param end Local end time, not later than the next midnight.
+ * @param day Day number since the local epoch.
+ * @return The cost in minor units.
+ */
+static int64_t tariff_day_segment_cost(const struct tariff_zone *zone, int64_t start, int64_t end, int64_t day)
+{
+    int64_t cost = tariff_day_uncapped_cost(zone, start, end);
+    int64_t cap = zone->day_cap[day % TARIFF_DAYS_PER_WEEK];
+
+    return (cost < cap) ? cost : cap;
+}
+
+/**
+ * @brief Cumulative capped cost of all the whole days from the local epoch up to a day.
+ *
+ * @param zone Pointer to the zone tariff.
+ * @param day Day number since the local epoch.
+ * @return The cost in minor units.
+ */
+static int64_t tariff_whole_days_cost(const struct tariff_zone *zone, int64_t day)
+{
+    return (day / TARIFF_DAYS_PER_WEEK) * zone->full_day_cost[TARIFF_DAYS_PER_WEEK] +
+           zone->full_day_cost[day % TARIFF_DAYS_PER_WEEK];
+}
+
+/**
+ * @brief Cost of [start, end) of local time, every day limited by its cap.
+ *
+ * The interval is split in to the partial first day, the whole days in the middle
+ * and the partial last day. Each part is a constant number of table lookups.
+ *
+ * @param zone Pointer to the zone tariff.
+ * @param start Local start time, not before the local epoch.
+ * @param end Local end time, after 'start'.
+ * @return The cost in minor units.
+ */
+static int64_t tariff_local_cost(const struct tariff_zone *zone, int64_t start, int64_t end)
+{
+    int64_t first_day = start / TARIFF_SECONDS_PER_DAY;
+    int64_t last_day = end / TARIFF_SECONDS_PER_DAY;
+
+    if (first_day == last_day)
+    {
+        return tariff_day_segment_cost(zone, start, end, first_day);
+    }
+
+    return tariff_day_segment_cost(zone, start, (first_day + 1) * TARIFF_SECONDS_PER_DAY, first_day) +
+           tariff_whole_days_cost(zone, last_day) - tariff_whole_days_cost(zone, first_day + 1) +
+           tariff_day_segment_cost(zone, last_day * TARIFF_SECONDS_PER_DAY, end, last_day);
+}
+
+/**
+ * @brief Correction of the day two parts of an interval share, around a change of the offset.
+ *
+ * Each part was limited by the cap of the day on its own, the day gets one cap for both.
+ *
+ * @param zone Pointer to the zone tariff.
+ * @param first_start Local start time of the part before the change.
+ * @param first_end Local end time of the part before the change.
+ * @param second_start Local start time of the part after the change.
+ * @param second_end Local end time of the part after the change.
+ * @return The amount to add to the cost of the two parts, 0 or less.
+ */
+static int64_t tariff_shared_day_cost(const struct tariff_zone *zone, int64_t first_start, int64_t first_end,
+                                      int64_t second_start, int64_t second_end)
+{
+    int64_t day = second_start / TARIFF_SECONDS_PER_DAY;
+    int64_t day_start = day * TARIFF_SECONDS_PER_DAY;
+    int64_t day_end = day_start + TARIFF_SECONDS_PER_DAY;
+    int64_t cap = zone->day_cap[day % TARIFF_DAYS_PER_WEEK];
+    int64_t first, second, both;
+
+    if (first_end <= day_start || first_start >= day_end)
+    {
+        return 0;
+    }
+    first = tariff_day_uncapped_cost(zone, (first_start > day_start) ? first_start : day_start,
+                                     (first_end < day_end) ? first_end : day_end);
+    second = tariff_day_uncapped_cost(zone, second_start, (second_end < day_end) ? second_end : day_end);
+    both = first + second;
+
+    return ((both < cap) ? both : cap) - ((first < cap) ? first : cap) - ((second < cap) ? second : cap);
+}
+
+/**
+ * @brief Offset of the local time from UTC at a time, by the rules of the local time zone.
+ *
+ * @param unix_time The time.
+ * @return Seconds added to the unix time to get the local time.
+ */
+static int32_t tariff_local_utc_offset(int64_t unix_time)
+{
+    time_t time = (time_t)unix_time;
+    struct tm local;
+
+    if (localtime_r(&time, &local) == NULL)
+    {
+        return 0;
+    }
+    return (int32_t)local.tm_gmtoff;
+}
+
+/**
+ * @brief Fill the offset schedule of a book from the rules of the local time zone.
+ *
+ * The range is scanned a day at a time, and the second of every change is found by bisection.
+ *
+ * @param book Pointer to the book.
+ * @param now Unix time the range is centred on.
+ */
+static void tariff_book_set_utc_offsets(struct tariff_book *book, int64_t now)
+{
+    int64_t day = now - (int64_t)TARIFF_UTC_OFFSET_PAST_DAYS * TARIFF_SECONDS_PER_DAY;
+    int64_t last_day = now + (int64_t)TARIFF_UTC_OFFSET_FUTURE_DAYS * TARIFF_SECONDS_PER_DAY;
+    int32_t offset = tariff_local_utc_offset(day);
+    uint8_t count = 1;
+
+    book->utc_offset_from[0] = INT64_MIN;
+    book->utc_offset[0] = offset;
+    for (; day < last_day && count < TARIFF_MAX_UTC_OFFSETS; day += TARIFF_SECONDS_PER_DAY)
+    {
+        int64_t before = day, after = day + TARIFF_SECONDS_PER_DAY;
+
+        if (tariff_local_utc_offset(after) == offset)
+        {
+            continue;
+        }
+        while (after - before > 1)
+        {
+            int64_t middle = before + (after - before) / 2;
+
+            if (tariff_local_utc_offset(middle) == offset)
+            {
+                before = middle;
+            }
+            else
+            {
+                after = middle;
+            }
+        }
+        offset = tariff_local_utc_offset(after);
+        book->utc_offset_from[count] = after;
+        book->utc_offset[count++] = offset;
+    }
+
+    /* The unused entries are never found by tariff_utc_offset_index.  */
+    book->utc_offset_count = count;
+    for (uint8_t i = count; i < TARIFF_MAX_UTC_OFFSETS; ++i)
+    {
+        book->utc_offset_from[i] = INT64_MAX;
+        book->utc_offset[i] = offset;
+    }
+    book->utc_offset_from[TARIFF_MAX_UTC_OFFSETS] = INT64_MAX;
+}
+
+/**
+ * @brief Make the local time of the process the one of TARIFF_TIME_ZONE.
+ *
+ * Must be called before any thread is started and before the first book is created.
+ */
+void tariff_time_zone_init(void)
+{
+    setenv("TZ", TARIFF_TIME_ZONE, 1);
+    tzset();
+
+    /* Without the tz database the zone falls back to UTC, its rules are then taken from the POSIX string.  */
+    if (tariff_local_utc_offset(0) == 0)
+    {
+        printf("tariff_time_zone_init: no rules for %s, using %s\n", TARIFF_TIME_ZONE, TARIFF_TIME_ZONE_RULE);
+        setenv("TZ", TARIFF_TIME_ZONE_RULE, 1);
+        tzset();
+    }
+}
+
+/**
+ * @brief Allocate a tariff book where every zone is free of charge.
+ *
+ * The offset schedule of the book is taken from the rules of the local time zone,
+ * from TARIFF_UTC_OFFSET_PAST_DAYS before now to TARIFF_UTC_OFFSET_FUTURE_DAYS after it.
+ * The first offset holds before that range and the last one after it.
+ *
+ * @param version Version of the tariffs.
+ * @return Pointer to the book, NULL if the allocation failed.
+ */
+struct tariff_book *tariff_book_create(uint32_t version)
+{
+    struct tariff_book *book = calloc(1, sizeof(*book));
+
+    if (book == NULL)
+    {
+        perror("tariff_book_create: calloc");
+        return NULL;
+    }
+    book->version = version;
+    tariff_book_set_utc_offsets(book, time(NULL));
+    for (int i = 0; i < ZONE_COUNT; ++i)
+    {
+        tariff_zone_set_daily_cap(&book->zone[i], TARIFF_EVERY_DAY, TARIFF_NO_DAILY_CAP);
+    }
+    tariff_book_precompute(book);
+    return book;
+}
+
+/**
+ * @brief Release a tariff book.
+ *
+ * @param book Pointer to the book.
+ */
+void tariff_book_destroy(struct tariff_book *book)
+{
+    free(book);
+}
+
+/**
+ * @brief Set the rate of a zone for a range of hours.
+ *
+ * @param zone Pointer to the zone tariff.
+ * @param weekday Day of the week (Sunday = 0) or TARIFF_EVERY_DAY.
+ * @param start_hour First hour of the range (0-23).
+ * @param end_hour Hour after the last hour of the range (1-24).
+ * @param rate_per_hour Minor units per hour, up to TARIFF_MAX_RATE_PER_HOUR.
+ * @return TRUE on success, FALSE if the arguments are out of range.
+ */
+uint8_t tariff_zone_set_rate(struct tariff_zone *zone, int weekday, int start_hour, int end_hour, int64_t rate_per_hour)
+{
+    if (weekday < TARIFF_EVERY_DAY || weekday >= TARIFF_DAYS_PER_WEEK ||
+        start_hour < 0 || end_hour > TARIFF_HOURS_PER_DAY || start_hour >= end_hour ||
+        rate_per_hour < 0 || rate_per_hour > TARIFF_MAX_RATE_PER_HOUR)
+    {
+        printf("tariff_zone_set_rate: invalid rule (%d, %d-%d)\n", weekday, start_hour, end_hour);
+        return FALSE;
+    }
+    for (int day = 0; day < TARIFF_DAYS_PER_WEEK; ++day)
+    {
+        if (weekday != TARIFF_EVERY_DAY && weekday != day)
+        {
+            continue;
+        }
+        for (int hour = start_hour; hour < end_hour; ++hour)
+        {
+            zone->hour_rate[tariff_day_index(day) * TARIFF_HOURS_PER_DAY + hour] = rate_per_hour;
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Set the daily cap of a zone.
+ *
+ * @param zone Pointer to the zone tariff.
+ * @param weekday Day of the week (Sunday = 0) or TARIFF_EVERY_DAY.
+ * @param cap Maximal charge for one day in minor units, TARIFF_NO_DAILY_CAP for none.
+ * @return TRUE on success, FALSE if the arguments are out of range.
+ */
+uint8_t tariff_zone_set_daily_cap(struct tariff_zone *zone, int weekday, int64_t cap)
+{
+    if (weekday < TARIFF_EVERY_DAY || weekday >= TARIFF_DAYS_PER_WEEK || cap < 0)
+    {
+        printf("tariff_zone_set_daily_cap: invalid cap (%d)\n", weekday);
+        return FALSE;
+    }
+    for (int day = 0; day < TARIFF_DAYS_PER_WEEK; ++day)
+    {
+        if (weekday == TARIFF_EVERY_DAY || weekday == day)
+        {
+            zone->day_cap[tariff_day_index(day)] = cap;
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Build the cumulative tables of a zone after its rates and caps are set.
+ *
+ * @param zone Pointer to the zone tariff.
+ */
+void tariff_zone_precompute(struct tariff_zone *zone)
+{
+    zone->minute_cost[0] = 0;
+    for (int minute = 0; minute < TARIFF_MINUTES_PER_WEEK; ++minute)
+    {
+        /* Every second of the hour costs rate / 3600 minor units, which is 'rate' rate seconds.  */
+        zone->minute_cost[minute + 1] = zone->minute_cost[minute] +
+                                        zone->hour_rate[minute / 60] * TARIFF_SECONDS_PER_MINUTE;
+    }
+
+    zone->full_day_cost[0] = 0;
+    for (int day = 0; day < TARIFF_DAYS_PER_WEEK; ++day)
+    {
+        int64_t cost = (zone->minute_cost[(day + 1) * TARIFF_MINUTES_PER_DAY] -
+                        zone->minute_cost[day * TARIFF_MINUTES_PER_DAY]) / TARIFF_SECONDS_PER_HOUR;
+        if (cost > zone->day_cap[day])
+        {
+            cost = zone->day_cap[day];
+        }
+        zone->full_day_cost[day + 1] = zone->full_day_cost[day] + cost;
+    }
+}
+
+/**
+ * @brief Build the cumulative tables of all the zones of a book.
+ *
+ * @param book Pointer to the book.
+ */
+void tariff_book_precompute(struct tariff_book *book)
+{
+    for (int i = 0; i < ZONE_COUNT; ++i)
+    {
+        tariff_zone_precompute(&book->zone[i]);
+    }
+}
+
+/**
+ * @brief Find the entry of the offset schedule in effect at a time.
+ *
+ * @param book Pointer to the book.
+ * @param unix_time The time.
+ * @return Index in book->utc_offset, the offset holds up to book->utc_offset_from[index + 1].
+ */
+uint8_t tariff_utc_offset_index(const struct tariff_book *book, int64_t unix_time)
+{
+    uint8_t index = 0;
+
+    for (uint8_t step = TARIFF_MAX_UTC_OFFSETS / 2; step > 0; step /= 2)
+    {
+        index += (book->utc_offset_from[index + step] <= unix_time) ? step : 0;
+    }
+    return index;
+}
+
+/**
+ * @brief Calculate the cost of parking in a zone during [start_time, end_time).
+ *
+ * The interval is split where the offset of the local time changes, every part
+ * is charged in its own local time, and a day two parts share gets one cap.
+ *
+ * @param book Pointer to the book.
+ * @param zone_id The zone id.
+ * @param start_time Unix time the parking started.
+ * @param end_time Unix time the parking ended.
+ * @return The cost in minor units, 0 for an empty interval or an unknown zone.
+ */
+int64_t tariff_cost(const struct tariff_book *book, uint16_t zone_id, int64_t start_time, int64_t end_time)
+{
+    const struct tariff_zone *zone;
+    int64_t cost = 0, previous_start = 0, previous_end = 0;
+
+    if (book == NULL || zone_id >= ZONE_COUNT || end_time <= start_time)
+    {
+        return 0;
+    }
+    zone = &book->zone[zone_id];
+
+    for (uint8_t index = tariff_utc_offset_index(book, start_time);; ++index)
+    {
+        int64_t part_end = (book->utc_offset_from[index + 1] < end_time) ? book->utc_offset_from[index + 1] : end_time;
+        int64_t start = start_time + book->utc_offset[index];
+        int64_t end = part_end + book->utc_offset[index];
+
+        /* Moving to local time, times before the local epoch are not charged.  */
+        if (start < 0)
+        {
+            start = 0;
+        }
+        if (end > start)
+        {
+            cost += tariff_local_cost(zone, start, end);
+            if (previous_end > previous_start)
+            {
+                cost += tariff_shared_day_cost(zone, previous_start, previous_end, start, end);
+            }
+            previous_start = start;
+            previous_end = end;
+        }
+        if (part_end == end_time)
+        {
+            return cost;
+        }
+        start_time = part_end;
+    }
+}
@@ -0,0 +1,180 @@
+/**
+ * @file 	tariff.h
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-18
+ * @brief 	Header file containing declarations for the time-of-day tariff engine.
+ *
+ * Every zone has a rate per hour for each hour of the week and an optional cap per day.
+ * The rates are turned into a cumulative cost table of one week in minute steps,
+ * so the cost of any [start, end) interval, even one that spans many days,
+ * is computed with a few table lookups.
+ * All the amounts are integers in minor currency units (agorot).
+ *
+ * Internally the week starts on the weekday of the unix epoch (Thursday),
+ * so the position in the table is simply the local time modulo one week.
+ *
+ * The local time follows the rules of TARIFF_TIME_ZONE: every book keeps the
+ * schedule of its offsets from UTC, and an interval that spans a change of the
+ * offset is charged in parts, each one in the local time of its own part.
+ */
+#ifndef TARIFF_H
+#define TARIFF_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../zone/zone_index.h"
+
+#define TARIFF_SECONDS_PER_MINUTE 60
+#define TARIFF_SECONDS_PER_HOUR 3600
+#define TARIFF_SECONDS_PER_DAY 86400
+#define TARIFF_SECONDS_PER_WEEK 604800
+#define TARIFF_MINUTES_PER_HOUR 60
+#define TARIFF_MINUTES_PER_DAY 1440
+#define TARIFF_MINUTES_PER_WEEK 10080
+#define TARIFF_HOURS_PER_DAY 24
+#define TARIFF_HOURS_PER_WEEK 168
+#define TARIFF_DAYS_PER_WEEK 7
+
+/* 1970-01-01 was a Thursday, weekdays are counted from Sunday = 0.  */
+#define TARIFF_EPOCH_WEEKDAY 4
+/* Every weekday, when used in place of a weekday.  */
+#define TARIFF_EVERY_DAY -1
+/* The highest accepted rate, keeps every cumulative table far below 2^51.  */
+#define TARIFF_MAX_RATE_PER_HOUR 100000000
+/* A day without a cap.  */
+#define TARIFF_NO_DAILY_CAP INT64_MAX
+/* Minor currency units in one major unit (agorot in one shekel).  */
+#define TARIFF_MINOR_UNITS_PER_MAJOR 100
+/* The time zone of the tariffs, its rules give the offset of the local time from UTC.  */
+#define TARIFF_TIME_ZONE "Asia/Jerusalem"
+/* The rules of TARIFF_TIME_ZONE as a POSIX TZ string, for a system without the tz database.  */
+#define TARIFF_TIME_ZONE_RULE "IST-2IDT,M3.4.4/26,M10.5.0"
+/* Entries of the offset schedule of a book, a power of 2 for the binary search.  */
+#define TARIFF_MAX_UTC_OFFSETS 32
+/* The offset schedule of a book covers these days before and after the book is created.  */
+#define TARIFF_UTC_OFFSET_PAST_DAYS 730
+#define TARIFF_UTC_OFFSET_FUTURE_DAYS 3650
+
+#ifndef STATEMENT_STATUS
+#define STATEMENT_STATUS
+enum statement_status
+{
+	FALSE = 0,
+	TRUE = !FALSE
+};
+#endif /*STATEMENT_STATUS*/
+
+/**
+ * @brief The precomputed tariff of one zone.
+ *
+ * The tables are indexed by the position in the epoch aligned week.
+ * 'minute_cost' holds the cost in "rate seconds" (minor units * 3600),
+ * which keeps the sum exact and is divided by 3600 only once per day segment.
+ */
+struct tariff_zone
+{
+	int64_t hour_rate[TARIFF_HOURS_PER_WEEK];		  /*Minor units per hour*/
+	int64_t minute_cost[TARIFF_MINUTES_PER_WEEK + 1]; /*Cumulative cost from the start of the week up to a minute*/
+	int64_t day_cap[TARIFF_DAYS_PER_WEEK];			  /*Maximal charge for one day*/
+	int64_t full_day_cost[TARIFF_DAYS_PER_WEEK + 1];  /*Cumulative capped cost of whole days from the start of the week*/
+};
+
+/**
+ * @brief The tariffs of all the zones.
+ */
+struct tariff_book
+{
+	uint32_t version;	/*Version of the tariffs, every change of prices gets a new version*/
+	uint8_t utc_offset_count; /*Entries of the offset schedule*/
+	int64_t utc_offset_from[TARIFF_MAX_UTC_OFFSETS + 1]; /*Unix time every offset takes effect, INT64_MAX after the last one*/
+	int32_t utc_offset[TARIFF_MAX_UTC_OFFSETS]; /*Seconds added to the unix time to get the local time*/
+	double price[ZONE_COUNT]; /*Flat price per second of every zone, as listed in the price D.B*/
+	struct tariff_zone zone[ZONE_COUNT];
+};
+
+/**
+ * @brief Make the local time of the process the one of TARIFF_TIME_ZONE.
+ *
+ * Must be called before any thread is started and before the first book is created.
+ */
+void tariff_time_zone_init(void);
+
+/**
+ * @brief Allocate a tariff book where every zone is free of charge.
+ *
+ * The offset schedule of the book is taken from the rules of the local time zone,
+ * from TARIFF_UTC_OFFSET_PAST_DAYS before now to TARIFF_UTC_OFFSET_FUTURE_DAYS after it.
+ * The first offset holds before that range and the last one after it.
+ *
+ * @param version Version of the tariffs.
+ * @return Pointer to the book, NULL if the allocation failed.
+ */
+struct tariff_book *tariff_book_create(uint32_t version);
+
+/**
+ * @brief Release a tariff book.
+ *
+ * @param book Pointer to the book.
+ */
+void tariff_book_destroy(struct tariff_book *book);
+
+/**
+ * @brief Set the rate of a zone for a range of hours.
+ *
+ * @param zone Pointer to the zone tariff.
+ * @param weekday Day of the week (Sunday = 0) or TARIFF_EVERY_DAY.
+ * @param start_hour First hour of the range (0-23).
+ * @param end_hour Hour after the last hour of the range (1-24).
+ * @param rate_per_hour Minor units per hour, up to TARIFF_MAX_RATE_PER_HOUR.
+ * @return TRUE on success, FALSE if the arguments are out of range.
+ */
+uint8_t tariff_zone_set_rate(struct tariff_zone *zone, int weekday, int start_hour, int end_hour, int64_t rate_per_hour);
+
+/**
+ * @brief Set the daily cap of a zone.
+ *
+ * @param zone Pointer to the zone tariff.
+ * @param weekday Day of the week (Sunday = 0) or TARIFF_EVERY_DAY.
+ * @param cap Maximal charge for one day in minor units, TARIFF_NO_DAILY_CAP for none.
+ * @return TRUE on success, FALSE if the arguments are out of range.
+ */
+uint8_t tariff_zone_set_daily_cap(struct tariff_zone *zone, int weekday, int64_t cap);
+
+/**
+ * @brief Build the cumulative tables of a zone after its rates and caps are set.
+ *
+ * @param zone Pointer to the zone tariff.
+ */
+void tariff_zone_precompute(struct tariff_zone *zone);
+
+/**
+ * @brief Build the cumulative tables of all the zones of a book.
+ *
+ * @param book Pointer to the book.
+ */
+void tariff_book_precompute(struct tariff_book *book);
+
+/**
+ * @brief Find the entry of the offset schedule in effect at a time.
+ *
+ * @param book Pointer to the book.
+ * @param unix_time The time.
+ * @return Index in book->utc_offset, the offset holds up to book->utc_offset_from[index + 1].
+ */
+uint8_t tariff_utc_offset_index(const struct tariff_book *book, int64_t unix_time);
+
+/**
+ * @brief Calculate the cost of parking in a zone during [start_time, end_time).
+ *
+ * @param book Pointer to the book.
+ * @param zone_id The zone id.
+ * @param start_time Unix time the parking started.
+ * @param end_time Unix time the parking ended.
+ * @return The cost in minor units, 0 for an empty interval or an unknown zone.
+ */
+int64_t tariff_cost(const struct tariff_book *book, uint16_t zone_id, int64_t start_time, int64_t end_time);
+
+#endif /*TARIFF_H*/
@@ -0,0 +1,254 @@
+/**
+ * @file    tariff_rcu.c
+ * @author  Vlad Kulikov
+ * @date    2026-10-18
+ * @brief   Implementation of publishing tariff versions.
+ *
+ * The read sections are counted in two counters, readers enter the one of the
+ * current phase. A grace period flips the phase twice and waits for each counter
+ * to drain, so every reader that could have loaded a removed pointer is done.
+ */
+#include "tariff_rcu.h"
+
+/**
+ * @brief A registered version.
+ */
+struct tariff_rcu_slot
+{
+    struct tariff_book *_Atomic book; /*NULL when the slot is free*/
+    int64_t effective_time;           /*Is written before 'book' is published*/
+};
+
+static struct tariff_rcu_slot tariff_slots[TARIFF_RCU_MAX_VERSIONS];
+static struct tariff_book *_Atomic tariff_current_book;
+static atomic_uint tariff_rcu_phase;
+static atomic_long tariff_rcu_readers[2];
+/* Serializes the writers, the readers never take it.  */
+static pthread_mutex_t tariff_rcu_writer = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Get the slot of a registered version.
+ *
+ * @param version The version.
+ * @return Pointer to the slot, NULL if the version is not registered.
+ */
+static struct tariff_rcu_slot *tariff_rcu_slot_of(uint32_t version)
+{
+    struct tariff_rcu_slot *slot = &tariff_slots[version % TARIFF_RCU_MAX_VERSIONS];
+    struct tariff_book *book = atomic_load_explicit(&slot->book, memory_order_acquire);
+
+    return (book != NULL && book->version == version) ? slot : NULL;
+}
+
+/**
+ * @brief Wait for the readers of one phase to leave their read sections.
+ */
+static void tariff_rcu_flip_and_wait(void)
+{
+    unsigned int old_phase = atomic_fetch_xor(&tariff_rcu_phase, 1) & 1;
+
+    while (atomic_load(&tariff_rcu_readers[old_phase]) != 0)
+    {
+        usleep(TARIFF_RCU_GRACE_PERIOD_POLL_US);
+    }
+}
+
+/**
+ * @brief Publish the first tariff version.
+ *
+ * @param book Pointer to the book, is owned by the registry from now on.
+ * @param effective_time Unix time the version took effect.
+ * @return TRUE on success, FALSE otherwise.
+ */
+uint8_t tariff_rcu_init(struct tariff_book *book, int64_t effective_time)
+{
+    return tariff_publish(book, effective_time);
+}
+
+/**
+ * @brief Free every registered book, when no reader is left.
+ */
+void tariff_rcu_destroy(void)
+{
+    atomic_store(&tariff_current_book, NULL);
+    for (int i = 0; i < TARIFF_RCU_MAX_VERSIONS; ++i)
+    {
+        tariff_book_destroy(atomic_exchange(&tariff_slots[i].book, NULL));
+    }
+}
+
+/**
+ * @brief Enter a read section.
+ *
+ * The books returned inside the section stay valid until tariff_read_unlock.
+ *
+ * @return A token that has to be passed to tariff_read_unlock.
+ */
+int tariff_read_lock(void)
+{
+    int token = atomic_load(&tariff_rcu_phase) & 1;
+
+    atomic_fetch_add(&tariff_rcu_readers[token], 1);
+    return token;
+}
+
+/**
+ * @brief Leave a read section.
+ *
+ * @param token The value returned by tariff_read_lock.
+ */
+void tariff_read_unlock(int token)
+{
+    atomic_fetch_sub(&tariff_rcu_readers[token], 1);
+}
+
+/**
+ * @brief Get the current tariff book, inside a read section.
+ *
+ * @return Pointer to the book.
+ */
+const struct tariff_book *tariff_current(void)
+{
+    return atomic_load_explicit(&tariff_current_book, memory_order_acquire);
+}
+
+/**
+ * @brief Get the book of a registered version, inside a read section.
+ *
+ * @param version The version.
+ * @return Pointer to the book, NULL if the version was retired or never published.
+ */
+const struct tariff_book *tariff_version_book(uint32_t version)
+{
+    struct tariff_rcu_slot *slot = tariff_rcu_slot_of(version);
+
+    return (slot != NULL) ? atomic_load_explicit(&slot->book, memory_order_acquire) : NULL;
+}
+
+/**
+ * @brief Calculate the charge of a session priced under a version, inside a read section.
+ *
+ * The interval is split at the effective time of every later version, and each part
+ * is charged by the version that was in effect.
+ *
+ * @param version The version the session is priced under.
+ * @param zone_id The zone id.
+ * @param start_time Unix time the not yet charged part of the session started.
+ * @param end_time Unix time the session ended.
+ * @return The charge in minor units.
+ */
+int64_t tariff_session_cost(uint32_t version, uint16_t zone_id, int64_t start_time, int64_t end_time)
+{
+    const struct tariff_book *book = tariff_version_book(version);
+    int64_t cost = 0;
+
+    /* A version that was already retired is replaced by the current one.  */
+    if (book == NULL)
+    {
+        book = tariff_current();
+    }
+
+    while (book != NULL && start_time < end_time)
+    {
+        const struct tariff_book *next = NULL;
+        int64_t next_time = end_time;
+
+        /* The oldest registered version after the one of this part.  */
+        for (int i = 0; i < TARIFF_RCU_MAX_VERSIONS; ++i)
+        {
+            struct tariff_book *candidate = atomic_load_explicit(&tariff_slots[i].book, memory_order_acquire);
+
+            if (candidate != NULL && candidate->version > book->version &&
+                (next == NULL || candidate->version < next->version))
+            {
+                next = candidate;
+                next_time = tariff_slots[i].effective_time;
+            }
+        }
+
+        if (next == NULL || next_time >= end_time)
+        {
+            cost += tariff_cost(book, zone_id, start_time, end_time);
+            break;
+        }
+        cost += tariff_cost(book, zone_id, start_time, next_time);
+        if (next_time > start_time)
+        {
+            start_time = next_time;
+        }
+        book = next;
+    }
+    return cost;
+}
+
+/**
+ * @brief Make a new version the current one.
+ *
+ * @param book Pointer to the book, its version has to be higher than the current one.
+ *        Is owned by the registry from now on.
+ * @param effective_time Unix time the version takes effect.
+ * @return TRUE on success, FALSE if the version is not new or there is no free slot.
+ */
+uint8_t tariff_publish(struct tariff_book *book, int64_t effective_time)
+{
+    struct tariff_rcu_slot *slot = &tariff_slots[book->version % TARIFF_RCU_MAX_VERSIONS];
+    struct tariff_book *current;
+
+    pthread_mutex_lock(&tariff_rcu_writer);
+    current = atomic_load(&tariff_current_book);
+    if ((current != NULL && book->version <= current->version) || atomic_load(&slot->book) != NULL)
+    {
+        pthread_mutex_unlock(&tariff_rcu_writer);
+        fprintf(stderr, "tariff_publish: version %u can't be published\n", book->version);
+        return FALSE;
+    }
+
+    slot->effective_time = effective_time;
+    atomic_store_explicit(&slot->book, book, memory_order_release);
+    atomic_store_explicit(&tariff_current_book, book, memory_order_release);
+    pthread_mutex_unlock(&tariff_rcu_writer);
+
+    printf("Tariff version %u is in effect from %lld\n", book->version, (long long)effective_time);
+    return TRUE;
+}
+
+/**
+ * @brief Wait until every read section that started before the call has ended.
+ */
+void tariff_synchronize(void)
+{
+    pthread_mutex_lock(&tariff_rcu_writer);
+    tariff_rcu_flip_and_wait();
+    tariff_rcu_flip_and_wait();
+    pthread_mutex_unlock(&tariff_rcu_writer);
+}
+
+/**
+ * @brief Remove an old version and free its book after a grace period.
+ *
+ * No session should be priced under the version anymore.
+ *
+ * @param version The version, the current one is not retired.
+ */
+void tariff_retire(uint32_t version)
+{
+    struct tariff_rcu_slot *slot;
+    struct tariff_book *book;
+
+    pthread_mutex_lock(&tariff_rcu_writer);
+    slot = tariff_rcu_slot_of(version);
+    if (slot == NULL || atomic_load(&slot->book) == atomic_load(&tariff_current_book))
+    {
+        pthread_mutex_unlock(&tariff_rcu_writer);
+        return;
+    }
+    book = atomic_exchange(&slot->book, NULL);
+
+    /* A reader that loaded the pointer before the exchange is done after the grace period.  */
+    tariff_rcu_flip_and_wait();
+    tariff_rcu_flip_and_wait();
+    pthread_mutex_unlock(&tariff_rcu_writer);
+
+    tariff_book_destroy(book);
+    printf("Tariff version %u is retired\n", version);
+}
@@ -0,0 +1,114 @@
+/**
+ * @file 	tariff_rcu.h
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-18
+ * @brief 	Header file containing declarations for publishing tariff versions.
+ *
+ * The current tariff book is published through an RCU pointer. Readers (the client
+ * threads) don't take a lock: they enter a read section, which is two atomic counter
+ * updates, and use any book of a registered version until they leave it.
+ * The writer (the repricing thread) publishes a new version and waits for a grace
+ * period, after which no reader can still see a book it removed, before freeing it.
+ *
+ * Every version is kept with the time it took effect, so the charge of a session
+ * that was priced under an older version can be split at each change of tariffs.
+ */
+#ifndef TARIFF_RCU_H
+#define TARIFF_RCU_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "tariff.h"
+
+/* Versions that can be registered at the same time, the current one and those not retired yet.  */
+#define TARIFF_RCU_MAX_VERSIONS 16
+/* Microseconds the writer sleeps between checks of the readers during a grace period.  */
+#define TARIFF_RCU_GRACE_PERIOD_POLL_US 1000
+
+/**
+ * @brief Publish the first tariff version.
+ *
+ * @param book Pointer to the book, is owned by the registry from now on.
+ * @param effective_time Unix time the version took effect.
+ * @return TRUE on success, FALSE otherwise.
+ */
+uint8_t tariff_rcu_init(struct tariff_book *book, int64_t effective_time);
+
+/**
+ * @brief Free every registered book, when no reader is left.
+ */
+void tariff_rcu_destroy(void);
+
+/**
+ * @brief Enter a read section.
+ *
+ * The books returned inside the section stay valid until tariff_read_unlock.
+ *
+ * @return A token that has to be passed to tariff_read_unlock.
+ */
+int tariff_read_lock(void);
+
+/**
+ * @brief Leave a read section.
+ *
+ * @param token The value returned by tariff_read_lock.
+ */
+void tariff_read_unlock(int token);
+
+/**
+ * @brief Get the current tariff book, inside a read section.
+ *
+ * @return Pointer to the book.
+ */
+const struct tariff_book *tariff_current(void);
+
+/**
+ * @brief Get the book of a registered version, inside a read section.
+ *
+ * @param version The version.
+ * @return Pointer to the book, NULL if the version was retired or never published.
+ */
+const struct tariff_book *tariff_version_book(uint32_t version);
+
+/**
+ * @brief Calculate the charge of a session priced under a version, inside a read section.
+ *
+ * The interval is split at the effective time of every later version, and each part
+ * is charged by the version that was in effect.
+ *
+ * @param version The version the session is priced under.
+ * @param zone_id The zone id.
+ * @param start_time Unix time the not yet charged part of the session started.
+ * @param end_time Unix time the session ended.
+ * @return The charge in minor units.
+ */
+int64_t tariff_session_cost(uint32_t version, uint16_t zone_id, int64_t start_time, int64_t end_time);
+
+/**
+ * @brief Make a new version the current one.
+ *
+ * @param book Pointer to the book, its version has to be higher than the current one.
+ *        Is owned by the registry from now on.
+ * @param effective_time Unix time the version takes effect.
+ * @return TRUE on success, FALSE if the version is not new or there is no free slot.
+ */
+uint8_t tariff_publish(struct tariff_book *book, int64_t effective_time);
+
+/**
+ * @brief Wait until every read section that started before the call has ended.
+ */
+void tariff_synchronize(void);
+
+/**
+ * @brief Remove an old version and free its book after a grace period.
+ *
+ * No session should be priced under the version anymore.
+ *
+ * @param version The version, the current one is not retired.
+ */
+void tariff_retire(uint32_t version);
+
+#endif /*TARIFF_RCU_H*/
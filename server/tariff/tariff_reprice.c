@@ -0,0 +1,145 @@
+/**
+ * @file    tariff_reprice.c
+ * @author  Vlad Kulikov
+ * @date    2026-10-18
+ * @brief   Implementation of the tariff repricing thread.
+ */
+#include "tariff_reprice.h"
+
+/**
+ * @brief Publish a new tariff version and reprice the active sessions.
+ *
+ * @param client Pointer to the array of SERVER_MAX_NUM_CLIENTS client structures.
+ * @param book Pointer to the book of the new version, is owned by the registry from now on.
+ * @param effective_time Unix time the version takes effect.
+ * @return Number of repriced sessions.
+ */
+size_t tariff_reprice_sessions(struct pango_data *client, struct tariff_book *book, int64_t effective_time)
+{
+    int64_t start_time[SERVER_MAX_NUM_CLIENTS], end_time[SERVER_MAX_NUM_CLIENTS], charges[SERVER_MAX_NUM_CLIENTS];
+    uint16_t zone_id[SERVER_MAX_NUM_CLIENTS], version_index[SERVER_MAX_NUM_CLIENTS];
+    uint32_t old_version[SERVER_MAX_NUM_CLIENTS];
+    uint64_t priced_from_ns[SERVER_MAX_NUM_CLIENTS];
+    int session[SERVER_MAX_NUM_CLIENTS];
+    const struct tariff_book *books[TARIFF_RCU_MAX_VERSIONS] = {NULL};
+    struct billing_batch batch = {0, start_time, end_time, zone_id, version_index};
+    uint32_t new_version = book->version, previous_version;
+    uint64_t effective_ns = server_clock_from_wall(effective_time);
+    size_t repriced = 0;
+    int token;
+
+    token = tariff_read_lock();
+    previous_version = tariff_current()->version;
+    tariff_read_unlock(token);
+
+    if (tariff_publish(book, effective_time) != TRUE)
+    {
+        tariff_book_destroy(book);
+        return 0;
+    }
+
+    /* Every session that read an old version is connected by now,
+       since the version is read in the same mutex section that sets 'connected'.  */
+    pthread_mutex_lock(&mutex);
+    for (int i = 0; i < SERVER_MAX_NUM_CLIENTS; ++i)
+    {
+        if (client[i].connected == TRUE && client[i].tariff_version != new_version)
+        {
+            session[batch.count] = i;
+            old_version[batch.count] = client[i].tariff_version;
+            priced_from_ns[batch.count] = client[i].priced_from_ns;
+            start_time[batch.count] = server_clock_to_wall(client[i].priced_from_ns);
+            end_time[batch.count] = effective_time;
+            zone_id[batch.count] = client[i].zone_id;
+            version_index[batch.count] = client[i].tariff_version % TARIFF_RCU_MAX_VERSIONS;
+            ++batch.count;
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+
+    /* The old books can't be retired while they are charged, only this thread retires.  */
+    token = tariff_read_lock();
+    for (size_t i = 0; i < batch.count; ++i)
+    {
+        books[version_index[i]] = tariff_version_book(old_version[i]);
+    }
+    batch_billing_run(&batch, books, TARIFF_RCU_MAX_VERSIONS, charges, BILLING_KERNEL_AUTO);
+    tariff_read_unlock(token);
+
+    /* A session that closed meanwhile was charged in full by its own thread.  */
+    pthread_mutex_lock(&mutex);
+    for (size_t i = 0; i < batch.count; ++i)
+    {
+        struct pango_data *repriced_client = &client[session[i]];
+
+        if (repriced_client->connected == TRUE && repriced_client->tariff_version == old_version[i] &&
+            repriced_client->priced_from_ns == priced_from_ns[i])
+        {
+            /* The client thread reads the pricing without the mutex, see send_quote_to_client.  */
+            __atomic_store_n(&repriced_client->pricing_seq, repriced_client->pricing_seq + 1, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            __atomic_store_n(&repriced_client->charge, repriced_client->charge + charges[i], __ATOMIC_RELAXED);
+            if (repriced_client->priced_from_ns < effective_ns)
+            {
+                __atomic_store_n(&repriced_client->priced_from_ns, effective_ns, __ATOMIC_RELAXED);
+            }
+            __atomic_store_n(&repriced_client->tariff_version, new_version, __ATOMIC_RELAXED);
+            __atomic_store_n(&repriced_client->pricing_seq, repriced_client->pricing_seq + 1, __ATOMIC_RELEASE);
+            ++repriced;
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+
+    /* No session is priced under the old versions anymore.  */
+    tariff_retire(previous_version);
+    for (size_t i = 0; i < batch.count; ++i)
+    {
+        tariff_retire(old_version[i]);
+    }
+    printf("Tariff version %u: repriced %zu of %zu active sessions\n", new_version, repriced, batch.count);
+    return repriced;
+}
+
+/**
+ * @brief Tariff repricing thread function.
+ *
+ * Runs until 'return_thread' is set.
+ *
+ * @param address_buffer_of_clinets_data_structs Pointer to the array of SERVER_MAX_NUM_CLIENTS client structures.
+ * @return None.
+ */
+void *tariff_reprice(void *address_buffer_of_clinets_data_structs)
+{
+    struct pango_data *client = (struct pango_data *)address_buffer_of_clinets_data_structs;
+
+    while (return_thread != TRUE)
+    {
+        /* The versions take effect by the wall clock, as the sessions are priced.  */
+        int64_t now = server_clock_to_wall(server_clock_coarse_ns()), effective_time;
+        uint32_t current_version, next_version;
+        int token;
+
+        token = tariff_read_lock();
+        current_version = tariff_current()->version;
+        tariff_read_unlock(token);
+
+        /* The rows of the new version can be changed until it takes effect, so it is loaded then.  */
+        if (tariff_next_version(db_prices, current_version, &next_version, &effective_time) == TRUE &&
+            effective_time <= now)
+        {
+            struct tariff_book *book = tariff_load(db_prices, next_version);
+
+            if (book == NULL)
+            {
+                perror("tariff_reprice: tariff_load");
+            }
+            else
+            {
+                tariff_reprice_sessions(client, book, effective_time);
+            }
+        }
+        sleep(TARIFF_REPRICE_POLL_SECONDS);
+    }
+    printf("Out of tariff repricing thread\n");
+    pthread_exit(NULL);
+}
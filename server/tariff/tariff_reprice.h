@@ -0,0 +1,53 @@
+/**
+ * @file 	tariff_reprice.h
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-18
+ * @brief 	Header file containing declarations for the tariff repricing thread.
+ *
+ * The thread watches the 'tariff_version' table of the price database. When a new
+ * version takes effect, it loads and publishes it, then reprices every active session:
+ * the part of the session before the effective time is charged by the old version
+ * and the rest is left to the new one. The charges are calculated with the batch
+ * billing kernels on the repricing thread itself, the SERVER_MAX_NUM_CLIENTS
+ * sessions are too few to be worth splitting between threads.
+ * Once no session is priced under the old version, it is retired.
+ */
+#ifndef TARIFF_REPRICE_H
+#define TARIFF_REPRICE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "tariff_rcu.h"
+#include "../billing/batch_billing.h"
+#include "../client/client_thread.h"
+#include "../database/price_db/tariff_loader.h"
+
+/* Seconds between checks of the 'tariff_version' table.  */
+#define TARIFF_REPRICE_POLL_SECONDS 1
+
+extern volatile uint8_t return_thread;
+
+/**
+ * @brief Tariff repricing thread function.
+ *
+ * Runs until 'return_thread' is set.
+ *
+ * @param address_buffer_of_clinets_data_structs Pointer to the array of SERVER_MAX_NUM_CLIENTS client structures.
+ * @return None.
+ */
+void *tariff_reprice(void *address_buffer_of_clinets_data_structs);
+
+/**
+ * @brief Publish a new tariff version and reprice the active sessions.
+ *
+ * @param client Pointer to the array of SERVER_MAX_NUM_CLIENTS client structures.
+ * @param book Pointer to the book of the new version, is owned by the registry from now on.
+ * @param effective_time Unix time the version takes effect.
+ * @return Number of repriced sessions.
+ */
+size_t tariff_reprice_sessions(struct pango_data *client, struct tariff_book *book, int64_t effective_time);
+
+#endif /*TARIFF_REPRICE_H*/
@@ -0,0 +1,106 @@
+/**
+ * @file    tariff_snapshot.c
+ * @author  Vlad Kulikov
+ * @date    2026-10-19
+ * @brief   Implementation of the zone and tariff snapshot of the BBB.
+ */
+#include "tariff_snapshot.h"
+
+/**
+ * @brief Write a little-endian field.
+ *
+ * @param buff Destination.
+ * @param value The value.
+ * @param size Size of the field in bytes.
+ */
+static void tariff_snapshot_put_le(uint8_t *buff, uint32_t value, uint8_t size)
+{
+    for (uint8_t i = 0; i < size; i++)
+    {
+        buff[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+/**
+ * @brief Count the runs of equal rates in the week of a zone.
+ *
+ * @param zone Pointer to the zone tariff.
+ * @return Number of runs.
+ */
+static uint8_t tariff_snapshot_runs(const struct tariff_zone *zone)
+{
+    uint8_t runs = 1;
+
+    for (int hour = 1; hour < TARIFF_HOURS_PER_WEEK; hour++)
+    {
+        if (zone->hour_rate[hour] != zone->hour_rate[hour - 1])
+        {
+            runs++;
+        }
+    }
+    return runs;
+}
+
+/**
+ * @brief Encode the zone index and a tariff book into a snapshot.
+ *
+ * @param book Pointer to the book.
+ * @param buff Destination buffer.
+ * @param size Size of the buffer, TARIFF_SNAPSHOT_MAX_SIZE is always enough.
+ * @return Size of the snapshot, 0 if it doesn't fit.
+ */
+size_t tariff_snapshot_encode(const struct tariff_book *book, uint8_t *buff, size_t size)
+{
+    size_t used = TARIFF_SNAPSHOT_HEADER_SIZE + (size_t)book->utc_offset_count * TARIFF_SNAPSHOT_OFFSET_SIZE;
+
+    if (size < used + 1)
+    {
+        return 0;
+    }
+    tariff_snapshot_put_le(&buff[0], book->version, 4);
+    buff[4] = book->utc_offset_count;
+    buff[5] = ZONE_BORDER_COORDINATE;
+    buff[6] = ZONE_MAX_COORDINATE;
+    /* The quadrants are asked from the index, so the snapshot follows any change of the borders.  */
+    buff[7] = (uint8_t)zone_id_from_coordinates(0, 0);
+    buff[8] = (uint8_t)zone_id_from_coordinates(0, ZONE_MAX_COORDINATE);
+    buff[9] = (uint8_t)zone_id_from_coordinates(ZONE_MAX_COORDINATE, 0);
+    buff[10] = (uint8_t)zone_id_from_coordinates(ZONE_MAX_COORDINATE, ZONE_MAX_COORDINATE);
+    buff[11] = ZONE_COUNT - 1;
+
+    for (uint8_t i = 0; i < book->utc_offset_count; i++)
+    {
+        uint8_t *offset = &buff[TARIFF_SNAPSHOT_HEADER_SIZE + i * TARIFF_SNAPSHOT_OFFSET_SIZE];
+
+        tariff_snapshot_put_le(&offset[0], (i == 0) ? 0 : (uint32_t)book->utc_offset_from[i], 4);
+        tariff_snapshot_put_le(&offset[4], (uint32_t)book->utc_offset[i], 4);
+    }
+
+    for (uint16_t zone_id = ZONE_INVALID + 1; zone_id < ZONE_COUNT; zone_id++)
+    {
+        const struct tariff_zone *zone = &book->zone[zone_id];
+        uint8_t runs = tariff_snapshot_runs(zone);
+
+        if (used + TARIFF_SNAPSHOT_ZONE_SIZE + (size_t)runs * TARIFF_SNAPSHOT_RUN_SIZE + 1 > size)
+        {
+            return 0;
+        }
+        buff[used] = (uint8_t)zone_id;
+        memcpy(&buff[used + 1], zone_name(zone_id), ZONE_NAME_SIZE);
+        buff[used + 1 + ZONE_NAME_SIZE] = runs;
+        used += TARIFF_SNAPSHOT_ZONE_SIZE;
+
+        for (int hour = 0; hour < TARIFF_HOURS_PER_WEEK; hour++)
+        {
+            if (hour == 0 || zone->hour_rate[hour] != zone->hour_rate[hour - 1])
+            {
+                buff[used] = (uint8_t)hour;
+                tariff_snapshot_put_le(&buff[used + 1], (uint32_t)zone->hour_rate[hour], 4);
+                used += TARIFF_SNAPSHOT_RUN_SIZE;
+            }
+        }
+    }
+
+    buff[used] = crc8_compute(buff, used);
+    return used + 1;
+}
@@ -0,0 +1,59 @@
+/**
+ * @file 	tariff_snapshot.h
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-19
+ * @brief 	Header file containing declarations for the zone and tariff snapshot of the BBB.
+ *
+ * The snapshot lets a BBB resolve the city of a START and show its rate as soon
+ * as the STM frame arrives, without waiting for the LOCATION reply. It is only
+ * a display aid: the server still resolves the zone and bills every session.
+ *
+ * | version u32 | offset count u8 | border u8 | max u8 | zone id of 4 quadrants | zone count u8 | offsets | zones | crc8 |
+ *
+ * The offsets are the schedule of the book, each one is | from u32 | utc_offset i32 |,
+ * the seconds added to the unix time to get the local time from 'from' on, up
+ * to the next one. The first one also holds before its 'from', which is 0.
+ * The quadrants are (x <= border, y <= border), (x <= border, y > border),
+ * (x > border, y <= border) and (x > border, y > border); a coordinate above
+ * 'max' is in no zone. Every zone is:
+ *
+ * | id u8 | name ZONE_NAME_SIZE | run count u8 | runs |
+ *
+ * The hour rates of the epoch aligned week are run-length encoded, each run is
+ * | first hour of the week u8 | minor units per hour u32 | and lasts up to the
+ * next one. Multi-byte fields are little-endian, the CRC-8 covers every byte before it.
+ */
+#ifndef TARIFF_SNAPSHOT_H
+#define TARIFF_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "tariff.h"
+#include "../zone/zone_index.h"
+#include "../../common/crc8/crc8.h"
+
+/* Number of quadrants of the zone index.  */
+#define TARIFF_SNAPSHOT_QUADRANTS 4
+/* Size of the fields before the offsets, the zone count included.  */
+#define TARIFF_SNAPSHOT_HEADER_SIZE (4 + 1 + 1 + 1 + TARIFF_SNAPSHOT_QUADRANTS + 1)
+/* Size of one entry of the offset schedule.  */
+#define TARIFF_SNAPSHOT_OFFSET_SIZE 8
+/* Size of a zone without its runs.  */
+#define TARIFF_SNAPSHOT_ZONE_SIZE (1 + ZONE_NAME_SIZE + 1)
+/* Size of one run of hour rates.  */
+#define TARIFF_SNAPSHOT_RUN_SIZE 5
+/* The largest snapshot, when the rate of every zone changes every hour.  */
+#define TARIFF_SNAPSHOT_MAX_SIZE (TARIFF_SNAPSHOT_HEADER_SIZE + TARIFF_MAX_UTC_OFFSETS * TARIFF_SNAPSHOT_OFFSET_SIZE + \
+								  (ZONE_COUNT - 1) * (TARIFF_SNAPSHOT_ZONE_SIZE + TARIFF_HOURS_PER_WEEK * TARIFF_SNAPSHOT_RUN_SIZE) + 1)
+
+/**
+ * @brief Encode the zone index and a tariff book into a snapshot.
+ *
+ * @param book Pointer to the book.
+ * @param buff Destination buffer.
+ * @param size Size of the buffer, TARIFF_SNAPSHOT_MAX_SIZE is always enough.
+ * @return Size of the snapshot, 0 if it doesn't fit.
+ */
+size_t tariff_snapshot_encode(const struct tariff_book *book, uint8_t *buff, size_t size);
+
+#endif /*TARIFF_SNAPSHOT_H*/
@@ -0,0 +1,125 @@
+/**
+ * @file    timer_bench.c
+ * @author  Vlad Kulikov
+ * @date    2026-10-18
+ * @brief   Benchmark of the hierarchical timer wheel.
+ *
+ * Adds timers spread over a day, cancels a quarter of them and moves another
+ * quarter, then lets a simulated day pass by moving the origin of the wheel
+ * back, BENCH_STEP_TICKS at a time. Every timer that fires is checked to
+ * expire neither before its tick nor after the step it belongs to, and every
+ * timer that wasn't cancelled must fire exactly once.
+ *
+ * Usage: ./timer_bench [timers, in millions]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "timer_wheel.h"
+
+#define BENCH_DEFAULT_MILLIONS 1
+#define BENCH_DAY_MS (24ULL * 60 * 60 * 1000)
+#define BENCH_STEP_TICKS 10
+
+struct timer_wheel server_timers;
+
+static uint64_t bench_tick_before;
+static size_t bench_fired, bench_early, bench_late;
+
+/**
+ * @brief Seconds of the monotonic clock.
+ */
+static double bench_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Timer callback, checks the timer fires in the step of its tick.
+ */
+static void bench_expired(struct timer_entry *entry, void *fired)
+{
+    ++*(uint32_t *)fired;
+    ++bench_fired;
+    if (entry->expires > (timer_wheel_now_ms() - server_timers.origin_ms) / TIMER_WHEEL_TICK_MS)
+    {
+        ++bench_early;
+    }
+    if (entry->expires < bench_tick_before)
+    {
+        ++bench_late;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t millions = (argc > 1) ? strtoul(argv[1], NULL, 10) : BENCH_DEFAULT_MILLIONS;
+    size_t count = millions * 1000000, cancelled = 0, wrong = 0, steps = 0;
+    struct timer_entry *timers = malloc(count * sizeof(*timers));
+    uint32_t *fired = calloc(count, sizeof(*fired));
+    double begin, add_time, cancel_time, move_time, run_time;
+
+    if (count == 0 || timers == NULL || fired == NULL || timer_wheel_init(&server_timers) != 0)
+    {
+        perror("timer_bench: malloc");
+        return EXIT_FAILURE;
+    }
+
+    srand(55152);
+    begin = bench_now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        timer_entry_init(&timers[i], bench_expired, &fired[i]);
+        timer_wheel_add(&server_timers, &timers[i], ((uint64_t)rand() << 16 ^ rand()) % BENCH_DAY_MS);
+    }
+    add_time = bench_now() - begin;
+
+    begin = bench_now();
+    for (size_t i = 0; i < count; i += 4)
+    {
+        timer_wheel_cancel(&server_timers, &timers[i]);
+        ++cancelled;
+    }
+    cancel_time = bench_now() - begin;
+
+    begin = bench_now();
+    for (size_t i = 1; i < count; i += 4)
+    {
+        timer_wheel_add(&server_timers, &timers[i], ((uint64_t)rand() << 16 ^ rand()) % BENCH_DAY_MS);
+    }
+    move_time = bench_now() - begin;
+
+    /* A simulated day, the real time the loop takes is added to it.  */
+    begin = bench_now();
+    while (bench_fired + cancelled < count)
+    {
+        bench_tick_before = server_timers.tick;
+        server_timers.origin_ms -= BENCH_STEP_TICKS * TIMER_WHEEL_TICK_MS;
+        timer_wheel_run(&server_timers);
+        ++steps;
+    }
+    run_time = bench_now() - begin;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (fired[i] != ((i % 4 == 0) ? 0 : 1))
+        {
+            ++wrong;
+        }
+    }
+
+    printf("timer_bench: %zu timers over a day, %zu steps of %d ms\n", count, steps, BENCH_STEP_TICKS * TIMER_WHEEL_TICK_MS);
+    printf("  add    %7.1f ns per timer\n", add_time * 1e9 / count);
+    printf("  cancel %7.1f ns per timer\n", cancel_time * 1e9 / cancelled);
+    printf("  move   %7.1f ns per timer\n", move_time * 1e9 / (count / 4));
+    printf("  expire %7.1f ns per timer, cascades included\n", run_time * 1e9 / bench_fired);
+    printf("  %zu fired, %zu early, %zu late, %zu fired a wrong number of times: %s\n",
+           bench_fired, bench_early, bench_late, wrong, (bench_early || bench_late || wrong) ? "FAILED" : "ok");
+
+    timer_wheel_destroy(&server_timers);
+    free(timers);
+    free(fired);
+    return (bench_early || bench_late || wrong) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
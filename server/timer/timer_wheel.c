@@ -0,0 +1,379 @@
+/**
+ * @file    timer_wheel.c
+ * @author  Vlad Kulikov
+ * @date    2026-10-18
+ * @brief   Implementation of the hierarchical timer wheel of the server.
+ */
+#include "timer_wheel.h"
+
+/* The driving thread isn't sleeping.  */
+#define TIMER_WHEEL_AWAKE UINT64_MAX
+
+/**
+ * @brief Get the monotonic time.
+ *
+ * @return Milliseconds since an arbitrary point.
+ */
+uint64_t timer_wheel_now_ms(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Get the tick of the wheel a monotonic time falls in.
+ */
+static uint64_t timer_wheel_tick_of(const struct timer_wheel *wheel, uint64_t time_ms)
+{
+    /* The origin is never after the monotonic time, the difference is right even when it wrapped around.  */
+    return (time_ms - wheel->origin_ms) / TIMER_WHEEL_TICK_MS;
+}
+
+static void timer_list_init(struct timer_entry *head)
+{
+    head->next = head->prev = head;
+}
+
+static void timer_list_insert(struct timer_entry *head, struct timer_entry *entry)
+{
+    entry->prev = head->prev;
+    entry->next = head;
+    head->prev->next = entry;
+    head->prev = entry;
+}
+
+static void timer_list_remove(struct timer_entry *entry)
+{
+    entry->prev->next = entry->next;
+    entry->next->prev = entry->prev;
+    entry->next = entry->prev = entry;
+}
+
+/**
+ * @brief Move all the timers of the list 'from' to the end of the list 'to'.
+ */
+static void timer_list_splice(struct timer_entry *from, struct timer_entry *to)
+{
+    if (from->next == from)
+    {
+        return;
+    }
+    from->next->prev = to->prev;
+    to->prev->next = from->next;
+    from->prev->next = to;
+    to->prev = from->prev;
+    timer_list_init(from);
+}
+
+/**
+ * @brief Put a timer in the slot of its expiry, on the lowest level whose range it is in.
+ *
+ * Must be called with the lock of the wheel.
+ */
+static void timer_wheel_place(struct timer_wheel *wheel, struct timer_entry *entry)
+{
+    uint64_t delta;
+    size_t level = 0, index;
+
+    if (entry->expires < wheel->tick)
+    {
+        entry->expires = wheel->tick;
+    }
+    delta = entry->expires - wheel->tick;
+    if (delta > TIMER_WHEEL_MAX_TICKS)
+    {
+        entry->expires = wheel->tick + TIMER_WHEEL_MAX_TICKS;
+        delta = TIMER_WHEEL_MAX_TICKS;
+    }
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1ULL << (TIMER_WHEEL_LEVEL_BITS * (level + 1))))
+    {
+        ++level;
+    }
+    index = (entry->expires >> (TIMER_WHEEL_LEVEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+    timer_list_insert(&wheel->slot[level][index], entry);
+    if (level == 0)
+    {
+        wheel->occupied[index / 64] |= 1ULL << (index % 64);
+    }
+}
+
+/**
+ * @brief Move the timers of a slot of a higher level down to the levels below.
+ *
+ * The slot is emptied first, a timer placed in it again is moved on the next cascade.
+ */
+static void timer_wheel_cascade(struct timer_wheel *wheel, size_t level, size_t index)
+{
+    struct timer_entry list;
+
+    timer_list_init(&list);
+    timer_list_splice(&wheel->slot[level][index], &list);
+    while (list.next != &list)
+    {
+        struct timer_entry *entry = list.next;
+
+        timer_list_remove(entry);
+        timer_wheel_place(wheel, entry);
+    }
+}
+
+/**
+ * @brief Find the next tick at or after wheel->tick that may have timers to expire.
+ *
+ * That is the next slot of level 0 that has timers, or the start of the next
+ * rotation of level 0 where the higher levels cascade; waking too early costs nothing.
+ */
+static uint64_t timer_wheel_next_tick(const struct timer_wheel *wheel)
+{
+    size_t index = wheel->tick & (TIMER_WHEEL_SLOTS - 1);
+    uint64_t rotation = wheel->tick - index;
+
+    /* The start of a rotation cascades.  */
+    if (index == 0)
+    {
+        return wheel->tick;
+    }
+    for (size_t word = index / 64; word < TIMER_WHEEL_SLOTS / 64; ++word)
+    {
+        uint64_t bits = wheel->occupied[word];
+
+        if (word == index / 64)
+        {
+            bits &= ~0ULL << (index % 64);
+        }
+        if (bits != 0)
+        {
+            return rotation + word * 64 + __builtin_ctzll(bits);
+        }
+    }
+    return rotation + TIMER_WHEEL_SLOTS;
+}
+
+/**
+ * @brief Process the ticks up to and including 'target': cascade and collect the expired timers.
+ *
+ * Ticks without timers are skipped, so a long sleep costs one step per rotation of level 0.
+ */
+static void timer_wheel_advance(struct timer_wheel *wheel, uint64_t target)
+{
+    while (wheel->tick <= target)
+    {
+        size_t index = wheel->tick & (TIMER_WHEEL_SLOTS - 1);
+        uint64_t next;
+
+        if (index == 0)
+        {
+            for (size_t level = 1; level < TIMER_WHEEL_LEVELS; ++level)
+            {
+                size_t level_index = (wheel->tick >> (TIMER_WHEEL_LEVEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+
+                timer_wheel_cascade(wheel, level, level_index);
+                if (level_index != 0)
+                {
+                    break;
+                }
+            }
+        }
+        timer_list_splice(&wheel->slot[0][index], &wheel->expired);
+        wheel->occupied[index / 64] &= ~(1ULL << (index % 64));
+        ++wheel->tick;
+
+        next = timer_wheel_next_tick(wheel);
+        wheel->tick = (next <= target) ? next : target + 1;
+    }
+}
+
+/**
+ * @brief Initialize a wheel, its tick 0 is now.
+ *
+ * @param wheel Pointer to the wheel.
+ * @return 0 on success, -1 on error.
+ */
+int timer_wheel_init(struct timer_wheel *wheel)
+{
+    pthread_condattr_t attr;
+
+    memset(wheel, 0, sizeof(*wheel));
+    if (pthread_mutex_init(&wheel->lock, NULL) != 0)
+    {
+        perror("timer_wheel_init: pthread_mutex_init");
+        return -1;
+    }
+    /* The driving thread sleeps until a monotonic time, a change of the wall clock can't delay the timers.  */
+    if (pthread_condattr_init(&attr) != 0 || pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) != 0 ||
+        pthread_cond_init(&wheel->changed, &attr) != 0)
+    {
+        perror("timer_wheel_init: pthread_cond_init");
+        pthread_mutex_destroy(&wheel->lock);
+        return -1;
+    }
+    pthread_condattr_destroy(&attr);
+
+    for (size_t level = 0; level < TIMER_WHEEL_LEVELS; ++level)
+    {
+        for (size_t index = 0; index < TIMER_WHEEL_SLOTS; ++index)
+        {
+            timer_list_init(&wheel->slot[level][index]);
+        }
+    }
+    timer_list_init(&wheel->expired);
+    wheel->origin_ms = timer_wheel_now_ms();
+    wheel->wake_tick = TIMER_WHEEL_AWAKE;
+    return 0;
+}
+
+/**
+ * @brief Release the resources of a wheel, its timers are dropped.
+ *
+ * @param wheel Pointer to the wheel.
+ */
+void timer_wheel_destroy(struct timer_wheel *wheel)
+{
+    pthread_cond_destroy(&wheel->changed);
+    pthread_mutex_destroy(&wheel->lock);
+}
+
+/**
+ * @brief Initialize a timer, before it is added the first time.
+ *
+ * @param entry Pointer to the timer.
+ * @param callback Function called when the timer expires.
+ * @param arg Argument of the callback.
+ */
+void timer_entry_init(struct timer_entry *entry, timer_callback callback, void *arg)
+{
+    timer_list_init(entry);
+    entry->expires = 0;
+    entry->callback = callback;
+    entry->arg = arg;
+    entry->pending = 0;
+}
+
+/**
+ * @brief Add a timer, or move it when it is pending already.
+ *
+ * @param wheel Pointer to the wheel.
+ * @param entry Pointer to the timer.
+ * @param delay_ms Milliseconds from now, rounded up to a tick.
+ */
+void timer_wheel_add(struct timer_wheel *wheel, struct timer_entry *entry, uint64_t delay_ms)
+{
+    uint64_t now_ms = timer_wheel_now_ms();
+
+    pthread_mutex_lock(&wheel->lock);
+    if (entry->pending)
+    {
+        timer_list_remove(entry);
+        --wheel->pending;
+    }
+    /* The tick of now has begun already, so the timer is never early.  */
+    entry->expires = timer_wheel_tick_of(wheel, now_ms) + (delay_ms + TIMER_WHEEL_TICK_MS - 1) / TIMER_WHEEL_TICK_MS + 1;
+    entry->pending = 1;
+    ++wheel->pending;
+    timer_wheel_place(wheel, entry);
+
+    if (entry->expires < wheel->wake_tick)
+    {
+        pthread_cond_broadcast(&wheel->changed);
+    }
+    pthread_mutex_unlock(&wheel->lock);
+}
+
+/**
+ * @brief Cancel a timer.
+ *
+ * Waits for the callback of the timer when it runs now, so the memory of the
+ * timer may be released once this returns. It must not be called by the
+ * callback of the timer itself, nor with a lock that callback takes.
+ *
+ * @param wheel Pointer to the wheel.
+ * @param entry Pointer to the timer, pending or not.
+ */
+void timer_wheel_cancel(struct timer_wheel *wheel, struct timer_entry *entry)
+{
+    pthread_mutex_lock(&wheel->lock);
+    while (wheel->running == entry)
+    {
+        pthread_cond_wait(&wheel->changed, &wheel->lock);
+    }
+    /* The bit of its slot in 'occupied' may stay set, that only wakes the driving thread once for nothing.  */
+    if (entry->pending)
+    {
+        timer_list_remove(entry);
+        entry->pending = 0;
+        --wheel->pending;
+    }
+    pthread_mutex_unlock(&wheel->lock);
+}
+
+/**
+ * @brief Sleep until the next timers expire, or timer_wheel_wake is called, and run them.
+ *
+ * @param wheel Pointer to the wheel.
+ * @return Number of callbacks run.
+ */
+size_t timer_wheel_run(struct timer_wheel *wheel)
+{
+    size_t run = 0;
+    uint64_t target;
+
+    pthread_mutex_lock(&wheel->lock);
+    target = timer_wheel_tick_of(wheel, timer_wheel_now_ms());
+    if (wheel->tick > target && wheel->expired.next == &wheel->expired)
+    {
+        if (wheel->pending == 0)
+        {
+            pthread_cond_wait(&wheel->changed, &wheel->lock);
+        }
+        else
+        {
+            uint64_t wake_ms;
+            struct timespec deadline;
+
+            wheel->wake_tick = timer_wheel_next_tick(wheel);
+            wake_ms = wheel->origin_ms + wheel->wake_tick * TIMER_WHEEL_TICK_MS;
+            deadline.tv_sec = wake_ms / 1000;
+            deadline.tv_nsec = (wake_ms % 1000) * 1000000;
+            pthread_cond_timedwait(&wheel->changed, &wheel->lock, &deadline);
+        }
+        wheel->wake_tick = TIMER_WHEEL_AWAKE;
+        target = timer_wheel_tick_of(wheel, timer_wheel_now_ms());
+    }
+    timer_wheel_advance(wheel, target);
+
+    while (wheel->expired.next != &wheel->expired)
+    {
+        struct timer_entry *entry = wheel->expired.next;
+        timer_callback callback = entry->callback;
+        void *arg = entry->arg;
+
+        timer_list_remove(entry);
+        entry->pending = 0;
+        --wheel->pending;
+        wheel->running = entry;
+        pthread_mutex_unlock(&wheel->lock);
+
+        callback(entry, arg);
+        ++run;
+
+        pthread_mutex_lock(&wheel->lock);
+        wheel->running = NULL;
+        pthread_cond_broadcast(&wheel->changed);
+    }
+    pthread_mutex_unlock(&wheel->lock);
+    return run;
+}
+
+/**
+ * @brief Make the driving thread return from timer_wheel_run.
+ *
+ * @param wheel Pointer to the wheel.
+ */
+void timer_wheel_wake(struct timer_wheel *wheel)
+{
+    pthread_mutex_lock(&wheel->lock);
+    pthread_cond_broadcast(&wheel->changed);
+    pthread_mutex_unlock(&wheel->lock);
+}
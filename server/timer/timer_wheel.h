@@ -0,0 +1,148 @@
+/**
+ * @file 	timer_wheel.h
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-18
+ * @brief 	Header file containing declarations for the hierarchical timer wheel of the server.
+ *
+ * The timers of the server (the D.B flush tick, the idle timeouts of the
+ * connections and the parking reminders of the sessions) are kept in one wheel
+ * of TIMER_WHEEL_LEVELS levels of TIMER_WHEEL_SLOTS slots:
+ *	level 0 holds the timers of the next 256 ticks, one slot per tick,
+ *	level 1 the timers of the next 256 * 256 ticks, one slot per 256 ticks, and so on.
+ * Every slot is an intrusive doubly linked list, so adding and cancelling a timer is O(1).
+ * When level 0 wraps around, the next slot of level 1 is cascaded down, and so on
+ * up the levels; a timer is moved at most once per level.
+ *
+ * The wheel has no thread of its own: the thread that drives it sleeps in
+ * timer_wheel_run until the next slot that has timers, and runs their
+ * callbacks without the lock of the wheel, so they may add timers themselves.
+ */
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+/* Resolution of the timers.  */
+#define TIMER_WHEEL_TICK_MS 100
+#define TIMER_WHEEL_LEVEL_BITS 8
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_LEVEL_BITS)
+/* Four levels of 8 bits cover 2^32 ticks, more than 13 years.  */
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_MAX_TICKS ((1ULL << (TIMER_WHEEL_LEVEL_BITS * TIMER_WHEEL_LEVELS)) - 1)
+
+struct timer_entry;
+
+/**
+ * @brief Called by the driving thread when a timer expires, without the lock of the wheel.
+ *
+ * @param entry The timer, no longer pending, it may be added again.
+ * @param arg The argument given to timer_entry_init.
+ */
+typedef void (*timer_callback)(struct timer_entry *entry, void *arg);
+
+/**
+ * @brief A timer, embedded in the structure it belongs to.
+ */
+struct timer_entry
+{
+	struct timer_entry *next;
+	struct timer_entry *prev;
+	uint64_t expires; /*The tick the timer expires at*/
+	timer_callback callback;
+	void *arg;
+	uint8_t pending; /*The timer is in the wheel*/
+};
+
+/**
+ * @brief A hierarchical timer wheel.
+ */
+struct timer_wheel
+{
+	pthread_mutex_t lock;
+	pthread_cond_t changed;	/*Signaled when the driving thread should look at the wheel again*/
+	uint64_t origin_ms;		/*Monotonic time of tick 0*/
+	uint64_t tick;			/*The next tick to process*/
+	uint64_t wake_tick;		/*The tick the driving thread sleeps until*/
+	size_t pending;			/*Timers in the wheel*/
+	const struct timer_entry *running; /*The timer whose callback runs now*/
+	struct timer_entry expired;	/*Head of the timers that expired and wait for their callback*/
+	struct timer_entry slot[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS]; /*Heads of the lists*/
+	uint64_t occupied[TIMER_WHEEL_SLOTS / 64]; /*Bit n is set when slot n of level 0 has timers*/
+};
+
+/* The wheel of the server, driven by the database update thread.  */
+extern struct timer_wheel server_timers;
+
+/**
+ * @brief Get the monotonic time.
+ *
+ * @return Milliseconds since an arbitrary point.
+ */
+uint64_t timer_wheel_now_ms(void);
+
+/**
+ * @brief Initialize a wheel, its tick 0 is now.
+ *
+ * @param wheel Pointer to the wheel.
+ * @return 0 on success, -1 on error.
+ */
+int timer_wheel_init(struct timer_wheel *wheel);
+
+/**
+ * @brief Release the resources of a wheel, its timers are dropped.
+ *
+ * @param wheel Pointer to the wheel.
+ */
+void timer_wheel_destroy(struct timer_wheel *wheel);
+
+/**
+ * @brief Initialize a timer, before it is added the first time.
+ *
+ * @param entry Pointer to the timer.
+ * @param callback Function called when the timer expires.
+ * @param arg Argument of the callback.
+ */
+void timer_entry_init(struct timer_entry *entry, timer_callback callback, void *arg);
+
+/**
+ * @brief Add a timer, or move it when it is pending already.
+ *
+ * @param wheel Pointer to the wheel.
+ * @param entry Pointer to the timer.
+ * @param delay_ms Milliseconds from now, rounded up to a tick.
+ */
+void timer_wheel_add(struct timer_wheel *wheel, struct timer_entry *entry, uint64_t delay_ms);
+
+/**
+ * @brief Cancel a timer.
+ *
+ * Waits for the callback of the timer when it runs now, so the memory of the
+ * timer may be released once this returns. It must not be called by the
+ * callback of the timer itself, nor with a lock that callback takes.
+ *
+ * @param wheel Pointer to the wheel.
+ * @param entry Pointer to the timer, pending or not.
+ */
+void timer_wheel_cancel(struct timer_wheel *wheel, struct timer_entry *entry);
+
+/**
+ * @brief Sleep until the next timers expire, or timer_wheel_wake is called, and run them.
+ *
+ * @param wheel Pointer to the wheel.
+ * @return Number of callbacks run.
+ */
+size_t timer_wheel_run(struct timer_wheel *wheel);
+
+/**
+ * @brief Make the driving thread return from timer_wheel_run.
+ *
+ * @param wheel Pointer to the wheel.
+ */
+void timer_wheel_wake(struct timer_wheel *wheel);
+
+#endif /*TIMER_WHEEL_H*/
@@ -0,0 +1,511 @@
+/**
+ * @file    udp_ingest.c
+ * @author  Vlad Kulikov
+ * @date    2026-10-18
+ * @brief   Implementation of the UDP telemetry ingest thread.
+ */
+#define _GNU_SOURCE
+#include "udp_ingest.h"
+#include "../client/client_thread.h"
+
+/* Receive buffer of the socket, room for bursts of the whole fleet while a batch is applied.  */
+#define UDP_RECEIVE_BUFFER_SIZE (1 << 20)
+/* Marks a datagram of a batch that isn't applied to a unit.  */
+#define UDP_DROPPED 0xFF
+
+/* The units with a UDP key, open addressing with linear probing.  */
+static struct udp_unit udp_units[UDP_UNIT_TABLE_SIZE];
+static size_t udp_unit_count;
+/* Taken by the connection threads that issue and forget keys, and by the ingest thread.
+   It may be taken inside the mutex of the client slots, never the other way round.  */
+static pthread_mutex_t udp_units_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Get the first entry a MAC is probed at.
+ */
+static size_t udp_unit_home(uint64_t mac_key)
+{
+    return (size_t)((mac_key * 0x9E3779B97F4A7C15ULL) >> 32) & (UDP_UNIT_TABLE_SIZE - 1);
+}
+
+/**
+ * @brief Find the entry of a MAC, with udp_units_lock held.
+ *
+ * @param mac_key The MAC address of the unit.
+ * @param free_entry Pointer to store the free entry the MAC would take, NULL if it isn't needed
+ *        (output parameter).
+ * @return The entry, or NULL if the MAC has none.
+ */
+static struct udp_unit *udp_unit_find(uint64_t mac_key, struct udp_unit **free_entry)
+{
+    size_t index = udp_unit_home(mac_key);
+
+    if (free_entry != NULL)
+    {
+        *free_entry = NULL;
+    }
+    /* The entries are removed by a backward shift, so the probe of a MAC ends at the first free entry.  */
+    for (size_t probe = 0; probe < UDP_UNIT_TABLE_SIZE; ++probe)
+    {
+        struct udp_unit *unit = &udp_units[(index + probe) & (UDP_UNIT_TABLE_SIZE - 1)];
+
+        if (unit->mac_key == mac_key)
+        {
+            return unit;
+        }
+        if (unit->mac_key == 0)
+        {
+            if (free_entry != NULL)
+            {
+                *free_entry = unit;
+            }
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Free an entry, with udp_units_lock held.
+ *
+ * The entries after it in the same run are moved back, so no probe passes a free entry.
+ */
+static void udp_unit_remove(struct udp_unit *unit)
+{
+    size_t hole = (size_t)(unit - udp_units);
+    size_t index = hole;
+
+    while (1)
+    {
+        size_t home;
+
+        index = (index + 1) & (UDP_UNIT_TABLE_SIZE - 1);
+        if (udp_units[index].mac_key == 0)
+        {
+            break;
+        }
+        /* An entry may fill the hole when the hole is on its probe, between its home and itself.  */
+        home = udp_unit_home(udp_units[index].mac_key);
+        if (((index - home) & (UDP_UNIT_TABLE_SIZE - 1)) >= ((index - hole) & (UDP_UNIT_TABLE_SIZE - 1)))
+        {
+            udp_units[hole] = udp_units[index];
+            hole = index;
+        }
+    }
+    memset(&udp_units[hole], 0, sizeof(udp_units[hole]));
+    --udp_unit_count;
+}
+
+/**
+ * @brief Get the time a unit was last heard of, over UDP or over its connection.
+ *
+ * The slot of the session is read without its mutex, the time is a hint for
+ * the eviction only.
+ */
+static uint64_t udp_unit_last_seen(const struct udp_unit *unit)
+{
+    uint64_t last_seen_ns = unit->last_seen_ns;
+
+    if (unit->session != NULL && unit->session->mac_key == unit->mac_key)
+    {
+        uint64_t slot_seen_ns = __atomic_load_n(&unit->session->last_seen_ns, __ATOMIC_RELAXED);
+
+        if (slot_seen_ns > last_seen_ns)
+        {
+            last_seen_ns = slot_seen_ns;
+        }
+    }
+    return last_seen_ns;
+}
+
+/**
+ * @brief Free the entry of the unit silent for the longest, with udp_units_lock held.
+ *
+ * A session that ended without a stop the server saw is never closed, so the
+ * unit heard of the longest ago is the likeliest to be gone. The scan is made
+ * when the table is at UDP_UNIT_MAX_LOAD only, never for a datagram.
+ */
+static void udp_unit_evict_oldest(void)
+{
+    struct udp_unit *oldest = NULL;
+    uint64_t oldest_seen_ns = 0;
+
+    for (size_t i = 0; i < UDP_UNIT_TABLE_SIZE; ++i)
+    {
+        uint64_t last_seen_ns;
+
+        if (udp_units[i].mac_key == 0)
+        {
+            continue;
+        }
+        last_seen_ns = udp_unit_last_seen(&udp_units[i]);
+        if (oldest == NULL || last_seen_ns < oldest_seen_ns)
+        {
+            oldest = &udp_units[i];
+            oldest_seen_ns = last_seen_ns;
+        }
+    }
+    if (oldest != NULL)
+    {
+        udp_unit_remove(oldest);
+    }
+}
+
+/**
+ * @brief Issue a new UDP key to the unit of a session that started.
+ *
+ * The key of an earlier session of the unit stops being valid.
+ * Is called by the connection thread before the start is answered.
+ * With the table at UDP_UNIT_MAX_LOAD the unit silent for the longest is forgotten.
+ *
+ * @param session The client slot of the session, its mac_key set.
+ * @param key Buffer for the PROTOCOL_UDP_KEY_SIZE bytes of the key (output parameter).
+ * @return TRUE on success, FALSE if no random key could be made.
+ */
+uint8_t udp_unit_open(struct pango_data *session, uint8_t *key)
+{
+    struct udp_unit *unit, *free_entry;
+
+    if (session->mac_key == 0 || getrandom(key, PROTOCOL_UDP_KEY_SIZE, 0) != PROTOCOL_UDP_KEY_SIZE)
+    {
+        return FALSE;
+    }
+
+    pthread_mutex_lock(&udp_units_lock);
+    unit = udp_unit_find(session->mac_key, &free_entry);
+    if (unit == NULL)
+    {
+        /* The runs stay short below the load, and a lookup never probes the whole table.  */
+        if (udp_unit_count >= UDP_UNIT_MAX_LOAD)
+        {
+            udp_unit_evict_oldest();
+            udp_unit_find(session->mac_key, &free_entry);
+        }
+        unit = free_entry;
+        ++udp_unit_count;
+    }
+    memset(unit, 0, sizeof(*unit));
+    unit->mac_key = session->mac_key;
+    memcpy(unit->key, key, PROTOCOL_UDP_KEY_SIZE);
+    unit->session = session;
+    unit->last_seen_ns = server_clock_coarse_ns();
+    unit->x_axis = session->x_axis;
+    unit->y_axis = session->y_axis;
+    pthread_mutex_unlock(&udp_units_lock);
+    return TRUE;
+}
+
+/**
+ * @brief Forget the UDP key of a unit whose session ended.
+ *
+ * @param mac_key The MAC address of the unit, see protocol_event_mac_key.
+ */
+void udp_unit_close(uint64_t mac_key)
+{
+    struct udp_unit *unit;
+
+    pthread_mutex_lock(&udp_units_lock);
+    unit = udp_unit_find(mac_key, NULL);
+    if (unit != NULL)
+    {
+        udp_unit_remove(unit);
+    }
+    pthread_mutex_unlock(&udp_units_lock);
+}
+
+/**
+ * @brief Open the UDP socket of the ingest thread.
+ *
+ * @param port The port to bind.
+ * @return The socket, or -1 on error.
+ */
+int udp_ingest_open(uint16_t port)
+{
+    struct sockaddr_in addr;
+    struct timeval timeout = {UDP_INGEST_POLL_SECONDS, 0};
+    int receive_buffer = UDP_RECEIVE_BUFFER_SIZE;
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (fd == -1)
+    {
+        perror("udp_ingest_open: socket");
+        return -1;
+    }
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == -1)
+    {
+        perror("udp_ingest_open: SO_RCVTIMEO");
+        close(fd);
+        return -1;
+    }
+    /* Not fatal, the default buffer only drops more datagrams under load.  */
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer)) == -1)
+    {
+        perror("udp_ingest_open: SO_RCVBUF");
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = INADDR_ANY;
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+    {
+        perror("udp_ingest_open: bind");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Check a sequence number against the window of its unit, and mark it seen.
+ *
+ * @param window The window of the unit.
+ * @param seq The sequence number of the datagram.
+ * @return One of enum udp_window_result.
+ */
+uint8_t udp_window_check(struct udp_window *window, uint32_t seq)
+{
+    /* The distance in serial number arithmetic, so the counter may wrap around.  */
+    int32_t ahead = (int32_t)(seq - window->newest_seq);
+    uint32_t behind;
+
+    if (window->seen == 0 || ahead > 0)
+    {
+        if (window->seen == 0 || ahead >= UDP_WINDOW_SIZE)
+        {
+            window->seen = 1;
+        }
+        else
+        {
+            window->seen = (window->seen << ahead) | 1;
+        }
+        window->newest_seq = seq;
+        return UDP_WINDOW_NEW;
+    }
+
+    /* A unit counts from 0 again with a new key only, an old datagram sent again stays stale.  */
+    behind = (uint32_t)(-(int64_t)ahead);
+    if (behind >= UDP_WINDOW_SIZE)
+    {
+        return UDP_WINDOW_STALE;
+    }
+    if (window->seen & (1ULL << behind))
+    {
+        return UDP_WINDOW_DUPLICATE;
+    }
+    window->seen |= 1ULL << behind;
+    return UDP_WINDOW_REORDERED;
+}
+
+/**
+ * @brief Read the little-endian tag of a datagram.
+ */
+static uint64_t udp_datagram_tag(const uint8_t *datagram)
+{
+    uint64_t tag = 0;
+
+    for (int i = SIPHASH_TAG_SIZE - 1; i >= 0; --i)
+    {
+        tag = (tag << 8) | datagram[UDP_TAG_OFFSET + i];
+    }
+    return tag;
+}
+
+/**
+ * @brief Apply a batch of received datagrams to the units.
+ *
+ * @param datagrams 'count' buffers of UDP_DATAGRAM_SIZE bytes one after the other.
+ * @param lengths The received length of every datagram, more than UDP_DATAGRAM_SIZE when it was truncated.
+ * @param count Number of datagrams, UDP_BATCH at most.
+ * @param stats Pointer to the counters to add to.
+ * @return Number of datagrams applied to a unit.
+ */
+size_t udp_ingest_batch(const uint8_t *datagrams, const size_t *lengths, size_t count,
+                        struct udp_ingest_stats *stats)
+{
+    uint8_t valid[UDP_BATCH], result[UDP_BATCH];
+    uint64_t mac_key[UDP_BATCH];
+    struct pango_data *session[UDP_BATCH];
+    size_t applied = 0, connected = 0;
+    uint64_t now = server_clock_coarse_ns();
+
+    if (count > UDP_BATCH)
+    {
+        count = UDP_BATCH;
+    }
+    crc8_verify_batch(datagrams, UDP_DATAGRAM_SIZE, count, valid);
+
+    /* The datagrams are checked first, so the locks are held only to find and update the units.  */
+    for (size_t n = 0; n < count; ++n)
+    {
+        const uint8_t *datagram = datagrams + n * UDP_DATAGRAM_SIZE;
+
+        result[n] = UDP_DROPPED;
+        ++stats->received;
+        if (lengths[n] != UDP_DATAGRAM_SIZE ||
+            (datagram[0] != UDP_STATUS_POSITION && datagram[0] != UDP_STATUS_HEARTBEAT))
+        {
+            ++stats->malformed;
+            continue;
+        }
+        if (valid[n] == 0)
+        {
+            ++stats->crc_failed;
+            continue;
+        }
+        mac_key[n] = protocol_event_mac_key(datagram);
+        if (mac_key[n] == 0)
+        {
+            ++stats->malformed;
+            continue;
+        }
+        result[n] = UDP_WINDOW_NEW;
+    }
+
+    pthread_mutex_lock(&udp_units_lock);
+    for (size_t n = 0; n < count; ++n)
+    {
+        const uint8_t *datagram = datagrams + n * UDP_DATAGRAM_SIZE;
+        struct udp_unit *unit;
+        uint32_t seq;
+
+        if (result[n] == UDP_DROPPED)
+        {
+            continue;
+        }
+        result[n] = UDP_DROPPED;
+        unit = udp_unit_find(mac_key[n], NULL);
+        if (unit == NULL)
+        {
+            ++stats->no_session;
+            continue;
+        }
+        /* The tag is checked before the window, which a forged sequence number would move.  */
+        if (siphash24(unit->key, datagram, UDP_TAG_OFFSET) != udp_datagram_tag(datagram))
+        {
+            ++stats->unauthenticated;
+            continue;
+        }
+
+        seq = datagram[UDP_SEQ_OFFSET] | (uint32_t)datagram[UDP_SEQ_OFFSET + 1] << 8 |
+              (uint32_t)datagram[UDP_SEQ_OFFSET + 2] << 16 | (uint32_t)datagram[UDP_SEQ_OFFSET + 3] << 24;
+        result[n] = udp_window_check(&unit->window, seq);
+        if (result[n] == UDP_WINDOW_DUPLICATE)
+        {
+            ++stats->duplicate;
+            result[n] = UDP_DROPPED;
+            continue;
+        }
+        if (result[n] == UDP_WINDOW_STALE)
+        {
+            ++stats->stale;
+            result[n] = UDP_DROPPED;
+            continue;
+        }
+        if (result[n] == UDP_WINDOW_REORDERED)
+        {
+            ++stats->reordered;
+        }
+
+        unit->last_seen_ns = now;
+        /* A late position is older than the one the unit has.  */
+        if (result[n] == UDP_WINDOW_NEW && datagram[0] == UDP_STATUS_POSITION)
+        {
+            unit->x_axis = datagram[7];
+            unit->y_axis = datagram[8];
+        }
+        session[n] = unit->session;
+        connected += (session[n] != NULL);
+        ++applied;
+    }
+    pthread_mutex_unlock(&udp_units_lock);
+
+    /* The slot may have been taken by another unit since the key was issued, or lost its connection.  */
+    if (connected != 0)
+    {
+        pthread_mutex_lock(&mutex);
+        for (size_t n = 0; n < count; ++n)
+        {
+            const uint8_t *datagram = datagrams + n * UDP_DATAGRAM_SIZE;
+
+            if (result[n] == UDP_DROPPED || session[n] == NULL || session[n]->connected != TRUE ||
+                session[n]->mac_key != mac_key[n])
+            {
+                continue;
+            }
+            __atomic_store_n(&session[n]->last_seen_ns, now, __ATOMIC_RELAXED);
+            if (result[n] == UDP_WINDOW_NEW && datagram[0] == UDP_STATUS_POSITION)
+            {
+                session[n]->x_axis = datagram[7];
+                session[n]->y_axis = datagram[8];
+            }
+        }
+        pthread_mutex_unlock(&mutex);
+    }
+
+    stats->applied += applied;
+    return applied;
+}
+
+/**
+ * @brief UDP telemetry ingest thread function.
+ *
+ * Runs until 'return_thread' is set.
+ *
+ * @param arg Unused, the units are found by their UDP keys.
+ * @return None.
+ */
+void *udp_ingest(void *arg)
+{
+    uint8_t datagrams[UDP_BATCH][UDP_DATAGRAM_SIZE];
+    struct mmsghdr messages[UDP_BATCH];
+    struct iovec iovecs[UDP_BATCH];
+    size_t lengths[UDP_BATCH];
+    struct udp_ingest_stats stats;
+    int fd = udp_ingest_open(UDP_INGEST_PORT);
+
+    (void)arg;
+    if (fd == -1)
+    {
+        pthread_exit(NULL);
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    memset(messages, 0, sizeof(messages));
+    for (int i = 0; i < UDP_BATCH; ++i)
+    {
+        iovecs[i].iov_base = datagrams[i];
+        iovecs[i].iov_len = UDP_DATAGRAM_SIZE;
+        messages[i].msg_hdr.msg_iov = &iovecs[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    while (return_thread != TRUE)
+    {
+        /* Blocks for the first datagram only, then takes whatever else is queued.  */
+        int received = recvmmsg(fd, messages, UDP_BATCH, MSG_WAITFORONE, NULL);
+
+        if (received == -1)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            {
+                continue;
+            }
+            perror("udp_ingest: recvmmsg");
+            break;
+        }
+        for (int i = 0; i < received; ++i)
+        {
+            lengths[i] = (messages[i].msg_hdr.msg_flags & MSG_TRUNC) ? UDP_DATAGRAM_SIZE + 1 : messages[i].msg_len;
+        }
+        udp_ingest_batch(&datagrams[0][0], lengths, received, &stats);
+    }
+
+    printf("UDP ingest: %zu datagrams, %zu applied, %zu duplicate, %zu stale, %zu reordered, "
+           "%zu without a key, %zu with a wrong tag, %zu failed the CRC-8, %zu malformed\n",
+           stats.received, stats.applied, stats.duplicate, stats.stale, stats.reordered,
+           stats.no_session, stats.unauthenticated, stats.crc_failed, stats.malformed);
+    close(fd);
+    printf("Out of UDP ingest thread\n");
+    pthread_exit(NULL);
+}
@@ -0,0 +1,204 @@
+/**
+ * @file 	udp_ingest.h
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-18
+ * @brief 	Header file containing declarations for the UDP telemetry ingest thread.
+ *
+ * Units send their periodic positions and liveness pings as datagrams on
+ * UDP_INGEST_PORT, instead of holding a TCP connection for them:
+ *	 __________________________________________________
+ *	| status | MAC | x_axis | y_axis | seq | tag | crc8 |
+ *	|   1    |  6  |   1    |   1    |  4  |  8  |  1   |
+ *	|________|_____|________|________|_____|_____|______|
+ * the 9 byte payload of an event, a little-endian sequence number the unit
+ * counts per datagram, the SipHash-2-4 of the first 13 bytes under the UDP key
+ * of the unit, little-endian, and a CRC-8 over the first 21 bytes.
+ * The datagrams are received in batches with recvmmsg and update the units
+ * in memory only.
+ *
+ * The server issues a new random key to a unit in the reply to the start of
+ * its session, see PROTOCOL_FLAG_UDP_KEY, and forgets it when the session ends.
+ * Only a datagram tagged with the key of its MAC is applied, so knowing the MAC
+ * of a parked unit isn't enough to move it or keep it alive, and the datagrams
+ * of a unit are taken from any address, whether its TCP connection is still
+ * open or not. The keys are kept in a table of UDP_UNIT_TABLE_SIZE units, found
+ * by the MAC in a few probes. A unit whose session has a connection is updated
+ * in its client slot too.
+ *
+ * A unit is removed from the table when its session ends. One whose session
+ * ended without a stop the server saw stays until the table reaches
+ * UDP_UNIT_MAX_LOAD, then the unit silent for the longest makes room for the
+ * next start. A datagram of a unit that isn't in the table is dropped.
+ *
+ * Every unit has a window of the last UDP_WINDOW_SIZE sequence numbers:
+ * a datagram seen already is dropped, one older than the window is dropped,
+ * and one that comes late inside the window counts as a sign of life but
+ * doesn't move the position back. The window starts again with every key,
+ * so a unit counts from 0 in every session.
+ */
+#ifndef UDP_INGEST_H
+#define UDP_INGEST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/random.h>
+#include <netinet/in.h>
+#include "../protocol/protocol.h"
+#include "../clock/server_clock.h"
+#include "../../common/crc8/crc8.h"
+#include "../../common/siphash/siphash.h"
+
+#define UDP_INGEST_PORT 55152
+#define UDP_PAYLOAD_SIZE 9
+#define UDP_SEQ_OFFSET UDP_PAYLOAD_SIZE
+#define UDP_TAG_OFFSET (UDP_SEQ_OFFSET + 4)
+#define UDP_DATAGRAM_SIZE (UDP_TAG_OFFSET + SIPHASH_TAG_SIZE + 1)
+/* Datagrams received by one recvmmsg call at most.  */
+#define UDP_BATCH 64
+/* Sequence numbers of a unit a datagram may be behind the newest one, the bits of 'seen'.  */
+#define UDP_WINDOW_SIZE 64
+/* Units with a UDP key, a power of two above the fleet size.  */
+#define UDP_UNIT_TABLE_SIZE 4096
+/* Units kept at most, the rest of the table keeps the probes short.  */
+#define UDP_UNIT_MAX_LOAD (UDP_UNIT_TABLE_SIZE / 4 * 3)
+/* Seconds recvmmsg waits before 'return_thread' is checked again.  */
+#define UDP_INGEST_POLL_SECONDS 1
+
+#ifndef UDP_STATUS
+#define UDP_STATUS
+enum udp_status
+{
+	UDP_STATUS_POSITION = 5,  /*The position of a parked unit*/
+	UDP_STATUS_HEARTBEAT = 6, /*A liveness ping, the position is ignored*/
+};
+#endif /*UDP_STATUS*/
+
+#ifndef UDP_WINDOW_RESULT
+#define UDP_WINDOW_RESULT
+enum udp_window_result
+{
+	UDP_WINDOW_NEW = 0,		  /*Newer than every datagram of the unit so far*/
+	UDP_WINDOW_REORDERED = 1, /*Late, but inside the window and not seen yet*/
+	UDP_WINDOW_DUPLICATE = 2,
+	UDP_WINDOW_STALE = 3, /*Older than the window*/
+};
+#endif /*UDP_WINDOW_RESULT*/
+
+struct pango_data;
+
+/**
+ * @brief The sequence numbers received lately from one unit.
+ */
+struct udp_window
+{
+	uint32_t newest_seq;
+	uint64_t seen;		  /*Bit n is set when newest_seq - n was received, 0 before the first datagram*/
+};
+
+/**
+ * @brief A unit that was issued a UDP key.
+ */
+struct udp_unit
+{
+	uint64_t mac_key;	  /*0 when the entry is free*/
+	uint8_t key[PROTOCOL_UDP_KEY_SIZE];
+	struct udp_window window;
+	struct pango_data *session; /*The client slot the session started on, checked before it is used*/
+	uint64_t last_seen_ns;	  /*Coarse monotonic time of the last datagram, or of the start*/
+	uint8_t x_axis;
+	uint8_t y_axis;
+};
+
+/**
+ * @brief Counters of the ingest thread.
+ */
+struct udp_ingest_stats
+{
+	size_t received;
+	size_t malformed; /*Datagrams of the wrong size or status*/
+	size_t crc_failed;
+	size_t duplicate;
+	size_t stale;
+	size_t reordered;
+	size_t no_session; /*The MAC has no UDP key, its session didn't ask for one or has ended*/
+	size_t unauthenticated; /*The tag doesn't match the UDP key of the MAC*/
+	size_t applied;
+};
+
+extern volatile uint8_t return_thread;
+
+/**
+ * @brief Open the UDP socket of the ingest thread.
+ *
+ * @param port The port to bind.
+ * @return The socket, or -1 on error.
+ */
+int udp_ingest_open(uint16_t port);
+
+/**
+ * @brief Check a sequence number against the window of its unit, and mark it seen.
+ *
+ * @param window The window of the unit.
+ * @param seq The sequence number of the datagram.
+ * @return One of enum udp_window_result.
+ */
+uint8_t udp_window_check(struct udp_window *window, uint32_t seq);
+
+/**
+ * @brief Issue a new UDP key to the unit of a session that started.
+ *
+ * The key of an earlier session of the unit stops being valid.
+ * Is called by the connection thread before the start is answered.
+ * With the table at UDP_UNIT_MAX_LOAD the unit silent for the longest is forgotten.
+ *
+ * @param session The client slot of the session, its mac_key set.
+ * @param key Buffer for the PROTOCOL_UDP_KEY_SIZE bytes of the key (output parameter).
+ * @return TRUE on success, FALSE if no random key could be made.
+ */
+uint8_t udp_unit_open(struct pango_data *session, uint8_t *key);
+
+/**
+ * @brief Forget the UDP key of a unit whose session ended.
+ *
+ * @param mac_key The MAC address of the unit, see protocol_event_mac_key.
+ */
+void udp_unit_close(uint64_t mac_key);
+
+/**
+ * @brief Open the UDP socket of the ingest thread.
+ *
+ * @param port The port to bind.
+ * @return The socket, or -1 on error.
+ */
+int udp_ingest_open(uint16_t port);
+
+/**
+ * @brief Apply a batch of received datagrams to the units.
+ *
+ * @param datagrams 'count' buffers of UDP_DATAGRAM_SIZE bytes one after the other.
+ * @param lengths The received length of every datagram, more than UDP_DATAGRAM_SIZE when it was truncated.
+ * @param count Number of datagrams, UDP_BATCH at most.
+ * @param stats Pointer to the counters to add to.
+ * @return Number of datagrams applied to a unit.
+ */
+size_t udp_ingest_batch(const uint8_t *datagrams, const size_t *lengths, size_t count,
+						struct udp_ingest_stats *stats);
+
+/**
+ * @brief UDP telemetry ingest thread function.
+ *
+ * Runs until 'return_thread' is set.
+ *
+ * @param arg Unused, the units are found by their UDP keys.
+ * @return None.
+ */
+void *udp_ingest(void *arg);
+
+#endif /*UDP_INGEST_H*/
@@ -0,0 +1,83 @@
+/**
+ * @file    zone_index.c
+ * @author  Vlad Kulikov
+ * @date    2026-10-18
+ * @brief   Implementation of the interned city/zone index.
+ */
+#include "zone_index.h"
+
+/* The names are stored in a fixed size, null padded form
+   which is the same form the BBB expects to receive.  */
+static const char zone_names[ZONE_COUNT][ZONE_NAME_SIZE] =
+{
+    [ZONE_INVALID] = "ERROR",
+    [ZONE_ASHKELON] = "Ashkelon",
+    [ZONE_JERUSALEM] = "Jerusalem",
+    [ZONE_PETAH_TIKVA] = "Petah-Tikva",
+    [ZONE_HERZLIYA] = "Herzliya",
+};
+
+/**
+ * @brief Determine the zone id based on coordinates.
+ *
+ * This function determines the zone based on the given x and y coordinates.
+ * If the coordinates are out of range, ZONE_INVALID is returned.
+ *
+ * @param x X-coordinate (0-127).
+ * @param y Y-coordinate (0-127).
+ * @return The zone id.
+ */
+uint16_t zone_id_from_coordinates(uint8_t x, uint8_t y)
+{
+    if (x > ZONE_MAX_COORDINATE || y > ZONE_MAX_COORDINATE)
+    {
+        return ZONE_INVALID;
+    }
+    if (x <= ZONE_BORDER_COORDINATE)
+    {
+        return (y <= ZONE_BORDER_COORDINATE) ? ZONE_ASHKELON : ZONE_JERUSALEM;
+    }
+    return (y <= ZONE_BORDER_COORDINATE) ? ZONE_PETAH_TIKVA : ZONE_HERZLIYA;
+}
+
+/**
+ * @brief Translate a zone name to its id.
+ *
+ * Is used only at the edges, when a name arrives from a text source (old database rows).
+ *
+ * @param name Null terminated zone name.
+ * @return The zone id, ZONE_INVALID if the name is unknown.
+ */
+uint16_t zone_id_from_name(const char *name)
+{
+    if (name == NULL)
+    {
+        return ZONE_INVALID;
+    }
+    for (uint16_t i = ZONE_INVALID + 1; i < ZONE_COUNT; ++i)
+    {
+        if (strncmp(name, zone_names[i], ZONE_NAME_SIZE) == 0)
+        {
+            return i;
+        }
+    }
+    return ZONE_INVALID;
+}
+
+/**
+ * @brief Translate a zone id to its name.
+ *
+ * The returned buffer is always ZONE_NAME_SIZE bytes long and null padded,
+ * so it can be sent to the BBB as is.
+ *
+ * @param zone_id The zone id.
+ * @return Pointer to the zone name, "ERROR" for unknown ids.
+ */
+const char *zone_name(uint16_t zone_id)
+{
+    if (zone_id >= ZONE_COUNT)
+    {
+        return zone_names[ZONE_INVALID];
+    }
+    return zone_names[zone_id];
+}
@@ -0,0 +1,70 @@
+/**
+ * @file 	zone_index.h
+ * @author 	Vlad Kulikov
+ * @date 	2026-10-18
+ * @brief 	Header file containing declarations for the interned city/zone index.
+ *
+ * Every city (zone) the server knows about is represented by a small integer id.
+ * The id is what is kept in the session struct, the databases and the price cache,
+ * the zone name is only produced at the edges (logs and the reply to the BBB).
+ */
+#ifndef ZONE_INDEX_H
+#define ZONE_INDEX_H
+
+#include <stdint.h>
+#include <string.h>
+
+/* Size of the zone name as it is sent to the BBB.  */
+#define ZONE_NAME_SIZE 12
+/* The highest coordinate value the STM is able to send.  */
+#define ZONE_MAX_COORDINATE 127
+/* The border between the zones on both axes.  */
+#define ZONE_BORDER_COORDINATE 70
+
+#ifndef ZONE_ID
+#define ZONE_ID
+enum zone_id
+{
+	ZONE_INVALID = 0, /*Coordinates that are out of range, is sent to the BBB as "ERROR"*/
+	ZONE_ASHKELON = 1,
+	ZONE_JERUSALEM = 2,
+	ZONE_PETAH_TIKVA = 3,
+	ZONE_HERZLIYA = 4,
+	ZONE_COUNT /*Number of zone ids, must stay the last value*/
+};
+#endif /*ZONE_ID*/
+
+/**
+ * @brief Determine the zone id based on coordinates.
+ *
+ * This function determines the zone based on the given x and y coordinates.
+ * If the coordinates are out of range, ZONE_INVALID is returned.
+ *
+ * @param x X-coordinate (0-127).
+ * @param y Y-coordinate (0-127).
+ * @return The zone id.
+ */
+uint16_t zone_id_from_coordinates(uint8_t x, uint8_t y);
+
+/**
+ * @brief Translate a zone name to its id.
+ *
+ * Is used only at the edges, when a name arrives from a text source (old database rows).
+ *
+ * @param name Null terminated zone name.
+ * @return The zone id, ZONE_INVALID if the name is unknown.
+ */
+uint16_t zone_id_from_name(const char *name);
+
+/**
+ * @brief Translate a zone id to its name.
+ *
+ * The returned buffer is always ZONE_NAME_SIZE bytes long and null padded,
+ * so it can be sent to the BBB as is.
+ *
+ * @param zone_id The zone id.
+ * @return Pointer to the zone name, "ERROR" for unknown ids.
+ */
+const char *zone_name(uint16_t zone_id);
+
+#endif /*ZONE_INDEX_H*/